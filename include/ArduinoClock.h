@@ -0,0 +1,15 @@
+#ifndef ARDUINO_CLOCK_H
+#define ARDUINO_CLOCK_H
+
+#include <Arduino.h>
+#include "IClock.h"
+
+// IClock backed by the Arduino core timers
+class ArduinoClock : public IClock {
+public:
+    uint32_t nowMs() const override { return millis(); }
+    uint32_t nowUs() const override { return micros(); }
+    void sleepMs(uint32_t ms) override { delay(ms); }
+};
+
+#endif
@@ -4,20 +4,14 @@
 #include <NimBLEServer.h>
 #include <NimBLEUtils.h>
 #include "Scale.h"
+#include "ScalePayload.h"
+#include "ScaleCodecs.h"
+#include "NotificationScheduler.h"
+#include "ControlCommands.h"
 
 class Display; // Forward declaration
-
-enum class WeighMyBruMessageType : uint8_t {
-  SYSTEM = 0x0A,
-  WEIGHT = 0x0B
-};
-
-enum class BeanConquerorCommand : uint8_t {
-  TARE = 0x01,
-  TIMER_START = 0x02,
-  TIMER_STOP = 0x03,
-  TIMER_RESET = 0x04
-};
+class JsonWriter; // Forward declaration
+class SamplingTask; // Forward declaration
 
 class BluetoothScale : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks {
 public:
@@ -28,61 +22,173 @@ public:
     void begin();  // Initialize without scale reference
     void setScale(Scale* scale);  // Set scale reference later
     void setDisplay(Display* display); // Set display reference for timer control
+    void setSamplingTask(SamplingTask* samplingTask); // Read weight from published snapshots
+    void setCommandQueue(ControlCommands* commands); // Incoming commands run from loop(), not the BLE callback
     void end();
     void update();
     bool isConnected();
+    uint8_t getClientCount() const { return clientCount; }
     void sendWeight(float weight);
-    void handleTareCommand();
-    void handleTimerCommand(BeanConquerorCommand command);
+    bool handleTareCommand(); // Executed by ControlCommands on the loop() task
+    bool handleTimerCommand(BeanConquerorCommand command);
     int getBluetoothSignalStrength(); // Get BLE signal strength (RSSI)
-    String getBluetoothConnectionInfo(); // Get detailed BLE connection information
+    void writeConnectionInfo(JsonWriter& json); // Detailed BLE connection information as JSON fields
+    void writeConnections(JsonWriter& json);    // "connections" array, one entry per attached client
+    
+    // Change-driven weight notifications, one channel (and policy) per codec in
+    // ScaleCodecs, indexed the same way
+    typedef uint8_t WeightChannel;
+    static const uint8_t CHANNEL_COUNT = ScaleCodecs::COUNT;
+    void setNotificationPolicy(WeightChannel channel, const NotificationPolicy& policy);
+    NotificationPolicy getNotificationPolicy(WeightChannel channel);
+    void getNotificationCounts(WeightChannel channel, uint32_t& sent, uint32_t& suppressed); // All clients since boot
+    static const char* getChannelName(WeightChannel channel);
+    
+    // Codecs (bit per ScaleCodecs index) - chosen at runtime, stored in NVS and
+    // applied when BLE starts, since clients cache the GATT layout
+    bool isChannelEnabled(WeightChannel channel) const { return (enabledCodecs & (1 << channel)) != 0; }
+    uint8_t getEnabledCodecs() const { return enabledCodecs; }
+    uint8_t getStoredCodecs();
+    bool setStoredCodecs(uint8_t mask); // False if no known codec is selected
     
-    // BLE Server callbacks
-    void onConnect(NimBLEServer* pServer) override;
-    void onDisconnect(NimBLEServer* pServer) override;
+    // Opt-in batched characteristic: every sample with sequence and timestamp
+    uint32_t getBatchFramesSent() const { return batchFramesSent; }
+    uint32_t getBatchSamplesSent() const { return batchSamplesSent; }
+    static const uint32_t BATCH_INTERVAL_MS = 100; // Longest a sample waits for its frame
     
-    // BLE Characteristic callbacks
+    // Centrals attached at once (e.g. GaggiMate and a phone running Bean Conqueror)
+    static const uint8_t MAX_CLIENTS = CONFIG_BT_NIMBLE_MAX_CONNECTIONS;
+    
+    // BLE Server callbacks (NimBLE host task)
+    void onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) override;
+    void onDisconnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) override;
+    void onMTUChange(uint16_t mtu, ble_gap_conn_desc* desc) override;
+    
+    // BLE Characteristic callbacks (NimBLE host task)
     void onWrite(NimBLECharacteristic* pCharacteristic) override;
+    void onSubscribe(NimBLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc, uint16_t subValue) override;
 
 private:
     Scale* scale;
     Display* display; // Reference to display for timer control
+    SamplingTask* samplingTask; // Source of published weight snapshots
+    ControlCommands* commands; // Written commands are queued here
     NimBLEServer* server;
-    NimBLEService* service;
-    NimBLECharacteristic* weightCharacteristic;          // Bean Conqueror (simple float)
-    NimBLECharacteristic* gaggiMateWeightCharacteristic; // GaggiMate (WeighMyBru protocol)
-    NimBLECharacteristic* commandCharacteristic;
+    NimBLEService* service;                              // WeighMyBru service
+    NimBLEService* services[CHANNEL_COUNT + 1];          // Every service created, WeighMyBru first
+    uint8_t serviceCount;
+    NimBLECharacteristic* weightCharacteristics[CHANNEL_COUNT];  // nullptr while the codec is disabled
+    NimBLECharacteristic* commandCharacteristics[CHANNEL_COUNT]; // May be shared between codecs
+    NimBLECharacteristic* commandCharacteristic;         // WeighMyBru command (confirmations, heartbeat)
+    NimBLECharacteristic* batchCharacteristic;           // Extended (batched samples with timestamps)
     NimBLEAdvertising* advertising;
     
-    bool deviceConnected;
-    bool oldDeviceConnected;
+    // Connection parameters asked of each central. FAST while a shot is in
+    // progress (timer running, weight flowing or a BLE tare/timer command), IDLE
+    // after SHOT_HOLD_MS without one; the central has the final say, so the
+    // negotiated values are read back and reported separately.
+    enum LinkProfile : uint8_t {
+        LINK_DEFAULT, // Whatever the central chose at connect
+        LINK_FAST,
+        LINK_IDLE
+    };
+    
+    // One attached central. Slots are claimed and released by the host task
+    // callbacks; update() offers weights through each client's own schedulers,
+    // so a slow Bean Conqueror policy never throttles GaggiMate.
+    struct Peer {
+        bool inUse;
+        bool greeted;              // Notification request sent by update()
+        uint16_t connHandle;
+        uint8_t subscriptions;     // Bit per WeightChannel, plus SUBSCRIBED_COMMAND/_BATCH
+        uint8_t indicateOnly;      // Channels the client enabled indications (not notifications) on
+        uint16_t mtu;
+        uint16_t intervalUnits;    // Connection interval, 1.25 ms units
+        uint16_t latency;          // Peripheral latency, connection events
+        uint16_t supervisionTimeout; // 10 ms units
+        LinkProfile linkProfile;   // Last profile requested
+        bool phyRequested;         // 2M PHY asked for on this connection
+        uint8_t txPhy;             // BLE_GAP_LE_PHY_1M / _2M / _CODED, 0 = unknown
+        uint8_t rxPhy;
+        uint32_t connectedMs;
+        uint32_t notificationsSent;
+        uint32_t bytesSent;
+        uint32_t notifyFailures;
+        uint32_t rateBytes;        // bytesSent at the last throughput sample
+        uint32_t rateMs;
+        uint32_t bytesPerSecond;
+        NotificationScheduler schedulers[CHANNEL_COUNT];
+        
+        Peer();
+    };
+    
+    static const uint8_t SUBSCRIBED_COMMAND = 1 << CHANNEL_COUNT;
+    static const uint8_t SUBSCRIBED_BATCH = 1 << (CHANNEL_COUNT + 1);
+    static const size_t MAX_BATCH_SAMPLES = 16;          // Flushed early when full
+    static const size_t MAX_BATCH_FRAME = 244;           // 247-byte MTU less the ATT header
+    static const uint16_t DEFAULT_ATT_MTU = 23;
+    static const uint32_t PEER_REFRESH_INTERVAL = 1000; // Connection parameters and throughput
+    static const uint32_t SHOT_HOLD_MS = 15000;         // Stay FAST this long after the last shot activity
+    static const uint32_t CONNECT_SETTLE_MS = 5000;     // Let service discovery finish before asking for IDLE
+    // Intervals in 1.25 ms units, supervision timeout in 10 ms units
+    static const uint16_t FAST_INTERVAL_MIN = 6;        // 7.5 ms
+    static const uint16_t FAST_INTERVAL_MAX = 12;       // 15 ms
+    static const uint16_t FAST_LATENCY = 0;
+    static const uint16_t FAST_TIMEOUT = 400;           // 4 s
+    static const uint16_t IDLE_INTERVAL_MIN = 80;       // 100 ms
+    static const uint16_t IDLE_INTERVAL_MAX = 160;      // 200 ms
+    static const uint16_t IDLE_LATENCY = 4;             // Skip up to 4 events while nothing is queued
+    static const uint16_t IDLE_TIMEOUT = 600;           // 6 s, > 2 x (1 + latency) x max interval
+    
+    Peer peers[MAX_CLIENTS];    // Guarded by peerLock
+    portMUX_TYPE peerLock;
+    volatile uint8_t clientCount;
+    uint8_t enabledCodecs;      // Codecs with characteristics since begin()
+    const char* advertisedName; // Chosen in begin() - a codec's name or DEFAULT_DEVICE_NAME
+    NotificationPolicy channelPolicies[CHANNEL_COUNT]; // Applied to every client's scheduler
+    uint32_t closedSent[CHANNEL_COUNT];       // Counters of clients that have disconnected
+    uint32_t closedSuppressed[CHANNEL_COUNT];
     uint32_t lastHeartbeat;
-    uint32_t lastWeightSent;
-    float lastWeight;
+    uint32_t lastPeerRefresh;
+    uint32_t lastOfferedSequence; // Snapshot already offered to the schedulers
+    uint32_t lastShotActivity;    // millis() of the last sign of a shot, 0 = none yet
+    BatchSample pendingBatch[MAX_BATCH_SAMPLES]; // Samples not yet sent on the batched characteristic
+    size_t pendingBatchCount;
+    uint32_t pendingBatchSinceMs;
+    float batchFlowRate;          // Flow and tare state of the newest pending sample
+    bool batchTaring;
+    uint32_t batchFramesSent;
+    uint32_t batchSamplesSent;
     int8_t connectionRSSI; // Store RSSI value for connected device
-    uint16_t connectionHandle; // Store connection handle for RSSI queries
+    bool tareConfirmPending;   // Tare requested over BLE, confirmation sent on completion
+    uint32_t tareCountAtRequest;
     
-    // WeighMyBru protocol constants
-    static const uint8_t PRODUCT_NUMBER = 0x03;
-    static const size_t PROTOCOL_LENGTH = 20;
     static const uint32_t HEARTBEAT_INTERVAL = 2000; // 2 seconds
-    static const uint32_t WEIGHT_SEND_INTERVAL = 50; // 50ms (20 updates/sec) - faster for GaggiMate
+    static const uint32_t FALLBACK_POLL_INTERVAL = 50; // Offer rate without a sampling task
+    static const char* DEFAULT_DEVICE_NAME;               // Advertised unless a codec needs its own
     
-    // WeighMyBru UUIDs - unique to avoid conflicts with Bookoo scales
-    static const char* SERVICE_UUID;
-    static const char* WEIGHT_CHARACTERISTIC_UUID;        // Bean Conqueror (simple float)
-    static const char* GAGGIMATE_CHARACTERISTIC_UUID;     // GaggiMate (WeighMyBru protocol)
-    static const char* COMMAND_CHARACTERISTIC_UUID;
+    // In the WeighMyBru service (WeighMyBruUuids), whichever codecs are enabled
+    static const char* BATCH_CHARACTERISTIC_UUID;         // Batched samples (opt-in)
     
     void initializeBLE();
+    NimBLEService* getOrCreateService(const char* uuid);
+    NimBLECharacteristic* getOrCreateCharacteristic(NimBLEService* owner, const char* uuid, uint32_t properties);
     void startAdvertising();
     void stopAdvertising();
     void sendMessage(WeighMyBruMessageType msgType, const uint8_t* payload, size_t length);
     void sendHeartbeat();
     void sendNotificationRequest();
-    void processIncomingMessage(uint8_t* data, size_t length);
+    void sendTareConfirmation();
+    void processIncomingMessage(NimBLECharacteristic* characteristic, const uint8_t* data, size_t length);
+    void queueCommand(ControlCommands::Type type);
     uint8_t calculateChecksum(const uint8_t* data, size_t length);
-    void sendWeightNotification(float weight);
-    void sendBeanConquerorWeight(float weight);    // Send simple float format
-    void sendGaggiMateWeight(float weight);        // Send WeighMyBru protocol format
+    bool collectBatchSamples(uint32_t now); // True when a batch is due
+    void sendBatch(uint8_t slot, uint16_t connHandle, uint16_t mtu, bool indicate);
+    bool notifyPeer(uint8_t slot, uint16_t connHandle, NimBLECharacteristic* characteristic,
+                    const uint8_t* payload, size_t length, bool indicate);
+    void refreshPeer(uint8_t slot, uint16_t connHandle, uint32_t now);
+    void requestLinkProfile(uint8_t slot, uint16_t connHandle, LinkProfile profile);
+    static const char* getLinkProfileName(LinkProfile profile);
+    static const char* getPhyName(uint8_t phy);
+    int findPeer(uint16_t connHandle) const; // Slot index, -1 if unknown - call with peerLock held
 };
@@ -0,0 +1,96 @@
+#ifndef BOOT_SEQUENCER_H
+#define BOOT_SEQUENCER_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <freertos/event_groups.h>
+
+class Scale; // Forward declaration
+class SamplingTask; // Forward declaration
+
+// Brings subsystems up concurrently instead of one after another with fixed sleeps.
+// Stages that only touch their own peripheral (HX711, OLED on I2C) run in short-lived
+// tasks while setup() brings up the radios; setup() then waits on each stage's
+// readiness bit. Every stage is timed and printed with printReport().
+//
+// Fast wake: enterDeepSleep() calls prepareForSleep(), which keeps the tare offset
+// and the WiFi channel/BSSID in RTC memory. On wake from deep sleep the initial
+// tare and the WiFi channel scan are skipped.
+class BootSequencer {
+public:
+    enum Stage : uint8_t {
+        STAGE_BLE,
+        STAGE_WIFI,
+        STAGE_SCALE,
+        STAGE_DISPLAY,
+        STAGE_WEB,
+        STAGE_COUNT
+    };
+
+    typedef bool (*StageFunction)(); // Returns false if the subsystem failed to come up
+
+    BootSequencer(Scale& scale, SamplingTask& samplingTask);
+    void begin(); // First thing in setup() - reads the wake cause and RTC state
+
+    bool run(Stage stage, StageFunction function);   // On the calling task
+    void start(Stage stage, StageFunction function); // In its own task, returns at once
+    bool waitFor(Stage stage, uint32_t timeoutMs);   // Stage result, false on timeout
+
+    void update(); // Call from loop() - logs time to first weight and WiFi link once
+    void printReport() const;
+    void prepareForSleep(); // Keep tare offset and WiFi channel/BSSID for the next wake
+
+    bool isFastWake() const { return fastWake; }
+    esp_sleep_wakeup_cause_t getWakeCause() const { return wakeCause; }
+    bool getTareOffset(int32_t& offset) const;     // Tare from before deep sleep
+    uint8_t getWiFiChannel() const;                // 0 = unknown, scan
+    const uint8_t* getWiFiBssid() const;           // nullptr = unknown
+
+private:
+    // Survives deep sleep in RTC slow memory
+    struct RtcState {
+        uint32_t magic;
+        int32_t tareOffset;
+        bool tareValid;
+        uint8_t wifiChannel;
+        uint8_t wifiBssid[6];
+    };
+
+    struct Job {
+        BootSequencer* sequencer;
+        Stage stage;
+        StageFunction function;
+    };
+
+    struct Timing {
+        int64_t startUs;
+        int64_t endUs; // 0 while running
+        bool ok;
+    };
+
+    static const uint32_t RTC_MAGIC = 0x57424231; // "WBB1"
+    static const uint32_t TASK_STACK_SIZE = 4096;
+    static const UBaseType_t TASK_PRIORITY = 2;   // Above setup()/loop() so probes run while the radios start
+    static const BaseType_t TASK_CORE = 1;        // Peripheral interrupts (HX711 DOUT, I2C) stay on the app core
+
+    static RtcState rtcState;
+
+    Scale& scale;
+    SamplingTask& samplingTask;
+    EventGroupHandle_t readyEvents;
+    esp_sleep_wakeup_cause_t wakeCause;
+    bool fastWake;
+    RtcState restored;
+    Job jobs[STAGE_COUNT];
+    Timing timings[STAGE_COUNT];
+    int64_t firstWeightUs;
+    int64_t wifiLinkUs;
+
+    static void taskEntry(void* arg);
+    static const char* stageName(Stage stage);
+    static const char* wakeCauseName(esp_sleep_wakeup_cause_t cause);
+    void beginStage(Stage stage);
+    void finishStage(Stage stage, bool ok);
+};
+
+#endif
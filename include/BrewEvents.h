@@ -0,0 +1,62 @@
+#ifndef BREW_EVENTS_H
+#define BREW_EVENTS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+class SamplingTask; // Forward declaration
+class Display; // Forward declaration
+
+// Server-Sent Events stream of brewing telemetry on /api/brew/events, for
+// controllers that cannot use the /ws WebSocket. One long-lived response
+// replaces polling /api/brew/status or /api/brew/weight.
+//
+//   event: w      data: 45.2                           id: <sample sequence>
+//   event: f      data: 2.1                            id: <sample sequence>
+//   event: timer  data: {"ms":27340,"running":true}    on start/stop and once a second while running
+//
+// Samples are sent at most once per interval (default 50 ms, 0 = every sample;
+// POST /api/brew/events/config intervalMs=...). A client reconnecting with
+// Last-Event-ID first gets the samples it missed that are still in the history.
+class BrewEvents {
+public:
+    BrewEvents(SamplingTask& samplingTask, Display& display);
+    void begin(AsyncWebServer& server); // Register the endpoints
+    void update(); // Call from loop() - sends the newest sample
+    void setMaxRate(uint16_t intervalMs);
+    uint16_t getMaxRate() const { return intervalMs; }
+    size_t getClientCount() { return events.count(); }
+
+private:
+    struct HistoryEntry {
+        uint32_t sequence;
+        float weight;
+        float flowRate;
+    };
+
+    static const size_t HISTORY_SIZE = 64; // ~3 s at the default rate
+    static const uint16_t MAX_INTERVAL_MS = 1000;
+    static const uint32_t TIMER_INTERVAL_MS = 1000;
+    static const size_t MAX_PACKETS_WAITING = 8; // Skip a sample rather than queue behind a slow client
+
+    AsyncEventSource events;
+    SamplingTask& samplingTask;
+    Display& display;
+
+    HistoryEntry history[HISTORY_SIZE]; // Written from loop(), replayed from the async_tcp task
+    size_t historyHead; // Next slot to write
+    size_t historyCount;
+    portMUX_TYPE historyLock;
+
+    uint16_t intervalMs;
+    uint32_t lastSequence;
+    uint32_t lastSampleMs;
+    uint32_t lastTimerMs;
+    bool lastTimerRunning;
+
+    void onConnect(AsyncEventSourceClient* client);
+    void sendSample(AsyncEventSourceClient* client, const HistoryEntry& entry);
+    void sendTimer(unsigned long elapsedMs, bool running);
+};
+
+#endif
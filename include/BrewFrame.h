@@ -0,0 +1,75 @@
+#ifndef BREW_FRAME_H
+#define BREW_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "WeightSnapshot.h"
+
+// Fixed 24-byte binary brew sample for machine consumers (GET /api/brew/frame,
+// and /ws binary frames for clients that send {"format":"binary"}).
+// Little-endian, naturally aligned, so a reader can memcpy it into the same
+// struct or read fields at fixed offsets - full resolution, no text parsing.
+//
+//   offset  size  field
+//   0       u8    version        BREW_FRAME_VERSION; a reader should reject other values
+//   1       u8    filterState    Scale::FilterState (0 stable, 1 brewing, 2 transitioning)
+//   2       u8    flags          bit 0 timer running, bit 1 tare in progress
+//   3       u8    reserved       0
+//   4       u32   sequence       Sample sequence, +1 per published sample
+//   8       u32   timestampUs    Capture time of the sample (device clock, wraps ~71 min)
+//   12      i32   weight         0.01 g
+//   16      i32   flowRate       0.01 g/s
+//   20      u32   timerMs        Brew timer elapsed
+//
+// Layout details and a parsing example: docs/Brew_Frame_Protocol.md
+
+static const uint8_t BREW_FRAME_VERSION = 1;
+static const uint8_t BREW_FRAME_TIMER_RUNNING = 0x01;
+static const uint8_t BREW_FRAME_TARING = 0x02;
+
+struct BrewFrame {
+    uint8_t version;
+    uint8_t filterState;
+    uint8_t flags;
+    uint8_t reserved;
+    uint32_t sequence;
+    uint32_t timestampUs;
+    int32_t weight;     // 0.01 g
+    int32_t flowRate;   // 0.01 g/s
+    uint32_t timerMs;
+};
+
+static_assert(sizeof(BrewFrame) == 24, "BrewFrame layout must match the documented wire format");
+
+// Centi-units, rounded; NaN and values beyond int32 clamp so a frame is always valid
+inline int32_t brewFrameCenti(float value) {
+    if (isnan(value)) {
+        return 0;
+    }
+    float scaled = value * 100.0f;
+    if (scaled >= 2147483520.0f) {
+        return INT32_MAX;
+    }
+    if (scaled <= -2147483520.0f) {
+        return INT32_MIN;
+    }
+    return (int32_t)lroundf(scaled);
+}
+
+inline void encodeBrewFrame(const WeightSnapshot& snapshot, uint32_t timerMs, bool timerRunning, uint8_t* out) {
+    BrewFrame frame;
+    frame.version = BREW_FRAME_VERSION;
+    frame.filterState = snapshot.filterState;
+    frame.flags = (timerRunning ? BREW_FRAME_TIMER_RUNNING : 0) | (snapshot.taring ? BREW_FRAME_TARING : 0);
+    frame.reserved = 0;
+    frame.sequence = snapshot.sequence;
+    frame.timestampUs = snapshot.timestampUs;
+    frame.weight = brewFrameCenti(snapshot.weight);
+    frame.flowRate = brewFrameCenti(snapshot.flowRate);
+    frame.timerMs = timerMs;
+    memcpy(out, &frame, sizeof(frame)); // Native order is little-endian on the ESP32-S3
+}
+
+#endif
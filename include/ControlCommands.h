@@ -0,0 +1,122 @@
+#ifndef CONTROL_COMMANDS_H
+#define CONTROL_COMMANDS_H
+
+#include <Arduino.h>
+#include "MpmcQueue.h"
+
+class Scale; // Forward declaration
+class Display; // Forward declaration
+class FlowRate; // Forward declaration
+class BluetoothScale; // Forward declaration
+class JsonWriter; // Forward declaration
+
+// Side effects requested from radio stack callbacks (NimBLE host task, async_tcp)
+// are queued here and executed by process() on the loop() task, so tare, timer,
+// calibration and settings changes never run inside a BLE or HTTP callback and
+// never race the display and touch handling done from loop().
+//
+// Producers only post() a typed command and get an id back; process() executes
+// it and records the outcome, which HTTP clients can read from /api/commands
+// and BLE clients receive as the usual confirmation message. Commands whose work
+// outlives process() (a tare collecting samples, a WiFi change waiting for the
+// HTTP response to leave) stay running until that work has actually finished.
+class ControlCommands {
+public:
+    enum Type : uint8_t {
+        TARE,
+        TIMER_START,
+        TIMER_STOP,
+        TIMER_RESET,
+        SET_CALIBRATION,  // value = calibration factor
+        RESET_SETTINGS,   // Clear NVS, then restart
+        WIFI_CONNECT,     // Join the stored network, config AP if that fails
+        WIFI_ENABLE,
+        WIFI_DISABLE,
+        WIFI_TOGGLE
+    };
+
+    enum Source : uint8_t {
+        SOURCE_HTTP,
+        SOURCE_BLE
+    };
+
+    enum State : uint8_t {
+        STATE_UNKNOWN, // Never posted, or too old to be remembered
+        STATE_QUEUED,
+        STATE_RUNNING, // Executed, waiting for its work to finish
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    struct Command {
+        uint32_t id;
+        Type type;
+        Source source;
+        uint8_t samples; // TARE
+        float value;     // SET_CALIBRATION
+    };
+
+    ControlCommands(Scale& scale, Display& display, FlowRate& flowRate, BluetoothScale& bluetoothScale);
+
+    // Any task; returns the command id, 0 when the queue is full
+    uint32_t post(Type type, Source source, float value = 0.0f, uint8_t samples = 0);
+    void process(); // Call from loop() - runs everything queued
+
+    State getState(uint32_t id);
+    void writeStatus(JsonWriter& json); // Queue counters and recent results as a JSON object
+    static const char* getTypeName(Type type);
+    static const char* getStateName(State state);
+
+private:
+    enum Outcome : uint8_t {
+        OUTCOME_DONE,
+        OUTCOME_FAILED,
+        OUTCOME_PENDING // Finished later by finishPending()
+    };
+
+    struct Pending {
+        Command command;   // id 0 = empty slot
+        uint32_t sinceMs;
+        uint32_t tareCount; // TARE: scale tare count when the job was requested
+        bool started;       // WIFI_CONNECT: attempt handed to maintainWiFi()
+    };
+
+    struct Result {
+        uint32_t id;     // 0 = empty slot
+        Type type;
+        Source source;
+        bool ok;
+        uint32_t completedMs;
+    };
+
+    static const size_t QUEUE_SIZE = 16;
+    static const size_t RESULT_COUNT = 8;
+    static const size_t PENDING_COUNT = 4;
+    static const uint32_t RESTART_DELAY_MS = 3000; // Lets the HTTP response reach the client
+    static const uint32_t WIFI_CHANGE_DELAY_MS = 500; // Same, before the link goes down
+    static const uint32_t TARE_TIMEOUT_MS = 10000; // 20 samples at 10 SPS take 2 s
+    static const uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000; // maintainWiFi() gives up on an attempt after 10 s
+
+    Scale& scale;
+    Display& display;
+    FlowRate& flowRate;
+    BluetoothScale& bluetoothScale;
+
+    MpmcQueue<Command, QUEUE_SIZE> queue;
+    std::atomic<uint32_t> nextId;
+    uint32_t executed;
+    Result results[RESULT_COUNT]; // Written by process(), read from the async_tcp task
+    size_t resultIndex;
+    Pending pending[PENDING_COUNT]; // Same - guarded by resultLock
+    portMUX_TYPE resultLock;
+    uint32_t restartAtMs; // 0 = no restart scheduled
+
+    Outcome execute(const Command& command);
+    static Outcome toOutcome(bool ok) { return ok ? OUTCOME_DONE : OUTCOME_FAILED; }
+    bool addPending(const Command& command, uint32_t tareCount = 0);
+    void finishPending();
+    bool runWiFiChange(Type type);
+    void recordResult(const Command& command, bool ok);
+};
+
+#endif
@@ -10,6 +10,8 @@ class FlowRate; // Forward declaration
 class BluetoothScale; // Forward declaration
 class PowerManager; // Forward declaration
 class BatteryMonitor; // Forward declaration
+class SamplingTask; // Forward declaration
+class TraceRecorder; // Forward declaration
 
 class Display {
 public:
@@ -42,6 +44,12 @@ public:
     // Battery monitor reference for battery status display
     void setBatteryMonitor(BatteryMonitor* battery);
     
+    // Sampling task reference - weight and flow are read from its published snapshot
+    void setSamplingTask(SamplingTask* samplingTask);
+    
+    // Trace recorder - raw samples are recorded while the timer runs
+    void setTraceRecorder(TraceRecorder* recorder);
+    
     // WiFi manager reference for network status display  
     void setWiFiManager(class WiFiManager* wifi);
     
@@ -53,7 +61,40 @@ public:
     float getTimerSeconds() const;
     unsigned long getElapsedTime() const; // Get current elapsed time in milliseconds
     
+    // Block until the display task has sent every pushed frame (e.g. before deep sleep)
+    void flush(uint32_t timeoutMs = 200);
+    
+    // Render counters - frames actually sent, main-view renders skipped, bytes on the I2C bus
+    uint32_t getFramesPushed() const { return framesPushed; }
+    uint32_t getFramesSkipped() const { return framesSkipped; }
+    uint32_t getFramesDropped() const { return framesDropped; } // Replaced by a newer frame before sending
+    uint32_t getI2CBytes() const { return i2cBytes; }
+    uint32_t getLastFrameUs() const { return lastFrameUs; } // Transfer time of the last frame sent
+    uint32_t getMaxFrameUs() const { return maxFrameUs; }
+    
 private:
+    // Everything the main weight/timer/flow view shows - it is only redrawn when this changes
+    struct MainView {
+        bool weightNegative;
+        int32_t weightInteger;
+        uint8_t weightDecimal;
+        bool timerNegative;
+        int32_t timerInteger;
+        uint8_t timerDecimal;
+        bool flowNegative;
+        int32_t flowInteger;
+        uint8_t flowDecimal;
+        
+        bool operator==(const MainView& other) const {
+            return weightNegative == other.weightNegative && weightInteger == other.weightInteger &&
+                   weightDecimal == other.weightDecimal && timerNegative == other.timerNegative &&
+                   timerInteger == other.timerInteger && timerDecimal == other.timerDecimal &&
+                   flowNegative == other.flowNegative && flowInteger == other.flowInteger &&
+                   flowDecimal == other.flowDecimal;
+        }
+    };
+    
+
     uint8_t sdaPin;
     uint8_t sclPin;
     Scale* scalePtr;
@@ -61,6 +102,8 @@ private:
     BluetoothScale* bluetoothPtr;
     PowerManager* powerManagerPtr;
     BatteryMonitor* batteryPtr;
+    SamplingTask* samplingTaskPtr;
+    TraceRecorder* traceRecorderPtr;
     class WiFiManager* wifiManagerPtr;
     Adafruit_SSD1306* display;
     bool displayConnected; // Track if display is actually connected
@@ -69,6 +112,36 @@ private:
     static const uint8_t SCREEN_HEIGHT = 32;
     static const uint8_t OLED_RESET = -1; // Reset pin not used
     static const uint8_t SCREEN_ADDRESS = 0x3C; // Common I2C address for SSD1306
+    static const uint8_t PAGE_COUNT = SCREEN_HEIGHT / 8; // SSD1306 RAM pages of 8 pixel rows
+    static const uint16_t FRAME_BYTES = SCREEN_WIDTH * PAGE_COUNT;
+    static const uint8_t I2C_DATA_CHUNK = 127; // Wire buffer is 128 bytes including the control byte
+    static const uint32_t I2C_CLOCK_HZ = 400000; // SSD1306 fast-mode maximum
+    static const uint8_t CHAR_WIDTH = 6; // Built-in 5x7 font advance at text size 1
+    
+    static const uint32_t TASK_STACK_SIZE = 3072;
+    static const UBaseType_t TASK_PRIORITY = 1;   // Same as loop(), below sampling - it only waits on I2C
+    static const BaseType_t TASK_CORE = 1;        // Application core - WiFi/BLE live on core 0
+    
+    // Double buffering: loop() renders into the Adafruit buffer and copies it to
+    // pendingFrame; the display task takes it into sendingFrame and transmits from there
+    uint8_t pendingFrame[FRAME_BYTES];
+    uint8_t sendingFrame[FRAME_BYTES];
+    volatile bool framePending;
+    volatile bool transmitting;
+    portMUX_TYPE frameLock;
+    TaskHandle_t taskHandle;
+    
+    // What the panel currently shows, to send only changed columns of each page - display task only
+    uint8_t panelFrame[FRAME_BYTES];
+    bool panelFrameValid;
+    MainView lastMainView;
+    bool mainViewShown; // Panel still shows lastMainView
+    uint32_t framesPushed;
+    uint32_t framesSkipped;
+    uint32_t framesDropped;
+    uint32_t i2cBytes;
+    uint32_t lastFrameUs;
+    uint32_t maxFrameUs;
     
     unsigned long messageStartTime;
     int messageDuration; // Store the duration for each message
@@ -88,7 +161,14 @@ private:
     static const unsigned long STATUS_PAGE_TIMEOUT = 10000; // 10 seconds timeout
     
     void drawWeight(float weight);
-    void showWeightWithFlowAndTimer(float weight); // Main display showing weight, flow rate, and timer
+    void pushFrame(); // Hand the framebuffer to the display task
+    void transmitFrame(const uint8_t* frame); // Send only the parts that differ from the panel
+    void sendRegion(const uint8_t* frame, uint8_t page, uint8_t firstColumn, uint8_t lastColumn);
+    static void taskEntry(void* arg);
+    void runTask();
+    static void splitTenths(float value, bool& negative, int32_t& integer, uint8_t& decimal);
+    static uint16_t textWidth(const char* text, uint8_t size) { return strlen(text) * CHAR_WIDTH * size; }
+    void showWeightWithFlowAndTimer(float weight, float flowRate); // Main display showing weight, flow rate, and timer
     void setupDisplay();
     void drawBluetoothStatus(); // Draw Bluetooth connection status icon
     void drawBatteryStatus(); // Draw battery status with 3-segment indicator
@@ -1,13 +1,25 @@
 #pragma once
 
-#define FLOWRATE_AVG_WINDOW 20  // Increased for better smoothing
+#include <stdint.h>
+#include "SlopeWindow.h"
 
 class FlowRate {
 public:
+    // Regression window length - response time versus smoothness
+    enum Profile : uint8_t {
+        PROFILE_FAST,   // Short window, follows pour changes quickly
+        PROFILE_SMOOTH  // Long window, steadier reading
+    };
+    
     FlowRate();
-    void update(float currentWeight);
+    void addSample(uint32_t timestampUs, float weight); // Every raw weight sample, straight from Scale
+    void updateEstimate(float estimatedRate); // Use a flow rate estimated upstream per sample (Kalman mode)
     float getFlowRate() const; // grams per second
     
+    void setProfile(Profile profile); // Applied by the sample consumer on its next sample
+    Profile getProfile() const { return requestedProfile; }
+    static const char* getProfileName(Profile profile);
+    
     // Timer-based average flow rate tracking
     void startTimerAveraging();
     void stopTimerAveraging();
@@ -21,12 +33,11 @@ public:
     void clearFlowRateBuffer(); // Clear all flow rate history for fresh start
     
 private:
-    float lastWeight;
-    unsigned long lastTime;
+    static const size_t WINDOW_CAPACITY = 256; // 3.2s at 80 SPS - covers the smooth window
+    SlopeWindow<WINDOW_CAPACITY> window;       // Least-squares slope over timestamped weights
     float flowRate;
-    float flowRateBuffer[FLOWRATE_AVG_WINDOW];
-    int bufferIndex;
-    int bufferCount;
+    volatile Profile requestedProfile;
+    Profile activeProfile;
     
     // Timer-based average tracking
     bool timerAveragingActive;
@@ -34,15 +45,17 @@ private:
     int timerFlowRateSamples;
     float timerAverageFlowRate;
     bool hasValidTimerAverage;
-    bool calculationPaused; // Flag to pause flow rate during tare operations
+    volatile bool calculationPaused; // Flag to pause flow rate during tare operations
+    volatile bool clearRequested;    // History cleared by the sample consumer, not the caller
     
-    // Flow rate filtering parameters
-    static constexpr float WEIGHT_DEADBAND = 0.08f;     // Increased deadband for load cell noise
-    static constexpr float MIN_DELTA_TIME = 0.15f;      // Increased to 150ms for much more stable readings
-    static constexpr float ZERO_THRESHOLD = 0.08f;      // Increased zero threshold
-    static constexpr float RAPID_CHANGE_THRESHOLD = 1.5f; // Higher threshold for major changes
-    static constexpr float NEGATIVE_CHANGE_THRESHOLD = 0.5f; // Higher threshold for weight removal
+    // Flow rate estimation parameters
+    static const uint32_t FAST_WINDOW_US = 750000;    // ~60 samples at 80 SPS
+    static const uint32_t SMOOTH_WINDOW_US = 2000000;
+    static const uint32_t MIN_SPAN_US = 300000;       // Report 0 until the fit spans this long
+    static constexpr float STEP_THRESHOLD = 5.0f;     // Cup placed/removed - restart the fit (same 5g rule as Scale)
+    static constexpr float ZERO_THRESHOLD = 0.08f;    // Suppress tiny fluctuations around zero
     
     // Helper methods
-    float calculateStableAverage(bool isWeightRemoval);
+    void applyProfile(Profile profile);
+    void publish(float rate);
 };
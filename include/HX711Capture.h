@@ -0,0 +1,48 @@
+#ifndef HX711_CAPTURE_H
+#define HX711_CAPTURE_H
+
+#include <Arduino.h>
+#include "ILoadCellSource.h"
+
+// Interrupt-driven HX711 acquisition.
+// The HX711 pulls DOUT low when a conversion is ready. A falling-edge interrupt
+// on DOUT shifts the 24-bit result out immediately and pushes it, timestamped,
+// into a lock-free SPSC ring. The filter chain drains the ring at its own pace,
+// so no conversion is lost while the main loop is busy with WiFi, BLE or the display.
+class HX711Capture : public ILoadCellSource {
+public:
+    static const size_t RING_SIZE = 64; // 0.8s of headroom at 80 SPS, 6.4s at 10 SPS
+
+    HX711Capture(uint8_t dataPin, uint8_t clockPin);
+    bool begin() override; // Probe the HX711 (blocking, up to 3s) before capture starts
+    void start() override; // Attach data-ready interrupt and begin capturing
+    void stop() override;  // Detach interrupt
+    bool isRunning() const override { return running; }
+    void setGain(uint8_t gain); // 128/64 (channel A) or 32 (channel B)
+
+    // Callback must be placed in IRAM - it runs inside the DOUT interrupt
+    void setDataReadyCallback(DataReadyCallback cb, void* context) override {
+        callbackContext = context;
+        callback = cb;
+    }
+
+    bool readSample(RawSample& sample) override { return ring.pop(sample); }
+    size_t pendingSamples() const override { return ring.available(); }
+    uint32_t getCapturedCount() const override { return captured; }
+    uint32_t getDroppedCount() const override { return ring.getDroppedCount(); }
+
+private:
+    uint8_t dataPin;
+    uint8_t clockPin;
+    uint8_t gainPulses;          // Extra clock pulses after 24 data bits selecting next gain
+    volatile bool running;
+    volatile uint32_t captured;
+    DataReadyCallback volatile callback;
+    void* volatile callbackContext;
+    SampleRing<RawSample, RING_SIZE> ring;
+
+    static void onDataReady(void* arg);
+    bool captureConversion(); // Shift out one conversion, false if none was ready
+};
+
+#endif
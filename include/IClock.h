@@ -0,0 +1,16 @@
+#ifndef I_CLOCK_H
+#define I_CLOCK_H
+
+#include <stdint.h>
+
+// Time source for the signal path. ArduinoClock wraps millis()/micros() on
+// the device; SimulatedClock lets host builds step time deterministically.
+class IClock {
+public:
+    virtual ~IClock() {}
+    virtual uint32_t nowMs() const = 0;
+    virtual uint32_t nowUs() const = 0;
+    virtual void sleepMs(uint32_t ms) = 0; // Blocking wait (simulated clocks just advance)
+};
+
+#endif
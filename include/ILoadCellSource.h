@@ -0,0 +1,32 @@
+#ifndef I_LOAD_CELL_SOURCE_H
+#define I_LOAD_CELL_SOURCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SampleRing.h"
+
+// Where Scale gets its raw conversions from.
+// On hardware this is HX711Capture (DOUT interrupt into a SampleRing); on a
+// Linux host it is SimulatedLoadCell, so the whole filter chain can run
+// without a load cell attached.
+class ILoadCellSource {
+public:
+    // Called for every new conversion. On hardware this runs in interrupt context.
+    typedef void (*DataReadyCallback)(void* context);
+
+    virtual ~ILoadCellSource() {}
+
+    virtual bool begin() = 0;  // Probe the converter, true if it responds
+    virtual void start() = 0;  // Begin delivering samples
+    virtual void stop() = 0;
+    virtual bool isRunning() const = 0;
+
+    virtual bool readSample(RawSample& sample) = 0;
+    virtual size_t pendingSamples() const = 0;
+    virtual uint32_t getCapturedCount() const = 0;
+    virtual uint32_t getDroppedCount() const = 0;
+
+    virtual void setDataReadyCallback(DataReadyCallback callback, void* context) = 0;
+};
+
+#endif
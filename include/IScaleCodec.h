@@ -0,0 +1,48 @@
+#ifndef I_SCALE_CODEC_H
+#define I_SCALE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "NotificationScheduler.h"
+
+// One BLE scale protocol as a client app expects it: where the weight and
+// command characteristics live, how a weight goes on air and what written
+// bytes mean. BluetoothScale builds its GATT layout from the enabled codecs
+// and handles connections, scheduling and command execution for all of them.
+// Implementations are pure byte transforms, so they build and can be checked
+// on a Linux host (test/test_scale_codecs).
+class IScaleCodec {
+public:
+    // Scale actions a client can ask for, whatever the wire format
+    enum Command : uint8_t {
+        COMMAND_NONE, // Not a command of this protocol
+        COMMAND_TARE,
+        COMMAND_TIMER_START,
+        COMMAND_TIMER_STOP,
+        COMMAND_TIMER_RESET
+    };
+
+    // What a weight frame can carry; codecs use the fields their protocol has
+    struct WeightFrame {
+        float weight;   // Grams
+        float flowRate; // g/s
+        bool brewing;   // Weight changing (vs stable)
+    };
+
+    static const size_t MAX_WEIGHT_FRAME = 20; // Fits the default 23-byte MTU
+
+    virtual ~IScaleCodec() {}
+
+    virtual const char* getName() const = 0;           // API and log name, lower case
+    virtual const char* getServiceUuid() const = 0;
+    virtual const char* getWeightUuid() const = 0;     // READ/NOTIFY/INDICATE
+    virtual const char* getCommandUuid() const = 0;    // WRITE, nullptr = no commands
+    virtual const char* getAdvertisedName() const { return nullptr; } // nullptr = keep "WeighMyBru"
+    virtual NotificationPolicy getDefaultPolicy() const = 0;
+
+    // Returns the frame length, 0 if capacity is too small
+    virtual size_t encodeWeight(const WeightFrame& frame, uint8_t* out, size_t capacity) const = 0;
+    virtual Command decodeCommand(const uint8_t* data, size_t length) const = 0;
+};
+
+#endif
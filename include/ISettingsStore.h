@@ -0,0 +1,28 @@
+#ifndef I_SETTINGS_STORE_H
+#define I_SETTINGS_STORE_H
+
+#include <stdint.h>
+
+// Namespaced key/value persistence with the same shape as ESP32 Preferences,
+// so callers keep the begin()/get/put/end() pattern. PreferencesSettingsStore
+// writes NVS on the device; MemorySettingsStore keeps values in RAM on a host.
+class ISettingsStore {
+public:
+    virtual ~ISettingsStore() {}
+
+    virtual bool begin(const char* name, bool readOnly) = 0;
+    virtual void end() = 0;
+    virtual bool isKey(const char* key) = 0;
+
+    virtual float getFloat(const char* key, float defaultValue) = 0;
+    virtual int32_t getInt(const char* key, int32_t defaultValue) = 0;
+    virtual uint32_t getULong(const char* key, uint32_t defaultValue) = 0;
+    virtual uint8_t getUChar(const char* key, uint8_t defaultValue) = 0;
+
+    virtual void putFloat(const char* key, float value) = 0;
+    virtual void putInt(const char* key, int32_t value) = 0;
+    virtual void putULong(const char* key, uint32_t value) = 0;
+    virtual void putUChar(const char* key, uint8_t value) = 0;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Heap-free streaming JSON writer into a caller-owned buffer; overflow is flagged
+//
+//   char buffer[256];
+//   JsonWriter json(buffer, sizeof(buffer));
+//   json.beginObject().field("w", 45.2f, 1).field("ok", true).endObject();
+//   if (!json.overflowed()) send(json.c_str(), json.length());
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t capacity)
+        : buffer(buffer), capacity(capacity), used(0), depth(0), needsComma(0), overflow(false) {
+        if (capacity > 0) {
+            buffer[0] = '\0';
+        }
+    }
+
+    // Containers - pass a key inside an object, nullptr inside an array or at top level
+    JsonWriter& beginObject(const char* key = nullptr) { return open(key, '{'); }
+    JsonWriter& endObject() { return close('}'); }
+    JsonWriter& beginArray(const char* key = nullptr) { return open(key, '['); }
+    JsonWriter& endArray() { return close(']'); }
+
+    JsonWriter& field(const char* key, const char* value) {
+        writeKey(key);
+        if (value == nullptr) {
+            append("null", 4);
+        } else {
+            appendEscaped(value);
+        }
+        return *this;
+    }
+    JsonWriter& field(const char* key, bool value) {
+        writeKey(key);
+        if (value) {
+            append("true", 4);
+        } else {
+            append("false", 5);
+        }
+        return *this;
+    }
+    JsonWriter& field(const char* key, int value) { return signedField(key, value); }
+    JsonWriter& field(const char* key, long value) { return signedField(key, value); }
+    JsonWriter& field(const char* key, long long value) { return signedField(key, value); }
+    JsonWriter& field(const char* key, unsigned int value) { return unsignedField(key, value); }
+    JsonWriter& field(const char* key, unsigned long value) { return unsignedField(key, value); }
+    JsonWriter& field(const char* key, unsigned long long value) { return unsignedField(key, value); }
+    // Fixed-point with 0-6 decimals; NaN and infinity become null
+    JsonWriter& field(const char* key, float value, uint8_t decimals) {
+        writeKey(key);
+        appendFixed(value, decimals);
+        return *this;
+    }
+    JsonWriter& nullField(const char* key) {
+        writeKey(key);
+        append("null", 4);
+        return *this;
+    }
+    // Pre-serialized JSON value (e.g. a constant fragment)
+    JsonWriter& rawField(const char* key, const char* json) {
+        writeKey(key);
+        append(json, strlen(json));
+        return *this;
+    }
+
+    // Array elements and bare top-level values
+    template <typename T>
+    JsonWriter& value(T v) { return field(nullptr, v); }
+    JsonWriter& value(float v, uint8_t decimals) { return field(nullptr, v, decimals); }
+
+    const char* c_str() const { return buffer; }
+    size_t length() const { return used; }
+    bool overflowed() const { return overflow; }
+
+private:
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    uint8_t depth;
+    uint32_t needsComma; // One bit per nesting level
+
+    bool overflow;
+
+    JsonWriter& open(const char* key, char bracket) {
+        writeKey(key);
+        append(&bracket, 1);
+        if (depth < 31) {
+            depth++;
+            needsComma &= ~(1UL << depth);
+        } else {
+            overflow = true;
+        }
+        return *this;
+    }
+
+    JsonWriter& close(char bracket) {
+        if (depth > 0) {
+            depth--;
+        }
+        append(&bracket, 1);
+        return *this;
+    }
+
+    void writeKey(const char* key) {
+        if (needsComma & (1UL << depth)) {
+            append(",", 1);
+        }
+        needsComma |= (1UL << depth);
+        if (key != nullptr) {
+            appendEscaped(key);
+            append(":", 1);
+        }
+    }
+
+    JsonWriter& signedField(const char* key, long long value) {
+        writeKey(key);
+        if (value < 0) {
+            append("-", 1);
+            appendUnsigned(0ULL - (unsigned long long)value);
+        } else {
+            appendUnsigned((unsigned long long)value);
+        }
+        return *this;
+    }
+
+    JsonWriter& unsignedField(const char* key, unsigned long long value) {
+        writeKey(key);
+        appendUnsigned(value);
+        return *this;
+    }
+
+    void appendUnsigned(unsigned long long value) {
+        char digits[20];
+        size_t count = 0;
+        do {
+            digits[count++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (count > 0) {
+            append(&digits[--count], 1);
+        }
+    }
+
+    void appendFixed(float value, uint8_t decimals) {
+        if (isnan(value) || isinf(value)) {
+            append("null", 4);
+            return;
+        }
+        static const uint32_t SCALE[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+        if (decimals > 6) {
+            decimals = 6;
+        }
+        uint32_t scale = SCALE[decimals];
+        double magnitude = fabs((double)value) * scale + 0.5;
+        if (magnitude >= 1.8e19) {
+            append("null", 4); // Beyond uint64 - not a reading
+            return;
+        }
+        unsigned long long scaled = (unsigned long long)magnitude;
+        if (value < 0.0f && scaled != 0) {
+            append("-", 1); // No "-0.00" for values that round to zero
+        }
+        appendUnsigned(scaled / scale);
+        if (decimals > 0) {
+            append(".", 1);
+            unsigned long long fraction = scaled % scale;
+            char digits[6];
+            for (int i = decimals - 1; i >= 0; i--) {
+                digits[i] = (char)('0' + fraction % 10);
+                fraction /= 10;
+            }
+            append(digits, decimals);
+        }
+    }
+
+    void appendEscaped(const char* text) {
+        append("\"", 1);
+        for (const char* c = text; *c != '\0'; c++) {
+            unsigned char ch = (unsigned char)*c;
+            if (ch == '"' || ch == '\\') {
+                char escaped[2] = {'\\', (char)ch};
+                append(escaped, 2);
+            } else if (ch == '\n') {
+                append("\\n", 2);
+            } else if (ch == '\r') {
+                append("\\r", 2);
+            } else if (ch == '\t') {
+                append("\\t", 2);
+            } else if (ch < 0x20) {
+                static const char HEX_DIGITS[] = "0123456789abcdef";
+                char escaped[6] = {'\\', 'u', '0', '0', HEX_DIGITS[ch >> 4], HEX_DIGITS[ch & 0x0F]};
+                append(escaped, 6);
+            } else {
+                append(c, 1);
+            }
+        }
+        append("\"", 1);
+    }
+
+    void append(const char* data, size_t count) {
+        if (overflow || used + count >= capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(buffer + used, data, count);
+        used += count;
+        buffer[used] = '\0';
+    }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+class Scale; // Forward declaration
+class SamplingTask; // Forward declaration
+class FlowRate; // Forward declaration
+class Display; // Forward declaration
+class BatteryMonitor; // Forward declaration
+class BluetoothScale; // Forward declaration
+
+// WebSocket push of live scale data on /ws, replacing dashboard polling.
+//
+// Server -> client, compact JSON text frames:
+//   {"t":"l","s":812,"w":45.23,"f":2.1,"tm":27340,"tr":1,"a":null}  live - every new sample
+//   {"t":"s","bp":87,"bl":0,"bc":0,"hx":1,"ws":-58,"wq":"Good","bt":1}  status - changed fields only
+// Client -> server, optional:
+//   {"sub":["weight","flow","timer","battery","signal"],"rate":50}
+//   Fields to receive and minimum ms between live frames (0 = every sample).
+//   A new client gets every field at full rate until it subscribes.
+//   {"format":"binary"} / {"format":"json"}
+//   Binary sends each live sample as a 24-byte BrewFrame (BrewFrame.h) in a
+//   binary frame instead of the "l" JSON; status frames stay JSON.
+class LiveStream {
+public:
+    LiveStream(Scale& scale, SamplingTask& samplingTask, FlowRate& flowRate, Display& display,
+               BatteryMonitor& battery, BluetoothScale& bluetoothScale);
+    void begin(AsyncWebServer& server); // Register the /ws endpoint
+    void update(); // Call from loop() - pushes the newest sample and status changes
+    size_t getClientCount();
+    uint32_t getFramesSent() const { return framesSent; }
+    uint32_t getFramesSkipped() const { return framesSkipped; } // Client send queue was full
+
+    enum Field : uint8_t {
+        FIELD_WEIGHT = 0x01,
+        FIELD_FLOW = 0x02,
+        FIELD_TIMER = 0x04,
+        FIELD_BATTERY = 0x08,
+        FIELD_SIGNAL = 0x10,
+        FIELD_ALL = 0x1F
+    };
+
+private:
+    struct Subscriber {
+        uint32_t clientId;       // 0 = free slot
+        uint8_t fields;
+        uint16_t intervalMs;
+        uint32_t lastLiveMs;
+        bool needsFullStatus;    // Just connected or resubscribed
+        bool binary;             // Live samples as BrewFrame
+    };
+
+    // Slow fields, compared against the last values pushed
+    struct StatusFields {
+        int batteryPercentage;
+        bool batteryLow;
+        bool batteryCritical;
+        bool scaleConnected;
+        int wifiSignal;
+        const char* wifiQuality; // Static string from getWiFiSignalQuality()
+        bool bluetoothConnected;
+    };
+
+    static const size_t MAX_SUBSCRIBERS = 4;
+    static const uint32_t STATUS_INTERVAL_MS = 1000;
+    static const uint16_t MAX_INTERVAL_MS = 1000;
+
+    AsyncWebSocket socket;
+    Scale& scale;
+    SamplingTask& samplingTask;
+    FlowRate& flowRate;
+    Display& display;
+    BatteryMonitor& battery;
+    BluetoothScale& bluetoothScale;
+
+    Subscriber subscribers[MAX_SUBSCRIBERS]; // Written from the async_tcp task, read from loop()
+    portMUX_TYPE subscriberLock;
+    uint32_t lastSequence;
+    uint32_t lastStatusCheck;
+    StatusFields lastStatus;
+    bool hasStatus;
+    uint32_t framesSent;
+    uint32_t framesSkipped;
+
+    void onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len);
+    void handleMessage(AsyncWebSocketClient* client, const char* message);
+    void addSubscriber(uint32_t clientId);
+    void removeSubscriber(uint32_t clientId);
+    void sendLive(uint32_t now);
+    void sendStatus(bool changedOnly);
+    size_t formatLive(char* buffer, size_t size, uint8_t fields, uint32_t sequence, float weight, float flow);
+    size_t formatStatus(char* buffer, size_t size, uint8_t fields, const StatusFields& status, const StatusFields* previous);
+    StatusFields readStatus();
+    bool sendFrame(uint32_t clientId, const char* frame, size_t length, bool binary = false);
+};
+
+#endif
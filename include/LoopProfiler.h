@@ -0,0 +1,104 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+// Timing profiler for loop() and the subsystems it drives.
+// Enabled with -DWEIGHMYBRU_PROFILER=1 (platformio.ini); with 0 the class,
+// its global and the /api/profile endpoint are not compiled at all and the
+// PROFILE_* macros reduce to the bare calls.
+//
+//   PROFILE_LOOP_START();                            // first statement in loop()
+//   PROFILE_CALL(LoopProfiler::WIFI, maintainWiFi());
+//   PROFILE_LOOP_END();                              // before the trailing delay()
+//
+// Reports: GET /api/profile (JSON), or type "profile" / "profile reset" on serial.
+#ifndef WEIGHMYBRU_PROFILER
+#define WEIGHMYBRU_PROFILER 0
+#endif
+
+#if WEIGHMYBRU_PROFILER
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+class JsonWriter; // Forward declaration
+
+class LoopProfiler {
+public:
+    enum Section : uint8_t {
+        WIFI,
+        LIVE_STREAM,
+        BREW_EVENTS,
+        BLUETOOTH,
+        TOUCH,
+        POWER,
+        BATTERY,
+        OLED,
+        COMMANDS,
+        LOOP_WORK,   // loop() start to PROFILE_LOOP_END(), i.e. without the delay
+        LOOP_PERIOD, // loop() start to the next loop() start
+        SECTION_COUNT
+    };
+
+    static const uint32_t DEADLINE_US = 20000; // Budget for LOOP_WORK
+
+    // Log-linear buckets: exact below 4 us, then 4 per power of two (<= 25% wide) up to ~33 s
+    static const uint8_t SUB_BITS = 2;
+    static const uint8_t SUB_BUCKETS = 1 << SUB_BITS;
+    static const uint8_t BUCKET_COUNT = 96;
+
+    struct Histogram {
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t totalUs;
+        uint32_t buckets[BUCKET_COUNT];
+    };
+
+    LoopProfiler();
+
+    void loopStart();
+    void loopEnd();
+    void record(Section section, uint32_t elapsedUs);
+    void reset();
+
+    // Upper bound of the bucket holding the given percentile (0-100); 0 when empty
+    uint32_t percentile(Section section, uint8_t percent) const;
+    uint32_t getMissedDeadlines() const { return missedDeadlines; }
+    const Histogram& getHistogram(Section section) const { return histograms[section]; }
+    static const char* sectionName(Section section);
+
+    void writeReport(JsonWriter& json) const;
+    void printReport() const;
+    void handleSerial(); // Call from loop() - reads "profile" commands
+
+private:
+    // Written only by loop(); readers on other tasks may see one sample in flight
+    Histogram histograms[SECTION_COUNT];
+    uint32_t missedDeadlines;
+    int64_t loopStartUs; // 0 before the first loop()
+    char command[24];
+    uint8_t commandLength;
+
+    static uint8_t bucketIndex(uint32_t us);
+    static uint32_t bucketUpperUs(uint8_t index);
+};
+
+extern LoopProfiler loopProfiler;
+
+#define PROFILE_LOOP_START() loopProfiler.loopStart()
+#define PROFILE_LOOP_END() loopProfiler.loopEnd()
+#define PROFILE_CALL(section, call)                                                          \
+    do {                                                                                     \
+        int64_t profileStartUs = esp_timer_get_time();                                       \
+        call;                                                                                \
+        loopProfiler.record(section, (uint32_t)(esp_timer_get_time() - profileStartUs));     \
+    } while (0)
+
+#else
+
+#define PROFILE_LOOP_START() do {} while (0)
+#define PROFILE_LOOP_END() do {} while (0)
+#define PROFILE_CALL(section, call) do { call; } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef MEMORY_SETTINGS_STORE_H
+#define MEMORY_SETTINGS_STORE_H
+
+#include <map>
+#include <string>
+#include "ISettingsStore.h"
+
+// In-RAM ISettingsStore for host builds and replays. Values are kept per
+// namespace like NVS; every supported type fits exactly in a double.
+class MemorySettingsStore : public ISettingsStore {
+public:
+    bool begin(const char* name, bool readOnly) override {
+        currentNamespace = name;
+        readOnlyMode = readOnly;
+        return true;
+    }
+    void end() override { currentNamespace.clear(); }
+    bool isKey(const char* key) override { return values.count(fullKey(key)) > 0; }
+
+    float getFloat(const char* key, float defaultValue) override { return (float)get(key, defaultValue); }
+    int32_t getInt(const char* key, int32_t defaultValue) override { return (int32_t)get(key, defaultValue); }
+    uint32_t getULong(const char* key, uint32_t defaultValue) override { return (uint32_t)get(key, defaultValue); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue) override { return (uint8_t)get(key, defaultValue); }
+
+    void putFloat(const char* key, float value) override { put(key, value); }
+    void putInt(const char* key, int32_t value) override { put(key, value); }
+    void putULong(const char* key, uint32_t value) override { put(key, value); }
+    void putUChar(const char* key, uint8_t value) override { put(key, value); }
+
+    void clear() { values.clear(); }
+
+private:
+    std::map<std::string, double> values;
+    std::string currentNamespace;
+    bool readOnlyMode = false;
+
+    std::string fullKey(const char* key) const { return currentNamespace + "/" + key; }
+
+    double get(const char* key, double defaultValue) const {
+        std::map<std::string, double>::const_iterator it = values.find(fullKey(key));
+        return it != values.end() ? it->second : defaultValue;
+    }
+
+    void put(const char* key, double value) {
+        if (!readOnlyMode) {
+            values[fullKey(key)] = value;
+        }
+    }
+};
+
+#endif
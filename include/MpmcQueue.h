@@ -0,0 +1,94 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free bounded multi-producer/multi-consumer queue (Vyukov)
+template <typename T, size_t N>
+class MpmcQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpmcQueue capacity must be a power of two");
+
+public:
+    MpmcQueue() : MpmcQueue(0) {}
+
+    // Positions start at startPosition instead of 0, so a test can run the
+    // 32-bit counters across their wrap without pushing 2^32 items first
+    explicit MpmcQueue(uint32_t startPosition) : enqueuePos(startPosition), dequeuePos(startPosition), dropped(0) {
+        for (size_t i = 0; i < N; i++) {
+            uint32_t pos = startPosition + (uint32_t)i;
+            cells[pos & (N - 1)].sequence.store(pos, std::memory_order_relaxed);
+        }
+    }
+
+    // Any task - returns false (and counts a drop) when the queue is full
+    bool push(const T& item) {
+        Cell* cell;
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & (N - 1)];
+            uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(sequence - pos);
+            if (diff == 0) {
+                // Cell is free for this position - claim it
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Cell still holds the item from one lap ago
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed); // Another producer got here first
+            }
+        }
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Any task - returns false when no item is pending
+    bool pop(T& item) {
+        Cell* cell;
+        uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & (N - 1)];
+            uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(sequence - (pos + 1));
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Not yet written
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        item = cell->data;
+        cell->sequence.store(pos + N, std::memory_order_release); // Free for the next lap
+        return true;
+    }
+
+    // Approximate while producers or consumers are active
+    size_t available() const {
+        return enqueuePos.load(std::memory_order_acquire) - dequeuePos.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+    uint32_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        T data;
+    };
+
+    Cell cells[N];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos;
+    std::atomic<uint32_t> dropped;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef NOTIFICATION_SCHEDULER_H
+#define NOTIFICATION_SCHEDULER_H
+
+#include <stdint.h>
+#include <math.h>
+
+// When to notify one characteristic
+struct NotificationPolicy {
+    float deadbandGrams;    // Change from the last sent weight that triggers a send
+    uint32_t minIntervalMs; // Rate cap - never two notifications closer than this
+    uint32_t keepaliveMs;   // Resend an unchanged weight this often
+};
+
+// Decides whether a weight is worth a BLE notification - change, brewing cap or keepalive
+class NotificationScheduler {
+public:
+    // Sends every offered weight until setPolicy()
+    NotificationScheduler()
+        : policy{0.0f, 0, 0}, lastSentWeight(0.0f), lastSentMs(0), hasSent(false),
+          sentCount(0), suppressedCount(0) {}
+    explicit NotificationScheduler(const NotificationPolicy& policy)
+        : policy(policy), lastSentWeight(0.0f), lastSentMs(0), hasSent(false),
+          sentCount(0), suppressedCount(0) {}
+
+    void setPolicy(const NotificationPolicy& newPolicy) { policy = newPolicy; }
+    const NotificationPolicy& getPolicy() const { return policy; }
+
+    // Offer a new weight; true if it should be notified now (recorded as sent)
+    bool offer(float weight, bool brewing, uint32_t nowMs) {
+        if (shouldSend(weight, brewing, nowMs)) {
+            lastSentWeight = weight;
+            lastSentMs = nowMs;
+            hasSent = true;
+            sentCount++;
+            return true;
+        }
+        suppressedCount++;
+        return false;
+    }
+
+    // New subscriber - send the next weight regardless of policy
+    void restart() { hasSent = false; }
+
+    uint32_t getSentCount() const { return sentCount; }
+    uint32_t getSuppressedCount() const { return suppressedCount; }
+    void resetCounters() {
+        sentCount = 0;
+        suppressedCount = 0;
+    }
+
+private:
+    NotificationPolicy policy;
+    float lastSentWeight;
+    uint32_t lastSentMs;
+    bool hasSent;
+    uint32_t sentCount;
+    uint32_t suppressedCount;
+
+    bool shouldSend(float weight, bool brewing, uint32_t nowMs) const {
+        if (!hasSent) {
+            return true;
+        }
+        uint32_t elapsed = nowMs - lastSentMs;
+        if (elapsed < policy.minIntervalMs) {
+            return false;
+        }
+        float change = fabsf(weight - lastSentWeight);
+        if (change > policy.deadbandGrams) {
+            return true;
+        }
+        if (brewing && change > 0.0f) {
+            return true;
+        }
+        return elapsed >= policy.keepaliveMs;
+    }
+};
+
+#endif
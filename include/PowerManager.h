@@ -5,6 +5,7 @@
 #include <esp_sleep.h>
 
 class Display; // Forward declaration
+class BootSequencer; // Forward declaration
 
 class PowerManager {
 public:
@@ -15,6 +16,7 @@ public:
     void setSleepTouchThreshold(uint16_t threshold);
     bool isSleepTouchPressed();
     void setDisplay(Display* display);
+    void setBootSequencer(BootSequencer* bootSequencer); // Saves fast-wake state before sleep
     
     // Timer control for TIME mode
     void handleTimerControl();
@@ -23,6 +25,7 @@ public:
 private:
     uint8_t sleepTouchPin;
     Display* displayPtr;
+    BootSequencer* bootSequencerPtr;
     uint16_t sleepTouchThreshold;
     bool lastSleepTouchState;
     unsigned long lastSleepTouchTime;
@@ -0,0 +1,28 @@
+#ifndef PREFERENCES_SETTINGS_STORE_H
+#define PREFERENCES_SETTINGS_STORE_H
+
+#include <Preferences.h>
+#include "ISettingsStore.h"
+
+// ISettingsStore backed by ESP32 NVS through the Preferences library
+class PreferencesSettingsStore : public ISettingsStore {
+public:
+    bool begin(const char* name, bool readOnly) override { return preferences.begin(name, readOnly); }
+    void end() override { preferences.end(); }
+    bool isKey(const char* key) override { return preferences.isKey(key); }
+
+    float getFloat(const char* key, float defaultValue) override { return preferences.getFloat(key, defaultValue); }
+    int32_t getInt(const char* key, int32_t defaultValue) override { return preferences.getInt(key, defaultValue); }
+    uint32_t getULong(const char* key, uint32_t defaultValue) override { return preferences.getULong(key, defaultValue); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue) override { return preferences.getUChar(key, defaultValue); }
+
+    void putFloat(const char* key, float value) override { preferences.putFloat(key, value); }
+    void putInt(const char* key, int32_t value) override { preferences.putInt(key, value); }
+    void putULong(const char* key, uint32_t value) override { preferences.putULong(key, value); }
+    void putUChar(const char* key, uint8_t value) override { preferences.putUChar(key, value); }
+
+private:
+    Preferences preferences;
+};
+
+#endif
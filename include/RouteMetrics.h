@@ -0,0 +1,278 @@
+#ifndef ROUTE_METRICS_H
+#define ROUTE_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Per-route HTTP counters and latency histograms as chunked Prometheus text; async_tcp task only
+class RouteMetrics {
+public:
+    static const size_t MAX_ROUTES = 64;
+    static const size_t BUCKET_COUNT = 8;  // Last one is +Inf
+    static const size_t MAX_GAUGES = 32;
+    static const size_t LINE_SIZE = 192;
+
+    struct Route {
+        const char* path;
+        const char* method;
+        uint32_t count;
+        uint64_t bytes;
+        uint64_t sumUs;
+        uint32_t buckets[BUCKET_COUNT]; // Non-cumulative; summed while rendering
+    };
+
+    struct Gauge {
+        const char* name;
+        const char* help;
+        const char* type; // "gauge" or "counter"
+        uint32_t value;
+    };
+
+    // One scrape in progress. Gauges and counters kept outside RouteMetrics are
+    // sampled by the caller when it starts.
+    struct Cursor {
+        Gauge gauges[MAX_GAUGES];
+        size_t gaugeCount;
+        uint32_t droppedGauges;
+        uint8_t section;
+        size_t item;
+        size_t line;
+        char pending[LINE_SIZE];
+        size_t pendingLength;
+        size_t pendingOffset;
+    };
+
+    RouteMetrics() : routeCount(0), droppedRoutes(0) {}
+
+    // nullptr once MAX_ROUTES are taken; record() ignores nullptr
+    Route* addRoute(const char* path, const char* method) {
+        if (routeCount >= MAX_ROUTES) {
+            droppedRoutes++;
+            return nullptr;
+        }
+        Route* route = &routes[routeCount++];
+        memset(route, 0, sizeof(*route));
+        route->path = path;
+        route->method = method;
+        return route;
+    }
+
+    void record(Route* route, uint32_t elapsedUs, size_t bytes) {
+        if (route == nullptr) {
+            return;
+        }
+        route->count++;
+        route->bytes += bytes;
+        route->sumUs += elapsedUs;
+        size_t bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && elapsedUs > bucketBoundUs(bucket)) {
+            bucket++;
+        }
+        route->buckets[bucket]++;
+    }
+
+    // Body bytes written after the handler returned (chunked responses)
+    void addBytes(Route* route, size_t bytes) {
+        if (route != nullptr) {
+            route->bytes += bytes;
+        }
+    }
+
+    size_t getRouteCount() const { return routeCount; }
+    uint32_t getDroppedRoutes() const { return droppedRoutes; }
+    const Route& getRoute(size_t index) const { return routes[index]; }
+
+    static void beginScrape(Cursor& cursor) {
+        memset(&cursor, 0, sizeof(cursor));
+    }
+
+    static void addGauge(Cursor& cursor, const char* name, const char* help, uint32_t value) {
+        if (cursor.gaugeCount < MAX_GAUGES) {
+            cursor.gauges[cursor.gaugeCount++] = {name, help, "gauge", value};
+        } else {
+            cursor.droppedGauges++;
+        }
+    }
+
+    static void addCounter(Cursor& cursor, const char* name, const char* help, uint32_t value) {
+        if (cursor.gaugeCount < MAX_GAUGES) {
+            cursor.gauges[cursor.gaugeCount++] = {name, help, "counter", value};
+        } else {
+            cursor.droppedGauges++;
+        }
+    }
+
+    // Write up to size bytes of the exposition; 0 once everything was written
+    size_t render(Cursor& cursor, char* out, size_t size) const {
+        size_t written = 0;
+        while (written < size) {
+            if (cursor.pendingOffset == cursor.pendingLength) {
+                cursor.pendingOffset = 0;
+                cursor.pendingLength = nextLine(cursor, cursor.pending, sizeof(cursor.pending));
+                if (cursor.pendingLength == 0) {
+                    break;
+                }
+            }
+            size_t count = cursor.pendingLength - cursor.pendingOffset;
+            if (count > size - written) {
+                count = size - written;
+            }
+            memcpy(out + written, cursor.pending + cursor.pendingOffset, count);
+            cursor.pendingOffset += count;
+            written += count;
+        }
+        return written;
+    }
+
+private:
+    // Upper bounds of all but the +Inf bucket
+    static uint32_t bucketBoundUs(size_t index) {
+        static const uint32_t BOUNDS[BUCKET_COUNT - 1] = {100, 250, 500, 1000, 2500, 10000, 50000};
+        return BOUNDS[index];
+    }
+
+    enum Section : uint8_t {
+        SECTION_GAUGES,
+        SECTION_REQUESTS,
+        SECTION_BYTES,
+        SECTION_DURATION,
+        SECTION_DONE
+    };
+
+    Route routes[MAX_ROUTES];
+    size_t routeCount;
+    uint32_t droppedRoutes;
+
+    // Next line of output, advancing the cursor; 0 at the end
+    size_t nextLine(Cursor& cursor, char* line, size_t size) const {
+        while (cursor.section != SECTION_DONE) {
+            int length = 0;
+            switch (cursor.section) {
+                case SECTION_GAUGES:
+                    length = gaugeLine(cursor, line, size);
+                    break;
+                case SECTION_REQUESTS:
+                    length = counterLine(cursor, line, size, "weighmybru_http_requests_total",
+                                         "Requests handled per route", false);
+                    break;
+                case SECTION_BYTES:
+                    length = counterLine(cursor, line, size, "weighmybru_http_response_bytes_total",
+                                         "Response body bytes generated per route", true);
+                    break;
+                case SECTION_DURATION:
+                    length = durationLine(cursor, line, size);
+                    break;
+                default:
+                    break;
+            }
+            if (length > 0) {
+                return (size_t)length < size ? (size_t)length : size - 1;
+            }
+            // Section exhausted
+            cursor.section++;
+            cursor.item = 0;
+            cursor.line = 0;
+        }
+        return 0;
+    }
+
+    // Routes never hit are left out to keep a scrape small
+    bool skipUnusedRoutes(Cursor& cursor) const {
+        while (cursor.item < routeCount && routes[cursor.item].count == 0) {
+            cursor.item++;
+        }
+        return cursor.item < routeCount;
+    }
+
+    int gaugeLine(Cursor& cursor, char* line, size_t size) const {
+        if (cursor.item > cursor.gaugeCount) {
+            return 0;
+        }
+        // The caller's gauges, then our own overflow count
+        Gauge dropped = {"weighmybru_metrics_dropped", "Routes and gauges left out of this scrape for lack of slots",
+                         "gauge", droppedRoutes + cursor.droppedGauges};
+        const Gauge& gauge = cursor.item < cursor.gaugeCount ? cursor.gauges[cursor.item] : dropped;
+        int length;
+        switch (cursor.line) {
+            case 0:
+                length = snprintf(line, size, "# HELP %s %s\n", gauge.name, gauge.help);
+                break;
+            case 1:
+                length = snprintf(line, size, "# TYPE %s %s\n", gauge.name, gauge.type);
+                break;
+            default:
+                length = snprintf(line, size, "%s %lu\n", gauge.name, (unsigned long)gauge.value);
+                cursor.item++;
+                cursor.line = 0;
+                return length;
+        }
+        cursor.line++;
+        return length;
+    }
+
+    int counterLine(Cursor& cursor, char* line, size_t size, const char* name, const char* help, bool bytes) const {
+        // line 0/1 are the family header, then one sample per route
+        if (cursor.line == 0) {
+            cursor.line++;
+            return snprintf(line, size, "# HELP %s %s\n", name, help);
+        }
+        if (cursor.line == 1) {
+            cursor.line++;
+            return snprintf(line, size, "# TYPE %s counter\n", name);
+        }
+        if (!skipUnusedRoutes(cursor)) {
+            return 0;
+        }
+        const Route& route = routes[cursor.item++];
+        return snprintf(line, size, "%s{route=\"%s\",method=\"%s\"} %llu\n", name, route.path, route.method,
+                        bytes ? (unsigned long long)route.bytes : (unsigned long long)route.count);
+    }
+
+    int durationLine(Cursor& cursor, char* line, size_t size) const {
+        static const char* NAME = "weighmybru_http_request_duration_microseconds";
+        if (cursor.line == 0 && cursor.item == 0) {
+            cursor.line = 1;
+            return snprintf(line, size, "# HELP %s Handler time per route\n", NAME);
+        }
+        if (cursor.line == 1 && cursor.item == 0) {
+            cursor.line = 2;
+            return snprintf(line, size, "# TYPE %s histogram\n", NAME);
+        }
+        if (!skipUnusedRoutes(cursor)) {
+            return 0;
+        }
+        const Route& route = routes[cursor.item];
+        // Lines per route: BUCKET_COUNT buckets, _sum, _count
+        size_t index = cursor.line >= 2 ? cursor.line - 2 : 0;
+        int length;
+        if (index < BUCKET_COUNT) {
+            uint32_t cumulative = 0;
+            for (size_t i = 0; i <= index; i++) {
+                cumulative += route.buckets[i];
+            }
+            char bound[12];
+            if (index < BUCKET_COUNT - 1) {
+                snprintf(bound, sizeof(bound), "%lu", (unsigned long)bucketBoundUs(index));
+            } else {
+                strcpy(bound, "+Inf");
+            }
+            length = snprintf(line, size, "%s_bucket{route=\"%s\",method=\"%s\",le=\"%s\"} %lu\n", NAME,
+                              route.path, route.method, bound, (unsigned long)cumulative);
+        } else if (index == BUCKET_COUNT) {
+            length = snprintf(line, size, "%s_sum{route=\"%s\",method=\"%s\"} %llu\n", NAME, route.path,
+                              route.method, (unsigned long long)route.sumUs);
+        } else {
+            length = snprintf(line, size, "%s_count{route=\"%s\",method=\"%s\"} %lu\n", NAME, route.path,
+                              route.method, (unsigned long)route.count);
+            cursor.item++;
+            cursor.line = 2;
+            return length;
+        }
+        cursor.line = index + 3;
+        return length;
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// One HX711 conversion as captured on the data-ready edge
+struct RawSample {
+    uint32_t timestampUs; // micros() when DOUT went low
+    int32_t raw;          // Sign-extended 24-bit conversion result
+};
+
+// Lock-free single-producer/single-consumer ring - the ISR pushes, the filter chain pops
+template <typename T, size_t N>
+class SampleRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SampleRing capacity must be a power of two");
+
+public:
+    SampleRing() : head(0), tail(0), dropped(0) {}
+
+    // Producer side - returns false (and counts a drop) when the ring is full
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (h - t >= N) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side - returns false when no item is pending
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (t == h) {
+            return false;
+        }
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side - discard everything currently pending
+    void clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t available() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+    uint32_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    T buffer[N];
+    std::atomic<uint32_t> head;    // Written by producer only
+    std::atomic<uint32_t> tail;    // Written by consumer only
+    std::atomic<uint32_t> dropped; // Written by producer only
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SAMPLING_TASK_H
+#define SAMPLING_TASK_H
+
+#include <Arduino.h>
+#include "WeightSnapshot.h"
+#include "SampleRing.h"
+
+class Scale; // Forward declaration
+class FlowRate; // Forward declaration
+
+// High-priority FreeRTOS task pinned to the application core.
+// Woken by the HX711 data-ready interrupt, it drains the sample ring through
+// Scale filtering and FlowRate, then publishes a WeightSnapshot. Sample-to-output
+// latency no longer depends on how long the display, WiFi or BLE work in loop() takes.
+class SamplingTask {
+public:
+    SamplingTask(Scale* scale, FlowRate* flowRate);
+    bool begin();
+    void end();
+    bool isRunning() const { return taskHandle != nullptr; }
+
+    // Wait-free for the writer, safe from any task
+    WeightSnapshot getSnapshot() const { return publisher.read(); }
+
+    // Block the calling task until the next snapshot is published or timeoutMs passes.
+    // One waiting task (loop()); true if a publish woke it.
+    bool waitForSnapshot(uint32_t timeoutMs);
+
+    // Every conversion in order with its own capture time, for a consumer that needs
+    // all of them rather than the newest (BLE batched notifications). The sequence
+    // counts conversions here, not publishes. Single consumer only.
+    bool popSample(WeightSnapshot& sample) { return sampleHistory.pop(sample); }
+    void clearSamples() { sampleHistory.clear(); }
+
+    // Latency from DOUT data-ready to snapshot publish
+    uint32_t getLastLatencyUs() const { return lastLatencyUs; }
+    uint32_t getMaxLatencyUs() const { return maxLatencyUs; }
+    void resetLatencyStats() { maxLatencyUs = 0; }
+
+private:
+    Scale* scalePtr;
+    FlowRate* flowRatePtr;
+    TaskHandle_t taskHandle;
+    volatile TaskHandle_t waiterHandle; // Notified on every publish
+    SnapshotPublisher publisher;
+    SampleRing<WeightSnapshot, 32> sampleHistory; // 400 ms at 80 SPS
+    uint32_t sequence;
+    uint32_t sampleSequence; // Conversions pushed to sampleHistory
+    uint32_t lastSampleTimestampUs;
+    volatile uint32_t lastLatencyUs;
+    volatile uint32_t maxLatencyUs;
+
+    static const uint32_t TASK_STACK_SIZE = 4096;
+    static const UBaseType_t TASK_PRIORITY = 5;   // Above loop() (1), below the radio stacks
+    static const BaseType_t TASK_CORE = 1;        // Application core - WiFi/BLE live on core 0
+    static const uint32_t IDLE_PUBLISH_MS = 100;  // Publish even without samples (HX711 missing)
+
+    static void taskEntry(void* arg);
+    static void onDataReady(void* arg); // Load cell callback, runs in interrupt context
+    static void onSample(void* arg, const RawSample& sample); // Scale callback, runs in this task
+    void run();
+    void publishSnapshot();
+};
+
+#endif
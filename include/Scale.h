@@ -1,22 +1,49 @@
 #ifndef SCALE_H
 #define SCALE_H
 
-#include <HX711.h>
-#include <Preferences.h>
+#include <Arduino.h>
+#include "ILoadCellSource.h"
+#include "ISettingsStore.h"
+#include "IClock.h"
+#include "SlidingMedian.h"
+#include "WeightFlowKalman.h"
+#include "FlowRate.h"
 
 class Scale {
 public:
-    Scale(uint8_t dataPin, uint8_t clockPin, float calibrationFactor);
-    bool begin();  // Returns true if successful, false if HX711 fails
-    void tare(uint8_t times = 20);
+    // Brewing state tracking for smart filtering
+    enum FilterState : uint8_t {
+        STABLE,     // Using average filter - stable weight
+        BREWING,    // Using median filter - active brewing
+        TRANSITIONING // Waiting for stability after brewing activity
+    };
+    
+    // Which estimator turns raw samples into weight (and, for Kalman, flow)
+    enum FilterMode : uint8_t {
+        FILTER_SMART,  // Median/average switching, flow fitted by FlowRate
+        FILTER_KALMAN  // Constant-velocity Kalman filter estimating weight and flow together
+    };
+    
+    // Called from getWeight() once per drained sample, after it went through the filter chain
+    typedef void (*SampleCallback)(void* context, const RawSample& sample);
+    
+    Scale(ILoadCellSource& source, ISettingsStore& settings, IClock& clock, float calibrationFactor);
+    bool begin(bool performInitialTare = true);  // Returns true if successful, false if HX711 fails
+    bool tare(uint8_t times = 20); // Non-blocking: offset is averaged from the next 'times' captured samples
+    bool isTaring() const { return tareRequested || tareInProgress; }
+    uint32_t getTareCount() const { return tareCount; } // Incremented when a tare completes
     void set_scale(float factor);
-    float getWeight();
+    float getWeight();  // Drain captured samples through the filter chain
     float getCurrentWeight();
     long getRawValue();
+    int32_t getOffset() const { return offset; }
+    void setOffset(int32_t rawOffset) { offset = rawOffset; } // Restore a known zero (trace replay)
     void saveCalibration(); // Save calibration factor to NVS
     void loadCalibration(); // Load calibration factor from NVS
     float getCalibrationFactor() const { return calibrationFactor; } // Getter for API
     bool isHX711Connected() const { return isConnected; } // Check if HX711 is responding
+    uint32_t getCapturedSamples() const { return source.getCapturedCount(); }
+    uint32_t getDroppedSamples() const { return source.getDroppedCount(); }
     
     // Filtering configuration - adjustable for different load cells
     void setBrewingThreshold(float threshold);
@@ -28,39 +55,77 @@ public:
     unsigned long getStabilityTimeout() const { return stabilityTimeout; }
     int getMedianSamples() const { return medianSamples; }
     int getAverageSamples() const { return averageSamples; }
+    
+    // Kalman filter mode - process noise q (g^2/s^3), measurement noise r (g^2)
+    void setFilterMode(FilterMode mode);
+    void setKalmanProcessNoise(float q);
+    void setKalmanMeasurementNoise(float r);
+    FilterMode getFilterMode() const { return filterMode; }
+    static const char* getFilterModeName(FilterMode mode);
+    float getKalmanProcessNoise() const { return kalman.getProcessNoise(); }
+    float getKalmanMeasurementNoise() const { return kalman.getMeasurementNoise(); }
+    float getKalmanFlowRate() const { return kalman.getFlowRate(); } // Only meaningful in FILTER_KALMAN mode
+    
+    // Flow regression window used in FILTER_SMART mode
+    void setFlowProfile(FlowRate::Profile profile);
+    FlowRate::Profile getFlowProfile() const { return flowProfile; }
     String getFilterState() const; // Get current filter state as string for debugging
+    FilterState getFilterStateId() const { return currentFilterState; }
+    static const char* getFilterStateName(FilterState state);
+    uint32_t getLastSampleTimestampUs() const { return lastSampleTimestampUs; }
+    void setDataReadyCallback(ILoadCellSource::DataReadyCallback callback, void* context) {
+        source.setDataReadyCallback(callback, context); // Wake a consumer per conversion
+    }
+    void setSampleCallback(SampleCallback callback, void* context) { // Every filtered sample, not just the newest
+        sampleCallback = callback;
+        sampleCallbackContext = context;
+    }
     
     void saveFilterSettings();
     void loadFilterSettings();
     
-    // FlowRate integration for tare operations
-    void setFlowRatePtr(class FlowRate* flowRatePtr);
+    // FlowRate is fed every sample and paused during tare operations
+    void setFlowRatePtr(FlowRate* flowRatePtr);
+    void setTraceRecorder(class TraceRecorder* recorder) { traceRecorderPtr = recorder; } // Record raw samples
     
 private:
-    HX711 hx711;
-    Preferences preferences;
-    uint8_t dataPin;
-    uint8_t clockPin;
+    ILoadCellSource& source; // HX711Capture on the device, SimulatedLoadCell on a host
+    ISettingsStore& settings;
+    IClock& clock;
     float calibrationFactor = 0.0f;
+    int32_t offset = 0;        // Raw count at zero load, set by tare
     float currentWeight;
     bool isConnected = false;  // Track HX711 connection status
-    class FlowRate* flowRatePtr = nullptr; // For pausing flow rate during tare
+    int32_t lastRawCount = 0;  // Most recent conversion, for calibration
+    bool hasRawCount = false;
+    uint32_t lastSampleTimestampUs = 0; // Capture time of the last filtered sample
+    FlowRate* flowRatePtr = nullptr; // Fed per sample, paused during tare
+    FlowRate::Profile flowProfile = FlowRate::PROFILE_SMOOTH;
+    class TraceRecorder* traceRecorderPtr = nullptr;
+    SampleCallback sampleCallback = nullptr;
+    void* sampleCallbackContext = nullptr;
+    
+    // Incremental tare job - requested from any task, run by the sample consumer
+    volatile bool tareRequested = false;
+    volatile uint8_t tareRequestSamples = 20;
+    volatile bool tareInProgress = false;
+    volatile uint32_t tareCount = 0;
+    uint8_t tareTargetSamples = 0;
+    uint8_t tareCollectedSamples = 0;
+    int64_t tareAccumulator = 0;
+    static const uint8_t INITIAL_TARE_SAMPLES = 10;
+    static const uint32_t INITIAL_TARE_TIMEOUT_MS = 3000;
     
-    // Smart filtering variables - reduced buffer for faster response
-    static const int MAX_SAMPLES = 10;  // Reduced from 50 to 10 for faster response
+    // Smart filtering variables
+    static const int MAX_SAMPLES = 64;  // Median is incremental, so 32-64 sample windows are cheap at 80 SPS
     float readings[MAX_SAMPLES];
+    SlidingMedian<MAX_SAMPLES> medianWindow; // Sorted view of the last medianSamples readings
     int readingIndex = 0;
     bool samplesInitialized = false;
     float previousFilteredWeight = 0;
     
-    // Brewing state tracking for smart filtering
-    enum FilterState {
-        STABLE,     // Using average filter - stable weight
-        BREWING,    // Using median filter - active brewing
-        TRANSITIONING // Waiting for stability after brewing activity
-    };
     FilterState currentFilterState = STABLE;
-    unsigned long lastBrewingActivity = 0;  // Track when brewing was last detected
+    uint32_t lastBrewingActivity = 0;       // Sample timestamp (us) when brewing was last detected
     float lastStableWeight = 0.0f;          // Last weight when in stable state
     
     // Configurable filtering parameters
@@ -69,10 +134,18 @@ private:
     int medianSamples = 3;  // Keep for API compatibility
     int averageSamples = 2;  // Samples for average filter - reduced for faster response
     
+    volatile FilterMode filterMode = FILTER_SMART; // Requested mode, set from any task
+    FilterMode activeFilterMode = FILTER_SMART;    // Mode the sample consumer is running
+    WeightFlowKalman kalman;
+    
     // Filter methods
+    void processSample(const RawSample& sample);
+    void startTareJob();
+    void accumulateTareSample(const RawSample& sample);
     float medianFilter(int samples);
     float averageFilter(int samples);
     void initializeSamples(float initialValue);
+    void rebuildMedianWindow();
 };
 
 #endif
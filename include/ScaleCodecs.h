@@ -0,0 +1,184 @@
+#ifndef SCALE_CODECS_H
+#define SCALE_CODECS_H
+
+#include "IScaleCodec.h"
+#include "ScalePayload.h"
+
+// Built-in codecs - the index is the weight channel and enabled-mask bit, so only append
+
+// WeighMyBru GATT service, shared by the GaggiMate and Bean Conqueror codecs
+struct WeighMyBruUuids {
+    static constexpr const char* SERVICE = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E";
+    static constexpr const char* COMMAND = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E";
+};
+
+// Commands on the WeighMyBru command characteristic, written by both apps:
+// [product 0x02|0x03] [SYSTEM] [BeanConquerorCommand] [0x01 = trigger] ...
+inline IScaleCodec::Command decodeWeighMyBruCommand(const uint8_t* data, size_t length) {
+    if (length < 4) {
+        return IScaleCodec::COMMAND_NONE;
+    }
+    // GaggiMate writes product 0x02, WeighMyBru clients 0x03
+    if (data[0] != 0x02 && data[0] != ScalePayload::PRODUCT_NUMBER) {
+        return IScaleCodec::COMMAND_NONE;
+    }
+    if (data[1] != static_cast<uint8_t>(WeighMyBruMessageType::SYSTEM) || data[3] != 0x01) {
+        return IScaleCodec::COMMAND_NONE;
+    }
+    switch (static_cast<BeanConquerorCommand>(data[2])) {
+        case BeanConquerorCommand::TARE: return IScaleCodec::COMMAND_TARE;
+        case BeanConquerorCommand::TIMER_START: return IScaleCodec::COMMAND_TIMER_START;
+        case BeanConquerorCommand::TIMER_STOP: return IScaleCodec::COMMAND_TIMER_STOP;
+        case BeanConquerorCommand::TIMER_RESET: return IScaleCodec::COMMAND_TIMER_RESET;
+        default: return IScaleCodec::COMMAND_NONE;
+    }
+}
+
+// GaggiMate: 20-byte WeighMyBru weight message, 0.01 g
+class GaggiMateCodec : public IScaleCodec {
+public:
+    const char* getName() const override { return "gaggimate"; }
+    const char* getServiceUuid() const override { return WeighMyBruUuids::SERVICE; }
+    const char* getWeightUuid() const override { return "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"; }
+    const char* getCommandUuid() const override { return WeighMyBruUuids::COMMAND; }
+    // Stops shots on weight - 20 Hz cap, deadband at display resolution
+    NotificationPolicy getDefaultPolicy() const override { return NotificationPolicy{0.1f, 50, 1000}; }
+
+    size_t encodeWeight(const WeightFrame& frame, uint8_t* out, size_t capacity) const override {
+        if (capacity < ScalePayload::WEIGHMYBRU_WEIGHT_LENGTH) {
+            return 0;
+        }
+        ScalePayload::encodeWeighMyBruWeight(frame.weight, out);
+        return ScalePayload::WEIGHMYBRU_WEIGHT_LENGTH;
+    }
+    Command decodeCommand(const uint8_t* data, size_t length) const override {
+        return decodeWeighMyBruCommand(data, length);
+    }
+};
+
+// Bean Conqueror: 4-byte little-endian float in grams
+class BeanConquerorCodec : public IScaleCodec {
+public:
+    const char* getName() const override { return "beanconqueror"; }
+    const char* getServiceUuid() const override { return WeighMyBruUuids::SERVICE; }
+    const char* getWeightUuid() const override { return "6E400004-B5A3-F393-E0A9-E50E24DCCA9E"; }
+    const char* getCommandUuid() const override { return WeighMyBruUuids::COMMAND; }
+    // Only displays and logs - half GaggiMate's rate is plenty
+    NotificationPolicy getDefaultPolicy() const override { return NotificationPolicy{0.1f, 100, 2000}; }
+
+    size_t encodeWeight(const WeightFrame& frame, uint8_t* out, size_t capacity) const override {
+        if (capacity < ScalePayload::BEAN_CONQUEROR_WEIGHT_LENGTH) {
+            return 0;
+        }
+        ScalePayload::encodeBeanConquerorWeight(frame.weight, out);
+        return ScalePayload::BEAN_CONQUEROR_WEIGHT_LENGTH;
+    }
+    Command decodeCommand(const uint8_t* data, size_t length) const override {
+        return decodeWeighMyBruCommand(data, length);
+    }
+};
+
+// Decent Scale emulation (published Decent Scale BLE API, v1.0 frames), for
+// apps that only know that scale. Off by default: it renames the device to
+// "Decent Scale", which is what those apps scan for.
+//   Weight: 03 CE|CA [int16 BE, 0.1 g] 00 00 [XOR]   (CE = stable, CA = changing)
+//   Tare:   03 0F xx 00 00 00 [XOR]
+//   Timer:  03 0B 03|00|02 00 00 00 [XOR]            (start, stop, reset)
+class DecentScaleCodec : public IScaleCodec {
+public:
+    static const size_t FRAME_LENGTH = 7;
+
+    const char* getName() const override { return "decent"; }
+    const char* getServiceUuid() const override { return "0000FFF0-0000-1000-8000-00805F9B34FB"; }
+    const char* getWeightUuid() const override { return "0000FFF4-0000-1000-8000-00805F9B34FB"; }
+    const char* getCommandUuid() const override { return "000036F5-0000-1000-8000-00805F9B34FB"; }
+    const char* getAdvertisedName() const override { return "Decent Scale"; }
+    // The real scale streams at about 10 Hz
+    NotificationPolicy getDefaultPolicy() const override { return NotificationPolicy{0.1f, 100, 1000}; }
+
+    size_t encodeWeight(const WeightFrame& frame, uint8_t* out, size_t capacity) const override {
+        if (capacity < FRAME_LENGTH) {
+            return 0;
+        }
+        float tenths = frame.weight * 10.0f;
+        int32_t weight = (int32_t)(tenths >= 0.0f ? tenths + 0.5f : tenths - 0.5f);
+        if (weight > INT16_MAX) weight = INT16_MAX;
+        if (weight < INT16_MIN) weight = INT16_MIN;
+        out[0] = MODEL;
+        out[1] = frame.brewing ? WEIGHT_CHANGING : WEIGHT_STABLE;
+        out[2] = (uint8_t)((weight >> 8) & 0xFF);
+        out[3] = (uint8_t)(weight & 0xFF);
+        out[4] = 0;
+        out[5] = 0;
+        out[6] = ScalePayload::checksum(out, FRAME_LENGTH - 1);
+        return FRAME_LENGTH;
+    }
+
+    Command decodeCommand(const uint8_t* data, size_t length) const override {
+        if (length < FRAME_LENGTH || data[0] != MODEL ||
+            ScalePayload::checksum(data, FRAME_LENGTH - 1) != data[FRAME_LENGTH - 1]) {
+            return COMMAND_NONE;
+        }
+        if (data[1] == COMMAND_TYPE_TARE) {
+            return COMMAND_TARE;
+        }
+        if (data[1] == COMMAND_TYPE_TIMER) {
+            switch (data[2]) {
+                case 0x03: return COMMAND_TIMER_START;
+                case 0x00: return COMMAND_TIMER_STOP;
+                case 0x02: return COMMAND_TIMER_RESET;
+                default: break;
+            }
+        }
+        return COMMAND_NONE; // LED, power and other commands are accepted and ignored
+    }
+
+private:
+    static const uint8_t MODEL = 0x03;
+    static const uint8_t WEIGHT_STABLE = 0xCE;
+    static const uint8_t WEIGHT_CHANGING = 0xCA;
+    static const uint8_t COMMAND_TYPE_TARE = 0x0F;
+    static const uint8_t COMMAND_TYPE_TIMER = 0x0B;
+};
+
+// Registry of every codec the firmware can speak
+class ScaleCodecs {
+public:
+    enum Index : uint8_t {
+        GAGGIMATE,
+        BEAN_CONQUEROR,
+        DECENT,
+        COUNT
+    };
+
+    static const uint8_t DEFAULT_ENABLED = (1 << GAGGIMATE) | (1 << BEAN_CONQUEROR);
+
+    static const IScaleCodec* get(uint8_t index) {
+        static const GaggiMateCodec gaggiMate;
+        static const BeanConquerorCodec beanConqueror;
+        static const DecentScaleCodec decent;
+        switch (index) {
+            case GAGGIMATE: return &gaggiMate;
+            case BEAN_CONQUEROR: return &beanConqueror;
+            case DECENT: return &decent;
+            default: return nullptr;
+        }
+    }
+
+    // Codec index by getName(), COUNT if unknown
+    static uint8_t find(const char* name, size_t length) {
+        for (uint8_t i = 0; i < COUNT; i++) {
+            const char* candidate = get(i)->getName();
+            size_t j = 0;
+            while (j < length && candidate[j] != '\0' && candidate[j] == name[j]) {
+                j++;
+            }
+            if (j == length && candidate[j] == '\0') {
+                return i;
+            }
+        }
+        return COUNT;
+    }
+};
+
+#endif
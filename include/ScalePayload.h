@@ -0,0 +1,160 @@
+#ifndef SCALE_PAYLOAD_H
+#define SCALE_PAYLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+enum class WeighMyBruMessageType : uint8_t {
+  SYSTEM = 0x0A,
+  WEIGHT = 0x0B,
+  WEIGHT_BATCH = 0x0C
+};
+
+enum class BeanConquerorCommand : uint8_t {
+  TARE = 0x01,
+  TIMER_START = 0x02,
+  TIMER_STOP = 0x03,
+  TIMER_RESET = 0x04
+};
+
+// One conversion for the batched characteristic
+struct BatchSample {
+    uint32_t sequence;    // WeightSnapshot sequence
+    uint32_t timestampUs; // Capture time
+    float weight;         // Grams
+};
+
+// Byte encoders for the BLE weight characteristics.
+// Pure functions over caller-owned buffers, kept apart from the NimBLE glue
+// in BluetoothScale so they also build and can be checked on a Linux host.
+class ScalePayload {
+public:
+    static const uint8_t PRODUCT_NUMBER = 0x03;
+    static const size_t WEIGHMYBRU_WEIGHT_LENGTH = 20;
+    static const size_t BEAN_CONQUEROR_WEIGHT_LENGTH = 4;
+
+    // Batched weight frame (extended characteristic), all fields little-endian:
+    //   [0] product  [1] WEIGHT_BATCH  [2] sample count  [3] flags (bit 0 = taring)
+    //   [4..7] sequence of the first sample  [8..11] its timestamp in us
+    //   [12..13] current flow, int16 0.01 g/s
+    //   per sample: [0] sequence delta  [1..2] uint16 us since the previous sample
+    //               [3..5] int24 weight, 0.01 g   (first sample: both deltas 0)
+    //   [last] XOR checksum
+    static const size_t BATCH_HEADER_LENGTH = 14;
+    static const size_t BATCH_SAMPLE_LENGTH = 6;
+    static const size_t BATCH_OVERHEAD = BATCH_HEADER_LENGTH + 1;
+    static const uint8_t BATCH_FLAG_TARING = 0x01;
+
+    // XOR of all bytes - WeighMyBru protocol checksum
+    static uint8_t checksum(const uint8_t* data, size_t length) {
+        uint8_t sum = data[0];
+        for (size_t i = 1; i < length; i++) {
+            sum ^= data[i];
+        }
+        return sum;
+    }
+
+    // GaggiMate: 20-byte WeighMyBru weight message, 0.01g resolution
+    static void encodeWeighMyBruWeight(float weight, uint8_t* out) {
+        // Convert weight to integer (grams * 100 for 0.01g precision)
+        int32_t weightInt = (int32_t)(weight * 100);
+
+        memset(out, 0, WEIGHMYBRU_WEIGHT_LENGTH);
+
+        // Header
+        out[0] = PRODUCT_NUMBER; // Product number
+        out[1] = static_cast<uint8_t>(WeighMyBruMessageType::WEIGHT); // Message type
+        // out[2..5] reserved
+
+        // Sign (positive = 43, negative = 45)
+        out[6] = (weightInt >= 0) ? 43 : 45;
+
+        // Weight data (3 bytes, big endian)
+        uint32_t absWeight = (uint32_t)(weightInt >= 0 ? weightInt : -weightInt);
+        out[7] = (absWeight >> 16) & 0xFF;
+        out[8] = (absWeight >> 8) & 0xFF;
+        out[9] = absWeight & 0xFF;
+
+        // Checksum over everything before the last byte
+        out[WEIGHMYBRU_WEIGHT_LENGTH - 1] = checksum(out, WEIGHMYBRU_WEIGHT_LENGTH - 1);
+    }
+
+    // Samples that fit a frame of at most capacity bytes (0 if not even one does)
+    static size_t batchCapacity(size_t capacity) {
+        return capacity > BATCH_OVERHEAD ? (capacity - BATCH_OVERHEAD) / BATCH_SAMPLE_LENGTH : 0;
+    }
+
+    // Encodes samples from the front of the list into one frame. Stops early where
+    // a delta does not fit its field (dropped samples, long gap) so the next frame
+    // starts with absolute values. Returns the frame length, consumed = samples used.
+    static size_t encodeWeightBatch(const BatchSample* samples, size_t count, float flowRate, bool taring,
+                                    uint8_t* out, size_t capacity, size_t& consumed) {
+        consumed = 0;
+        size_t maxSamples = batchCapacity(capacity);
+        if (count == 0 || maxSamples == 0) {
+            return 0;
+        }
+        if (count > maxSamples) {
+            count = maxSamples;
+        }
+        if (count > 255) {
+            count = 255;
+        }
+
+        out[0] = PRODUCT_NUMBER;
+        out[1] = static_cast<uint8_t>(WeighMyBruMessageType::WEIGHT_BATCH);
+        out[3] = taring ? BATCH_FLAG_TARING : 0;
+        writeLE32(out + 4, samples[0].sequence);
+        writeLE32(out + 8, samples[0].timestampUs);
+        int32_t flow = (int32_t)(flowRate * 100);
+        if (flow > INT16_MAX) flow = INT16_MAX;
+        if (flow < INT16_MIN) flow = INT16_MIN;
+        out[12] = (uint8_t)(flow & 0xFF);
+        out[13] = (uint8_t)((flow >> 8) & 0xFF);
+
+        uint8_t* cursor = out + BATCH_HEADER_LENGTH;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t sequenceDelta = 0;
+            uint32_t timeDelta = 0;
+            if (i > 0) {
+                sequenceDelta = samples[i].sequence - samples[i - 1].sequence;
+                timeDelta = samples[i].timestampUs - samples[i - 1].timestampUs;
+                if (sequenceDelta > 0xFF || timeDelta > 0xFFFF) {
+                    break;
+                }
+            }
+            int32_t weight = (int32_t)(samples[i].weight * 100);
+            if (weight > 0x7FFFFF) weight = 0x7FFFFF;
+            if (weight < -0x800000) weight = -0x800000;
+            cursor[0] = (uint8_t)sequenceDelta;
+            cursor[1] = (uint8_t)(timeDelta & 0xFF);
+            cursor[2] = (uint8_t)(timeDelta >> 8);
+            cursor[3] = (uint8_t)(weight & 0xFF);
+            cursor[4] = (uint8_t)((weight >> 8) & 0xFF);
+            cursor[5] = (uint8_t)((weight >> 16) & 0xFF);
+            cursor += BATCH_SAMPLE_LENGTH;
+            consumed++;
+        }
+        out[2] = (uint8_t)consumed;
+
+        size_t length = (size_t)(cursor - out);
+        out[length] = checksum(out, length);
+        return length + 1;
+    }
+
+    // Bean Conqueror: 4-byte IEEE float, little-endian (native order on ESP32 and x86)
+    static void encodeBeanConquerorWeight(float weight, uint8_t* out) {
+        memcpy(out, &weight, BEAN_CONQUEROR_WEIGHT_LENGTH);
+    }
+
+private:
+    static void writeLE32(uint8_t* out, uint32_t value) {
+        out[0] = (uint8_t)(value & 0xFF);
+        out[1] = (uint8_t)((value >> 8) & 0xFF);
+        out[2] = (uint8_t)((value >> 16) & 0xFF);
+        out[3] = (uint8_t)(value >> 24);
+    }
+};
+
+#endif
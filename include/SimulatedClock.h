@@ -0,0 +1,23 @@
+#ifndef SIMULATED_CLOCK_H
+#define SIMULATED_CLOCK_H
+
+#include "IClock.h"
+
+// Manually stepped clock for host builds and replays.
+// Time only moves when the test advances it, so runs are fully deterministic.
+class SimulatedClock : public IClock {
+public:
+    explicit SimulatedClock(uint32_t startUs = 0) : us(startUs) {}
+
+    uint32_t nowMs() const override { return us / 1000UL; }
+    uint32_t nowUs() const override { return us; }
+    void sleepMs(uint32_t ms) override { us += ms * 1000UL; }
+
+    void setUs(uint32_t timeUs) { us = timeUs; }
+    void advanceUs(uint32_t deltaUs) { us += deltaUs; }
+
+private:
+    uint32_t us;
+};
+
+#endif
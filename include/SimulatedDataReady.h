@@ -0,0 +1,60 @@
+#ifndef SIMULATED_DATA_READY_H
+#define SIMULATED_DATA_READY_H
+
+#include <stdint.h>
+#include "SampleRing.h"
+
+// Simulated HX711 data-ready source for host-side testing of the capture path.
+// Emits one conversion every (1e6 / samplesPerSecond) microseconds into the
+// same SampleRing the DOUT interrupt feeds on hardware. The raw count for each
+// conversion comes from a user supplied generator so tests can model load
+// profiles, noise or recorded traces. No Arduino dependencies.
+template <size_t N>
+class SimulatedDataReady {
+public:
+    typedef int32_t (*Generator)(uint32_t timestampUs, void* context);
+
+    SimulatedDataReady(SampleRing<RawSample, N>& ring, uint32_t samplesPerSecond,
+                       Generator generator, void* context = nullptr)
+        : ring(ring), periodUs(1000000UL / (samplesPerSecond > 0 ? samplesPerSecond : 1)),
+          generator(generator), context(context), nextConversionUs(0), conversions(0) {}
+
+    // Emit every conversion that would have completed up to nowUs.
+    // Returns the number of data-ready events fired.
+    uint32_t advanceTo(uint32_t nowUs) {
+        uint32_t fired = 0;
+        while ((int32_t)(nowUs - nextConversionUs) >= 0) {
+            fireDataReady(nextConversionUs);
+            nextConversionUs += periodUs;
+            fired++;
+        }
+        return fired;
+    }
+
+    // Schedule the next conversion one period after nowUs without emitting anything
+    void syncTo(uint32_t nowUs) {
+        nextConversionUs = nowUs + periodUs;
+    }
+
+    // Fire a single data-ready edge at an explicit timestamp (jitter tests)
+    void fireDataReady(uint32_t timestampUs) {
+        RawSample sample;
+        sample.timestampUs = timestampUs;
+        sample.raw = generator ? generator(timestampUs, context) : 0;
+        ring.push(sample);
+        conversions++;
+    }
+
+    uint32_t getConversionCount() const { return conversions; }
+    uint32_t getPeriodUs() const { return periodUs; }
+
+private:
+    SampleRing<RawSample, N>& ring;
+    uint32_t periodUs;
+    Generator generator;
+    void* context;
+    uint32_t nextConversionUs;
+    uint32_t conversions;
+};
+
+#endif
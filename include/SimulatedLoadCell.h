@@ -0,0 +1,68 @@
+#ifndef SIMULATED_LOAD_CELL_H
+#define SIMULATED_LOAD_CELL_H
+
+#include "ILoadCellSource.h"
+#include "IClock.h"
+#include "SimulatedDataReady.h"
+
+// ILoadCellSource for host builds. Conversions are produced lazily from the
+// clock: whenever the consumer looks at the source, every conversion that
+// would have completed by clock.nowUs() is generated into the ring, exactly
+// as the DOUT interrupt would have pushed them on hardware.
+class SimulatedLoadCell : public ILoadCellSource {
+public:
+    static const size_t RING_SIZE = 64; // Same headroom as HX711Capture
+
+    typedef SimulatedDataReady<RING_SIZE>::Generator Generator;
+
+    SimulatedLoadCell(IClock& clock, uint32_t samplesPerSecond, Generator generator, void* context = nullptr)
+        : clock(clock), source(ring, samplesPerSecond, generator, context), connected(true), running(false),
+          callback(nullptr), callbackContext(nullptr) {}
+
+    void setConnected(bool isConnected) { connected = isConnected; } // Simulate a missing HX711
+
+    bool begin() override { return connected; }
+    void start() override {
+        ring.clear();
+        source.syncTo(clock.nowUs()); // Nothing from before start() reaches the filter
+        running = true;
+    }
+    void stop() override { running = false; }
+    bool isRunning() const override { return running; }
+
+    bool readSample(RawSample& sample) override {
+        poll();
+        return ring.pop(sample);
+    }
+    size_t pendingSamples() const override { return ring.available(); }
+    uint32_t getCapturedCount() const override { return source.getConversionCount(); }
+    uint32_t getDroppedCount() const override { return ring.getDroppedCount(); }
+
+    void setDataReadyCallback(DataReadyCallback cb, void* context) override {
+        callback = cb;
+        callbackContext = context;
+    }
+
+    // Generate conversions up to the current clock time, firing the callback once if any arrived
+    uint32_t poll() {
+        if (!running) {
+            return 0;
+        }
+        uint32_t fired = source.advanceTo(clock.nowUs());
+        if (fired > 0 && callback != nullptr) {
+            callback(callbackContext);
+        }
+        return fired;
+    }
+
+private:
+    IClock& clock;
+    SampleRing<RawSample, RING_SIZE> ring;
+    SimulatedDataReady<RING_SIZE> source;
+    bool connected;
+    bool running;
+    DataReadyCallback callback;
+    void* callbackContext;
+};
+
+#endif
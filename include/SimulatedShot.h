@@ -0,0 +1,89 @@
+#ifndef SIMULATED_SHOT_H
+#define SIMULATED_SHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Synthetic shot for host builds - cup, piecewise-linear pour and load cell noise
+class SimulatedShot {
+public:
+    static constexpr float CALIBRATION_FACTOR = 4195.712891f;
+    static const int32_t ZERO_COUNT = 84000; // Raw count with an empty platform
+
+    struct FlowPoint {
+        uint32_t atUs;
+        float gramsPerSec; // Linear to the next point, held after the last one
+    };
+
+    // profile must outlive the shot; seed != 0 (xorshift PRNG for repeatable noise)
+    SimulatedShot(float cupGrams, uint32_t cupAtUs, const FlowPoint* profile, size_t points,
+                  float noiseGrams, uint32_t seed)
+        : cupGrams(cupGrams), cupAtUs(cupAtUs), profile(profile), points(points),
+          noiseGrams(noiseGrams), noiseState(seed) {}
+
+    // Two points with the same time make an instant step
+    float flowAt(uint32_t timestampUs) const {
+        if (points == 0 || timestampUs < profile[0].atUs) {
+            return 0.0f;
+        }
+        for (size_t i = 0; i + 1 < points; i++) {
+            if (timestampUs < profile[i + 1].atUs) {
+                return segmentFlow(i, timestampUs);
+            }
+        }
+        return profile[points - 1].gramsPerSec;
+    }
+
+    // Poured weight only (the cup is tared away before the pour)
+    float pouredAt(uint32_t timestampUs) const {
+        double grams = 0.0;
+        for (size_t i = 0; i < points && timestampUs > profile[i].atUs; i++) {
+            uint32_t endUs = timestampUs;
+            if (i + 1 < points && profile[i + 1].atUs < endUs) {
+                endUs = profile[i + 1].atUs;
+            }
+            // Exact for a linear segment: mean of its end values times its length
+            grams += (segmentFlow(i, profile[i].atUs) + segmentFlow(i, endUs)) / 2.0 *
+                     (endUs - profile[i].atUs) / 1e6;
+        }
+        return (float)grams;
+    }
+
+    float weightAt(uint32_t timestampUs) const {
+        return (timestampUs >= cupAtUs ? cupGrams : 0.0f) + pouredAt(timestampUs);
+    }
+
+    // Uniform in +-noiseGrams
+    float noise() {
+        noiseState ^= noiseState << 13;
+        noiseState ^= noiseState >> 17;
+        noiseState ^= noiseState << 5;
+        return ((noiseState & 0xFFFF) / 65535.0f - 0.5f) * 2.0f * noiseGrams;
+    }
+
+    // SimulatedLoadCell generator - context is the SimulatedShot
+    static int32_t generate(uint32_t timestampUs, void* context) {
+        SimulatedShot& shot = *static_cast<SimulatedShot*>(context);
+        float grams = shot.weightAt(timestampUs) + shot.noise();
+        return ZERO_COUNT + (int32_t)(grams * CALIBRATION_FACTOR);
+    }
+
+private:
+    // Flow on segment i (from point i towards point i + 1) at timestampUs
+    float segmentFlow(size_t i, uint32_t timestampUs) const {
+        if (i + 1 >= points || profile[i + 1].atUs == profile[i].atUs) {
+            return profile[i].gramsPerSec;
+        }
+        float fraction = (float)(timestampUs - profile[i].atUs) / (profile[i + 1].atUs - profile[i].atUs);
+        return profile[i].gramsPerSec + fraction * (profile[i + 1].gramsPerSec - profile[i].gramsPerSec);
+    }
+
+    float cupGrams;
+    uint32_t cupAtUs;
+    const FlowPoint* profile;
+    size_t points;
+    float noiseGrams;
+    uint32_t noiseState;
+};
+
+#endif
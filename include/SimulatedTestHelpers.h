@@ -0,0 +1,29 @@
+#ifndef SIMULATED_TEST_HELPERS_H
+#define SIMULATED_TEST_HELPERS_H
+
+#include <stdint.h>
+
+// Timeline of the simulated shots: cup placed at 2 s, tared away at 4 s
+static const uint32_t SECOND_US = 1000000;
+static const uint32_t CUP_AT_US = 2 * SECOND_US;
+static const uint32_t TARE_AT_US = 4 * SECOND_US;
+
+// Repeatable xorshift32 sequence for test inputs and SimulatedShot noise seeds
+class XorShift32 {
+public:
+    static const uint32_t DEFAULT_SEED = 2463534242u;
+
+    explicit XorShift32(uint32_t seed = DEFAULT_SEED) : state(seed) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+private:
+    uint32_t state;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef SLIDING_MEDIAN_H
+#define SLIDING_MEDIAN_H
+
+#include <stddef.h>
+#include <string.h>
+
+// Sliding-window median with binary-search insertion - no re-sort per sample
+template <size_t N>
+class SlidingMedian {
+public:
+    SlidingMedian() : window(1), count(0), next(0) {}
+
+    // Resize the window and fill it with a single value
+    void reset(size_t windowSize, float value) {
+        window = clampWindow(windowSize);
+        for (size_t i = 0; i < window; i++) {
+            order[i] = value;
+            sorted[i] = value;
+        }
+        count = window;
+        next = 0;
+    }
+
+    // Resize the window and rebuild it from the most recent values (oldest first)
+    void rebuild(size_t windowSize, const float* values, size_t valueCount) {
+        window = clampWindow(windowSize);
+        count = 0;
+        next = 0;
+        size_t start = valueCount > window ? valueCount - window : 0;
+        for (size_t i = start; i < valueCount; i++) {
+            push(values[i]);
+        }
+    }
+
+    // Add the newest sample, evicting the oldest once the window is full
+    void push(float value) {
+        if (count == window) {
+            removeSorted(order[next]);
+        }
+        insertSorted(value);
+        order[next] = value;
+        next = (next + 1) % window;
+    }
+
+    // Upper median for even windows, matching the previous bubble-sort filter
+    float median() const {
+        return count > 0 ? sorted[count / 2] : 0.0f;
+    }
+
+    size_t size() const { return count; }
+    size_t getWindow() const { return window; }
+    static constexpr size_t capacity() { return N; }
+
+private:
+    float order[N];   // Samples in arrival order, oldest at 'next' once full
+    float sorted[N];  // Same samples in ascending order
+    size_t window;
+    size_t count;
+    size_t next;
+
+    static size_t clampWindow(size_t windowSize) {
+        if (windowSize < 1) return 1;
+        if (windowSize > N) return N;
+        return windowSize;
+    }
+
+    // First index whose value is >= value
+    size_t lowerBound(float value) const {
+        size_t lo = 0;
+        size_t hi = count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (sorted[mid] < value) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    void insertSorted(float value) {
+        size_t pos = lowerBound(value);
+        memmove(&sorted[pos + 1], &sorted[pos], (count - pos) * sizeof(float));
+        sorted[pos] = value;
+        count++;
+    }
+
+    void removeSorted(float value) {
+        size_t pos = lowerBound(value);
+        if (pos >= count) {
+            pos = count - 1; // NaN never reaches here (filtered upstream), but stay in bounds
+        }
+        memmove(&sorted[pos], &sorted[pos + 1], (count - pos - 1) * sizeof(float));
+        count--;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SLOPE_WINDOW_H
+#define SLOPE_WINDOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Least-squares slope over a sliding time window, O(1) per sample
+template <size_t N>
+class SlopeWindow {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SlopeWindow capacity must be a power of two");
+
+public:
+    SlopeWindow() : windowUs(1000000UL) { clear(); }
+
+    void setWindowUs(uint32_t window) { windowUs = window > 0 ? window : 1; }
+    uint32_t getWindowUs() const { return windowUs; }
+
+    void clear() {
+        head = 0;
+        count = 0;
+        baseUs = 0;
+        sumT = sumV = sumTT = sumTV = 0.0;
+    }
+
+    // Add the newest sample and drop everything older than the window
+    void push(uint32_t timestampUs, float value) {
+        if (count == 0) {
+            baseUs = timestampUs;
+        } else if ((uint32_t)(timestampUs - baseUs) > REBASE_US) {
+            rebase(times[tailIndex()]);
+        }
+
+        if (count == N) {
+            remove(tailIndex()); // Capacity bound - window longer than N samples
+        }
+        size_t index = head;
+        times[index] = timestampUs;
+        values[index] = value;
+        head = (head + 1) & (N - 1);
+        count++;
+        accumulate(index, 1.0);
+
+        while (count > 1 && (uint32_t)(timestampUs - times[tailIndex()]) > windowUs) {
+            remove(tailIndex());
+        }
+    }
+
+    // Slope in value units per second, 0 until two distinct timestamps are in the window
+    float slopePerSecond() const {
+        if (count < 2) {
+            return 0.0f;
+        }
+        double n = (double)count;
+        double denominator = n * sumTT - sumT * sumT;
+        if (denominator <= 1e-12) {
+            return 0.0f;
+        }
+        return (float)((n * sumTV - sumT * sumV) / denominator);
+    }
+
+    // Fitted value at the newest sample time (regression line, not the raw sample)
+    float fittedValue() const {
+        if (count == 0) {
+            return 0.0f;
+        }
+        double n = (double)count;
+        double slope = slopePerSecond();
+        double intercept = (sumV - slope * sumT) / n;
+        return (float)(intercept + slope * seconds(times[(head + N - 1) & (N - 1)]));
+    }
+
+    size_t size() const { return count; }
+    uint32_t spanUs() const {
+        return count > 1 ? times[(head + N - 1) & (N - 1)] - times[tailIndex()] : 0;
+    }
+
+private:
+    static const uint32_t REBASE_US = 60000000UL; // Move the time base forward once a minute
+
+    uint32_t times[N];
+    float values[N];
+    size_t head;
+    size_t count;
+    uint32_t windowUs;
+    uint32_t baseUs;
+    double sumT;
+    double sumV;
+    double sumTT;
+    double sumTV;
+
+    size_t tailIndex() const { return (head + N - count) & (N - 1); }
+
+    double seconds(uint32_t timestampUs) const {
+        return (uint32_t)(timestampUs - baseUs) / 1000000.0;
+    }
+
+    void accumulate(size_t index, double sign) {
+        double t = seconds(times[index]);
+        double v = values[index];
+        sumT += sign * t;
+        sumV += sign * v;
+        sumTT += sign * t * t;
+        sumTV += sign * t * v;
+    }
+
+    void remove(size_t index) {
+        accumulate(index, -1.0);
+        count--;
+    }
+
+    // O(n), once per REBASE_US - recompute the sums exactly against a new base
+    void rebase(uint32_t newBaseUs) {
+        baseUs = newBaseUs;
+        sumT = sumV = sumTT = sumTV = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            accumulate((tailIndex() + i) & (N - 1), 1.0);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef STATIC_ASSET_HANDLER_H
+#define STATIC_ASSET_HANDLER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ESPAsyncWebServer.h>
+#include "RouteMetrics.h"
+
+// Serves the web UI from the filesystem image built by scripts/web_assets.py.
+// Text assets are stored only as .gz and sent with Content-Encoding: gzip.
+// The image's build hash (/asset-hash) is the ETag for every file:
+//   /output.css?v=<hash>  Cache-Control: immutable for a year (pages link assets this way)
+//   anything else         Cache-Control: no-cache, 304 when If-None-Match matches
+// An image uploaded straight from data/ has no hash and is served without cache headers.
+class StaticAssetHandler : public AsyncWebHandler {
+public:
+    explicit StaticAssetHandler(fs::FS& fs);
+    void loadBuildHash(); // Call once the filesystem is mounted
+    const char* getBuildHash() const { return buildHash; }
+    void setMetrics(RouteMetrics* metrics); // Records every file served under route "static"
+    // Send one file (gzipped variant if that is what is stored) with cache headers; returns body bytes
+    size_t sendFile(AsyncWebServerRequest* request, const char* path);
+
+    bool canHandle(AsyncWebServerRequest* request) override;
+    void handleRequest(AsyncWebServerRequest* request) override;
+
+private:
+    static const size_t MAX_PATH = 64;
+
+    fs::FS& fs;
+    char buildHash[17]; // Empty when the image has no /asset-hash
+    char etag[20];      // Quoted hash
+    RouteMetrics* metrics;
+    RouteMetrics::Route* metricsRoute;
+
+    bool resolvePath(AsyncWebServerRequest* request, char* path, size_t size);
+    void addCacheHeaders(AsyncWebServerResponse* response, bool versioned);
+};
+
+#endif
@@ -33,12 +33,16 @@ private:
     // Delayed tare functionality for mounted touch sensors
     bool delayedTarePending;
     unsigned long delayedTareTime;
+    bool tareAwaitingCompletion; // Tare job running - show "Tared!" when it finishes
+    uint32_t tareCountAtRequest;
     static const unsigned long TARE_DELAY = 1500; // 1.5 seconds delay after touch release
     static const unsigned long WIFI_TOGGLE_DURATION = 5000; // 5 seconds for WiFi toggle (longer than status page)
     
     void handleTouch();
     void scheduleDelayedTare();
     void checkDelayedTare();
+    void requestTare();
+    void checkTareCompletion();
     void handleLongPress();
     void handleStatusPageToggle(); // Handle status page toggle on medium press
     void handleWiFiToggle(); // Handle WiFi toggle on long press (5 seconds)
@@ -0,0 +1,109 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Binary layout of a raw HX711 trace (/api/trace download, replay input).
+// A fixed 44-byte header followed by 8-byte records, all little-endian
+// (native order on both the ESP32-S3 and x86 hosts, so both sides memcpy).
+//
+//   header: "WMBT" | version | headerSize | recordSize | filterMode
+//           calibrationFactor f32 | offset i32 | recordCount u32
+//           brewingThreshold f32 | stabilityTimeout u32 (ms)
+//           medianSamples u16 | averageSamples u16
+//           kalmanProcessNoise f32 | kalmanMeasurementNoise f32
+//           flowProfile u8 | 3 reserved bytes
+//   record: timestampUs u32 | raw i32
+//
+// HX711 counts are sign-extended 24-bit values, so a raw field with
+// TRACE_TARE_MARKER in its top byte cannot be a conversion. Such records mark
+// a tare request; the low byte holds the number of samples it averages.
+
+static const uint8_t TRACE_VERSION = 2; // 2: flowProfile added
+static const uint32_t TRACE_TARE_MARKER = 0x40000000UL;
+
+struct TraceHeader {
+    char magic[4];
+    uint8_t version;
+    uint8_t headerSize;
+    uint8_t recordSize;
+    uint8_t filterMode;          // Scale::FilterMode
+    float calibrationFactor;
+    int32_t offset;              // Tare offset when recording started
+    uint32_t recordCount;
+    float brewingThreshold;
+    uint32_t stabilityTimeout;
+    uint16_t medianSamples;
+    uint16_t averageSamples;
+    float kalmanProcessNoise;
+    float kalmanMeasurementNoise;
+    uint8_t flowProfile;         // FlowRate::Profile
+    uint8_t reserved[3];
+};
+
+struct TraceRecord {
+    uint32_t timestampUs;
+    int32_t raw;
+};
+
+static_assert(sizeof(TraceHeader) == 44, "TraceHeader layout must match the file format");
+static_assert(sizeof(TraceRecord) == 8, "TraceRecord layout must match the file format");
+
+inline void initTraceHeader(TraceHeader& header) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "WMBT", 4);
+    header.version = TRACE_VERSION;
+    header.headerSize = sizeof(TraceHeader);
+    header.recordSize = sizeof(TraceRecord);
+}
+
+inline bool isTareMarker(const TraceRecord& record) {
+    return ((uint32_t)record.raw & 0xFF000000UL) == TRACE_TARE_MARKER;
+}
+
+inline uint8_t getTareMarkerSamples(const TraceRecord& record) {
+    return (uint8_t)((uint32_t)record.raw & 0xFF);
+}
+
+// Read-only view over a trace held in memory (downloaded file or recorder buffer)
+class TraceReader {
+public:
+    TraceReader() : records(nullptr), count(0), valid(false) { initTraceHeader(header); }
+
+    bool parse(const uint8_t* data, size_t length) {
+        valid = false;
+        if (data == nullptr || length < sizeof(TraceHeader)) {
+            return false;
+        }
+        memcpy(&header, data, sizeof(TraceHeader));
+        if (memcmp(header.magic, "WMBT", 4) != 0 || header.version != TRACE_VERSION ||
+            header.headerSize != sizeof(TraceHeader) || header.recordSize != sizeof(TraceRecord)) {
+            return false;
+        }
+        size_t available = (length - sizeof(TraceHeader)) / sizeof(TraceRecord);
+        count = header.recordCount < available ? header.recordCount : available; // Tolerate truncated downloads
+        records = data + sizeof(TraceHeader);
+        valid = true;
+        return true;
+    }
+
+    bool isValid() const { return valid; }
+    const TraceHeader& getHeader() const { return header; }
+    size_t size() const { return count; }
+
+    TraceRecord at(size_t index) const {
+        TraceRecord record;
+        memcpy(&record, records + index * sizeof(TraceRecord), sizeof(TraceRecord));
+        return record;
+    }
+
+private:
+    TraceHeader header;
+    const uint8_t* records;
+    size_t count;
+    bool valid;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "SampleRing.h"
+#include "TraceFormat.h"
+
+class Scale; // Forward declaration
+
+// Records every raw HX711 conversion (and tare requests) of a timer session
+// into a caller-provided buffer - PSRAM on the device - so real shots can be
+// downloaded and replayed offline through the filter pipeline.
+// Start/stop may be called from any task; samples are written only by the
+// sample consumer, which also opens a new trace, so the header snapshot of
+// offset and filter settings always matches the first recorded sample.
+class TraceRecorder {
+public:
+    TraceRecorder();
+    void setBuffer(uint8_t* buffer, size_t bytes); // Caller owns the memory
+    void setScale(Scale* scale) { scalePtr = scale; }
+    bool isAvailable() const { return records != nullptr; }
+
+    // Control - any task
+    void start();  // Begin a new trace with the next sample
+    void resume(); // Continue the current trace after a timer pause
+    void stop();
+    bool isRecording() const { return recording.load(std::memory_order_acquire); }
+    bool hasOverflowed() const { return overflowed; }
+    uint32_t getRecordCount() const { return count.load(std::memory_order_acquire); }
+    uint32_t getCapacity() const { return capacity; }
+
+    // Serialized trace (header + records), readable in chunks while not recording
+    size_t getTraceSize() const;
+    size_t readTrace(uint8_t* out, size_t maxLen, size_t index) const;
+
+    // Writer side - sample consumer only
+    void recordSample(const RawSample& sample);
+    void recordTare(uint8_t samples);
+
+private:
+    Scale* scalePtr;
+    uint8_t* records;
+    uint32_t capacity;
+    TraceHeader header;
+    std::atomic<uint32_t> count;
+    std::atomic<bool> recording;
+    std::atomic<bool> startRequested;
+    volatile bool overflowed;
+
+    void beginTrace();
+    void append(uint32_t timestampUs, int32_t raw);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include "TraceFormat.h"
+#include "ILoadCellSource.h"
+#include "SimulatedClock.h"
+#include "MemorySettingsStore.h"
+#include "Scale.h"
+#include "FlowRate.h"
+
+// One filtered output per replayed conversion
+struct ReplayPoint {
+    uint32_t timestampUs;
+    int32_t raw;
+    float weight;
+    float flowRate;
+    uint8_t filterState; // Scale::FilterState
+};
+
+// Deterministic replay of a recorded trace through the real Scale filter chain
+// and FlowRate, on simulated time. Filter settings start from the values in
+// the trace header; override them through getSettings() (same keys as NVS,
+// namespace "scale") before run() to try other tunings on the same shot.
+// The filter window starts empty, so the first few outputs can differ from
+// what the device showed until the window has refilled.
+class TraceReplay {
+public:
+    typedef void (*Sink)(const ReplayPoint& point, void* context);
+
+    explicit TraceReplay(const TraceReader& trace) : trace(trace) {
+        const TraceHeader& header = trace.getHeader();
+        settings.begin("scale", false);
+        settings.putFloat("calib", header.calibrationFactor);
+        settings.putFloat("brew_thresh", header.brewingThreshold);
+        settings.putULong("stab_timeout", header.stabilityTimeout);
+        settings.putInt("median_samples", header.medianSamples);
+        settings.putInt("avg_samples", header.averageSamples);
+        settings.putUChar("filter_mode", header.filterMode);
+        settings.putFloat("kf_q", header.kalmanProcessNoise);
+        settings.putFloat("kf_r", header.kalmanMeasurementNoise);
+        settings.putUChar("flow_profile", header.flowProfile);
+        settings.end();
+    }
+
+    MemorySettingsStore& getSettings() { return settings; }
+
+    // Returns the number of conversions replayed
+    uint32_t run(Sink sink, void* context = nullptr) {
+        const TraceHeader& header = trace.getHeader();
+        SimulatedClock clock;
+        ReplaySource source;
+        Scale scale(source, settings, clock, header.calibrationFactor);
+        FlowRate flowRate;
+        scale.setFlowRatePtr(&flowRate);
+
+        // Start from the recorded zero instead of taring on the first samples
+        scale.begin(false);
+        scale.setOffset(header.offset);
+
+        uint32_t replayed = 0;
+        for (size_t i = 0; i < trace.size(); i++) {
+            TraceRecord record = trace.at(i);
+            if (isTareMarker(record)) {
+                scale.tare(getTareMarkerSamples(record));
+                continue;
+            }
+
+            clock.setUs(record.timestampUs);
+            RawSample sample;
+            sample.timestampUs = record.timestampUs;
+            sample.raw = record.raw;
+            source.feed(sample);
+
+            // Same per-pass sequence as SamplingTask::run()
+            float weight = scale.getWeight();
+
+            ReplayPoint point;
+            point.timestampUs = record.timestampUs;
+            point.raw = record.raw;
+            point.weight = weight;
+            point.flowRate = flowRate.getFlowRate();
+            point.filterState = (uint8_t)scale.getFilterStateId();
+            if (sink != nullptr) {
+                sink(point, context);
+            }
+            replayed++;
+        }
+        return replayed;
+    }
+
+private:
+    // Hands the trace to Scale one conversion at a time
+    class ReplaySource : public ILoadCellSource {
+    public:
+        bool begin() override { return true; }
+        void start() override { running = true; }
+        void stop() override { running = false; }
+        bool isRunning() const override { return running; }
+        bool readSample(RawSample& sample) override { return ring.pop(sample); }
+        size_t pendingSamples() const override { return ring.available(); }
+        uint32_t getCapturedCount() const override { return fed; }
+        uint32_t getDroppedCount() const override { return ring.getDroppedCount(); }
+        void setDataReadyCallback(DataReadyCallback, void*) override {}
+
+        void feed(const RawSample& sample) {
+            ring.push(sample);
+            fed++;
+        }
+
+    private:
+        SampleRing<RawSample, 4> ring;
+        bool running = false;
+        uint32_t fed = 0;
+    };
+
+    const TraceReader& trace;
+    MemorySettingsStore settings;
+};
+
+#endif
@@ -6,10 +6,15 @@
 #include "BluetoothScale.h"
 #include "Display.h"
 #include "BatteryMonitor.h"
+#include "SamplingTask.h"
+#include "TraceRecorder.h"
+#include "LiveStream.h"
+#include "BrewEvents.h"
+#include "ControlCommands.h"
 
 extern float calibrationFactor;
 
-void setupWebServer(Scale &scale, FlowRate &flowRate, BluetoothScale &bluetoothScale, Display &display, BatteryMonitor &battery);
+void setupWebServer(Scale &scale, FlowRate &flowRate, SamplingTask &samplingTask, TraceRecorder &traceRecorder, LiveStream &liveStream, BrewEvents &brewEvents, BluetoothScale &bluetoothScale, Display &display, BatteryMonitor &battery, ControlCommands &commands);
 void startWebServer();
 void stopWebServer();
 
@@ -0,0 +1,135 @@
+#ifndef WEIGHT_FLOW_KALMAN_H
+#define WEIGHT_FLOW_KALMAN_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Kalman filter for weight and flow that hands over to a fast twin when the pour changes
+class WeightFlowKalman {
+public:
+    WeightFlowKalman()
+        : processNoise(DEFAULT_PROCESS_NOISE), measurementNoise(DEFAULT_MEASUREMENT_NOISE),
+          lastTimestampUs(0), evidence(0.0f), initialized(false) {
+        steady.reset(0.0f, measurementNoise);
+        fast.reset(0.0f, measurementNoise);
+    }
+
+    // q: white-noise flow acceleration spectral density (g^2/s^3) - higher follows flow changes faster
+    // r: measurement variance of one HX711 sample (g^2) - higher smooths more
+    void setProcessNoise(float q) { processNoise = q; }
+    void setMeasurementNoise(float r) { measurementNoise = r; }
+    float getProcessNoise() const { return processNoise; }
+    float getMeasurementNoise() const { return measurementNoise; }
+
+    // Restart from a known weight with zero flow
+    void reset(float initialWeight, uint32_t timestampUs) {
+        steady.reset(initialWeight, measurementNoise);
+        fast.reset(initialWeight, measurementNoise);
+        lastTimestampUs = timestampUs;
+        evidence = 0.0f;
+        initialized = true;
+    }
+
+    void invalidate() { initialized = false; }
+    bool isInitialized() const { return initialized; }
+
+    // Predict to the sample time, then correct with the measurement
+    void update(float measurement, uint32_t timestampUs) {
+        if (!initialized) {
+            reset(measurement, timestampUs);
+            return;
+        }
+
+        uint32_t elapsedUs = timestampUs - lastTimestampUs;
+        float dt = elapsedUs / 1000000.0f;
+        lastTimestampUs = timestampUs;
+        if (dt <= 0.0f || dt > MAX_PREDICT_SECONDS) {
+            // Gap in the sample stream - the model no longer holds
+            reset(measurement, timestampUs);
+            return;
+        }
+
+        // Cup placed/removed or tare - jump straight to the new weight
+        if (fabsf(measurement - (steady.weight + steady.flow * dt)) > STEP_THRESHOLD) {
+            reset(measurement, timestampUs);
+            return;
+        }
+
+        float steadyError = measurement - (steady.weight + steady.flow * dt);
+        float fastError = measurement - (fast.weight + fast.flow * dt);
+        steady.update(measurement, dt, processNoise, measurementNoise);
+        fast.update(measurement, dt, processNoise * FAST_PROCESS_GAIN, measurementNoise);
+
+        // Evidence that the fast estimate fits better; never below zero so a long
+        // steady pour does not delay the switch when the flow changes
+        evidence = evidence * expf(-dt / EVIDENCE_TIME_CONSTANT) +
+                   (steadyError * steadyError - fastError * fastError) / measurementNoise;
+        if (evidence < 0.0f) {
+            evidence = 0.0f;
+        } else if (evidence > SWITCH_EVIDENCE) {
+            steady = fast;
+            evidence = 0.0f;
+        }
+    }
+
+    float getWeight() const { return steady.weight; }
+    float getFlowRate() const { return steady.flow; }
+
+    // Tuned by replaying simulated shots (test/test_weight_flow_kalman) against the
+    // least-squares flow pipeline at 10 and 80 SPS
+    static constexpr float DEFAULT_PROCESS_NOISE = 0.001f;    // g^2/s^3 - steady pour
+    static constexpr float DEFAULT_MEASUREMENT_NOISE = 0.02f; // g^2 (~0.14 g RMS noise)
+    static constexpr float FAST_PROCESS_GAIN = 200.0f;        // Fast estimate's q multiple
+    static constexpr float SWITCH_EVIDENCE = 30.0f;
+    static constexpr float EVIDENCE_TIME_CONSTANT = 0.5f;     // s
+
+private:
+    struct Estimate {
+        float weight;
+        float flow;
+        float p00, p01, p11; // Symmetric 2x2 covariance
+
+        void reset(float initialWeight, float r) {
+            weight = initialWeight;
+            flow = 0.0f;
+            p00 = r;
+            p01 = 0.0f;
+            p11 = INITIAL_FLOW_VARIANCE;
+        }
+
+        void update(float measurement, float dt, float q, float r) {
+            // Predict: x = F x, P = F P F' + Q
+            weight += flow * dt;
+            float dt2 = dt * dt;
+            float n00 = p00 + 2.0f * dt * p01 + dt2 * p11 + q * dt2 * dt / 3.0f;
+            float n01 = p01 + dt * p11 + q * dt2 / 2.0f;
+            float n11 = p11 + q * dt;
+
+            // Update: K = P H' / (H P H' + R), H = [1 0]
+            float innovation = measurement - weight;
+            float s = n00 + r;
+            float k0 = n00 / s;
+            float k1 = n01 / s;
+            weight += k0 * innovation;
+            flow += k1 * innovation;
+
+            p00 = (1.0f - k0) * n00;
+            p01 = (1.0f - k0) * n01;
+            p11 = n11 - k1 * n01;
+        }
+    };
+
+    float processNoise;
+    float measurementNoise;
+    Estimate steady; // Reported
+    Estimate fast;   // Follows pour changes, resyncs 'steady' when they persist
+    uint32_t lastTimestampUs;
+    float evidence;
+    bool initialized;
+
+    static constexpr float INITIAL_FLOW_VARIANCE = 1.0f; // (1 g/s)^2 - resets follow a tare or cup, rarely a pour
+    static constexpr float MAX_PREDICT_SECONDS = 1.0f;
+    static constexpr float STEP_THRESHOLD = 5.0f;        // Same 5 g rule as the smart filter
+};
+
+#endif
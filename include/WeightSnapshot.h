@@ -0,0 +1,65 @@
+#ifndef WEIGHT_SNAPSHOT_H
+#define WEIGHT_SNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Immutable result of one pass of the sampling task.
+// Everything a consumer (BLE, web, display) needs, captured together so
+// weight and flow always belong to the same sample.
+struct WeightSnapshot {
+    float weight;          // Filtered weight in grams
+    float flowRate;        // Flow rate in g/s
+    uint8_t filterState;   // Scale::FilterState
+    bool taring;           // Tare job collecting samples
+    uint32_t timestampUs;  // Capture time of the newest sample that went into this snapshot
+    uint32_t sequence;     // Incremented on every publish, 0 = nothing published yet
+};
+
+// Single-writer seqlock. The writer never waits; readers copy the snapshot and
+// retry only if the writer published in the middle of the copy, so a torn
+// weight/flow pair can never be observed.
+class SnapshotPublisher {
+public:
+    SnapshotPublisher() : version(0) {
+        data.weight = 0.0f;
+        data.flowRate = 0.0f;
+        data.filterState = 0;
+        data.taring = false;
+        data.timestampUs = 0;
+        data.sequence = 0;
+    }
+
+    // Writer side - sampling task only
+    void publish(const WeightSnapshot& snapshot) {
+        uint32_t v = version.load(std::memory_order_relaxed);
+        version.store(v + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        data = snapshot;
+        std::atomic_thread_fence(std::memory_order_release);
+        version.store(v + 2, std::memory_order_release); // Even: stable
+    }
+
+    // Reader side - any task
+    WeightSnapshot read() const {
+        WeightSnapshot copy;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = version.load(std::memory_order_acquire);
+            while (before & 1) {
+                before = version.load(std::memory_order_acquire);
+            }
+            copy = data;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = version.load(std::memory_order_relaxed);
+        } while (before != after);
+        return copy;
+    }
+
+private:
+    WeightSnapshot data;
+    std::atomic<uint32_t> version;
+};
+
+#endif
@@ -5,26 +5,40 @@
 #include <Preferences.h>
 #include <ESPmDNS.h>
 
+class JsonWriter; // Forward declaration
+
+// Outcome of the last attemptSTAConnection()
+enum WiFiConnectResult : uint8_t {
+    WIFI_CONNECT_IDLE,    // None requested since boot
+    WIFI_CONNECT_RUNNING,
+    WIFI_CONNECT_OK,
+    WIFI_CONNECT_FAILED   // Config AP is up, the network is retried behind it
+};
+
 // Configuration for SuperMini antenna fix
 // Set to true to enable maximum power mode for boards with poor antenna design
 #define ENABLE_SUPERMINI_ANTENNA_FIX true
 
-void setupWiFi();
+void setupWiFi(uint8_t channel = 0, const uint8_t* bssid = nullptr); // Channel/BSSID of a known AP skip the scan
 void saveWiFiCredentials(const char* ssid, const char* password);
 void clearWiFiCredentials(); // Clear stored WiFi credentials
 void loadWiFiCredentials(char* ssid, char* password, size_t maxLen);
 bool loadWiFiCredentialsFromEEPROM(); // Load and cache WiFi credentials from EEPROM
-String getStoredSSID();
-String getStoredPassword();
+const String& getStoredSSID();
+const String& getStoredPassword();
 void setupmDNS(); // Setup mDNS for weighmybru.local hostname
 void printWiFiStatus(); // Print detailed WiFi status for debugging
-void maintainWiFi(); // Periodic WiFi maintenance to ensure AP stability
-bool attemptSTAConnection(const char* ssid, const char* password); // Attempt STA connection and switch from AP mode
-void switchToAPMode(); // Switch back to AP mode if STA connection fails
+void maintainWiFi(); // Call from loop() - non-blocking STA reconnection with backoff and AP fallback
+uint32_t getWiFiReconnectAttempts(); // STA reconnect attempts since boot
+uint32_t getWiFiDisconnectedMs(); // Total time the STA link was down since boot
+void attemptSTAConnection(const char* ssid, const char* password); // Start joining a network - returns at once
+WiFiConnectResult getWiFiConnectResult(); // How the last attemptSTAConnection() went
+void switchToAPMode(); // AP-only mode for configuration
 void applySuperMiniAntennaFix(); // Apply maximum power settings for problematic SuperMini boards
 int getWiFiSignalStrength(); // Get current WiFi signal strength in dBm
-String getWiFiSignalQuality(); // Get WiFi signal quality description
-String getWiFiConnectionInfo(); // Get detailed WiFi connection information
+const char* getWiFiSignalQuality(); // Get WiFi signal quality description
+const char* getConnectedSSID(char* buffer, size_t size); // SSID of the joined network, empty if none
+void writeWiFiConnectionInfo(JsonWriter& json); // Detailed WiFi connection information as JSON fields
 
 // WiFi Power Management
 bool isWiFiEnabled(); // Check if WiFi is currently enabled
@@ -0,0 +1,75 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Minimal Arduino surface for the native (Linux host) build.
+// Only what the signal path uses: String, Serial logging and the math helpers.
+// Serial goes to stderr so program output on stdout stays machine-readable.
+// Time is NOT provided here - host code goes through IClock/SimulatedClock.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using std::abs;
+using std::min;
+using std::max;
+using std::isnan;
+using std::isinf;
+
+#define ARDUINO_ISR_ATTR
+
+class String {
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    String(char c) : value(1, c) {}
+    String(int v) : value(std::to_string(v)) {}
+    String(unsigned int v) : value(std::to_string(v)) {}
+    String(long v) : value(std::to_string(v)) {}
+    String(unsigned long v) : value(std::to_string(v)) {}
+    String(long long v) : value(std::to_string(v)) {}
+    String(unsigned long long v) : value(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { format((double)v, decimals); }
+    String(double v, unsigned int decimals = 2) { format(v, decimals); }
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.length(); }
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator!=(const String& other) const { return value != other.value; }
+
+private:
+    std::string value;
+
+    void format(double v, unsigned int decimals) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, v);
+        value = buffer;
+    }
+};
+
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    void print(const String& s) { fputs(s.c_str(), stderr); }
+    void println(const String& s = String()) { fprintf(stderr, "%s\n", s.c_str()); }
+    int printf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int written = vfprintf(stderr, format, args);
+        va_end(args);
+        return written;
+    }
+};
+
+// One instance for the program and every test/ runner that links the signal path
+inline HostSerial Serial;
+
+#endif
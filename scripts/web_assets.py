@@ -0,0 +1,197 @@
+# Web UI asset pipeline for the LittleFS image.
+#
+# Copies data/ into a staging directory that buildfs/uploadfs pack instead of
+# data/ itself:
+#   - drops files the pages never load (see UNUSED)
+#   - purges output.css rules whose classes appear in no page
+#   - appends ?v=<hash> to local asset references so the server can mark them
+#     immutable; <hash> is written to /asset-hash for the firmware to read
+#   - gzips text assets and keeps only the .gz (the web server sends it with
+#     Content-Encoding: gzip when the plain file is absent)
+#
+# Used as a PlatformIO extra_script. Run directly for a size report:
+#   python scripts/web_assets.py
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+UNUSED = {
+    "chart.min.js",        # ES module build with an unshipped chunk import; index.html uses the CDN UMD build
+    "tailwind.min.css",    # Empty
+    "tailwind.config.js",  # Empty, belongs to the CSS build
+    "index_backup.html",
+}
+COMPRESS = (".html", ".css", ".js", ".svg", ".json", ".txt")
+ASSET_REF = re.compile(r'((?:src|href)="|url\()(/?[^"():?#]+\.(?:css|js|png|woff2?|svg|ico))(?=[")])')
+HASH_FILE = "asset-hash"
+
+
+def source_files(data_dir):
+    for root, _, files in os.walk(data_dir):
+        for name in sorted(files):
+            path = os.path.join(root, name)
+            rel = os.path.relpath(path, data_dir).replace(os.sep, "/")
+            if rel not in UNUSED:
+                yield rel, path
+
+
+def build_hash(data_dir):
+    digest = hashlib.sha256()
+    for rel, path in source_files(data_dir):
+        digest.update(rel.encode())
+        with open(path, "rb") as f:
+            digest.update(f.read())
+    return digest.hexdigest()[:12]
+
+
+def page_tokens(data_dir):
+    # Anything that could be a class name in markup or in class strings set from script
+    tokens = set()
+    for rel, path in source_files(data_dir):
+        if rel.endswith(".html"):
+            with open(path, encoding="utf-8") as f:
+                tokens.update(re.findall(r"[A-Za-z0-9_:/.\-\[\]#%!]+", f.read()))
+    return tokens
+
+
+def split_blocks(css):
+    # Top-level (prelude, body) pairs; body is None for statements like @import
+    blocks, depth, start, prelude = [], 0, 0, None
+    i = 0
+    while i < len(css):
+        c = css[i]
+        if c == "/" and css.startswith("/*", i):
+            i = css.find("*/", i + 2) + 2
+            if i == 1:
+                break
+            continue
+        if c == "{":
+            if depth == 0:
+                prelude, start = css[start:i].strip(), i + 1
+            depth += 1
+        elif c == "}":
+            depth -= 1
+            if depth == 0:
+                blocks.append((prelude, css[start:i]))
+                start = i + 1
+        elif c == ";" and depth == 0:
+            blocks.append((css[start:i].strip(), None))
+            start = i + 1
+        i += 1
+    return blocks
+
+
+def selector_used(selector, tokens):
+    classes = [c.replace("\\", "") for c in re.findall(r"\.((?:\\.|[A-Za-z0-9_-])+)", selector)]
+    return all(c in tokens for c in classes)
+
+
+def purge_css(css, tokens):
+    out = []
+    for prelude, body in split_blocks(css):
+        prelude = re.sub(r"/\*.*?\*/", "", prelude, flags=re.S).strip()
+        if body is None:
+            out.append(prelude + ";")
+        elif prelude.startswith("@media") or prelude.startswith("@supports"):
+            inner = purge_css(body, tokens)
+            if inner:
+                out.append(prelude + "{" + inner + "}")
+        elif prelude.startswith("@"):
+            out.append(prelude + "{" + body.strip() + "}")
+        else:
+            selectors = [s.strip() for s in prelude.split(",")]
+            kept = [s for s in selectors if selector_used(s, tokens)]
+            if kept:
+                out.append(",".join(kept) + "{" + body.strip() + "}")
+    return "".join(out)
+
+
+def add_version(text, version):
+    return ASSET_REF.sub(lambda m: m.group(1) + m.group(2) + "?v=" + version, text)
+
+
+def build(data_dir, out_dir):
+    version = build_hash(data_dir)
+    tokens = page_tokens(data_dir)
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    for rel, path in source_files(data_dir):
+        target = os.path.join(out_dir, rel)
+        os.makedirs(os.path.dirname(target), exist_ok=True)
+        with open(path, "rb") as f:
+            content = f.read()
+        if rel.endswith((".html", ".css")):
+            text = content.decode("utf-8")
+            if rel == "output.css":
+                text = purge_css(text, tokens)
+            content = add_version(text, version).encode("utf-8")
+        if rel.endswith(COMPRESS):
+            with open(target + ".gz", "wb") as f:
+                f.write(gzip.compress(content, 9, mtime=0))
+        else:
+            with open(target, "wb") as f:
+                f.write(content)
+    with open(os.path.join(out_dir, HASH_FILE), "w") as f:
+        f.write(version)
+    return version
+
+
+def page_load(data_dir, page, served_name):
+    # Requests and bytes for a cold load of one page: the page plus every local asset it pulls in
+    requests, total, pending, seen = 0, 0, [page], set()
+    while pending:
+        rel = pending.pop()
+        if rel in seen or not os.path.exists(os.path.join(data_dir, rel)):
+            continue
+        seen.add(rel)
+        requests += 1
+        total += os.path.getsize(served_name(rel))
+        if rel.endswith((".html", ".css")):
+            with open(os.path.join(data_dir, rel), encoding="utf-8") as f:
+                refs = ASSET_REF.findall(f.read())
+            for _, ref in refs:
+                if ref.startswith("/"):
+                    pending.append(ref[1:])
+                else:
+                    pending.append(os.path.normpath(os.path.join(os.path.dirname(rel), ref)).replace(os.sep, "/"))
+    return requests, total
+
+
+def report(data_dir, out_dir):
+    def before(rel):
+        return os.path.join(data_dir, rel)
+
+    def after(rel):
+        path = os.path.join(out_dir, rel)
+        return path + ".gz" if os.path.exists(path + ".gz") else path
+
+    def image_size(root):
+        return sum(os.path.getsize(os.path.join(r, f)) for r, _, files in os.walk(root) for f in files)
+
+    print("Filesystem image content: %d -> %d bytes" % (image_size(data_dir), image_size(out_dir)))
+    for page in ("index.html", "settings.html", "calibration.html", "updates.html"):
+        old_requests, old_bytes = page_load(data_dir, page, before)
+        new_requests, new_bytes = page_load(data_dir, page, after)
+        print("%-17s cold load: %d requests / %6d bytes -> %d requests / %6d bytes; repeat visit: %d -> 1 (304)"
+              % (page, old_requests, old_bytes, new_requests, new_bytes, old_requests))
+
+
+def project_dirs(project_dir):
+    return os.path.join(project_dir, "data"), os.path.join(project_dir, ".pio", "webfs")
+
+
+if __name__ == "__main__":
+    data_dir, out_dir = project_dirs(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    print("Asset hash %s, staged in %s" % (build(data_dir, out_dir), out_dir))
+    report(data_dir, out_dir)
+    sys.exit(0)
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+data_dir, out_dir = project_dirs(env.subst("$PROJECT_DIR"))  # noqa: F821
+if any(t in ("buildfs", "uploadfs", "uploadfsota") for t in COMMAND_LINE_TARGETS):  # noqa: F821
+    print("Web assets: hash %s, staged in %s" % (build(data_dir, out_dir), out_dir))
+env.Replace(PROJECT_DATA_DIR=out_dir)  # noqa: F821
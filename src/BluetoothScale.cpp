@@ -1,21 +1,38 @@
 #include "BluetoothScale.h"
 #include "Display.h"
+#include "SamplingTask.h"
+#include "JsonWriter.h"
 #include <Arduino.h>
 #include <stdexcept>
 #include <esp_bt.h>
+#include <Preferences.h>
 
-// UUIDs for WeighMyBru protocol - unique to avoid conflicts with Bookoo scales
-const char* BluetoothScale::SERVICE_UUID = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E";
-const char* BluetoothScale::WEIGHT_CHARACTERISTIC_UUID = "6E400004-B5A3-F393-E0A9-E50E24DCCA9E";  // Bean Conqueror (new UUID)
-const char* BluetoothScale::GAGGIMATE_CHARACTERISTIC_UUID = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E";  // GaggiMate (original UUID)
-const char* BluetoothScale::COMMAND_CHARACTERISTIC_UUID = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E";
+// WeighMyBru service UUIDs are unique to avoid conflicts with Bookoo scales (ScaleCodecs.h)
+const char* BluetoothScale::BATCH_CHARACTERISTIC_UUID = "6E400005-B5A3-F393-E0A9-E50E24DCCA9E";  // Batched samples (ScalePayload::encodeWeightBatch)
+const char* BluetoothScale::DEFAULT_DEVICE_NAME = "WeighMyBru";
+
+BluetoothScale::Peer::Peer()
+    : inUse(false), greeted(false), connHandle(BLE_HS_CONN_HANDLE_NONE), subscriptions(0), indicateOnly(0),
+      mtu(DEFAULT_ATT_MTU), intervalUnits(0), latency(0), supervisionTimeout(0),
+      linkProfile(LINK_DEFAULT), phyRequested(false), txPhy(0), rxPhy(0), connectedMs(0),
+      notificationsSent(0), bytesSent(0), notifyFailures(0), rateBytes(0), rateMs(0), bytesPerSecond(0) {
+}
 
 BluetoothScale::BluetoothScale() 
-    : scale(nullptr), display(nullptr), server(nullptr), service(nullptr), 
-      weightCharacteristic(nullptr), gaggiMateWeightCharacteristic(nullptr), 
-      commandCharacteristic(nullptr), advertising(nullptr), deviceConnected(false), 
-      oldDeviceConnected(false), lastHeartbeat(0), lastWeightSent(0), lastWeight(0.0f),
-      connectionRSSI(-100), connectionHandle(0) {
+    : scale(nullptr), display(nullptr), samplingTask(nullptr), commands(nullptr), server(nullptr), service(nullptr), 
+      serviceCount(0), weightCharacteristics{}, commandCharacteristics{},
+      commandCharacteristic(nullptr), batchCharacteristic(nullptr), advertising(nullptr), clientCount(0),
+      enabledCodecs(ScaleCodecs::DEFAULT_ENABLED), advertisedName(DEFAULT_DEVICE_NAME), closedSent{}, closedSuppressed{}, lastHeartbeat(0), lastPeerRefresh(0), lastOfferedSequence(0),
+      lastShotActivity(0), pendingBatchCount(0), pendingBatchSinceMs(0), batchFlowRate(0.0f), batchTaring(false),
+      batchFramesSent(0), batchSamplesSent(0),
+      connectionRSSI(-100), tareConfirmPending(false), tareCountAtRequest(0) {
+    peerLock = portMUX_INITIALIZER_UNLOCKED;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        channelPolicies[channel] = ScaleCodecs::get(channel)->getDefaultPolicy();
+        for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+            peers[i].schedulers[channel].setPolicy(channelPolicies[channel]);
+        }
+    }
 }
 
 BluetoothScale::~BluetoothScale() {
@@ -87,9 +104,21 @@ void BluetoothScale::end() {
         NimBLEDevice::deinit();
         server = nullptr;
         service = nullptr;
-        weightCharacteristic = nullptr;
+        serviceCount = 0;
+        for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+            weightCharacteristics[channel] = nullptr;
+            commandCharacteristics[channel] = nullptr;
+        }
         commandCharacteristic = nullptr;
+        batchCharacteristic = nullptr;
         advertising = nullptr;
+        
+        portENTER_CRITICAL(&peerLock);
+        for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+            peers[i].inUse = false;
+        }
+        clientCount = 0;
+        portEXIT_CRITICAL(&peerLock);
     }
 }
 
@@ -101,8 +130,19 @@ void BluetoothScale::initializeBLE() {
     esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, ESP_PWR_LVL_N0);      // Moderate advertising power (0dBm)
     esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_CONN_HDL0, ESP_PWR_LVL_N0); // Moderate connection power (0dBm)
     
-    // Initialize BLE Device with WeighMyBru name - this handles the low-level BLE stack
-    NimBLEDevice::init("WeighMyBru");
+    // Emulated scales may need their own name to be found by their apps
+    enabledCodecs = getStoredCodecs();
+    advertisedName = DEFAULT_DEVICE_NAME;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (isChannelEnabled(channel) && ScaleCodecs::get(channel)->getAdvertisedName() != nullptr) {
+            advertisedName = ScaleCodecs::get(channel)->getAdvertisedName();
+            break;
+        }
+    }
+    Serial.printf("BluetoothScale: Codecs 0x%02X, advertising as %s\n", (unsigned)enabledCodecs, advertisedName);
+    
+    // Initialize BLE Device - this handles the low-level BLE stack
+    NimBLEDevice::init(advertisedName);
     
     // Set moderate power to reduce current draw during boot while maintaining connectivity
     NimBLEDevice::setPower(ESP_PWR_LVL_N0);  // Moderate BLE power reduction (0dBm)
@@ -120,68 +160,58 @@ void BluetoothScale::initializeBLE() {
         throw std::runtime_error("Failed to create BLE server");
     }
     server->setCallbacks(this);
+    // A slot frees up on every disconnect - NimBLE restarts advertising from the host task
+    server->advertiseOnDisconnect(true);
     
-    Serial.println("BluetoothScale: Creating BLE service...");
+    Serial.println("BluetoothScale: Creating BLE services...");
     
-    // Create BLE Service
-    service = server->createService(SERVICE_UUID);
-    if (!service) {
-        throw std::runtime_error("Failed to create BLE service");
-    }
+    // WeighMyBru service first - it also carries the batched characteristic
+    serviceCount = 0;
+    service = getOrCreateService(WeighMyBruUuids::SERVICE);
     
     Serial.println("BluetoothScale: Creating characteristics...");
     
-    // Create Weight Characteristic for GaggiMate (WeighMyBru protocol format) - Keep original UUID
-    gaggiMateWeightCharacteristic = service->createCharacteristic(
-        GAGGIMATE_CHARACTERISTIC_UUID,
-        NIMBLE_PROPERTY::READ |
-        NIMBLE_PROPERTY::NOTIFY |
-        NIMBLE_PROPERTY::INDICATE
-    );
-    
-    if (!gaggiMateWeightCharacteristic) {
-        Serial.println("BluetoothScale: ERROR - Failed to create GaggiMate weight characteristic");
-        throw std::runtime_error("Failed to create GaggiMate weight characteristic");
+    // One weight characteristic per enabled codec; codecs sharing a command
+    // characteristic (GaggiMate and Bean Conqueror) get the same one back
+    // Note: NimBLE automatically creates 0x2902 descriptors for characteristics with NOTIFY/INDICATE properties
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (!isChannelEnabled(channel)) {
+            continue;
+        }
+        const IScaleCodec* codec = ScaleCodecs::get(channel);
+        NimBLEService* codecService = getOrCreateService(codec->getServiceUuid());
+        
+        weightCharacteristics[channel] = getOrCreateCharacteristic(codecService, codec->getWeightUuid(),
+            NIMBLE_PROPERTY::READ |
+            NIMBLE_PROPERTY::NOTIFY |
+            NIMBLE_PROPERTY::INDICATE
+        );
+        if (codec->getCommandUuid() != nullptr) {
+            commandCharacteristics[channel] = getOrCreateCharacteristic(codecService, codec->getCommandUuid(),
+                NIMBLE_PROPERTY::WRITE |
+                NIMBLE_PROPERTY::WRITE_NR |
+                NIMBLE_PROPERTY::NOTIFY
+            );
+        }
+        Serial.printf("BluetoothScale: %s characteristics created successfully\n", codec->getName());
     }
     
-    Serial.println("BluetoothScale: GaggiMate characteristic created successfully");
-    
-    // Note: NimBLE automatically creates 0x2902 descriptors for characteristics with NOTIFY/INDICATE properties
+    // Tare/timer confirmations and the heartbeat use the WeighMyBru format
+    commandCharacteristic = service->getCharacteristic(WeighMyBruUuids::COMMAND);
     
-    // Create Weight Characteristic for Bean Conqueror (simple float format) - New UUID
-    weightCharacteristic = service->createCharacteristic(
-        WEIGHT_CHARACTERISTIC_UUID,
-        NIMBLE_PROPERTY::READ |
+    // Batched samples for clients that negotiate a larger MTU - several samples per
+    // notification, each with its own sequence and timestamp
+    batchCharacteristic = getOrCreateCharacteristic(service, BATCH_CHARACTERISTIC_UUID,
         NIMBLE_PROPERTY::NOTIFY |
         NIMBLE_PROPERTY::INDICATE
     );
     
-    if (!weightCharacteristic) {
-        Serial.println("BluetoothScale: ERROR - Failed to create Bean Conqueror weight characteristic");
-        throw std::runtime_error("Failed to create Bean Conqueror weight characteristic");
-    }
-    
-    Serial.println("BluetoothScale: Bean Conqueror characteristic created successfully");
-    
-    // Note: NimBLE automatically creates 0x2902 descriptors for characteristics with NOTIFY/INDICATE properties
-    
-    // Create Command Characteristic (for receiving commands)
-    commandCharacteristic = service->createCharacteristic(
-        COMMAND_CHARACTERISTIC_UUID,
-        NIMBLE_PROPERTY::WRITE |
-        NIMBLE_PROPERTY::WRITE_NR |
-        NIMBLE_PROPERTY::NOTIFY
-    );
+    Serial.println("BluetoothScale: Starting services...");
     
-    if (!commandCharacteristic) {
-        throw std::runtime_error("Failed to create command characteristic");
+    // Start the services
+    for (uint8_t i = 0; i < serviceCount; i++) {
+        services[i]->start();
     }
-    commandCharacteristic->setCallbacks(this);
-    
-    Serial.println("BluetoothScale: Starting service...");
-    
-    // Start the service
-    service->start();
     
     Serial.println("BluetoothScale: Setting up advertising...");
     
@@ -191,19 +221,52 @@ void BluetoothScale::initializeBLE() {
         throw std::runtime_error("Failed to get advertising object");
     }
     
-    advertising->addServiceUUID(SERVICE_UUID);
+    for (uint8_t i = 0; i < serviceCount; i++) {
+        advertising->addServiceUUID(services[i]->getUUID());
+    }
     
     // Enable scan response to allow full device name in advertising
     advertising->setScanResponse(true);
     
-    // Explicitly set the advertising name to ensure full "WeighMyBru" appears
-    advertising->setName("WeighMyBru");
+    // Explicitly set the advertising name to ensure the full name appears
+    advertising->setName(advertisedName);
     
     advertising->setMinPreferred(0x0);
     
     Serial.println("BluetoothScale: BLE initialization completed successfully");
 }
 
+NimBLEService* BluetoothScale::getOrCreateService(const char* uuid) {
+    for (uint8_t i = 0; i < serviceCount; i++) {
+        if (services[i]->getUUID() == NimBLEUUID(uuid)) {
+            return services[i];
+        }
+    }
+    if (serviceCount >= sizeof(services) / sizeof(services[0])) {
+        throw std::runtime_error("Too many BLE services");
+    }
+    NimBLEService* created = server->createService(uuid);
+    if (!created) {
+        throw std::runtime_error("Failed to create BLE service");
+    }
+    services[serviceCount++] = created;
+    return created;
+}
+
+NimBLECharacteristic* BluetoothScale::getOrCreateCharacteristic(NimBLEService* owner, const char* uuid, uint32_t properties) {
+    NimBLECharacteristic* characteristic = owner->getCharacteristic(uuid);
+    if (characteristic) {
+        return characteristic;
+    }
+    characteristic = owner->createCharacteristic(uuid, properties);
+    if (!characteristic) {
+        Serial.printf("BluetoothScale: ERROR - Failed to create characteristic %s\n", uuid);
+        throw std::runtime_error("Failed to create characteristic");
+    }
+    characteristic->setCallbacks(this); // Per-client subscription tracking, commands
+    return characteristic;
+}
+
 void BluetoothScale::startAdvertising() {
     if (advertising) {
         advertising->start();
@@ -221,135 +284,390 @@ void BluetoothScale::update() {
     if (scale == nullptr) {
         return;
     }
-    
+
     uint32_t now = millis();
-    
-    // Handle connection state changes
-    if (!deviceConnected && oldDeviceConnected) {
-        delay(500); // Give the bluetooth stack time to get ready
-        server->startAdvertising();
-        Serial.println("BluetoothScale: Start advertising after disconnect");
-        oldDeviceConnected = deviceConnected;
+    if (clientCount == 0) {
+        if (samplingTask) {
+            samplingTask->clearSamples();
+        }
+        pendingBatchCount = 0;
+        return;
     }
-    
-    if (deviceConnected && !oldDeviceConnected) {
-        Serial.println("BluetoothScale: Client connected");
-        oldDeviceConnected = deviceConnected;
-        lastHeartbeat = now;
-        
-        // Send initialization response for WeighMyBru client
-        delay(100); // Give time for connection to stabilize
-        sendNotificationRequest();
+    bool flushBatch = collectBatchSamples(now);
+
+    // Offer each new snapshot once; every client's schedulers decide what goes on air
+    uint32_t sequence;
+    float currentWeight;
+    float currentFlow;
+    bool brewing;
+    if (samplingTask) {
+        WeightSnapshot snapshot = samplingTask->getSnapshot();
+        sequence = snapshot.sequence;
+        currentWeight = snapshot.weight;
+        currentFlow = snapshot.flowRate;
+        brewing = snapshot.flowRate != 0.0f; // Filter state flips to BREWING on noise alone
+    } else {
+        sequence = now / FALLBACK_POLL_INTERVAL;
+        currentWeight = scale->getCurrentWeight();
+        currentFlow = 0.0f;
+        brewing = false;
     }
+    bool newSample = sequence != lastOfferedSequence;
+    lastOfferedSequence = sequence;
     
-    if (deviceConnected) {
-        // Send weight updates - faster for GaggiMate brewing applications
-        if (scale && (now - lastWeightSent >= WEIGHT_SEND_INTERVAL)) {
-            float currentWeight = scale->getCurrentWeight();
-            // Send all weight updates for real-time brewing feedback
-            sendWeightNotification(currentWeight);
-            lastWeight = currentWeight;
-            lastWeightSent = now;
+    // Short intervals only while a shot needs them
+    if (brewing || (display && display->isTimerRunning())) {
+        lastShotActivity = now;
+    }
+    bool shotActive = lastShotActivity != 0 && now - lastShotActivity < SHOT_HOLD_MS;
+
+    // Encoded once per codec, sent to whichever clients are due
+    uint8_t payloads[CHANNEL_COUNT][IScaleCodec::MAX_WEIGHT_FRAME];
+    size_t payloadLengths[CHANNEL_COUNT] = {};
+    if (newSample) {
+        IScaleCodec::WeightFrame frame = {currentWeight, currentFlow, brewing};
+        for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+            if (!weightCharacteristics[channel]) {
+                continue;
+            }
+            payloadLengths[channel] = ScaleCodecs::get(channel)->encodeWeight(frame, payloads[channel],
+                                                                              IScaleCodec::MAX_WEIGHT_FRAME);
+            // Keep READ current for clients that poll instead of subscribing
+            weightCharacteristics[channel]->setValue(payloads[channel], payloadLengths[channel]);
         }
-        
-        // Send heartbeat
-        if (now - lastHeartbeat >= HEARTBEAT_INTERVAL) {
-            sendHeartbeat();
+    }
+
+    bool refresh = now - lastPeerRefresh >= PEER_REFRESH_INTERVAL;
+    if (refresh) {
+        lastPeerRefresh = now;
+    }
+
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        bool due[CHANNEL_COUNT] = {};
+        portENTER_CRITICAL(&peerLock);
+        Peer& peer = peers[i];
+        if (!peer.inUse) {
+            portEXIT_CRITICAL(&peerLock);
+            continue;
+        }
+        uint16_t handle = peer.connHandle;
+        uint8_t indicateOnly = peer.indicateOnly;
+        uint8_t subscriptions = peer.subscriptions;
+        uint16_t mtu = peer.mtu;
+        LinkProfile linkProfile = peer.linkProfile;
+        bool settled = now - peer.connectedMs >= CONNECT_SETTLE_MS;
+        bool greet = !peer.greeted;
+        peer.greeted = true;
+        if (newSample) {
+            for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+                if (peer.subscriptions & (1 << channel)) {
+                    due[channel] = peer.schedulers[channel].offer(currentWeight, brewing, now);
+                }
+            }
+        }
+        portEXIT_CRITICAL(&peerLock);
+
+        if (greet) {
+            Serial.printf("BluetoothScale: Client %u ready\n", (unsigned)handle);
             lastHeartbeat = now;
+            // Send initialization response for WeighMyBru client
+            sendNotificationRequest();
         }
+
+        // Registry order - GaggiMate first, critical for backward compatibility
+        for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+            if (due[channel] && payloadLengths[channel] > 0) {
+                notifyPeer(i, handle, weightCharacteristics[channel], payloads[channel], payloadLengths[channel],
+                           indicateOnly & (1 << channel));
+            }
+        }
+        if (flushBatch && (subscriptions & SUBSCRIBED_BATCH)) {
+            sendBatch(i, handle, mtu, indicateOnly & SUBSCRIBED_BATCH);
+        }
+
+        LinkProfile wanted = shotActive ? LINK_FAST : (settled ? LINK_IDLE : linkProfile);
+        if (wanted != linkProfile) {
+            requestLinkProfile(i, handle, wanted);
+        }
+        
+        if (refresh) {
+            refreshPeer(i, handle, now);
+        }
+    }
+
+    if (flushBatch) {
+        batchSamplesSent += pendingBatchCount;
+        pendingBatchCount = 0;
+    }
+    
+    // Tare completion event
+    if (tareConfirmPending && scale->getTareCount() != tareCountAtRequest) {
+        tareConfirmPending = false;
+        sendTareConfirmation();
+    }
+
+    // Send heartbeat
+    if (now - lastHeartbeat >= HEARTBEAT_INTERVAL) {
+        sendHeartbeat();
+        lastHeartbeat = now;
     }
 }
 
 bool BluetoothScale::isConnected() {
-    return deviceConnected;
+    return clientCount > 0;
 }
 
-void BluetoothScale::sendWeightNotification(float weight) {
-    if (!deviceConnected) {
-        return;
+// Moves new samples from the sampling task into the pending batch while anyone
+// is subscribed to the batched characteristic
+bool BluetoothScale::collectBatchSamples(uint32_t now) {
+    if (!samplingTask) {
+        return false;
     }
     
-    // Send to GaggiMate first (WeighMyBru protocol format) - critical for backward compatibility
-    sendGaggiMateWeight(weight);
+    bool subscribed = false;
+    portENTER_CRITICAL(&peerLock);
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (peers[i].inUse && (peers[i].subscriptions & SUBSCRIBED_BATCH)) {
+            subscribed = true;
+        }
+    }
+    portEXIT_CRITICAL(&peerLock);
+    if (!subscribed) {
+        samplingTask->clearSamples();
+        pendingBatchCount = 0;
+        return false;
+    }
     
-    // Send to Bean Conqueror (simple float format)  
-    sendBeanConquerorWeight(weight);
+    WeightSnapshot sample;
+    while (pendingBatchCount < MAX_BATCH_SAMPLES && samplingTask->popSample(sample)) {
+        if (pendingBatchCount == 0) {
+            pendingBatchSinceMs = now;
+        }
+        BatchSample& pending = pendingBatch[pendingBatchCount++];
+        pending.sequence = sample.sequence;
+        pending.timestampUs = sample.timestampUs;
+        pending.weight = sample.weight;
+        batchFlowRate = sample.flowRate;
+        batchTaring = sample.taring;
+    }
+    return pendingBatchCount > 0 &&
+           (pendingBatchCount == MAX_BATCH_SAMPLES || now - pendingBatchSinceMs >= BATCH_INTERVAL_MS);
 }
 
-void BluetoothScale::sendBeanConquerorWeight(float weight) {
-    if (!weightCharacteristic) {
-        return;
+// Splits the pending batch into as many frames as this client's MTU needs
+void BluetoothScale::sendBatch(uint8_t slot, uint16_t connHandle, uint16_t mtu, bool indicate) {
+    uint8_t frame[MAX_BATCH_FRAME];
+    size_t capacity = mtu > 3 ? mtu - 3 : 0; // ATT notification header
+    if (capacity > sizeof(frame)) {
+        capacity = sizeof(frame);
     }
     
-    try {
-        // Bean Conqueror expects a simple 4-byte float in little-endian format
-        union {
-            float floatValue;
-            uint8_t bytes[4];
-        } weightData;
-        
-        weightData.floatValue = weight;
-        
-        // ESP32 is little-endian, so bytes are already in correct order for Bean Conqueror
-        weightCharacteristic->setValue(weightData.bytes, 4);
-        weightCharacteristic->notify();
-        
-        //Serial.printf("BluetoothScale: Sent Bean Conqueror weight %.2fg as 4-byte float\n", weight);
-    } catch (const std::exception& e) {
-        Serial.printf("BluetoothScale: ERROR sending Bean Conqueror weight: %s\n", e.what());
+    size_t offset = 0;
+    while (offset < pendingBatchCount) {
+        size_t consumed;
+        size_t length = ScalePayload::encodeWeightBatch(pendingBatch + offset, pendingBatchCount - offset,
+                                                        batchFlowRate, batchTaring, frame, capacity, consumed);
+        if (length == 0) {
+            return; // Default 23-byte MTU cannot carry a sample - the client has to negotiate more
+        }
+        if (notifyPeer(slot, connHandle, batchCharacteristic, frame, length, indicate)) {
+            batchFramesSent++;
+        }
+        offset += consumed;
+    }
+}
+
+// Notification to one connection only - NimBLECharacteristic::notify() would send
+// the characteristic's single value to every subscriber at the same rate
+bool BluetoothScale::notifyPeer(uint8_t slot, uint16_t connHandle, NimBLECharacteristic* characteristic,
+                                const uint8_t* payload, size_t length, bool indicate) {
+    if (!characteristic) {
+        return false;
+    }
+
+    int rc = -1;
+    os_mbuf* om = ble_hs_mbuf_from_flat(payload, length);
+    if (om) {
+        // The stack takes ownership of om whatever the outcome
+        if (indicate) {
+            rc = ble_gattc_indicate_custom(connHandle, characteristic->getHandle(), om);
+        } else {
+            rc = ble_gattc_notify_custom(connHandle, characteristic->getHandle(), om);
+        }
+    }
+
+    portENTER_CRITICAL(&peerLock);
+    Peer& peer = peers[slot];
+    if (peer.inUse && peer.connHandle == connHandle) {
+        if (rc == 0) {
+            peer.notificationsSent++;
+            peer.bytesSent += length;
+        } else {
+            peer.notifyFailures++;
+        }
+    }
+    portEXIT_CRITICAL(&peerLock);
+    return rc == 0;
+}
+
+// Connection parameters can change after connect (central-initiated updates);
+// NimBLE has no server callback for that, so they are read back periodically
+void BluetoothScale::refreshPeer(uint8_t slot, uint16_t connHandle, uint32_t now) {
+    NimBLEConnInfo info = server->getPeerIDInfo(connHandle);
+    uint8_t txPhy = 0;
+    uint8_t rxPhy = 0;
+    if (ble_gap_read_le_phy(connHandle, &txPhy, &rxPhy) != 0) {
+        txPhy = 0;
+    }
+
+    portENTER_CRITICAL(&peerLock);
+    Peer& peer = peers[slot];
+    if (peer.inUse && peer.connHandle == connHandle) {
+        if (info.getConnInterval() != 0) {
+            peer.intervalUnits = info.getConnInterval();
+            peer.latency = info.getConnLatency();
+            peer.supervisionTimeout = info.getConnTimeout();
+        }
+        if (txPhy != 0) {
+            peer.txPhy = txPhy;
+            peer.rxPhy = rxPhy;
+        }
+        uint32_t elapsed = now - peer.rateMs;
+        if (elapsed > 0) {
+            peer.bytesPerSecond = (uint32_t)((uint64_t)(peer.bytesSent - peer.rateBytes) * 1000 / elapsed);
+        }
+        peer.rateBytes = peer.bytesSent;
+        peer.rateMs = now;
+    }
+    portEXIT_CRITICAL(&peerLock);
+}
+
+// The central may clamp or refuse the request (iOS will not go below 15 ms);
+// refreshPeer() reads back what was actually negotiated
+void BluetoothScale::requestLinkProfile(uint8_t slot, uint16_t connHandle, LinkProfile profile) {
+    if (profile == LINK_FAST) {
+        server->updateConnParams(connHandle, FAST_INTERVAL_MIN, FAST_INTERVAL_MAX, FAST_LATENCY, FAST_TIMEOUT);
+    } else if (profile == LINK_IDLE) {
+        server->updateConnParams(connHandle, IDLE_INTERVAL_MIN, IDLE_INTERVAL_MAX, IDLE_LATENCY, IDLE_TIMEOUT);
+    }
+
+    bool requestPhy = false;
+    portENTER_CRITICAL(&peerLock);
+    Peer& peer = peers[slot];
+    if (peer.inUse && peer.connHandle == connHandle) {
+        peer.linkProfile = profile;
+        // 2M halves airtime per notification; once per connection, kept when idle
+        requestPhy = profile == LINK_FAST && !peer.phyRequested;
+        if (requestPhy) {
+            peer.phyRequested = true;
+        }
     }
+    portEXIT_CRITICAL(&peerLock);
+
+    if (requestPhy) {
+        int rc = ble_gap_set_prefered_le_phy(connHandle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                             BLE_GAP_LE_PHY_CODED_ANY);
+        if (rc != 0) {
+            Serial.printf("BluetoothScale: 2M PHY request failed on handle %u (rc=%d)\n", (unsigned)connHandle, rc);
+        }
+    }
+    Serial.printf("BluetoothScale: Requested %s link on handle %u\n", getLinkProfileName(profile), (unsigned)connHandle);
 }
 
-void BluetoothScale::sendGaggiMateWeight(float weight) {
-    if (!gaggiMateWeightCharacteristic) {
-        Serial.println("BluetoothScale: WARNING - GaggiMate characteristic is null!");
+const char* BluetoothScale::getLinkProfileName(LinkProfile profile) {
+    switch (profile) {
+        case LINK_FAST: return "fast";
+        case LINK_IDLE: return "idle";
+        default: return "default";
+    }
+}
+
+const char* BluetoothScale::getPhyName(uint8_t phy) {
+    switch (phy) {
+        case BLE_GAP_LE_PHY_1M: return "1M";
+        case BLE_GAP_LE_PHY_2M: return "2M";
+        case BLE_GAP_LE_PHY_CODED: return "coded";
+        default: return "unknown";
+    }
+}
+
+int BluetoothScale::findPeer(uint16_t connHandle) const {
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (peers[i].inUse && peers[i].connHandle == connHandle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BluetoothScale::setNotificationPolicy(WeightChannel channel, const NotificationPolicy& policy) {
+    if (channel >= CHANNEL_COUNT || policy.deadbandGrams < 0.0f || policy.keepaliveMs < policy.minIntervalMs) {
         return;
     }
-    
-    try {
-        // Convert weight to integer (grams * 100 for 0.01g precision)
-        int32_t weightInt = (int32_t)(weight * 100);
-        
-        // Create weight message following WeighMyBru protocol
-        uint8_t payload[PROTOCOL_LENGTH] = {0};
-        
-        // Header
-        payload[0] = PRODUCT_NUMBER; // Product number
-        payload[1] = static_cast<uint8_t>(WeighMyBruMessageType::WEIGHT); // Message type
-        payload[2] = 0x00; // Reserved
-        payload[3] = 0x00; // Reserved
-        payload[4] = 0x00; // Reserved
-        payload[5] = 0x00; // Reserved
-        
-        // Sign (positive = 43, negative = 45)
-        payload[6] = (weightInt >= 0) ? 43 : 45;
-        
-        // Weight data (3 bytes, big endian)
-        uint32_t absWeight = abs(weightInt);
-        payload[7] = (absWeight >> 16) & 0xFF;
-        payload[8] = (absWeight >> 8) & 0xFF;
-        payload[9] = absWeight & 0xFF;
-        
-        // Fill remaining bytes with zeros
-        for (int i = 10; i < PROTOCOL_LENGTH - 1; i++) {
-            payload[i] = 0x00;
+    portENTER_CRITICAL(&peerLock);
+    channelPolicies[channel] = policy;
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        peers[i].schedulers[channel].setPolicy(policy);
+    }
+    portEXIT_CRITICAL(&peerLock);
+    Serial.printf("BluetoothScale: %s notify policy - deadband %.2fg, min %lums, keepalive %lums\n",
+                  getChannelName(channel), policy.deadbandGrams,
+                  (unsigned long)policy.minIntervalMs, (unsigned long)policy.keepaliveMs);
+}
+
+NotificationPolicy BluetoothScale::getNotificationPolicy(WeightChannel channel) {
+    portENTER_CRITICAL(&peerLock);
+    NotificationPolicy policy = channelPolicies[channel];
+    portEXIT_CRITICAL(&peerLock);
+    return policy;
+}
+
+void BluetoothScale::getNotificationCounts(WeightChannel channel, uint32_t& sent, uint32_t& suppressed) {
+    portENTER_CRITICAL(&peerLock);
+    sent = closedSent[channel];
+    suppressed = closedSuppressed[channel];
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (peers[i].inUse) {
+            sent += peers[i].schedulers[channel].getSentCount();
+            suppressed += peers[i].schedulers[channel].getSuppressedCount();
         }
-        
-        // Calculate and set checksum (last byte)
-        payload[PROTOCOL_LENGTH - 1] = calculateChecksum(payload, PROTOCOL_LENGTH - 1);
-        
-        // Send notification
-        gaggiMateWeightCharacteristic->setValue(payload, PROTOCOL_LENGTH);
-        gaggiMateWeightCharacteristic->notify();
-        
-        //Serial.printf("BluetoothScale: Sent GaggiMate weight %.2fg as WeighMyBru protocol\n", weight);
-    } catch (const std::exception& e) {
-        Serial.printf("BluetoothScale: ERROR sending GaggiMate weight: %s\n", e.what());
     }
+    portEXIT_CRITICAL(&peerLock);
+}
+
+const char* BluetoothScale::getChannelName(WeightChannel channel) {
+    const IScaleCodec* codec = ScaleCodecs::get(channel);
+    return codec ? codec->getName() : "unknown";
+}
+
+uint8_t BluetoothScale::getStoredCodecs() {
+    Preferences preferences;
+    uint8_t mask = ScaleCodecs::DEFAULT_ENABLED;
+    if (preferences.begin("ble", true)) {
+        mask = preferences.getUChar("codecs", ScaleCodecs::DEFAULT_ENABLED);
+        preferences.end();
+    }
+    mask &= (1 << CHANNEL_COUNT) - 1;
+    return mask != 0 ? mask : ScaleCodecs::DEFAULT_ENABLED;
+}
+
+bool BluetoothScale::setStoredCodecs(uint8_t mask) {
+    mask &= (1 << CHANNEL_COUNT) - 1;
+    if (mask == 0) {
+        return false;
+    }
+    Preferences preferences;
+    if (!preferences.begin("ble", false)) {
+        return false;
+    }
+    preferences.putUChar("codecs", mask);
+    preferences.end();
+    Serial.printf("BluetoothScale: Codecs 0x%02X stored, active after restart\n", (unsigned)mask);
+    return true;
 }
 
 void BluetoothScale::sendHeartbeat() {
-    if (!deviceConnected || !commandCharacteristic) return;
+    if (!isConnected() || !commandCharacteristic) return;
     
     // Send system heartbeat message
     uint8_t payload[] = {0x02, 0x00};
@@ -359,7 +677,7 @@ void BluetoothScale::sendHeartbeat() {
 }
 
 void BluetoothScale::sendNotificationRequest() {
-    if (!deviceConnected) return;
+    if (!isConnected()) return;
     
     // Send notification request for WeighMyBru initialization
     uint8_t payload[] = {0x06, 0x00, 0x00, 0x00, 0x00, 0x00};
@@ -369,7 +687,7 @@ void BluetoothScale::sendNotificationRequest() {
 }
 
 void BluetoothScale::sendMessage(WeighMyBruMessageType msgType, const uint8_t* payload, size_t length) {
-    if (!deviceConnected || !commandCharacteristic) return;
+    if (!isConnected() || !commandCharacteristic) return;
     
     // Create message buffer
     uint8_t message[length + 1];
@@ -380,38 +698,53 @@ void BluetoothScale::sendMessage(WeighMyBruMessageType msgType, const uint8_t* p
     // Calculate and append checksum
     message[length] = calculateChecksum(message, length);
     
-    // Send via command characteristic
+    // Keep READ current, then notify every client subscribed to the command characteristic
     commandCharacteristic->setValue(message, length + 1);
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        portENTER_CRITICAL(&peerLock);
+        bool subscribed = peers[i].inUse && (peers[i].subscriptions & SUBSCRIBED_COMMAND);
+        uint16_t handle = peers[i].connHandle;
+        bool indicate = peers[i].indicateOnly & SUBSCRIBED_COMMAND;
+        portEXIT_CRITICAL(&peerLock);
+        if (subscribed) {
+            notifyPeer(i, handle, commandCharacteristic, message, length + 1, indicate);
+        }
+    }
 }
 
 uint8_t BluetoothScale::calculateChecksum(const uint8_t* data, size_t length) {
-    uint8_t checksum = data[0];
-    for (size_t i = 1; i < length; i++) {
-        checksum ^= data[i];
-    }
-    return checksum;
+    return ScalePayload::checksum(data, length);
 }
 
-void BluetoothScale::handleTareCommand() {
-    if (scale) {
-        Serial.println("BluetoothScale: Executing tare command");
-        scale->tare(10);
-        
-        // Send tare confirmation
-        uint8_t payload[] = {0x03, 0x0a, 0x01, 0x00, 0x00};
-        sendMessage(WeighMyBruMessageType::SYSTEM, payload, sizeof(payload));
+bool BluetoothScale::handleTareCommand() {
+    if (!scale) {
+        return false;
     }
+    Serial.println("BluetoothScale: Executing tare command");
+    lastShotActivity = millis(); // Controllers tare at shot start - get the fast link up before flow begins
+    // Only starts the tare job - the confirmation goes out from update()
+    // once the new zero is in place
+    tareCountAtRequest = scale->getTareCount();
+    tareConfirmPending = scale->tare(10);
+    return tareConfirmPending;
 }
 
-void BluetoothScale::handleTimerCommand(BeanConquerorCommand command) {
+void BluetoothScale::sendTareConfirmation() {
+    uint8_t payload[] = {0x03, 0x0a, 0x01, 0x00, 0x00};
+    sendMessage(WeighMyBruMessageType::SYSTEM, payload, sizeof(payload));
+    Serial.println("BluetoothScale: Tare confirmation sent");
+}
+
+bool BluetoothScale::handleTimerCommand(BeanConquerorCommand command) {
     if (!display) {
         Serial.println("BluetoothScale: Display not available for timer command");
-        return;
+        return false;
     }
     
     switch (command) {
         case BeanConquerorCommand::TIMER_START:
             Serial.println("BluetoothScale: Starting timer");
+            lastShotActivity = millis();
             display->startTimer();
             // Send timer start confirmation
             {
@@ -442,73 +775,168 @@ void BluetoothScale::handleTimerCommand(BeanConquerorCommand command) {
             
         default:
             Serial.printf("BluetoothScale: Unknown timer command: 0x%02X\n", static_cast<uint8_t>(command));
-            break;
+            return false;
     }
+    return true;
 }
 
-void BluetoothScale::processIncomingMessage(uint8_t* data, size_t length) {
-    if (length < 2) return;
-    
-    uint8_t productNumber = data[0];
-    WeighMyBruMessageType messageType = static_cast<WeighMyBruMessageType>(data[1]);
-    
-    Serial.printf("BluetoothScale: Received message - Product: 0x%02X, Type: 0x%02X\n", 
-                  productNumber, static_cast<uint8_t>(messageType));
-    
-    // Accept messages from GaggiMate (Product 0x02) and WeighMyBru (Product 0x03)
-    if (productNumber != 0x02 && productNumber != PRODUCT_NUMBER) {
-        Serial.printf("BluetoothScale: Ignoring message from unknown product: 0x%02X\n", productNumber);
+void BluetoothScale::processIncomingMessage(NimBLECharacteristic* characteristic, const uint8_t* data, size_t length) {
+    // Every enabled codec behind this characteristic gets to decode it; the
+    // WeighMyBru command characteristic is shared by GaggiMate and Bean Conqueror
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (commandCharacteristics[channel] != characteristic) {
+            continue;
+        }
+        switch (ScaleCodecs::get(channel)->decodeCommand(data, length)) {
+            case IScaleCodec::COMMAND_TARE: queueCommand(ControlCommands::TARE); return;
+            case IScaleCodec::COMMAND_TIMER_START: queueCommand(ControlCommands::TIMER_START); return;
+            case IScaleCodec::COMMAND_TIMER_STOP: queueCommand(ControlCommands::TIMER_STOP); return;
+            case IScaleCodec::COMMAND_TIMER_RESET: queueCommand(ControlCommands::TIMER_RESET); return;
+            case IScaleCodec::COMMAND_NONE: break;
+        }
+    }
+    Serial.printf("BluetoothScale: Unrecognized command - Product: 0x%02X, Type: 0x%02X\n",
+                  data[0], length > 1 ? data[1] : 0);
+}
+
+// Runs on the NimBLE host task - the command itself executes in loop()
+void BluetoothScale::queueCommand(ControlCommands::Type type) {
+    if (!commands) {
+        Serial.printf("BluetoothScale: Not ready - %s ignored\n", ControlCommands::getTypeName(type));
         return;
     }
-    
-    if (messageType == WeighMyBruMessageType::SYSTEM && length >= 4) {
-        BeanConquerorCommand command = static_cast<BeanConquerorCommand>(data[2]);
-        
-        switch (command) {
-            case BeanConquerorCommand::TARE:
-                if (data[3] == 0x01) { // Command trigger
-                    handleTareCommand();
-                }
-                break;
-                
-            case BeanConquerorCommand::TIMER_START:
-                if (data[3] == 0x01) { // Command trigger
-                    handleTimerCommand(BeanConquerorCommand::TIMER_START);
-                }
-                break;
-                
-            case BeanConquerorCommand::TIMER_STOP:
-                if (data[3] == 0x01) { // Command trigger
-                    handleTimerCommand(BeanConquerorCommand::TIMER_STOP);
-                }
-                break;
-                
-            case BeanConquerorCommand::TIMER_RESET:
-                if (data[3] == 0x01) { // Command trigger
-                    handleTimerCommand(BeanConquerorCommand::TIMER_RESET);
-                }
-                break;
-                
-            default:
-                Serial.printf("BluetoothScale: Unknown command: 0x%02X\n", static_cast<uint8_t>(command));
-                break;
+    commands->post(type, ControlCommands::SOURCE_BLE);
+}
+
+// BLE Server Callbacks
+void BluetoothScale::onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) {
+    int slot = -1;
+    uint8_t clients = 0;
+    portENTER_CRITICAL(&peerLock);
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        if (!peers[i].inUse) {
+            slot = i;
+            break;
         }
     }
+    if (slot >= 0) {
+        Peer& peer = peers[slot];
+        peer.inUse = true;
+        peer.greeted = false;
+        peer.connHandle = desc->conn_handle;
+        peer.subscriptions = 0;
+        peer.indicateOnly = 0;
+        peer.mtu = DEFAULT_ATT_MTU;
+        peer.intervalUnits = desc->conn_itvl;
+        peer.latency = desc->conn_latency;
+        peer.supervisionTimeout = desc->supervision_timeout;
+        peer.linkProfile = LINK_DEFAULT;
+        peer.phyRequested = false;
+        peer.txPhy = 0;
+        peer.rxPhy = 0;
+        peer.connectedMs = millis();
+        peer.notificationsSent = 0;
+        peer.bytesSent = 0;
+        peer.notifyFailures = 0;
+        peer.rateBytes = 0;
+        peer.rateMs = peer.connectedMs;
+        peer.bytesPerSecond = 0;
+        // New client gets the current weight straight away
+        for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+            peer.schedulers[channel].setPolicy(channelPolicies[channel]);
+            peer.schedulers[channel].resetCounters();
+            peer.schedulers[channel].restart();
+        }
+        clientCount++;
+    }
+    clients = clientCount;
+    portEXIT_CRITICAL(&peerLock);
+
+    if (slot < 0) {
+        Serial.printf("BluetoothScale: No free client slot - disconnecting handle %u\n", (unsigned)desc->conn_handle);
+        pServer->disconnect(desc->conn_handle);
+        return;
+    }
+
+    Serial.printf("BluetoothScale: Device connected (handle %u, interval %.2f ms, %u/%u clients)\n",
+                  (unsigned)desc->conn_handle, desc->conn_itvl * 1.25f, (unsigned)clients, (unsigned)MAX_CLIENTS);
+
+    // Connecting stops advertising - keep accepting clients while slots are free
+    if (clients < MAX_CLIENTS) {
+        NimBLEDevice::startAdvertising();
+    }
 }
 
-// BLE Server Callbacks
-void BluetoothScale::onConnect(NimBLEServer* pServer) {
-    deviceConnected = true;
-    NimBLEDevice::stopAdvertising();
-    Serial.println("BluetoothScale: Device connected");
+void BluetoothScale::onDisconnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) {
+    uint8_t clients;
+    portENTER_CRITICAL(&peerLock);
+    int slot = findPeer(desc->conn_handle);
+    if (slot >= 0) {
+        Peer& peer = peers[slot];
+        // Keep the totals reported by /api/bluetooth/status
+        for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+            closedSent[channel] += peer.schedulers[channel].getSentCount();
+            closedSuppressed[channel] += peer.schedulers[channel].getSuppressedCount();
+        }
+        peer.inUse = false;
+        peer.connHandle = BLE_HS_CONN_HANDLE_NONE;
+        clientCount--;
+    }
+    clients = clientCount;
+    portEXIT_CRITICAL(&peerLock);
+
+    Serial.printf("BluetoothScale: Device disconnected (handle %u, %u clients left)\n",
+                  (unsigned)desc->conn_handle, (unsigned)clients);
 }
 
-void BluetoothScale::onDisconnect(NimBLEServer* pServer) {
-    deviceConnected = false;
-    Serial.println("BluetoothScale: Device disconnected");
+void BluetoothScale::onMTUChange(uint16_t mtu, ble_gap_conn_desc* desc) {
+    portENTER_CRITICAL(&peerLock);
+    int slot = findPeer(desc->conn_handle);
+    if (slot >= 0) {
+        peers[slot].mtu = mtu;
+    }
+    portEXIT_CRITICAL(&peerLock);
+    Serial.printf("BluetoothScale: MTU %u on handle %u\n", (unsigned)mtu, (unsigned)desc->conn_handle);
 }
 
 // BLE Characteristic Callbacks
+void BluetoothScale::onSubscribe(NimBLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc, uint16_t subValue) {
+    uint8_t bit = 0;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (pCharacteristic == weightCharacteristics[channel]) {
+            bit = 1 << channel;
+        }
+    }
+    // WeighMyBru confirmations and heartbeats go out on this one only
+    if (pCharacteristic == commandCharacteristic) {
+        bit = SUBSCRIBED_COMMAND;
+    }
+    if (pCharacteristic == batchCharacteristic) {
+        bit = SUBSCRIBED_BATCH;
+    }
+    if (bit == 0) {
+        return;
+    }
+
+    // subValue: bit 0 = notifications, bit 1 = indications
+    portENTER_CRITICAL(&peerLock);
+    int slot = findPeer(desc->conn_handle);
+    if (slot >= 0) {
+        Peer& peer = peers[slot];
+        if (subValue != 0) {
+            peer.subscriptions |= bit;
+        } else {
+            peer.subscriptions &= ~bit;
+        }
+        if (subValue == 2) {
+            peer.indicateOnly |= bit;
+        } else {
+            peer.indicateOnly &= ~bit;
+        }
+    }
+    portEXIT_CRITICAL(&peerLock);
+}
+
 void BluetoothScale::onWrite(NimBLECharacteristic* pCharacteristic) {
     std::string value = pCharacteristic->getValue();
     
@@ -517,7 +945,7 @@ void BluetoothScale::onWrite(NimBLECharacteristic* pCharacteristic) {
         size_t length = value.length();
         
         Serial.printf("BluetoothScale: Received %d bytes\n", length);
-        processIncomingMessage(data, length);
+        processIncomingMessage(pCharacteristic, data, length);
     }
 }
 
@@ -536,9 +964,19 @@ void BluetoothScale::setDisplay(Display* displayInstance) {
     Serial.println("BluetoothScale: Display reference set");
 }
 
+void BluetoothScale::setSamplingTask(SamplingTask* samplingTaskInstance) {
+    samplingTask = samplingTaskInstance;
+    Serial.println("BluetoothScale: Sampling task reference set");
+}
+
+void BluetoothScale::setCommandQueue(ControlCommands* commandQueue) {
+    commands = commandQueue;
+    Serial.println("BluetoothScale: Command queue set");
+}
+
 // Get BLE signal strength (RSSI)
 int BluetoothScale::getBluetoothSignalStrength() {
-    if (!deviceConnected || !server) {
+    if (!isConnected() || !server) {
         return -100; // Return very weak signal if not connected
     }
     
@@ -548,41 +986,99 @@ int BluetoothScale::getBluetoothSignalStrength() {
     return connectionRSSI; // Will be updated when available
 }
 
+
 // Get detailed BLE connection information
-String BluetoothScale::getBluetoothConnectionInfo() {
-    String info = "{";
-    
-    info += "\"connected\":" + String(deviceConnected ? "true" : "false") + ",";
-    info += "\"advertising\":" + String((advertising != nullptr) ? "true" : "false") + ",";
+void BluetoothScale::writeConnectionInfo(JsonWriter& json) {
+    bool connected = isConnected();
+    json.field("connected", connected);
+    json.field("advertising", advertising != nullptr && clientCount < MAX_CLIENTS);
+    json.field("clients", (unsigned int)clientCount);
+    json.field("max_clients", (unsigned int)MAX_CLIENTS);
     
-    if (deviceConnected) {
-        info += "\"signal_strength\":" + String(connectionRSSI) + ",";
+    if (connected) {
+        json.field("signal_strength", (int)connectionRSSI);
         
         if (connectionRSSI >= -30) {
-            info += "\"signal_quality\":\"Excellent\",";
+            json.field("signal_quality", "Excellent");
         } else if (connectionRSSI >= -50) {
-            info += "\"signal_quality\":\"Very Good\",";
+            json.field("signal_quality", "Very Good");
         } else if (connectionRSSI >= -60) {
-            info += "\"signal_quality\":\"Good\",";
+            json.field("signal_quality", "Good");
         } else if (connectionRSSI >= -70) {
-            info += "\"signal_quality\":\"Fair\",";
+            json.field("signal_quality", "Fair");
         } else if (connectionRSSI >= -80) {
-            info += "\"signal_quality\":\"Weak\",";
+            json.field("signal_quality", "Weak");
         } else {
-            info += "\"signal_quality\":\"Very Weak\",";
+            json.field("signal_quality", "Very Weak");
         }
-        
-        info += "\"connection_handle\":" + String(connectionHandle) + ",";
-        info += "\"service_uuid\":\"" + String(SERVICE_UUID) + "\",";
-        info += "\"device_name\":\"WeighMyBru\"";
     } else {
-        info += "\"signal_strength\":null,";
-        info += "\"signal_quality\":\"Disconnected\",";
-        info += "\"connection_handle\":null,";
-        info += "\"service_uuid\":\"" + String(SERVICE_UUID) + "\",";
-        info += "\"device_name\":\"WeighMyBru\"";
+        json.nullField("signal_strength");
+        json.field("signal_quality", "Disconnected");
     }
+    writeConnections(json);
     
-    info += "}";
-    return info;
+    // Services as begin() creates them: WeighMyBru, then each enabled codec's unless shared
+    const char* serviceUuids[CHANNEL_COUNT + 1];
+    uint8_t serviceUuidCount = 0;
+    serviceUuids[serviceUuidCount++] = WeighMyBruUuids::SERVICE;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (!isChannelEnabled(channel)) {
+            continue;
+        }
+        const char* uuid = ScaleCodecs::get(channel)->getServiceUuid();
+        bool listed = false;
+        for (uint8_t i = 0; i < serviceUuidCount; i++) {
+            listed |= strcmp(serviceUuids[i], uuid) == 0;
+        }
+        if (!listed) {
+            serviceUuids[serviceUuidCount++] = uuid;
+        }
+    }
+    json.beginArray("service_uuids");
+    for (uint8_t i = 0; i < serviceUuidCount; i++) {
+        json.value(serviceUuids[i]);
+    }
+    json.endArray();
+    json.field("device_name", advertisedName);
+}
+
+void BluetoothScale::writeConnections(JsonWriter& json) {
+    Peer snapshot[MAX_CLIENTS];
+    portENTER_CRITICAL(&peerLock);
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        snapshot[i] = peers[i];
+    }
+    portEXIT_CRITICAL(&peerLock);
+
+    uint32_t now = millis();
+    json.beginArray("connections");
+    for (uint8_t i = 0; i < MAX_CLIENTS; i++) {
+        const Peer& peer = snapshot[i];
+        if (!peer.inUse) {
+            continue;
+        }
+        json.beginObject();
+        json.field("handle", (unsigned int)peer.connHandle);
+        json.field("mtu", (unsigned int)peer.mtu);
+        json.field("interval_ms", peer.intervalUnits * 1.25f, 2);
+        json.field("latency", (unsigned int)peer.latency);
+        json.field("supervision_timeout_ms", (unsigned long)peer.supervisionTimeout * 10);
+        json.field("link_profile", getLinkProfileName(peer.linkProfile));
+        json.field("phy_tx", getPhyName(peer.txPhy));
+        json.field("phy_rx", getPhyName(peer.rxPhy));
+        json.field("connected_ms", (unsigned long)(now - peer.connectedMs));
+        json.beginObject("subscribed");
+        for (uint8_t channel = 0; channel < CHANNEL_COUNT; channel++) {
+            json.field(getChannelName((WeightChannel)channel), (peer.subscriptions & (1 << channel)) != 0);
+        }
+        json.field("commands", (peer.subscriptions & SUBSCRIBED_COMMAND) != 0);
+        json.field("batch", (peer.subscriptions & SUBSCRIBED_BATCH) != 0);
+        json.endObject();
+        json.field("notifications", (unsigned long)peer.notificationsSent);
+        json.field("bytes", (unsigned long)peer.bytesSent);
+        json.field("bytes_per_second", (unsigned long)peer.bytesPerSecond);
+        json.field("failures", (unsigned long)peer.notifyFailures);
+        json.endObject();
+    }
+    json.endArray();
 }
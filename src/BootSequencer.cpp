@@ -0,0 +1,170 @@
+#include "BootSequencer.h"
+#include <esp_timer.h>
+#include <WiFi.h>
+#include "Scale.h"
+#include "SamplingTask.h"
+
+RTC_DATA_ATTR BootSequencer::RtcState BootSequencer::rtcState;
+
+BootSequencer::BootSequencer(Scale& scale, SamplingTask& samplingTask)
+    : scale(scale), samplingTask(samplingTask), readyEvents(nullptr),
+      wakeCause(ESP_SLEEP_WAKEUP_UNDEFINED), fastWake(false), firstWeightUs(0), wifiLinkUs(0) {
+    memset(&restored, 0, sizeof(restored));
+    memset(jobs, 0, sizeof(jobs));
+    memset(timings, 0, sizeof(timings));
+}
+
+void BootSequencer::begin() {
+    readyEvents = xEventGroupCreate();
+
+    wakeCause = esp_sleep_get_wakeup_cause();
+    Serial.printf("Boot: wakeup cause %s\n", wakeCauseName(wakeCause));
+
+    // RTC memory also survives a plain reset, so only trust it after a deep sleep wake
+    if (wakeCause != ESP_SLEEP_WAKEUP_UNDEFINED && rtcState.magic == RTC_MAGIC) {
+        restored = rtcState;
+        fastWake = true;
+        Serial.printf("Boot: fast wake - tare %s, WiFi channel %u\n",
+                      restored.tareValid ? "restored" : "not saved", (unsigned)restored.wifiChannel);
+    }
+    // One use only - a later crash or reset boots the slow way
+    rtcState.magic = 0;
+}
+
+bool BootSequencer::run(Stage stage, StageFunction function) {
+    beginStage(stage);
+    bool ok = function();
+    finishStage(stage, ok);
+    return ok;
+}
+
+void BootSequencer::start(Stage stage, StageFunction function) {
+    Job& job = jobs[stage];
+    job.sequencer = this;
+    job.stage = stage;
+    job.function = function;
+    beginStage(stage);
+    if (xTaskCreatePinnedToCore(taskEntry, stageName(stage), TASK_STACK_SIZE, &job, TASK_PRIORITY, nullptr, TASK_CORE) != pdPASS) {
+        Serial.printf("Boot: WARNING - no task for %s, running it inline\n", stageName(stage));
+        finishStage(stage, function());
+    }
+}
+
+void BootSequencer::taskEntry(void* arg) {
+    Job* job = static_cast<Job*>(arg);
+    job->sequencer->finishStage(job->stage, job->function());
+    vTaskDelete(nullptr);
+}
+
+bool BootSequencer::waitFor(Stage stage, uint32_t timeoutMs) {
+    EventBits_t bit = 1 << stage;
+    EventBits_t bits = xEventGroupWaitBits(readyEvents, bit, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    if ((bits & bit) == 0) {
+        Serial.printf("Boot: WARNING - %s not ready after %lu ms, continuing without it\n",
+                      stageName(stage), (unsigned long)timeoutMs);
+        return false;
+    }
+    return timings[stage].ok;
+}
+
+void BootSequencer::beginStage(Stage stage) {
+    timings[stage].startUs = esp_timer_get_time();
+    timings[stage].endUs = 0;
+    timings[stage].ok = false;
+}
+
+void BootSequencer::finishStage(Stage stage, bool ok) {
+    Timing& timing = timings[stage];
+    timing.ok = ok;
+    timing.endUs = esp_timer_get_time();
+    Serial.printf("Boot: %s %s after %lu ms\n", stageName(stage), ok ? "ready" : "FAILED",
+                  (unsigned long)((timing.endUs - timing.startUs) / 1000));
+    xEventGroupSetBits(readyEvents, 1 << stage);
+}
+
+void BootSequencer::update() {
+    if (firstWeightUs == 0 && samplingTask.getSnapshot().timestampUs != 0 && !scale.isTaring()) {
+        firstWeightUs = esp_timer_get_time();
+        Serial.printf("Boot: first weight at %lu ms%s\n", (unsigned long)(firstWeightUs / 1000),
+                      fastWake ? " (fast wake)" : "");
+    }
+    if (wifiLinkUs == 0 && WiFi.isConnected()) {
+        wifiLinkUs = esp_timer_get_time();
+        Serial.printf("Boot: WiFi connected at %lu ms\n", (unsigned long)(wifiLinkUs / 1000));
+    }
+}
+
+void BootSequencer::printReport() const {
+    Serial.println("=== Boot Stages (ms since reset) ===");
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        const Timing& timing = timings[i];
+        if (timing.startUs == 0) {
+            continue; // Never started
+        }
+        if (timing.endUs == 0) {
+            Serial.printf("%-8s %6lu -> (still running)\n", stageName((Stage)i), (unsigned long)(timing.startUs / 1000));
+            continue;
+        }
+        Serial.printf("%-8s %6lu -> %6lu  %6lu ms  %s\n", stageName((Stage)i),
+                      (unsigned long)(timing.startUs / 1000), (unsigned long)(timing.endUs / 1000),
+                      (unsigned long)((timing.endUs - timing.startUs) / 1000), timing.ok ? "ok" : "FAILED");
+    }
+    Serial.printf("setup() done at %lu ms%s\n", (unsigned long)(esp_timer_get_time() / 1000),
+                  fastWake ? " (fast wake)" : "");
+    Serial.println("=== End Boot Stages ===");
+}
+
+void BootSequencer::prepareForSleep() {
+    rtcState.tareOffset = scale.getOffset();
+    rtcState.tareValid = scale.isHX711Connected() && !scale.isTaring();
+    rtcState.wifiChannel = 0;
+    memset(rtcState.wifiBssid, 0, sizeof(rtcState.wifiBssid));
+    if (WiFi.isConnected()) {
+        const uint8_t* bssid = WiFi.BSSID();
+        if (bssid != nullptr) {
+            rtcState.wifiChannel = (uint8_t)WiFi.channel();
+            memcpy(rtcState.wifiBssid, bssid, sizeof(rtcState.wifiBssid));
+        }
+    }
+    rtcState.magic = RTC_MAGIC;
+    Serial.printf("Fast wake state saved: tare %ld, WiFi channel %u\n", (long)rtcState.tareOffset,
+                  (unsigned)rtcState.wifiChannel);
+}
+
+bool BootSequencer::getTareOffset(int32_t& offset) const {
+    if (!fastWake || !restored.tareValid) {
+        return false;
+    }
+    offset = restored.tareOffset;
+    return true;
+}
+
+uint8_t BootSequencer::getWiFiChannel() const {
+    return fastWake ? restored.wifiChannel : 0;
+}
+
+const uint8_t* BootSequencer::getWiFiBssid() const {
+    return fastWake && restored.wifiChannel != 0 ? restored.wifiBssid : nullptr;
+}
+
+const char* BootSequencer::stageName(Stage stage) {
+    switch (stage) {
+        case STAGE_BLE: return "ble";
+        case STAGE_WIFI: return "wifi";
+        case STAGE_SCALE: return "scale";
+        case STAGE_DISPLAY: return "display";
+        case STAGE_WEB: return "web";
+        default: return "unknown";
+    }
+}
+
+const char* BootSequencer::wakeCauseName(esp_sleep_wakeup_cause_t cause) {
+    switch (cause) {
+        case ESP_SLEEP_WAKEUP_EXT0: return "external signal (touch sensor)";
+        case ESP_SLEEP_WAKEUP_EXT1: return "external signal using RTC_CNTL";
+        case ESP_SLEEP_WAKEUP_TIMER: return "timer";
+        case ESP_SLEEP_WAKEUP_TOUCHPAD: return "touchpad";
+        case ESP_SLEEP_WAKEUP_UNDEFINED: return "none (power-on or reset)";
+        default: return "other";
+    }
+}
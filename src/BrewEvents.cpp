@@ -0,0 +1,128 @@
+#include "BrewEvents.h"
+#include "SamplingTask.h"
+#include "Display.h"
+#include "JsonWriter.h"
+
+BrewEvents::BrewEvents(SamplingTask& samplingTask, Display& display)
+    : events("/api/brew/events"), samplingTask(samplingTask), display(display),
+      historyHead(0), historyCount(0), intervalMs(50), lastSequence(0),
+      lastSampleMs(0), lastTimerMs(0), lastTimerRunning(false) {
+    historyLock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void BrewEvents::begin(AsyncWebServer& server) {
+    events.onConnect([this](AsyncEventSourceClient* client) {
+        onConnect(client);
+    });
+    server.addHandler(&events);
+
+    server.on("/api/brew/events/config", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        if (!request->hasParam("intervalMs", true)) {
+            request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Missing intervalMs\"}");
+            return;
+        }
+        long interval = request->getParam("intervalMs", true)->value().toInt();
+        setMaxRate((uint16_t)constrain(interval, 0L, (long)MAX_INTERVAL_MS));
+        char body[48];
+        JsonWriter json(body, sizeof(body));
+        json.beginObject().field("status", "success").field("intervalMs", (unsigned int)intervalMs).endObject();
+        request->send(200, "application/json", body);
+    });
+    Serial.println("Brew event stream registered on /api/brew/events");
+}
+
+void BrewEvents::setMaxRate(uint16_t interval) {
+    intervalMs = interval > MAX_INTERVAL_MS ? MAX_INTERVAL_MS : interval;
+}
+
+void BrewEvents::onConnect(AsyncEventSourceClient* client) {
+    char timer[48];
+    JsonWriter json(timer, sizeof(timer));
+    json.beginObject().field("ms", display.getElapsedTime()).field("running", display.isTimerRunning()).endObject();
+    client->send(timer, "timer");
+
+    uint32_t lastId = client->lastId();
+    if (lastId == 0) {
+        return; // Fresh client - the next sample is its first event
+    }
+
+    // Resume: replay whatever is newer than the client's last id, oldest first
+    HistoryEntry missed[HISTORY_SIZE];
+    size_t count = 0;
+    portENTER_CRITICAL(&historyLock);
+    size_t start = (historyHead + HISTORY_SIZE - historyCount) % HISTORY_SIZE;
+    for (size_t i = 0; i < historyCount; i++) {
+        const HistoryEntry& entry = history[(start + i) % HISTORY_SIZE];
+        if ((int32_t)(entry.sequence - lastId) > 0) {
+            missed[count++] = entry;
+        }
+    }
+    portEXIT_CRITICAL(&historyLock);
+
+    for (size_t i = 0; i < count; i++) {
+        sendSample(client, missed[i]);
+    }
+}
+
+void BrewEvents::update() {
+    uint32_t now = millis();
+    bool hasClients = events.count() > 0;
+
+    if (hasClients) {
+        bool running = display.isTimerRunning();
+        if (running != lastTimerRunning || (running && now - lastTimerMs >= TIMER_INTERVAL_MS)) {
+            sendTimer(display.getElapsedTime(), running);
+            lastTimerRunning = running;
+            lastTimerMs = now;
+        }
+    }
+
+    WeightSnapshot snapshot = samplingTask.getSnapshot();
+    if (snapshot.sequence == lastSequence || now - lastSampleMs < intervalMs) {
+        return;
+    }
+    if (hasClients && events.avgPacketsWaiting() > MAX_PACKETS_WAITING) {
+        return; // Clients are behind - the next sample supersedes this one
+    }
+    lastSequence = snapshot.sequence;
+    lastSampleMs = now;
+
+    HistoryEntry entry = {snapshot.sequence, snapshot.weight, snapshot.flowRate};
+    portENTER_CRITICAL(&historyLock);
+    history[historyHead] = entry;
+    historyHead = (historyHead + 1) % HISTORY_SIZE;
+    if (historyCount < HISTORY_SIZE) {
+        historyCount++;
+    }
+    portEXIT_CRITICAL(&historyLock);
+
+    // History keeps filling with no clients so a lone client that drops can resume
+    if (hasClients) {
+        sendSample(nullptr, entry);
+    }
+}
+
+void BrewEvents::sendSample(AsyncEventSourceClient* client, const HistoryEntry& entry) {
+    char weight[16];
+    char flow[16];
+    JsonWriter weightJson(weight, sizeof(weight));
+    weightJson.value(entry.weight, 1);
+    JsonWriter flowJson(flow, sizeof(flow));
+    flowJson.value(entry.flowRate, 1);
+
+    // nullptr broadcasts to every connected client
+    if (client != nullptr) {
+        client->send(weight, "w", entry.sequence);
+        client->send(flow, "f", entry.sequence);
+    } else {
+        events.send(weight, "w", entry.sequence);
+        events.send(flow, "f", entry.sequence);
+    }
+}
+
+void BrewEvents::sendTimer(unsigned long elapsedMs, bool running) {
+    char data[48];
+    JsonWriter json(data, sizeof(data));
+    json.beginObject().field("ms", elapsedMs).field("running", running).endObject();
+    events.send(data, "timer");
+}
@@ -0,0 +1,336 @@
+#include "ControlCommands.h"
+#include <Preferences.h>
+#include "Scale.h"
+#include "Display.h"
+#include "FlowRate.h"
+#include "BluetoothScale.h"
+#include "JsonWriter.h"
+#include "WiFiManager.h"
+
+ControlCommands::ControlCommands(Scale& scale, Display& display, FlowRate& flowRate, BluetoothScale& bluetoothScale)
+    : scale(scale), display(display), flowRate(flowRate), bluetoothScale(bluetoothScale),
+      nextId(1), executed(0), resultIndex(0), restartAtMs(0) {
+    memset(results, 0, sizeof(results));
+    memset(pending, 0, sizeof(pending));
+    resultLock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+uint32_t ControlCommands::post(Type type, Source source, float value, uint8_t samples) {
+    Command command;
+    command.id = nextId.fetch_add(1);
+    if (command.id == 0) {
+        command.id = nextId.fetch_add(1); // 0 means "not queued" to callers
+    }
+    command.type = type;
+    command.source = source;
+    command.samples = samples;
+    command.value = value;
+    if (!queue.push(command)) {
+        Serial.printf("Commands: queue full - %s dropped\n", getTypeName(type));
+        return 0;
+    }
+    return command.id;
+}
+
+void ControlCommands::process() {
+    Command command;
+    while (queue.pop(command)) {
+        Outcome outcome = execute(command);
+        if (outcome != OUTCOME_PENDING) {
+            recordResult(command, outcome == OUTCOME_DONE);
+        }
+        executed++;
+    }
+    finishPending();
+
+    if (restartAtMs != 0 && (int32_t)(millis() - restartAtMs) >= 0) {
+        Serial.println("Commands: restarting after settings reset");
+        ESP.restart();
+    }
+}
+
+ControlCommands::Outcome ControlCommands::execute(const Command& command) {
+    Serial.printf("Commands: %s #%lu from %s\n", getTypeName(command.type), (unsigned long)command.id,
+                  command.source == SOURCE_BLE ? "BLE" : "HTTP");
+
+    // BLE commands answer with the WeighMyBru confirmation messages
+    if (command.source == SOURCE_BLE) {
+        switch (command.type) {
+            case TARE: {
+                uint32_t tareCount = scale.getTareCount();
+                if (!bluetoothScale.handleTareCommand()) {
+                    return OUTCOME_FAILED;
+                }
+                return addPending(command, tareCount) ? OUTCOME_PENDING : OUTCOME_DONE;
+            }
+            case TIMER_START: return toOutcome(bluetoothScale.handleTimerCommand(BeanConquerorCommand::TIMER_START));
+            case TIMER_STOP: return toOutcome(bluetoothScale.handleTimerCommand(BeanConquerorCommand::TIMER_STOP));
+            case TIMER_RESET: return toOutcome(bluetoothScale.handleTimerCommand(BeanConquerorCommand::TIMER_RESET));
+            default: break;
+        }
+    }
+
+    switch (command.type) {
+        case TARE: {
+            uint32_t tareCount = scale.getTareCount();
+            // Non-blocking - the offset is built from the next captured samples
+            if (!scale.tare(command.samples)) {
+                return OUTCOME_FAILED;
+            }
+            // Reset timer and flow rate averaging for a fresh brew
+            display.resetTimer();
+            flowRate.resetTimerAveraging();
+            // Done once the sample consumer has put the new zero in place
+            return addPending(command, tareCount) ? OUTCOME_PENDING : OUTCOME_DONE;
+        }
+
+        case TIMER_START:
+            display.startTimer();
+            return OUTCOME_DONE;
+
+        case TIMER_STOP:
+            display.stopTimer();
+            return OUTCOME_DONE;
+
+        case TIMER_RESET:
+            display.resetTimer();
+            return OUTCOME_DONE;
+
+        case SET_CALIBRATION:
+            if (command.value <= 0.0f) {
+                return OUTCOME_FAILED;
+            }
+            scale.set_scale(command.value);
+            Serial.printf("Calibration factor set to %.6f\n", command.value);
+            return OUTCOME_DONE;
+
+        case RESET_SETTINGS: {
+            Serial.println("Resetting NVS storage...");
+            Preferences clearPrefs;
+            const char* namespaces[] = {"wifi", "display", "scale", "ble"};
+            for (const char* name : namespaces) {
+                clearPrefs.begin(name, false);
+                clearPrefs.clear();
+                clearPrefs.end();
+            }
+            // Restart from process() once the response had time to go out
+            restartAtMs = millis() + RESTART_DELAY_MS;
+            if (restartAtMs == 0) {
+                restartAtMs = 1;
+            }
+            return OUTCOME_DONE;
+        }
+
+        case WIFI_CONNECT:
+        case WIFI_ENABLE:
+        case WIFI_DISABLE:
+        case WIFI_TOGGLE:
+            // These can take down the link the 202 travels on - run them from
+            // finishPending() once the response had time to go out
+            return addPending(command) ? OUTCOME_PENDING : OUTCOME_FAILED;
+    }
+    return OUTCOME_FAILED;
+}
+
+bool ControlCommands::addPending(const Command& command, uint32_t tareCount) {
+    for (size_t i = 0; i < PENDING_COUNT; i++) {
+        if (pending[i].command.id == 0) {
+            portENTER_CRITICAL(&resultLock);
+            pending[i].command = command;
+            pending[i].sinceMs = millis();
+            pending[i].tareCount = tareCount;
+            pending[i].started = false;
+            portEXIT_CRITICAL(&resultLock);
+            return true;
+        }
+    }
+    Serial.printf("Commands: too many running - %s #%lu not tracked\n", getTypeName(command.type),
+                  (unsigned long)command.id);
+    return false;
+}
+
+void ControlCommands::finishPending() {
+    for (size_t i = 0; i < PENDING_COUNT; i++) {
+        Pending entry = pending[i]; // Only process() writes slots, so reading without the lock is safe here
+        if (entry.command.id == 0) {
+            continue;
+        }
+        uint32_t elapsedMs = millis() - entry.sinceMs;
+        bool ok;
+        if (entry.command.type == TARE) {
+            // A tare requested while another runs starts after it, so wait until none is left
+            if (scale.getTareCount() != entry.tareCount && !scale.isTaring()) {
+                ok = true;
+            } else if (elapsedMs >= TARE_TIMEOUT_MS) {
+                Serial.printf("Commands: tare #%lu timed out\n", (unsigned long)entry.command.id);
+                ok = false;
+            } else {
+                continue;
+            }
+        } else if (entry.started) {
+            // WIFI_CONNECT: done when the link state machine settles the attempt
+            WiFiConnectResult result = getWiFiConnectResult();
+            if (result != WIFI_CONNECT_RUNNING) {
+                ok = result == WIFI_CONNECT_OK;
+            } else if (elapsedMs >= WIFI_CONNECT_TIMEOUT_MS) {
+                Serial.printf("Commands: wifi connect #%lu timed out\n", (unsigned long)entry.command.id);
+                ok = false;
+            } else {
+                continue;
+            }
+        } else {
+            if (elapsedMs < WIFI_CHANGE_DELAY_MS) {
+                continue;
+            }
+            ok = runWiFiChange(entry.command.type);
+            if (ok && entry.command.type == WIFI_CONNECT) {
+                pending[i].started = true; // Only process() reads it
+                continue;
+            }
+        }
+        // Result first, so getState() never sees the command in neither place
+        recordResult(entry.command, ok);
+        portENTER_CRITICAL(&resultLock);
+        pending[i].command.id = 0;
+        portEXIT_CRITICAL(&resultLock);
+    }
+}
+
+// None of these wait on the radio - a connect attempt is carried on by maintainWiFi()
+// and picked up again by finishPending()
+bool ControlCommands::runWiFiChange(Type type) {
+    switch (type) {
+        case WIFI_CONNECT: {
+            String ssid = getStoredSSID();
+            String password = getStoredPassword();
+            if (ssid.isEmpty()) {
+                return false;
+            }
+            attemptSTAConnection(ssid.c_str(), password.c_str());
+            return true;
+        }
+        case WIFI_ENABLE:
+            enableWiFi();
+            return true;
+        case WIFI_DISABLE:
+            disableWiFi();
+            return true;
+        case WIFI_TOGGLE:
+            toggleWiFi();
+            return true;
+        default:
+            return false;
+    }
+}
+
+void ControlCommands::recordResult(const Command& command, bool ok) {
+    portENTER_CRITICAL(&resultLock);
+    Result& result = results[resultIndex];
+    result.id = command.id;
+    result.type = command.type;
+    result.source = command.source;
+    result.ok = ok;
+    result.completedMs = millis();
+    resultIndex = (resultIndex + 1) % RESULT_COUNT;
+    portEXIT_CRITICAL(&resultLock);
+}
+
+ControlCommands::State ControlCommands::getState(uint32_t id) {
+    if (id == 0 || id >= nextId.load()) {
+        return STATE_UNKNOWN;
+    }
+    State state = STATE_UNKNOWN;
+    uint32_t oldestId = UINT32_MAX;
+    portENTER_CRITICAL(&resultLock);
+    for (size_t i = 0; i < RESULT_COUNT; i++) {
+        if (results[i].id == 0) {
+            continue;
+        }
+        if (results[i].id == id) {
+            state = results[i].ok ? STATE_DONE : STATE_FAILED;
+        }
+        if (results[i].id < oldestId) {
+            oldestId = results[i].id;
+        }
+    }
+    bool ringFull = results[resultIndex].id != 0;
+    if (state == STATE_UNKNOWN) {
+        for (size_t i = 0; i < PENDING_COUNT; i++) {
+            if (pending[i].command.id == id) {
+                state = STATE_RUNNING;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&resultLock);
+
+    // Posted but not completed yet, unless it was already pushed out of the result ring
+    if (state == STATE_UNKNOWN && (!ringFull || id > oldestId)) {
+        state = STATE_QUEUED;
+    }
+    return state;
+}
+
+void ControlCommands::writeStatus(JsonWriter& json) {
+    Result snapshot[RESULT_COUNT];
+    size_t newest;
+    unsigned long running = 0;
+    portENTER_CRITICAL(&resultLock);
+    memcpy(snapshot, results, sizeof(snapshot));
+    newest = resultIndex;
+    for (size_t i = 0; i < PENDING_COUNT; i++) {
+        if (pending[i].command.id != 0) {
+            running++;
+        }
+    }
+    portEXIT_CRITICAL(&resultLock);
+
+    json.beginObject();
+    json.field("queued", (unsigned long)queue.available());
+    json.field("running", running);
+    json.field("capacity", (unsigned long)queue.capacity());
+    json.field("executed", (unsigned long)executed);
+    json.field("dropped", (unsigned long)queue.getDroppedCount());
+    json.beginArray("recent");
+    // Newest first
+    for (size_t n = 0; n < RESULT_COUNT; n++) {
+        const Result& result = snapshot[(newest + RESULT_COUNT - 1 - n) % RESULT_COUNT];
+        if (result.id == 0) {
+            break;
+        }
+        json.beginObject();
+        json.field("id", (unsigned long)result.id);
+        json.field("type", getTypeName(result.type));
+        json.field("source", result.source == SOURCE_BLE ? "ble" : "http");
+        json.field("state", getStateName(result.ok ? STATE_DONE : STATE_FAILED));
+        json.field("age_ms", (unsigned long)(millis() - result.completedMs));
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+}
+
+const char* ControlCommands::getTypeName(Type type) {
+    switch (type) {
+        case TARE: return "tare";
+        case TIMER_START: return "timer_start";
+        case TIMER_STOP: return "timer_stop";
+        case TIMER_RESET: return "timer_reset";
+        case SET_CALIBRATION: return "set_calibration";
+        case RESET_SETTINGS: return "reset_settings";
+        case WIFI_CONNECT: return "wifi_connect";
+        case WIFI_ENABLE: return "wifi_enable";
+        case WIFI_DISABLE: return "wifi_disable";
+        case WIFI_TOGGLE: return "wifi_toggle";
+        default: return "unknown";
+    }
+}
+
+const char* ControlCommands::getStateName(State state) {
+    switch (state) {
+        case STATE_QUEUED: return "queued";
+        case STATE_RUNNING: return "running";
+        case STATE_DONE: return "done";
+        case STATE_FAILED: return "failed";
+        default: return "unknown";
+    }
+}
@@ -1,25 +1,41 @@
 #include "Display.h"
+#include <esp_timer.h>
 #include "Scale.h"
 #include "FlowRate.h"
 #include "BluetoothScale.h"
 #include "PowerManager.h"
 #include "BatteryMonitor.h"
+#include "SamplingTask.h"
+#include "TraceRecorder.h"
 #include <WiFi.h>
 #include "WiFiManager.h"
 
 Display::Display(uint8_t sdaPin, uint8_t sclPin, Scale* scale, FlowRate* flowRate)
-    : sdaPin(sdaPin), sclPin(sclPin), scalePtr(scale), flowRatePtr(flowRate), bluetoothPtr(nullptr), powerManagerPtr(nullptr), batteryPtr(nullptr), wifiManagerPtr(nullptr),
+    : sdaPin(sdaPin), sclPin(sclPin), scalePtr(scale), flowRatePtr(flowRate), bluetoothPtr(nullptr), powerManagerPtr(nullptr), batteryPtr(nullptr), samplingTaskPtr(nullptr), traceRecorderPtr(nullptr), wifiManagerPtr(nullptr),
       messageStartTime(0), messageDuration(2000), showingMessage(false), 
       timerStartTime(0), timerPausedTime(0), timerRunning(false), timerPaused(false),
       lastFlowRate(0.0), showingStatusPage(false), statusPageStartTime(0) {
-    display = new Adafruit_SSD1306(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+    // Keep the bus at fast mode - by default the library drops back to 100 kHz after every transfer
+    display = new Adafruit_SSD1306(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, I2C_CLOCK_HZ, I2C_CLOCK_HZ);
+    framePending = false;
+    transmitting = false;
+    frameLock = portMUX_INITIALIZER_UNLOCKED;
+    taskHandle = nullptr;
+    panelFrameValid = false;
+    mainViewShown = false;
+    framesPushed = 0;
+    framesSkipped = 0;
+    framesDropped = 0;
+    i2cBytes = 0;
+    lastFrameUs = 0;
+    maxFrameUs = 0;
 }
 
 bool Display::begin() {
     Serial.println("Initializing display...");
     
     // Initialize I2C with custom pins
-    Wire.begin(sdaPin, sclPin);
+    Wire.begin(sdaPin, sclPin, I2C_CLOCK_HZ);
     
     // Test I2C connection first with timeout
     Serial.println("Testing I2C connection to display...");
@@ -62,6 +78,12 @@ bool Display::begin() {
     
     Serial.println("Display connected and initialized successfully");
     displayConnected = true;
+    
+    // Frames are transmitted by their own task so I2C time never stalls loop()
+    if (xTaskCreatePinnedToCore(taskEntry, "display", TASK_STACK_SIZE, this, TASK_PRIORITY, &taskHandle, TASK_CORE) != pdPASS) {
+        taskHandle = nullptr;
+        Serial.println("WARNING: Display task not started - sending frames from loop()");
+    }
     setupDisplay();
     
     // Show startup message in same format as welcome message
@@ -95,7 +117,7 @@ bool Display::begin() {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
     
     Serial.println("SSD1306 display initialized on SDA:" + String(sdaPin) + " SCL:" + String(sclPin));
     
@@ -144,9 +166,15 @@ void Display::update() {
         showStatusPage();
     }
     // Show normal weight display when not showing message or status page
+    else if (!showingMessage && samplingTaskPtr != nullptr) {
+        // Weight and flow rate from the same published sample
+        WeightSnapshot snapshot = samplingTaskPtr->getSnapshot();
+        showWeightWithFlowAndTimer(snapshot.weight, snapshot.flowRate);
+    }
     else if (!showingMessage && scalePtr != nullptr) {
         float weight = scalePtr->getCurrentWeight();
-        showWeightWithFlowAndTimer(weight);
+        float flowRate = (flowRatePtr != nullptr) ? flowRatePtr->getFlowRate() : 0.0f;
+        showWeightWithFlowAndTimer(weight, flowRate);
     }
 }
 
@@ -159,7 +187,8 @@ void Display::showWeight(float weight) {
     if (showingMessage) return; // Don't override messages
     
     // Use the unified display showing weight, flow rate, and timer
-    showWeightWithFlowAndTimer(weight);
+    float flowRate = (flowRatePtr != nullptr) ? flowRatePtr->getFlowRate() : 0.0f;
+    showWeightWithFlowAndTimer(weight, flowRate);
 }
 
 void Display::showMessage(const String& message, int duration) {
@@ -189,7 +218,7 @@ void Display::showMessage(const String& message, int duration) {
         currentLine++;
     }
     
-    display->display();
+    pushFrame();
     
     // Update duration for this message
     if (duration > 0) {
@@ -239,7 +268,7 @@ void Display::showSleepCountdown(int seconds) {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::showSleepMessage() {
@@ -281,7 +310,7 @@ void Display::showSleepMessage() {
     display->setCursor(centerX2, 24);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::showGoingToSleepMessage() {
@@ -327,7 +356,7 @@ void Display::showGoingToSleepMessage() {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::showSleepCancelledMessage() {
@@ -373,7 +402,7 @@ void Display::showSleepCancelledMessage() {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::showTaringMessage() {
@@ -420,7 +449,7 @@ void Display::showTaringMessage() {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::showTaredMessage() {
@@ -466,7 +495,7 @@ void Display::showTaredMessage() {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::showWiFiStatusMessage(bool isEnabled) {
@@ -517,7 +546,7 @@ void Display::showWiFiStatusMessage(bool isEnabled) {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
+    pushFrame();
 }
 
 void Display::clearMessageState() {
@@ -564,8 +593,13 @@ void Display::showIPAddresses() {
     display->setCursor(centerX2, line2Y);
     display->print(line2);
     
-    display->display();
-    delay(1000); // Show ready message for 1 second, then continue to normal display
+    pushFrame();
+    
+    // Hold the ready message for 1 second via update(), then continue to normal display
+    currentMessage = "Ready message";
+    messageStartTime = millis();
+    messageDuration = 1000;
+    showingMessage = true;
 }
 
 void Display::clear() {
@@ -575,7 +609,7 @@ void Display::clear() {
     }
     
     display->clearDisplay();
-    display->display();
+    pushFrame();
 }
 
 void Display::setBrightness(uint8_t brightness) {
@@ -601,6 +635,14 @@ void Display::setBatteryMonitor(BatteryMonitor* battery) {
     batteryPtr = battery;
 }
 
+void Display::setSamplingTask(SamplingTask* samplingTask) {
+    samplingTaskPtr = samplingTask;
+}
+
+void Display::setTraceRecorder(TraceRecorder* recorder) {
+    traceRecorderPtr = recorder;
+}
+
 void Display::setWiFiManager(WiFiManager* wifi) {
     wifiManagerPtr = wifi;
 }
@@ -729,7 +771,7 @@ void Display::drawWeight(float weight) {
     // Draw battery status
     drawBatteryStatus();
     
-    display->display();
+    pushFrame();
 }
 
 /*
@@ -737,7 +779,7 @@ void Display::showWeightWithTimer(float weight) - REMOVED FUNCTION
 Function removed as part of mode simplification - unified into showWeightWithFlowAndTimer()
 */
 
-void Display::showWeightWithFlowAndTimer(float weight) {
+void Display::showWeightWithFlowAndTimer(float weight, float flowRate) {
     // Return early if display is not connected
     if (!displayConnected) {
         return;
@@ -748,180 +790,200 @@ void Display::showWeightWithFlowAndTimer(float weight) {
         return;
     }
     
-    // Declare variables used throughout function
-    int16_t x1, y1;
-    uint16_t w, h;
+    // Apply deadband to prevent flickering between 0.0 and -0.0 (weight and flow)
+    float displayWeight = (weight >= -0.1 && weight <= 0.1) ? 0.0f : weight;
+    float displayFlowRate = (flowRate >= -0.1 && flowRate <= 0.1) ? 0.0f : flowRate;
     
-    display->clearDisplay();
+    MainView view;
+    splitTenths(displayWeight, view.weightNegative, view.weightInteger, view.weightDecimal);
+    splitTenths(getTimerSeconds(), view.timerNegative, view.timerInteger, view.timerDecimal);
+    splitTenths(displayFlowRate, view.flowNegative, view.flowInteger, view.flowDecimal);
     
-    // Apply deadband to prevent flickering between 0.0g and -0.0g
-    float displayWeight = weight;
-    if (weight >= -0.1 && weight <= 0.1) {
-        displayWeight = 0.0;
+    // Nothing visible changed - skip rendering and the I2C transfer
+    if (mainViewShown && view == lastMainView) {
+        framesSkipped++;
+        return;
     }
     
-    // Split weight into integer and decimal parts for custom rendering
-    bool isNegative = displayWeight < 0;
-    float absWeight = abs(displayWeight);
-    int integerPart = (int)absWeight;
-    int decimalPart = (int)((absWeight - integerPart) * 10 + 0.5); // Round to 1 decimal
-    
-    // Handle carry-over when decimal part rounds to 10 (e.g., 4.95 -> 5.0)
-    if (decimalPart >= 10) {
-        integerPart += 1;
-        decimalPart = 0;
-    }
+    display->clearDisplay();
+    char text[16];
     
-    // Draw weight with custom decimal point - positioned at left middle
+    // Weight with custom decimal point - positioned at left middle
+    // (size 3 text is ~21px tall, so (32-21)/2 ≈ 5)
+    const int weightY = 5;
+    snprintf(text, sizeof(text), "%s%ld", view.weightNegative ? "-" : "", (long)view.weightInteger);
     display->setTextSize(3);
-    int weightY = 5; // Middle of 32-pixel screen (size 3 text is ~21px tall, so (32-21)/2 ≈ 5)
     display->setCursor(0, weightY);
+    display->print(text);
+    int currentX = textWidth(text, 3);
     
-    // Draw negative sign if needed
-    int currentX = 0;
-    if (isNegative) {
-        display->print("-");
-        // Calculate width of "-" in size 3
-        display->getTextBounds("-", 0, 0, &x1, &y1, &w, &h);
-        currentX += w;
-    }
-    
-    // Draw integer part in size 3
-    String intStr = String(integerPart);
-    display->setCursor(currentX, weightY);
-    display->print(intStr);
-    
-    // Calculate position after integer part
-    display->getTextBounds(intStr, 0, 0, &x1, &y1, &w, &h);
-    currentX += w;
-    
-    // Draw smaller decimal point (size 1) positioned to align with baseline
+    // Smaller decimal point (size 1) aligned with the baseline, decimal digit in size 2 for readability
     display->setTextSize(1);
-    display->setCursor(currentX, weightY + 11); // Offset from weight baseline for alignment
+    display->setCursor(currentX, weightY + 11);
     display->print(".");
-    display->getTextBounds(".", 0, 0, &x1, &y1, &w, &h);
-    currentX += w;
-    
-    // Draw decimal digit in size 2 for better readability
-    display->setTextSize(2);
-    display->setCursor(currentX, weightY + 3); // Positioned relative to weight baseline
-    display->print(String(decimalPart));
-    
-    // Right side: Timer and flow rate stacked (size 2)
+    currentX += textWidth(".", 1);
     display->setTextSize(2);
+    display->setCursor(currentX, weightY + 3);
+    display->print(view.weightDecimal);
     
-    // Get timer value and format without "s"
-    float currentTime = getTimerSeconds();
-    
-    // Get flow rate and format without "g/s"
-    float currentFlowRate = 0.0;
-    if (flowRatePtr != nullptr) {
-        currentFlowRate = flowRatePtr->getFlowRate();
-    }
-    
-    // Apply deadband to flow rate
-    float displayFlowRate = currentFlowRate;
-    if (currentFlowRate >= -0.1 && currentFlowRate <= 0.1) {
-        displayFlowRate = 0.0;
-    }
-    
-    // === CUSTOM TIMER RENDERING (like weight) ===
-    bool timerNegative = currentTime < 0;
-    float absTimer = abs(currentTime);
-    int timerInteger = (int)absTimer;
-    int timerDecimal = (int)((absTimer - timerInteger) * 10 + 0.5);
-    
-    // Handle timer carry-over
-    if (timerDecimal >= 10) {
-        timerInteger += 1;
-        timerDecimal = 0;
-    }
+    // Right side: timer over flow rate, each as size 2 integer, size 1 ".d" and a label at far right
+    const int labelX = SCREEN_WIDTH - textWidth("T", 1);
+    const int fractionWidth = textWidth(".", 1) + textWidth("0", 1);
     
-    // Calculate timer position with "T" label at far right
-    display->setTextSize(2);
-    String timerIntStr = String(timerInteger);
-    if (timerNegative) timerIntStr = "-" + timerIntStr;
-    
-    uint16_t timerIntWidth, timerDecWidth, timerH, timerLabelWidth;
-    display->getTextBounds(timerIntStr, 0, 0, &x1, &y1, &timerIntWidth, &timerH);
-    display->setTextSize(1);
-    display->getTextBounds("T", 0, 0, &x1, &y1, &timerLabelWidth, &timerH);
-    display->getTextBounds(".", 0, 0, &x1, &y1, &w, &timerH);
-    uint16_t timerDotWidth = w;
-    display->getTextBounds(String(timerDecimal), 0, 0, &x1, &y1, &timerDecWidth, &timerH);
-    
-    // Position "T" at far right, numbers to the left
-    int timerLabelX = SCREEN_WIDTH - timerLabelWidth;
-    int timerStartX = timerLabelX - timerIntWidth - timerDotWidth - timerDecWidth;
-    
-    // Draw timer integer part (size 2)
+    snprintf(text, sizeof(text), "%s%ld", view.timerNegative ? "-" : "", (long)view.timerInteger);
+    int timerStartX = labelX - textWidth(text, 2) - fractionWidth;
     display->setTextSize(2);
     display->setCursor(timerStartX, 0);
-    display->print(timerIntStr);
-    
-    // Draw timer decimal point (size 1)
+    display->print(text);
     display->setTextSize(1);
-    display->setCursor(timerStartX + timerIntWidth, 7); // Aligned with size 2 baseline
+    display->setCursor(timerStartX + textWidth(text, 2), 7); // Aligned with size 2 baseline
     display->print(".");
-    
-    // Draw timer decimal digit (size 1)
-    display->setCursor(timerStartX + timerIntWidth + timerDotWidth, 7);
-    display->print(String(timerDecimal));
-    
-    // Draw "T" label at far right (size 1)
-    display->setTextSize(1);
-    display->setCursor(timerLabelX, 0); // Far right position
+    display->print(view.timerDecimal);
+    display->setCursor(labelX, 0);
     display->print("T");
     
-    // === CUSTOM FLOW RATE RENDERING (like weight) ===
-    bool flowNegative = displayFlowRate < 0;
-    float absFlow = abs(displayFlowRate);
-    int flowInteger = (int)absFlow;
-    int flowDecimal = (int)((absFlow - flowInteger) * 10 + 0.5);
-    
-    // Handle flow rate carry-over
-    if (flowDecimal >= 10) {
-        flowInteger += 1;
-        flowDecimal = 0;
-    }
-    
-    // Calculate flow rate position with "F" label at far right
-    display->setTextSize(2);
-    String flowIntStr = String(flowInteger);
-    if (flowNegative) flowIntStr = "-" + flowIntStr;
-    
-    uint16_t flowIntWidth, flowDecWidth, flowH, flowLabelWidth;
-    display->getTextBounds(flowIntStr, 0, 0, &x1, &y1, &flowIntWidth, &flowH);
-    display->setTextSize(1);
-    display->getTextBounds("F", 0, 0, &x1, &y1, &flowLabelWidth, &flowH);
-    display->getTextBounds(".", 0, 0, &x1, &y1, &w, &flowH);
-    uint16_t flowDotWidth = w;
-    display->getTextBounds(String(flowDecimal), 0, 0, &x1, &y1, &flowDecWidth, &flowH);
-    
-    // Position "F" at far right, numbers to the left
-    int flowLabelX = SCREEN_WIDTH - flowLabelWidth;
-    int flowStartX = flowLabelX - flowIntWidth - flowDotWidth - flowDecWidth;
-    
-    // Draw flow rate integer part (size 2)
+    snprintf(text, sizeof(text), "%s%ld", view.flowNegative ? "-" : "", (long)view.flowInteger);
+    int flowStartX = labelX - textWidth(text, 2) - fractionWidth;
     display->setTextSize(2);
     display->setCursor(flowStartX, 16); // Below timer
-    display->print(flowIntStr);
-    
-    // Draw flow rate decimal point (size 1)
+    display->print(text);
     display->setTextSize(1);
-    display->setCursor(flowStartX + flowIntWidth, 23); // Aligned with size 2 baseline
+    display->setCursor(flowStartX + textWidth(text, 2), 23); // Aligned with size 2 baseline
     display->print(".");
+    display->print(view.flowDecimal);
+    display->setCursor(labelX, 16);
+    display->print("F");
     
-    // Draw flow rate decimal digit (size 1)
-    display->setCursor(flowStartX + flowIntWidth + flowDotWidth, 23);
-    display->print(String(flowDecimal));
+    pushFrame();
+    lastMainView = view;
+    mainViewShown = true;
+}
+
+void Display::splitTenths(float value, bool& negative, int32_t& integer, uint8_t& decimal) {
+    negative = value < 0;
+    float magnitude = fabsf(value);
+    integer = (int32_t)magnitude;
+    int tenths = (int)((magnitude - integer) * 10 + 0.5f); // Round to 1 decimal
+    // Carry when the decimal rounds to 10 (e.g., 4.95 -> 5.0)
+    if (tenths >= 10) {
+        integer += 1;
+        tenths = 0;
+    }
+    decimal = (uint8_t)tenths;
+}
+
+void Display::pushFrame() {
+    if (!displayConnected) {
+        return;
+    }
+    // Any screen other than the main view leaves the panel out of sync with lastMainView;
+    // showWeightWithFlowAndTimer() sets it again after its own push
+    mainViewShown = false;
     
-    // Draw "F" label at far right (size 1)
-    display->setTextSize(1);
-    display->setCursor(flowLabelX, 16); // Far right position, below timer
-    display->print("F");
+    if (taskHandle == nullptr) {
+        transmitFrame(display->getBuffer());
+        return;
+    }
     
-    display->display();
+    portENTER_CRITICAL(&frameLock);
+    if (framePending) {
+        framesDropped++; // Task still busy with the previous frame - only the newest one matters
+    }
+    memcpy(pendingFrame, display->getBuffer(), FRAME_BYTES);
+    framePending = true;
+    portEXIT_CRITICAL(&frameLock);
+    xTaskNotifyGive(taskHandle);
+}
+
+void Display::flush(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while ((framePending || transmitting) && millis() - start < timeoutMs) {
+        delay(1);
+    }
+}
+
+void Display::taskEntry(void* arg) {
+    static_cast<Display*>(arg)->runTask();
+}
+
+void Display::runTask() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        portENTER_CRITICAL(&frameLock);
+        bool pending = framePending;
+        if (pending) {
+            memcpy(sendingFrame, pendingFrame, FRAME_BYTES);
+            framePending = false;
+            transmitting = true;
+        }
+        portEXIT_CRITICAL(&frameLock);
+        
+        if (pending) {
+            transmitFrame(sendingFrame);
+            transmitting = false;
+        }
+    }
+}
+
+void Display::transmitFrame(const uint8_t* frame) {
+    int64_t start = esp_timer_get_time();
+    bool changed = false;
+    for (uint8_t page = 0; page < PAGE_COUNT; page++) {
+        const uint8_t* row = frame + page * SCREEN_WIDTH;
+        uint8_t* panelRow = panelFrame + page * SCREEN_WIDTH;
+        int first = 0;
+        int last = SCREEN_WIDTH - 1;
+        if (panelFrameValid) {
+            while (first < SCREEN_WIDTH && row[first] == panelRow[first]) {
+                first++;
+            }
+            if (first == SCREEN_WIDTH) {
+                continue; // Page unchanged
+            }
+            while (row[last] == panelRow[last]) {
+                last--;
+            }
+        }
+        sendRegion(frame, page, first, last);
+        memcpy(panelRow + first, row + first, last - first + 1);
+        changed = true;
+    }
+    panelFrameValid = true;
+    if (changed) {
+        lastFrameUs = (uint32_t)(esp_timer_get_time() - start);
+        if (lastFrameUs > maxFrameUs) {
+            maxFrameUs = lastFrameUs;
+        }
+        framesPushed++;
+    }
+}
+
+void Display::sendRegion(const uint8_t* frame, uint8_t page, uint8_t firstColumn, uint8_t lastColumn) {
+    // Window the SSD1306 RAM to these columns of one page (horizontal addressing, set up by begin())
+    Wire.beginTransmission(SCREEN_ADDRESS);
+    Wire.write((uint8_t)0x00); // Command stream
+    Wire.write((uint8_t)SSD1306_COLUMNADDR);
+    Wire.write(firstColumn);
+    Wire.write(lastColumn);
+    Wire.write((uint8_t)SSD1306_PAGEADDR);
+    Wire.write(page);
+    Wire.write(page);
+    Wire.endTransmission();
+    i2cBytes += 8; // Address, control and 6 command bytes
+    
+    const uint8_t* data = frame + page * SCREEN_WIDTH + firstColumn;
+    size_t remaining = lastColumn - firstColumn + 1;
+    while (remaining > 0) {
+        size_t chunk = remaining < I2C_DATA_CHUNK ? remaining : I2C_DATA_CHUNK;
+        Wire.beginTransmission(SCREEN_ADDRESS);
+        Wire.write((uint8_t)0x40); // Data stream
+        Wire.write(data, chunk);
+        Wire.endTransmission();
+        i2cBytes += chunk + 2;
+        data += chunk;
+        remaining -= chunk;
+    }
 }
 
 // Timer management methods
@@ -936,6 +998,11 @@ void Display::startTimer() {
         if (flowRatePtr != nullptr) {
             flowRatePtr->startTimerAveraging();
         }
+        
+        // Every fresh timer session gets its own raw trace
+        if (traceRecorderPtr != nullptr) {
+            traceRecorderPtr->start();
+        }
     } else if (timerPaused) {
         // Resume from paused state
         timerStartTime = millis() - timerPausedTime;
@@ -945,6 +1012,10 @@ void Display::startTimer() {
         if (flowRatePtr != nullptr) {
             flowRatePtr->startTimerAveraging();
         }
+        
+        if (traceRecorderPtr != nullptr) {
+            traceRecorderPtr->resume();
+        }
     }
     // If timer is already running and not paused, do nothing
 }
@@ -958,6 +1029,10 @@ void Display::stopTimer() {
         if (flowRatePtr != nullptr) {
             flowRatePtr->stopTimerAveraging();
         }
+        
+        if (traceRecorderPtr != nullptr) {
+            traceRecorderPtr->stop();
+        }
     }
 }
 
@@ -1045,7 +1120,7 @@ void Display::showStatusPage() {
         display->print(WiFi.softAPIP().toString());
     }
     
-    display->display();
+    pushFrame();
 }
 
 void Display::toggleStatusPage() {
@@ -1,126 +1,80 @@
 #include "FlowRate.h"
-#include "Calibration.h"
 #include <Arduino.h>
 
-FlowRate::FlowRate() : lastWeight(0), lastTime(0), flowRate(0), bufferIndex(0), bufferCount(0),
+FlowRate::FlowRate() : flowRate(0), requestedProfile(PROFILE_SMOOTH), activeProfile(PROFILE_SMOOTH),
     timerAveragingActive(false), timerFlowRateSum(0), timerFlowRateSamples(0), 
-    timerAverageFlowRate(0), hasValidTimerAverage(false), calculationPaused(false) {
-    for (int i = 0; i < FLOWRATE_AVG_WINDOW; ++i) flowRateBuffer[i] = 0;
+    timerAverageFlowRate(0), hasValidTimerAverage(false), calculationPaused(false), clearRequested(false) {
+    applyProfile(activeProfile);
 }
 
-void FlowRate::update(float currentWeight) {
+void FlowRate::addSample(uint32_t timestampUs, float weight) {
     // Skip flow rate calculation if paused (during tare operations)
     if (calculationPaused) {
         return;
     }
     
-    unsigned long now = millis();
+    if (clearRequested) {
+        clearRequested = false;
+        window.clear();
+    }
     
-    if (lastTime > 0) {
-        float deltaWeight = currentWeight - lastWeight;
-        float deltaTime = (now - lastTime) / 1000.0f; // seconds
-        
-        // Only update if enough time has passed for meaningful calculation
-        if (deltaTime >= MIN_DELTA_TIME) {
-            // Simple tare transition detection
-            bool tareTransition = false;
-            
-            // Check for tare transition: negative weight going to near zero
-            if (lastWeight < -5.0f && abs(currentWeight) < 2.0f) {
-                tareTransition = true;
-            }
-            
-            // Check for large weight jump (likely tare operation)
-            if (abs(deltaWeight) > 50.0f) {
-                tareTransition = true;
-            }
-            
-            if (!tareTransition) {
-                // Detect different types of changes with higher thresholds
-                bool majorWeightIncrease = deltaWeight > RAPID_CHANGE_THRESHOLD;
-                bool weightRemoval = deltaWeight < -NEGATIVE_CHANGE_THRESHOLD;
-                
-                // Apply stronger deadband filter for load cell noise
-                if (abs(deltaWeight) < WEIGHT_DEADBAND) {
-                    deltaWeight = 0.0f;
-                }
-                
-                if (deltaTime > 0) {
-                    float instantRate = deltaWeight / deltaTime;
-                    
-                    // Only clear buffer for significant weight removal
-                    if (weightRemoval && abs(deltaWeight) > 1.0f) {
-                        // Major weight removed - reset buffer for fast zero response
-                        for (int i = 0; i < FLOWRATE_AVG_WINDOW; i++) {
-                            flowRateBuffer[i] = 0.0f;
-                        }
-                        bufferCount = 1;
-                        bufferIndex = 0;
-                        flowRateBuffer[0] = instantRate;
-                    } else {
-                        // Normal operation - store in circular buffer
-                        flowRateBuffer[bufferIndex] = instantRate;
-                        bufferIndex = (bufferIndex + 1) % FLOWRATE_AVG_WINDOW;
-                        if (bufferCount < FLOWRATE_AVG_WINDOW) bufferCount++;
-                    }
-                    
-                    // Calculate stable average with consistent smoothing
-                    flowRate = calculateStableAverage(weightRemoval);
-                    
-                    // Track flow rate for timer-based averaging (only when positive flow)
-                    if (timerAveragingActive && flowRate > 0.1f) { // Only count meaningful positive flow
-                        timerFlowRateSum += flowRate;
-                        timerFlowRateSamples++;
-                    }
-                    
-                    // Apply zero threshold to eliminate tiny fluctuations
-                    if (abs(flowRate) < ZERO_THRESHOLD) {
-                        flowRate = 0.0f;
-                    }
-                }
-            } else {
-                // Tare transition detected - set flow rate to zero
-                flowRate = 0.0f;
-            }
-            
-            lastWeight = currentWeight;
-            lastTime = now;
-        }
-    } else {
-        // First update - just store the values
-        lastWeight = currentWeight;
-        lastTime = now;
+    Profile profile = requestedProfile;
+    if (profile != activeProfile) {
+        applyProfile(profile);
+    }
+    
+    // Step change (cup placed/removed) - the old samples no longer describe the pour
+    if (window.size() >= 2 && abs(weight - window.fittedValue()) > STEP_THRESHOLD) {
+        window.clear();
     }
+    
+    window.push(timestampUs, weight);
+    
+    // Slope of the least-squares line through the window, in g/s
+    float rate = window.spanUs() >= MIN_SPAN_US ? window.slopePerSecond() : 0.0f;
+    publish(rate);
 }
 
-float FlowRate::calculateStableAverage(bool isWeightRemoval) {
-    if (bufferCount == 0) return 0.0f;
+void FlowRate::updateEstimate(float estimatedRate) {
+    // Skip flow rate calculation if paused (during tare operations)
+    if (calculationPaused) {
+        return;
+    }
     
-    if (isWeightRemoval) {
-        // For weight removal, use fewer samples for faster zero response
-        int samplesToUse = min(5, bufferCount);
-        float sum = 0.0f;
-        for (int i = 0; i < samplesToUse; i++) {
-            int index = (bufferIndex - 1 - i + FLOWRATE_AVG_WINDOW) % FLOWRATE_AVG_WINDOW;
-            sum += flowRateBuffer[index];
-        }
-        return sum / samplesToUse;
-    } else {
-        // Normal operation - use gentle linear weighting for maximum stability
-        float weightedSum = 0.0f;
-        float totalWeight = 0.0f;
-        
-        // Use more samples with gentle linear weighting (not exponential)
-        int samplesToUse = min(bufferCount, FLOWRATE_AVG_WINDOW);
-        for (int i = 0; i < samplesToUse; i++) {
-            int index = (bufferIndex - 1 - i + FLOWRATE_AVG_WINDOW) % FLOWRATE_AVG_WINDOW;
-            // Gentle linear weighting: recent samples slightly more important
-            float weight = 1.0f + (0.05f * (samplesToUse - i)); // Very gentle weighting
-            weightedSum += flowRateBuffer[index] * weight;
-            totalWeight += weight;
-        }
-        
-        return weightedSum / totalWeight;
+    // The estimator already tracks flow as a state - only the shared bookkeeping here
+    publish(estimatedRate);
+}
+
+void FlowRate::publish(float rate) {
+    // Track flow rate for timer-based averaging (only when positive flow)
+    if (timerAveragingActive && rate > 0.1f) { // Only count meaningful positive flow
+        timerFlowRateSum += rate;
+        timerFlowRateSamples++;
+    }
+    
+    // Apply zero threshold to eliminate tiny fluctuations
+    if (abs(rate) < ZERO_THRESHOLD) {
+        rate = 0.0f;
+    }
+    flowRate = rate;
+}
+
+void FlowRate::setProfile(Profile profile) {
+    if (profile == PROFILE_FAST || profile == PROFILE_SMOOTH) {
+        requestedProfile = profile;
+    }
+}
+
+void FlowRate::applyProfile(Profile profile) {
+    activeProfile = profile;
+    window.setWindowUs(profile == PROFILE_FAST ? FAST_WINDOW_US : SMOOTH_WINDOW_US);
+}
+
+const char* FlowRate::getProfileName(Profile profile) {
+    switch (profile) {
+        case PROFILE_FAST: return "fast";
+        case PROFILE_SMOOTH: return "smooth";
+        default: return "unknown";
     }
 }
 
@@ -174,22 +128,16 @@ void FlowRate::pauseCalculation() {
 }
 
 void FlowRate::resumeCalculation() {
+    // Weights before the tare are on a different zero - start the fit over
+    clearRequested = true;
+    flowRate = 0.0f;
     calculationPaused = false;
-    // Reset timing to avoid using old weight data
-    lastTime = millis();
     Serial.println("Flow rate calculation resumed");
 }
 
 void FlowRate::clearFlowRateBuffer() {
     // Clear all flow rate history and reset to zero state
-    for (int i = 0; i < FLOWRATE_AVG_WINDOW; i++) {
-        flowRateBuffer[i] = 0.0f;
-    }
-    bufferIndex = 0;
-    bufferCount = 0;
+    clearRequested = true;
     flowRate = 0.0f;
-    lastWeight = 0.0f;
-    lastTime = 0;
     Serial.println("Flow rate buffer cleared for fresh start");
 }
-
@@ -0,0 +1,134 @@
+#include "HX711Capture.h"
+#include <HX711.h>
+
+HX711Capture::HX711Capture(uint8_t dataPin, uint8_t clockPin)
+    : dataPin(dataPin), clockPin(clockPin), gainPulses(1), running(false), captured(0),
+      callback(nullptr), callbackContext(nullptr) {
+}
+
+bool HX711Capture::begin() {
+    // Use the HX711 library for the one-off connection test only
+    Serial.println("Initializing HX711...");
+    HX711 probe;
+    probe.begin(dataPin, clockPin);
+    
+    // Test if HX711 is responding with a timeout
+    Serial.println("Testing HX711 connection...");
+    unsigned long startTime = millis();
+    
+    // Try to get a reading with 3 second timeout
+    while (millis() - startTime < 3000) {
+        if (probe.is_ready()) {
+            long testReading = probe.read();
+            if (testReading != 0) {  // HX711 returns 0 when not connected
+                Serial.println("HX711 test reading: " + String(testReading));
+                Serial.println("HX711 connected successfully");
+                return true;
+            }
+        }
+        delay(10);  // Short poll - at 80 SPS a conversion is due every 12.5 ms
+    }
+    
+    Serial.println("ERROR: HX711 not responding!");
+    Serial.println("Check connections:");
+    Serial.println("- VCC to 3.3V or 5V");
+    Serial.println("- GND to GND");
+    Serial.println("- DT to GPIO " + String(dataPin));
+    Serial.println("- SCK to GPIO " + String(clockPin));
+    Serial.println("- Load cell connections");
+    return false;
+}
+
+void HX711Capture::setGain(uint8_t gain) {
+    // Gain for the next conversion is selected by the number of extra clock pulses
+    switch (gain) {
+        case 64: gainPulses = 3; break;
+        case 32: gainPulses = 2; break;
+        default: gainPulses = 1; break; // 128, channel A
+    }
+}
+
+void HX711Capture::start() {
+    if (running) {
+        return;
+    }
+
+    pinMode(dataPin, INPUT);
+    pinMode(clockPin, OUTPUT);
+    digitalWrite(clockPin, LOW);
+
+    // Drop anything captured before a stop() so stale counts never reach the filter
+    ring.clear();
+    running = true;
+    attachInterruptArg(digitalPinToInterrupt(dataPin), onDataReady, this, FALLING);
+
+    // If a conversion is already waiting, its edge has passed - fetch it now
+    if (digitalRead(dataPin) == LOW) {
+        noInterrupts();
+        captureConversion();
+        interrupts();
+    }
+
+    Serial.println("HX711 interrupt capture started on DOUT GPIO " + String(dataPin));
+}
+
+void HX711Capture::stop() {
+    if (!running) {
+        return;
+    }
+    detachInterrupt(digitalPinToInterrupt(dataPin));
+    running = false;
+    Serial.println("HX711 interrupt capture stopped");
+}
+
+void ARDUINO_ISR_ATTR HX711Capture::onDataReady(void* arg) {
+    HX711Capture* self = static_cast<HX711Capture*>(arg);
+    if (!self->captureConversion()) {
+        return;
+    }
+
+    DataReadyCallback cb = self->callback;
+    if (cb != nullptr) {
+        cb(self->callbackContext);
+    }
+}
+
+bool ARDUINO_ISR_ATTR HX711Capture::captureConversion() {
+    // Shifting the result out toggles DOUT, which queues further falling edges.
+    // Those re-entries find DOUT high (no conversion ready) and return here.
+    if (digitalRead(dataPin) != LOW) {
+        return false;
+    }
+
+    RawSample sample;
+    sample.timestampUs = micros();
+
+    // 24 data bits, MSB first. Clock high time must stay well below 60us
+    // or the HX711 enters power-down, which is why this runs inside the ISR.
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 24; i++) {
+        digitalWrite(clockPin, HIGH);
+        delayMicroseconds(1);
+        value = (value << 1) | (digitalRead(dataPin) ? 1 : 0);
+        digitalWrite(clockPin, LOW);
+        delayMicroseconds(1);
+    }
+
+    // Gain/channel selection pulses for the next conversion
+    for (uint8_t i = 0; i < gainPulses; i++) {
+        digitalWrite(clockPin, HIGH);
+        delayMicroseconds(1);
+        digitalWrite(clockPin, LOW);
+        delayMicroseconds(1);
+    }
+
+    // Sign-extend 24-bit two's complement
+    if (value & 0x800000) {
+        value |= 0xFF000000;
+    }
+    sample.raw = (int32_t)value;
+
+    ring.push(sample);
+    captured = captured + 1;
+    return true;
+}
@@ -0,0 +1,320 @@
+#include "LiveStream.h"
+#include "Scale.h"
+#include "SamplingTask.h"
+#include "FlowRate.h"
+#include "Display.h"
+#include "BatteryMonitor.h"
+#include "BluetoothScale.h"
+#include "WiFiManager.h"
+#include "JsonWriter.h"
+#include "BrewFrame.h"
+
+LiveStream::LiveStream(Scale& scale, SamplingTask& samplingTask, FlowRate& flowRate, Display& display,
+                       BatteryMonitor& battery, BluetoothScale& bluetoothScale)
+    : socket("/ws"), scale(scale), samplingTask(samplingTask), flowRate(flowRate), display(display),
+      battery(battery), bluetoothScale(bluetoothScale), lastSequence(0), lastStatusCheck(0),
+      hasStatus(false), framesSent(0), framesSkipped(0) {
+    subscriberLock = portMUX_INITIALIZER_UNLOCKED;
+    memset(subscribers, 0, sizeof(subscribers));
+}
+
+void LiveStream::begin(AsyncWebServer& server) {
+    socket.onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                          void* arg, uint8_t* data, size_t len) {
+        onEvent(client, type, arg, data, len);
+    });
+    server.addHandler(&socket);
+    Serial.println("Live stream WebSocket registered on /ws");
+}
+
+size_t LiveStream::getClientCount() {
+    return socket.count();
+}
+
+void LiveStream::onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    switch (type) {
+        case WS_EVT_CONNECT:
+            addSubscriber(client->id());
+            Serial.printf("Live stream client %u connected\n", client->id());
+            break;
+        case WS_EVT_DISCONNECT:
+            removeSubscriber(client->id());
+            Serial.printf("Live stream client %u disconnected\n", client->id());
+            break;
+        case WS_EVT_DATA: {
+            // Subscriptions are small - only handle single-frame text messages
+            AwsFrameInfo* info = (AwsFrameInfo*)arg;
+            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT && len < 128) {
+                char message[128];
+                memcpy(message, data, len);
+                message[len] = '\0';
+                handleMessage(client, message);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void LiveStream::handleMessage(AsyncWebSocketClient* client, const char* message) {
+    const char* sub = strstr(message, "\"sub\"");
+    const char* rate = strstr(message, "\"rate\"");
+    const char* format = strstr(message, "\"format\"");
+
+    uint8_t fields = 0;
+    if (sub != nullptr) {
+        if (strstr(sub, "\"weight\"")) fields |= FIELD_WEIGHT;
+        if (strstr(sub, "\"flow\"")) fields |= FIELD_FLOW;
+        if (strstr(sub, "\"timer\"")) fields |= FIELD_TIMER;
+        if (strstr(sub, "\"battery\"")) fields |= FIELD_BATTERY;
+        if (strstr(sub, "\"signal\"")) fields |= FIELD_SIGNAL;
+    }
+    long interval = -1;
+    if (rate != nullptr) {
+        const char* colon = strchr(rate, ':');
+        if (colon != nullptr) {
+            interval = constrain(atol(colon + 1), 0L, (long)MAX_INTERVAL_MS);
+        }
+    }
+
+    portENTER_CRITICAL(&subscriberLock);
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].clientId == client->id()) {
+            if (sub != nullptr) {
+                subscribers[i].fields = fields;
+                subscribers[i].needsFullStatus = true;
+            }
+            if (interval >= 0) {
+                subscribers[i].intervalMs = (uint16_t)interval;
+            }
+            if (format != nullptr) {
+                subscribers[i].binary = strstr(format, "\"binary\"") != nullptr;
+            }
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+}
+
+void LiveStream::addSubscriber(uint32_t clientId) {
+    bool added = false;
+    portENTER_CRITICAL(&subscriberLock);
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].clientId == 0) {
+            subscribers[i].clientId = clientId;
+            subscribers[i].fields = FIELD_ALL;
+            subscribers[i].intervalMs = 0;
+            subscribers[i].lastLiveMs = 0;
+            subscribers[i].needsFullStatus = true;
+            subscribers[i].binary = false;
+            added = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+
+    if (!added) {
+        // Every slot taken - the page falls back to polling
+        socket.close(clientId, 1013, "Too many clients");
+    }
+}
+
+void LiveStream::removeSubscriber(uint32_t clientId) {
+    portENTER_CRITICAL(&subscriberLock);
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].clientId == clientId) {
+            subscribers[i].clientId = 0;
+        }
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+}
+
+void LiveStream::update() {
+    socket.cleanupClients(MAX_SUBSCRIBERS);
+    if (socket.count() == 0) {
+        hasStatus = false; // Next client starts from a fresh status read
+        return;
+    }
+
+    uint32_t now = millis();
+    sendLive(now);
+
+    if (now - lastStatusCheck >= STATUS_INTERVAL_MS) {
+        lastStatusCheck = now;
+        sendStatus(true);
+    } else {
+        sendStatus(false); // Only subscribers that still need their first full status
+    }
+}
+
+void LiveStream::sendLive(uint32_t now) {
+    WeightSnapshot snapshot = samplingTask.getSnapshot();
+    if (snapshot.sequence == lastSequence) {
+        return;
+    }
+    lastSequence = snapshot.sequence;
+
+    Subscriber current[MAX_SUBSCRIBERS];
+    portENTER_CRITICAL(&subscriberLock);
+    memcpy(current, subscribers, sizeof(current));
+    portEXIT_CRITICAL(&subscriberLock);
+
+    char frame[128];
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        const Subscriber& subscriber = current[i];
+        if (subscriber.clientId == 0 || (subscriber.fields & (FIELD_WEIGHT | FIELD_FLOW | FIELD_TIMER)) == 0) {
+            continue;
+        }
+        if (now - subscriber.lastLiveMs < subscriber.intervalMs) {
+            continue;
+        }
+        size_t length;
+        if (subscriber.binary) {
+            encodeBrewFrame(snapshot, display.getElapsedTime(), display.isTimerRunning(), (uint8_t*)frame);
+            length = sizeof(BrewFrame);
+        } else {
+            length = formatLive(frame, sizeof(frame), subscriber.fields, snapshot.sequence,
+                                snapshot.weight, snapshot.flowRate);
+        }
+        if (length > 0 && sendFrame(subscriber.clientId, frame, length, subscriber.binary)) {
+            portENTER_CRITICAL(&subscriberLock);
+            if (subscribers[i].clientId == subscriber.clientId) {
+                subscribers[i].lastLiveMs = now;
+            }
+            portEXIT_CRITICAL(&subscriberLock);
+        }
+    }
+}
+
+void LiveStream::sendStatus(bool changedOnly) {
+    Subscriber current[MAX_SUBSCRIBERS];
+    portENTER_CRITICAL(&subscriberLock);
+    memcpy(current, subscribers, sizeof(current));
+    portEXIT_CRITICAL(&subscriberLock);
+
+    bool anyNew = false;
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (current[i].clientId != 0 && current[i].needsFullStatus) {
+            anyNew = true;
+        }
+    }
+    if (!changedOnly && !anyNew) {
+        return;
+    }
+
+    // Battery and WiFi reads are the slow part - at most once per interval, or for a new client
+    StatusFields status = (changedOnly || !hasStatus) ? readStatus() : lastStatus;
+
+    char frame[160];
+    for (size_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        const Subscriber& subscriber = current[i];
+        uint8_t fields = subscriber.fields & (FIELD_BATTERY | FIELD_SIGNAL);
+        if (subscriber.clientId == 0 || fields == 0) {
+            continue;
+        }
+        if (subscriber.needsFullStatus) {
+            size_t length = formatStatus(frame, sizeof(frame), fields, status, nullptr);
+            if (length > 0 && sendFrame(subscriber.clientId, frame, length)) {
+                portENTER_CRITICAL(&subscriberLock);
+                if (subscribers[i].clientId == subscriber.clientId) {
+                    subscribers[i].needsFullStatus = false;
+                }
+                portEXIT_CRITICAL(&subscriberLock);
+            }
+        } else if (changedOnly && hasStatus) {
+            size_t length = formatStatus(frame, sizeof(frame), fields, status, &lastStatus);
+            if (length > 0) {
+                sendFrame(subscriber.clientId, frame, length);
+            }
+        }
+    }
+
+    lastStatus = status;
+    hasStatus = true;
+}
+
+size_t LiveStream::formatLive(char* buffer, size_t size, uint8_t fields, uint32_t sequence, float weight, float flow) {
+    JsonWriter json(buffer, size);
+    json.beginObject().field("t", "l").field("s", sequence);
+    if (fields & FIELD_WEIGHT) {
+        json.field("w", weight, 2);
+    }
+    if (fields & FIELD_FLOW) {
+        json.field("f", flow, 1);
+    }
+    if (fields & FIELD_TIMER) {
+        json.field("tm", display.getElapsedTime());
+        json.field("tr", display.isTimerRunning() ? 1 : 0);
+        if (flowRate.hasTimerAverage()) {
+            json.field("a", flowRate.getTimerAverageFlowRate(), 2);
+        } else {
+            json.nullField("a");
+        }
+    }
+    json.endObject();
+    return json.overflowed() ? 0 : json.length();
+}
+
+size_t LiveStream::formatStatus(char* buffer, size_t size, uint8_t fields, const StatusFields& status, const StatusFields* previous) {
+    JsonWriter json(buffer, size);
+    json.beginObject().field("t", "s");
+    size_t empty = json.length();
+    if (fields & FIELD_BATTERY) {
+        if (!previous || previous->batteryPercentage != status.batteryPercentage) {
+            json.field("bp", status.batteryPercentage);
+        }
+        if (!previous || previous->batteryLow != status.batteryLow) {
+            json.field("bl", status.batteryLow ? 1 : 0);
+        }
+        if (!previous || previous->batteryCritical != status.batteryCritical) {
+            json.field("bc", status.batteryCritical ? 1 : 0);
+        }
+    }
+    if (fields & FIELD_SIGNAL) {
+        if (!previous || previous->scaleConnected != status.scaleConnected) {
+            json.field("hx", status.scaleConnected ? 1 : 0);
+        }
+        if (!previous || previous->wifiSignal != status.wifiSignal) {
+            json.field("ws", status.wifiSignal);
+        }
+        if (!previous || strcmp(previous->wifiQuality, status.wifiQuality) != 0) {
+            json.field("wq", status.wifiQuality);
+        }
+        if (!previous || previous->bluetoothConnected != status.bluetoothConnected) {
+            json.field("bt", status.bluetoothConnected ? 1 : 0);
+        }
+    }
+    if (json.length() == empty) {
+        return 0; // Nothing changed for this subscriber
+    }
+    json.endObject();
+    return json.overflowed() ? 0 : json.length();
+}
+
+LiveStream::StatusFields LiveStream::readStatus() {
+    StatusFields status;
+    status.batteryPercentage = battery.getBatteryPercentage();
+    status.batteryLow = battery.isLowBattery();
+    status.batteryCritical = battery.isCriticalBattery();
+    status.scaleConnected = scale.isHX711Connected();
+    status.wifiSignal = getWiFiSignalStrength();
+    status.wifiQuality = getWiFiSignalQuality();
+    status.bluetoothConnected = bluetoothScale.isConnected();
+    return status;
+}
+
+bool LiveStream::sendFrame(uint32_t clientId, const char* frame, size_t length, bool binary) {
+    // A slow client gets the next frame instead of an ever-growing queue
+    if (!socket.availableForWrite(clientId)) {
+        framesSkipped++;
+        return false;
+    }
+    if (binary) {
+        socket.binary(clientId, frame, length);
+    } else {
+        socket.text(clientId, frame, length);
+    }
+    framesSent++;
+    return true;
+}
@@ -0,0 +1,159 @@
+#include "LoopProfiler.h"
+
+#if WEIGHMYBRU_PROFILER
+
+#include "JsonWriter.h"
+
+LoopProfiler::LoopProfiler() {
+    reset();
+}
+
+void LoopProfiler::reset() {
+    memset(histograms, 0, sizeof(histograms));
+    missedDeadlines = 0;
+    loopStartUs = 0;
+    commandLength = 0;
+}
+
+void LoopProfiler::loopStart() {
+    int64_t now = esp_timer_get_time();
+    if (loopStartUs != 0) {
+        record(LOOP_PERIOD, (uint32_t)(now - loopStartUs));
+    }
+    loopStartUs = now;
+}
+
+void LoopProfiler::loopEnd() {
+    if (loopStartUs == 0) {
+        return;
+    }
+    uint32_t work = (uint32_t)(esp_timer_get_time() - loopStartUs);
+    record(LOOP_WORK, work);
+    if (work > DEADLINE_US) {
+        missedDeadlines++;
+    }
+}
+
+void LoopProfiler::record(Section section, uint32_t elapsedUs) {
+    Histogram& histogram = histograms[section];
+    histogram.count++;
+    histogram.totalUs += elapsedUs;
+    if (elapsedUs > histogram.maxUs) {
+        histogram.maxUs = elapsedUs;
+    }
+    histogram.buckets[bucketIndex(elapsedUs)]++;
+}
+
+uint8_t LoopProfiler::bucketIndex(uint32_t us) {
+    if (us < SUB_BUCKETS) {
+        return (uint8_t)us;
+    }
+    uint8_t msb = 31 - __builtin_clz(us);
+    uint32_t index = (uint32_t)(msb - SUB_BITS + 1) * SUB_BUCKETS + ((us >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+    return index < BUCKET_COUNT ? (uint8_t)index : BUCKET_COUNT - 1;
+}
+
+uint32_t LoopProfiler::bucketUpperUs(uint8_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    uint8_t msb = index / SUB_BUCKETS + SUB_BITS - 1;
+    uint32_t width = 1UL << (msb - SUB_BITS);
+    return (1UL << msb) + (index % SUB_BUCKETS) * width + width - 1;
+}
+
+uint32_t LoopProfiler::percentile(Section section, uint8_t percent) const {
+    const Histogram& histogram = histograms[section];
+    if (histogram.count == 0) {
+        return 0;
+    }
+    // Rank of the sample at this percentile, rounded up
+    uint32_t rank = (uint32_t)(((uint64_t)histogram.count * percent + 99) / 100);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += histogram.buckets[i];
+        if (seen >= rank) {
+            // The bucket bound can overshoot the largest sample seen
+            uint32_t upper = bucketUpperUs(i);
+            return upper < histogram.maxUs ? upper : histogram.maxUs;
+        }
+    }
+    return histogram.maxUs;
+}
+
+const char* LoopProfiler::sectionName(Section section) {
+    switch (section) {
+        case WIFI: return "wifi";
+        case LIVE_STREAM: return "liveStream";
+        case BREW_EVENTS: return "brewEvents";
+        case BLUETOOTH: return "bluetooth";
+        case TOUCH: return "touch";
+        case POWER: return "power";
+        case BATTERY: return "battery";
+        case OLED: return "display";
+        case COMMANDS: return "commands";
+        case LOOP_WORK: return "loopWork";
+        case LOOP_PERIOD: return "loopPeriod";
+        default: return "unknown";
+    }
+}
+
+void LoopProfiler::writeReport(JsonWriter& json) const {
+    json.beginObject();
+    json.field("deadlineUs", DEADLINE_US);
+    json.field("missedDeadlines", missedDeadlines);
+    json.beginObject("sections");
+    for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+        Section section = (Section)i;
+        const Histogram& histogram = histograms[i];
+        json.beginObject(sectionName(section));
+        json.field("count", histogram.count);
+        json.field("meanUs", histogram.count > 0 ? (uint32_t)(histogram.totalUs / histogram.count) : 0U);
+        json.field("p50Us", percentile(section, 50));
+        json.field("p99Us", percentile(section, 99));
+        json.field("maxUs", histogram.maxUs);
+        json.endObject();
+    }
+    json.endObject();
+    json.endObject();
+}
+
+void LoopProfiler::printReport() const {
+    Serial.println("=== Loop Profile (us) ===");
+    Serial.printf("%-12s %8s %8s %8s %8s %8s\n", "section", "count", "mean", "p50", "p99", "max");
+    for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+        Section section = (Section)i;
+        const Histogram& histogram = histograms[i];
+        Serial.printf("%-12s %8lu %8lu %8lu %8lu %8lu\n", sectionName(section), (unsigned long)histogram.count,
+                      histogram.count > 0 ? (unsigned long)(histogram.totalUs / histogram.count) : 0UL,
+                      (unsigned long)percentile(section, 50), (unsigned long)percentile(section, 99),
+                      (unsigned long)histogram.maxUs);
+    }
+    Serial.printf("Missed %lu ms deadlines: %lu\n", (unsigned long)(DEADLINE_US / 1000), (unsigned long)missedDeadlines);
+    Serial.println("=== End Loop Profile ===");
+}
+
+void LoopProfiler::handleSerial() {
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (commandLength < sizeof(command) - 1) {
+                command[commandLength++] = c;
+            }
+            continue;
+        }
+        command[commandLength] = '\0';
+        if (strcmp(command, "profile") == 0) {
+            printReport();
+        } else if (strcmp(command, "profile reset") == 0) {
+            reset();
+            Serial.println("Loop profile reset");
+        }
+        commandLength = 0;
+    }
+}
+
+#endif
@@ -1,8 +1,9 @@
 #include "PowerManager.h"
 #include "Display.h"
+#include "BootSequencer.h"
 
 PowerManager::PowerManager(uint8_t sleepTouchPin, Display* display) 
-    : sleepTouchPin(sleepTouchPin), displayPtr(display), sleepTouchThreshold(0),
+    : sleepTouchPin(sleepTouchPin), displayPtr(display), bootSequencerPtr(nullptr), sleepTouchThreshold(0),
       lastSleepTouchState(false), lastSleepTouchTime(0), touchStartTime(0),
       debounceDelay(200), sleepCountdownStart(0), sleepCountdownActive(false),
       longPressDetected(false), cancelledRecently(false), cancelTime(0),
@@ -108,6 +109,12 @@ void PowerManager::enterDeepSleep() {
         displayPtr->showGoingToSleepMessage();
         delay(2000);
         displayPtr->clear();
+        displayPtr->flush(); // Frames go out from the display task - let the blank one land
+    }
+    
+    // Tare offset and WiFi access point for the fast path on wake
+    if (bootSequencerPtr != nullptr) {
+        bootSequencerPtr->prepareForSleep();
     }
     
     // Print wake-up configuration for debugging
@@ -144,6 +151,10 @@ void PowerManager::setDisplay(Display* display) {
     displayPtr = display;
 }
 
+void PowerManager::setBootSequencer(BootSequencer* bootSequencer) {
+    bootSequencerPtr = bootSequencer;
+}
+
 void PowerManager::handleSleepTouch() {
     // Only called after long press detection
     sleepCountdownActive = true;
@@ -0,0 +1,111 @@
+#include "SamplingTask.h"
+#include "Scale.h"
+#include "FlowRate.h"
+
+SamplingTask::SamplingTask(Scale* scale, FlowRate* flowRate)
+    : scalePtr(scale), flowRatePtr(flowRate), taskHandle(nullptr), waiterHandle(nullptr), sequence(0),
+      sampleSequence(0), lastSampleTimestampUs(0),
+      lastLatencyUs(0), maxLatencyUs(0) {
+}
+
+bool SamplingTask::begin() {
+    if (taskHandle != nullptr) {
+        return true;
+    }
+
+    BaseType_t result = xTaskCreatePinnedToCore(taskEntry, "sampling", TASK_STACK_SIZE, this,
+                                                TASK_PRIORITY, &taskHandle, TASK_CORE);
+    if (result != pdPASS) {
+        taskHandle = nullptr;
+        Serial.println("ERROR: Failed to create sampling task");
+        return false;
+    }
+
+    // Let the data-ready interrupt wake the task directly
+    scalePtr->setDataReadyCallback(onDataReady, this);
+    scalePtr->setSampleCallback(onSample, this);
+
+    Serial.printf("Sampling task started on core %d (priority %d)\n", (int)TASK_CORE, (int)TASK_PRIORITY);
+    return true;
+}
+
+void SamplingTask::end() {
+    if (taskHandle == nullptr) {
+        return;
+    }
+    scalePtr->setDataReadyCallback(nullptr, nullptr);
+    scalePtr->setSampleCallback(nullptr, nullptr);
+    vTaskDelete(taskHandle);
+    taskHandle = nullptr;
+}
+
+bool SamplingTask::waitForSnapshot(uint32_t timeoutMs) {
+    waiterHandle = xTaskGetCurrentTaskHandle();
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) > 0;
+}
+
+void SamplingTask::taskEntry(void* arg) {
+    static_cast<SamplingTask*>(arg)->run();
+}
+
+void ARDUINO_ISR_ATTR SamplingTask::onDataReady(void* arg) {
+    TaskHandle_t task = static_cast<SamplingTask*>(arg)->taskHandle;
+    if (task == nullptr) {
+        return;
+    }
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// One history entry per conversion - a wake-up often drains several
+void SamplingTask::onSample(void* arg, const RawSample& sample) {
+    SamplingTask* task = static_cast<SamplingTask*>(arg);
+    WeightSnapshot snapshot;
+    snapshot.weight = task->scalePtr->getCurrentWeight();
+    snapshot.flowRate = task->flowRatePtr->getFlowRate();
+    snapshot.filterState = static_cast<uint8_t>(task->scalePtr->getFilterStateId());
+    snapshot.taring = task->scalePtr->isTaring();
+    snapshot.timestampUs = sample.timestampUs;
+    snapshot.sequence = ++task->sampleSequence;
+    task->sampleHistory.push(snapshot);
+}
+
+void SamplingTask::run() {
+    for (;;) {
+        // Sleep until the HX711 interrupt signals a new conversion
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_PUBLISH_MS));
+
+        // Filters and feeds FlowRate once per drained sample
+        scalePtr->getWeight();
+        publishSnapshot();
+    }
+}
+
+void SamplingTask::publishSnapshot() {
+    WeightSnapshot snapshot;
+    snapshot.weight = scalePtr->getCurrentWeight();
+    snapshot.flowRate = flowRatePtr->getFlowRate();
+    snapshot.filterState = static_cast<uint8_t>(scalePtr->getFilterStateId());
+    snapshot.taring = scalePtr->isTaring();
+    snapshot.timestampUs = scalePtr->getLastSampleTimestampUs();
+    snapshot.sequence = ++sequence;
+    publisher.publish(snapshot);
+
+    TaskHandle_t waiter = waiterHandle;
+    if (waiter != nullptr) {
+        xTaskNotifyGive(waiter);
+    }
+
+    // Only measure when this pass actually consumed a new conversion
+    if (snapshot.timestampUs != 0 && snapshot.timestampUs != lastSampleTimestampUs) {
+        lastSampleTimestampUs = snapshot.timestampUs;
+        uint32_t latency = micros() - snapshot.timestampUs;
+        lastLatencyUs = latency;
+        if (latency > maxLatencyUs) {
+            maxLatencyUs = latency;
+        }
+    }
+}
@@ -1,10 +1,9 @@
 #include "Scale.h"
-#include "WebServer.h"
-#include "Calibration.h"
 #include "FlowRate.h"
+#include "TraceRecorder.h"
 
-Scale::Scale(uint8_t dataPin, uint8_t clockPin, float calibrationFactor)
-    : dataPin(dataPin), clockPin(clockPin), calibrationFactor(calibrationFactor), currentWeight(0.0f),
+Scale::Scale(ILoadCellSource& source, ISettingsStore& settings, IClock& clock, float calibrationFactor)
+    : source(source), settings(settings), clock(clock), calibrationFactor(calibrationFactor), currentWeight(0.0f),
       readingIndex(0), samplesInitialized(false), previousFilteredWeight(0), medianSamples(3), averageSamples(2),
       currentFilterState(STABLE), lastBrewingActivity(0), lastStableWeight(0.0f) {
     // Initialize readings array
@@ -13,18 +12,18 @@ Scale::Scale(uint8_t dataPin, uint8_t clockPin, float calibrationFactor)
     }
 }
 
-bool Scale::begin() {
+bool Scale::begin(bool performInitialTare) {
     Serial.println("Starting scale initialization...");
     
-    preferences.begin("scale", false);
-    calibrationFactor = preferences.getFloat("calib", calibrationFactor);
+    settings.begin("scale", false);
+    calibrationFactor = settings.getFloat("calib", calibrationFactor);
     
     // Load filtering parameters with load cell-specific defaults
     loadFilterSettings();
     
     // Auto-adjust brewing threshold based on calibration factor and load cell characteristics
     // Only if not previously saved by user (check if key exists)
-    if (!preferences.isKey("brew_thresh")) {
+    if (!settings.isKey("brew_thresh")) {
         // For 3kg load cells (1mV/V): calibration factors typically 400-800
         // For 500g load cells (2mV/V): calibration factors typically 2000-5000+
         if (calibrationFactor < 1000) {
@@ -40,74 +39,85 @@ bool Scale::begin() {
         saveFilterSettings(); // Save auto-detected values
     }
     
-    preferences.end();
+    settings.end();
     
-    // Initialize HX711 with error handling
-    Serial.println("Initializing HX711...");
-    hx711.begin(dataPin, clockPin);
-    hx711.set_scale(calibrationFactor);
+    // Probe the load cell source with error handling
+    if (!source.begin()) {
+        Serial.println("ERROR: Load cell source not responding!");
+        isConnected = false;
+        return false;
+    }
+    isConnected = true;
     
-    // Test if HX711 is responding with a timeout
-    Serial.println("Testing HX711 connection...");
-    unsigned long startTime = millis();
-    bool testPassed = false;
+    // From here on conversions are delivered by the source (DOUT data-ready edge on hardware)
+    source.start();
     
-    // Try to get a reading with 3 second timeout
-    while (millis() - startTime < 3000) {
-        if (hx711.is_ready()) {
-            long testReading = hx711.read();
-            if (testReading != 0) {  // HX711 returns 0 when not connected
-                testPassed = true;
-                Serial.println("HX711 test reading: " + String(testReading));
-                break;
-            }
+    // Initial tare still blocks so the first published weight is already zeroed
+    if (performInitialTare) {
+        Serial.println("Performing initial tare...");
+        tare(INITIAL_TARE_SAMPLES);
+        uint32_t startMs = clock.nowMs();
+        while (isTaring() && clock.nowMs() - startMs < INITIAL_TARE_TIMEOUT_MS) {
+            clock.sleepMs(10);
+            getWeight();
+        }
+        if (isTaring()) {
+            Serial.println("WARNING: Initial tare timed out, will complete in the background");
         }
-        delay(100);  // Small delay between attempts
     }
     
-    if (testPassed) {
-        Serial.println("HX711 connected successfully");
-        isConnected = true;
-        
-        // Only tare if connection is confirmed
-        Serial.println("Performing initial tare...");
-        hx711.tare();
-        
-        Serial.println("Smart Scale filtering configured:");
-        Serial.println("Brewing threshold: " + String(brewingThreshold) + "g");
-        Serial.println("Stability timeout: " + String(stabilityTimeout) + "ms");
-        Serial.println("Median samples (brewing): " + String(medianSamples));
-        Serial.println("Average samples (stable): " + String(averageSamples));
-        Serial.println("Smart filtering: ENABLED - Dynamic filter switching based on brewing activity");
-        
-        return true;
-    } else {
-        Serial.println("ERROR: HX711 not responding!");
-        Serial.println("Check connections:");
-        Serial.println("- VCC to 3.3V or 5V");
-        Serial.println("- GND to GND");
-        Serial.println("- DT to GPIO " + String(dataPin));
-        Serial.println("- SCK to GPIO " + String(clockPin));
-        Serial.println("- Load cell connections");
-        
-        isConnected = false;
-        return false;
-    }
+    Serial.println("Smart Scale filtering configured:");
+    Serial.println("Brewing threshold: " + String(brewingThreshold) + "g");
+    Serial.println("Stability timeout: " + String(stabilityTimeout) + "ms");
+    Serial.println("Median samples (brewing): " + String(medianSamples));
+    Serial.println("Average samples (stable): " + String(averageSamples));
+    Serial.println("Filter mode: " + String(getFilterModeName(filterMode)));
+    Serial.println("Smart filtering: ENABLED - Dynamic filter switching based on brewing activity");
+    
+    return true;
 }
 
-void Scale::tare(uint8_t times) {
+bool Scale::tare(uint8_t times) {
     if (!isConnected) {
         Serial.println("Cannot tare: HX711 not connected");
-        return;
+        return false;
+    }
+    
+    // Only flag the request here - this may run on the AsyncTCP task or inside a
+    // NimBLE callback, so it must never block. The sample consumer does the work.
+    tareRequestSamples = times > 0 ? times : 1;
+    tareRequested = true;
+    Serial.println("Tare requested (" + String(tareRequestSamples) + " samples)");
+    return true;
+}
+
+void Scale::startTareJob() {
+    tareInProgress = true; // Before clearing the request so isTaring() never reads false in between
+    tareRequested = false;
+    tareTargetSamples = tareRequestSamples;
+    tareCollectedSamples = 0;
+    tareAccumulator = 0;
+    
+    if (traceRecorderPtr != nullptr) {
+        traceRecorderPtr->recordTare(tareTargetSamples);
     }
     
     // Pause flow rate calculation to prevent tare operation from affecting flow rate
     if (flowRatePtr != nullptr) {
         flowRatePtr->pauseCalculation();
     }
-    
     Serial.println("Taring scale...");
-    hx711.tare(times);
+}
+
+void Scale::accumulateTareSample(const RawSample& sample) {
+    tareAccumulator += sample.raw;
+    tareCollectedSamples++;
+    if (tareCollectedSamples < tareTargetSamples) {
+        return;
+    }
+    
+    // New zero is the mean raw count over the collected samples
+    offset = (int32_t)(tareAccumulator / tareCollectedSamples);
     Serial.println("Tare complete");
     
     // Reset smart filter state after taring - return to stable mode
@@ -120,32 +130,33 @@ void Scale::tare(uint8_t times) {
     samplesInitialized = false;
     Serial.println("Smart filter reset to STABLE state");
     
-    // Resume flow rate calculation after a short delay to ensure stable readings
+    // Resume flow rate calculation - the filter restarts from the new zero
     if (flowRatePtr != nullptr) {
-        delay(100); // Short delay to let scale stabilize
         flowRatePtr->resumeCalculation();
     }
+    
+    tareInProgress = false;
+    tareCount = tareCount + 1;
 }
 
 void Scale::set_scale(float factor) {
     // Only save if the calibration factor actually changed
     if (calibrationFactor != factor) {
         calibrationFactor = factor;
-        hx711.set_scale(calibrationFactor);
         saveCalibration();
     }
 }
 
 void Scale::saveCalibration() {
-    preferences.begin("scale", false);
-    preferences.putFloat("calib", calibrationFactor);
-    preferences.end();
+    settings.begin("scale", false);
+    settings.putFloat("calib", calibrationFactor);
+    settings.end();
 }
 
 void Scale::loadCalibration() {
-    preferences.begin("scale", true);
-    calibrationFactor = preferences.getFloat("calib", calibrationFactor);
-    preferences.end();
+    settings.begin("scale", true);
+    calibrationFactor = settings.getFloat("calib", calibrationFactor);
+    settings.end();
 }
 
 float Scale::getWeight() {
@@ -154,25 +165,42 @@ float Scale::getWeight() {
         return 0.0f;
     }
     
-    static unsigned long lastReadTime = 0;
-    unsigned long currentTime = millis();
+    // Pick up a tare requested from another task
+    if (tareRequested && !tareInProgress) {
+        startTareJob();
+    }
     
-    // Read at 50Hz (every 20ms) for good responsiveness
-    if (currentTime - lastReadTime < 20) {
-        return currentWeight;
+    // Run every conversion captured since the last call through the filter chain.
+    // While a tare job is running, samples also build up the new offset.
+    RawSample sample;
+    while (source.readSample(sample)) {
+        if (traceRecorderPtr != nullptr) {
+            traceRecorderPtr->recordSample(sample);
+        }
+        if (tareInProgress) {
+            accumulateTareSample(sample);
+        }
+        processSample(sample);
+        if (sampleCallback != nullptr) {
+            sampleCallback(sampleCallbackContext, sample);
+        }
     }
-    lastReadTime = currentTime;
+    
+    return currentWeight;
+}
 
-    // Check if HX711 is ready before attempting to read
-    if (!hx711.is_ready()) {
-        return currentWeight;  // Return last known value if not ready
-    }
+void Scale::processSample(const RawSample& sample) {
+    lastRawCount = sample.raw;
+    hasRawCount = true;
+    lastSampleTimestampUs = sample.timestampUs;
     
-    float rawReading = hx711.get_units(1);
+    // Same conversion as HX711::get_units(): (raw - offset) / calibration factor
+    float rawReading = (float)(sample.raw - offset) / calibrationFactor;
+    uint32_t currentTime = sample.timestampUs;
     
     // Handle NaN or invalid readings
-    if (isnan(rawReading)) {
-        return currentWeight;
+    if (isnan(rawReading) || isinf(rawReading)) {
+        return;
     }
     
     // Initialize sample buffer on first valid reading
@@ -181,16 +209,44 @@ float Scale::getWeight() {
         currentWeight = rawReading;
         lastStableWeight = rawReading;
         currentFilterState = STABLE;
-        return currentWeight;
+        activeFilterMode = filterMode;
+        kalman.reset(rawReading, currentTime);
+        return;
     }
     
-    // Store reading in circular buffer
+    // Store reading in circular buffer and the incremental median window
     readings[readingIndex] = rawReading;
     readingIndex = (readingIndex + 1) % MAX_SAMPLES;
+    medianWindow.push(rawReading);
+    
+    // Mode changed from another task - restart the new estimator from the current weight
+    FilterMode mode = filterMode;
+    if (mode != activeFilterMode) {
+        activeFilterMode = mode;
+        kalman.reset(currentWeight, currentTime);
+        currentFilterState = STABLE;
+        lastStableWeight = currentWeight;
+    }
+    
+    // Kalman mode estimates weight and flow jointly; the smart filter below is bypassed
+    if (activeFilterMode == FILTER_KALMAN) {
+        kalman.update(rawReading, currentTime);
+        currentWeight = kalman.getWeight();
+        if (flowRatePtr != nullptr) {
+            flowRatePtr->updateEstimate(kalman.getFlowRate());
+        }
+        return;
+    }
+    
+    // Flow is fitted to the unfiltered samples - the regression does its own smoothing
+    if (flowRatePtr != nullptr) {
+        flowRatePtr->addSample(currentTime, rawReading);
+    }
     
     // Smart filtering based on brewing activity detection
     float weightChange = abs(rawReading - currentWeight);
     bool brewingDetected = false;
+    uint32_t stabilityTimeoutUs = stabilityTimeout * 1000UL;
     
     // Detect brewing activity using configurable threshold
     if (currentFilterState == STABLE) {
@@ -207,7 +263,7 @@ float Scale::getWeight() {
             lastBrewingActivity = currentTime;
         } else {
             // Check if we should transition to stable
-            if (currentTime - lastBrewingActivity > stabilityTimeout) {
+            if (currentTime - lastBrewingActivity > stabilityTimeoutUs) {
                 currentFilterState = TRANSITIONING;
             }
         }
@@ -218,7 +274,7 @@ float Scale::getWeight() {
             brewingDetected = true;
             currentFilterState = BREWING;
             lastBrewingActivity = currentTime;
-        } else if (currentTime - lastBrewingActivity > stabilityTimeout * 2) {
+        } else if (currentTime - lastBrewingActivity > stabilityTimeoutUs * 2) {
             // Extended stability confirmed - switch to stable mode
             currentFilterState = STABLE;
             lastStableWeight = currentWeight;
@@ -234,6 +290,7 @@ float Scale::getWeight() {
             break;
         case STABLE:
         case TRANSITIONING:
+        default:
             // Use average filter for stable readings - smoother and faster
             filteredWeight = averageFilter(averageSamples);
             break;
@@ -252,7 +309,6 @@ float Scale::getWeight() {
     }
     
     currentWeight = filteredWeight;
-    return currentWeight;
 }
 
 float Scale::getCurrentWeight() {
@@ -263,37 +319,40 @@ long Scale::getRawValue() {
     if (!isConnected) {
         return 0;  // Return 0 if HX711 not connected
     }
-    return hx711.get_value(1); // Get raw value from HX711
+    if (!hasRawCount) {
+        return 0;
+    }
+    // Offset-corrected count of the latest captured conversion (same as HX711::get_value)
+    return lastRawCount - offset;
 }
 
 void Scale::initializeSamples(float initialValue) {
     for (int i = 0; i < MAX_SAMPLES; i++) {
         readings[i] = initialValue;
     }
+    medianWindow.reset(medianSamples, initialValue);
     samplesInitialized = true;
 }
 
+void Scale::rebuildMedianWindow() {
+    // Unroll the circular buffer oldest-first and reseed the median window from it
+    float ordered[MAX_SAMPLES];
+    for (int i = 0; i < MAX_SAMPLES; i++) {
+        ordered[i] = readings[(readingIndex + i) % MAX_SAMPLES];
+    }
+    medianWindow.rebuild(medianSamples, ordered, MAX_SAMPLES);
+}
+
 float Scale::medianFilter(int samples) {
     if (samples > MAX_SAMPLES) samples = MAX_SAMPLES;
     
-    // Copy recent readings
-    float temp[samples];
-    for (int i = 0; i < samples; i++) {
-        int idx = (readingIndex - 1 - i + MAX_SAMPLES) % MAX_SAMPLES;
-        temp[i] = readings[idx];
+    // Window size changed since the last sample - reseed from the reading history
+    if ((size_t)samples != medianWindow.getWindow()) {
+        rebuildMedianWindow();
     }
     
-    // Simple bubble sort for median (efficient for small arrays)
-    for (int i = 0; i < samples - 1; i++) {
-        for (int j = 0; j < samples - i - 1; j++) {
-            if (temp[j] > temp[j + 1]) {
-                float swap = temp[j];
-                temp[j] = temp[j + 1];
-                temp[j + 1] = swap;
-            }
-        }
-    }
-    return temp[samples / 2]; // Return median
+    // Window is kept sorted incrementally on every sample, no per-call sort needed
+    return medianWindow.median();
 }
 
 float Scale::averageFilter(int samples) {
@@ -341,30 +400,90 @@ void Scale::setAverageSamples(int samples) {
     }
 }
 
+void Scale::setFilterMode(FilterMode mode) {
+    if (mode == FILTER_SMART || mode == FILTER_KALMAN) {
+        filterMode = mode;
+        saveFilterSettings();
+        Serial.println("Filter mode: " + String(getFilterModeName(mode)));
+    }
+}
+
+void Scale::setKalmanProcessNoise(float q) {
+    if (q >= 0.0001f && q <= 100.0f) { // From near-constant flow to tracking abrupt pour changes
+        kalman.setProcessNoise(q);
+        saveFilterSettings();
+    }
+}
+
+void Scale::setKalmanMeasurementNoise(float r) {
+    if (r >= 0.0001f && r <= 10.0f) { // 0.01g to ~3g RMS sample noise
+        kalman.setMeasurementNoise(r);
+        saveFilterSettings();
+    }
+}
+
+void Scale::setFlowProfile(FlowRate::Profile profile) {
+    if (profile == FlowRate::PROFILE_FAST || profile == FlowRate::PROFILE_SMOOTH) {
+        flowProfile = profile;
+        if (flowRatePtr != nullptr) {
+            flowRatePtr->setProfile(profile);
+        }
+        saveFilterSettings();
+        Serial.println("Flow profile: " + String(FlowRate::getProfileName(profile)));
+    }
+}
+
+const char* Scale::getFilterModeName(FilterMode mode) {
+    switch (mode) {
+        case FILTER_SMART: return "smart";
+        case FILTER_KALMAN: return "kalman";
+        default: return "unknown";
+    }
+}
+
 void Scale::saveFilterSettings() {
-    preferences.begin("scale", false);
-    preferences.putFloat("brew_thresh", brewingThreshold);
-    preferences.putULong("stab_timeout", stabilityTimeout);
-    preferences.putInt("median_samples", medianSamples);
-    preferences.putInt("avg_samples", averageSamples);
-    preferences.end();
+    settings.begin("scale", false);
+    settings.putFloat("brew_thresh", brewingThreshold);
+    settings.putULong("stab_timeout", stabilityTimeout);
+    settings.putInt("median_samples", medianSamples);
+    settings.putInt("avg_samples", averageSamples);
+    settings.putUChar("filter_mode", (uint8_t)filterMode);
+    settings.putFloat("kf_q", kalman.getProcessNoise());
+    settings.putFloat("kf_r", kalman.getMeasurementNoise());
+    settings.putUChar("flow_profile", (uint8_t)flowProfile);
+    settings.end();
     Serial.println("Filter settings saved to EEPROM");
 }
 
 void Scale::loadFilterSettings() {
     // Load with sensible defaults
-    brewingThreshold = preferences.getFloat("brew_thresh", 0.15f);
-    stabilityTimeout = preferences.getULong("stab_timeout", 2000);
-    medianSamples = preferences.getInt("median_samples", 3);
-    averageSamples = preferences.getInt("avg_samples", 2); // Reduced for faster response
+    brewingThreshold = settings.getFloat("brew_thresh", 0.15f);
+    stabilityTimeout = settings.getULong("stab_timeout", 2000);
+    medianSamples = settings.getInt("median_samples", 3);
+    averageSamples = settings.getInt("avg_samples", 2); // Reduced for faster response
+    filterMode = settings.getUChar("filter_mode", FILTER_SMART) == FILTER_KALMAN ? FILTER_KALMAN : FILTER_SMART;
+    kalman.setProcessNoise(settings.getFloat("kf_q", WeightFlowKalman::DEFAULT_PROCESS_NOISE));
+    kalman.setMeasurementNoise(settings.getFloat("kf_r", WeightFlowKalman::DEFAULT_MEASUREMENT_NOISE));
+    flowProfile = settings.getUChar("flow_profile", FlowRate::PROFILE_SMOOTH) == FlowRate::PROFILE_FAST
+        ? FlowRate::PROFILE_FAST : FlowRate::PROFILE_SMOOTH;
+    if (flowRatePtr != nullptr) {
+        flowRatePtr->setProfile(flowProfile);
+    }
 }
 
 void Scale::setFlowRatePtr(FlowRate* flowRatePtr) {
     this->flowRatePtr = flowRatePtr;
+    if (flowRatePtr != nullptr) {
+        flowRatePtr->setProfile(flowProfile);
+    }
 }
 
 String Scale::getFilterState() const {
-    switch (currentFilterState) {
+    return String(getFilterStateName(currentFilterState));
+}
+
+const char* Scale::getFilterStateName(FilterState state) {
+    switch (state) {
         case STABLE: return "STABLE";
         case BREWING: return "BREWING";
         case TRANSITIONING: return "TRANSITIONING";
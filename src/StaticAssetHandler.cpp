@@ -0,0 +1,111 @@
+#include "StaticAssetHandler.h"
+
+StaticAssetHandler::StaticAssetHandler(fs::FS& fs) : fs(fs), metrics(nullptr), metricsRoute(nullptr) {
+    buildHash[0] = '\0';
+    etag[0] = '\0';
+}
+
+void StaticAssetHandler::loadBuildHash() {
+    File file = fs.open("/asset-hash", "r");
+    if (!file) {
+        Serial.println("Web assets: no /asset-hash - serving without cache headers");
+        return;
+    }
+    size_t length = file.read((uint8_t*)buildHash, sizeof(buildHash) - 1);
+    file.close();
+    while (length > 0 && isspace((unsigned char)buildHash[length - 1])) {
+        length--;
+    }
+    buildHash[length] = '\0';
+    snprintf(etag, sizeof(etag), "\"%s\"", buildHash);
+    Serial.printf("Web assets: build %s\n", buildHash);
+}
+
+void StaticAssetHandler::setMetrics(RouteMetrics* metrics) {
+    this->metrics = metrics;
+    metricsRoute = metrics != nullptr ? metrics->addRoute("static", "GET") : nullptr;
+}
+
+bool StaticAssetHandler::canHandle(AsyncWebServerRequest* request) {
+    if (request->method() != HTTP_GET && request->method() != HTTP_HEAD) {
+        return false;
+    }
+    if (request->url().startsWith("/api/")) {
+        return false;
+    }
+    char path[MAX_PATH];
+    if (!resolvePath(request, path, sizeof(path))) {
+        return false;
+    }
+    request->addInterestingHeader("If-None-Match");
+    return true;
+}
+
+void StaticAssetHandler::handleRequest(AsyncWebServerRequest* request) {
+    uint32_t start = micros();
+    char path[MAX_PATH];
+    size_t bytes = 0;
+    if (resolvePath(request, path, sizeof(path))) {
+        bytes = sendFile(request, path);
+    } else {
+        request->send(404);
+    }
+    if (metrics != nullptr) {
+        metrics->record(metricsRoute, micros() - start, bytes);
+    }
+}
+
+size_t StaticAssetHandler::sendFile(AsyncWebServerRequest* request, const char* path) {
+    // Pages link assets as ?v=<hash>; a stale hash from an old page is served but not cached
+    bool versioned = buildHash[0] != '\0' && request->hasParam("v") &&
+                     request->getParam("v")->value().equals(buildHash);
+
+    if (etag[0] != '\0' && request->hasHeader("If-None-Match") &&
+        request->header("If-None-Match").equals(etag)) {
+        AsyncWebServerResponse* response = request->beginResponse(304);
+        addCacheHeaders(response, versioned);
+        request->send(response);
+        return 0;
+    }
+
+    // Open the stored variant ourselves to know the body size; a File named *.gz
+    // served under the plain path is sent with Content-Encoding: gzip
+    File file = fs.open(path, "r");
+    if (!file || file.isDirectory()) {
+        char gzPath[MAX_PATH + 3];
+        snprintf(gzPath, sizeof(gzPath), "%s.gz", path);
+        file = fs.open(gzPath, "r");
+    }
+    if (!file) {
+        request->send(404);
+        return 0;
+    }
+    size_t bytes = file.size();
+    AsyncWebServerResponse* response = request->beginResponse(file, path, String());
+    addCacheHeaders(response, versioned);
+    request->send(response);
+    return bytes;
+}
+
+bool StaticAssetHandler::resolvePath(AsyncWebServerRequest* request, char* path, size_t size) {
+    const String& url = request->url();
+    int length = snprintf(path, size, "%s%s", url.c_str(), url.endsWith("/") ? "index.html" : "");
+    if (length <= 0 || (size_t)length + 3 >= size) {
+        return false; // No room for the .gz suffix
+    }
+    if (fs.exists(path)) {
+        return true;
+    }
+    strcat(path, ".gz");
+    bool found = fs.exists(path);
+    path[length] = '\0';
+    return found;
+}
+
+void StaticAssetHandler::addCacheHeaders(AsyncWebServerResponse* response, bool versioned) {
+    if (etag[0] == '\0') {
+        return;
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", versioned ? "public, max-age=31536000, immutable" : "no-cache");
+}
@@ -7,7 +7,8 @@
 TouchSensor::TouchSensor(uint8_t touchPin, Scale* scale) 
     : touchPin(touchPin), scalePtr(scale), displayPtr(nullptr), flowRatePtr(nullptr), touchThreshold(30000), 
       lastTouchState(false), lastTouchTime(0), touchStartTime(0), debounceDelay(200),
-      longPressDetected(false), delayedTarePending(false), delayedTareTime(0) {
+      longPressDetected(false), delayedTarePending(false), delayedTareTime(0),
+      tareAwaitingCompletion(false), tareCountAtRequest(0) {
 }
 
 void TouchSensor::begin() {
@@ -67,6 +68,9 @@ void TouchSensor::update() {
     
     // Check for pending delayed tare
     checkDelayedTare();
+    
+    // Show completion once the background tare job has finished
+    checkTareCompletion();
 }
 
 void TouchSensor::setTouchThreshold(uint16_t threshold) {
@@ -111,25 +115,7 @@ void TouchSensor::handleTouch() {
             displayPtr->showTaringMessage();
         }
         
-        scalePtr->tare();
-        Serial.println("Scale tared successfully");
-        
-        // Reset timer when manual tare is pressed
-        if (displayPtr != nullptr) {
-            displayPtr->resetTimer();
-            Serial.println("Timer reset with manual tare");
-        }
-        
-        // Reset flow rate averaging for fresh brew
-        if (flowRatePtr != nullptr) {
-            flowRatePtr->resetTimerAveraging();
-            Serial.println("Flow rate averaging reset for fresh brew");
-        }
-        
-        // Show completion message on display if available
-        if (displayPtr != nullptr) {
-            displayPtr->showTaredMessage();
-        }
+        requestTare();
     } else {
         Serial.println("Error: Scale pointer is null");
     }
@@ -156,31 +142,46 @@ void TouchSensor::checkDelayedTare() {
         
         // Perform the actual tare operation without showing message again
         if (scalePtr != nullptr) {
-            scalePtr->tare();
-            Serial.println("Scale tared successfully");
-            
-            // Reset timer when manual tare is pressed
-            if (displayPtr != nullptr) {
-                displayPtr->resetTimer();
-                Serial.println("Timer reset with manual tare");
-            }
-            
-            // Reset flow rate averaging for fresh brew
-            if (flowRatePtr != nullptr) {
-                flowRatePtr->resetTimerAveraging();
-                Serial.println("Flow rate averaging reset for fresh brew");
-            }
-            
-            // Show completion message on display if available
-            if (displayPtr != nullptr) {
-                displayPtr->showTaredMessage();
-            }
+            requestTare();
         } else {
             Serial.println("Error: Scale pointer is null");
         }
     }
 }
 
+void TouchSensor::requestTare() {
+    // Queue the tare job - it completes in the sampling task without blocking loop()
+    tareCountAtRequest = scalePtr->getTareCount();
+    tareAwaitingCompletion = scalePtr->tare();
+    
+    // Reset timer when manual tare is pressed
+    if (displayPtr != nullptr) {
+        displayPtr->resetTimer();
+        Serial.println("Timer reset with manual tare");
+    }
+    
+    // Reset flow rate averaging for fresh brew
+    if (flowRatePtr != nullptr) {
+        flowRatePtr->resetTimerAveraging();
+        Serial.println("Flow rate averaging reset for fresh brew");
+    }
+}
+
+void TouchSensor::checkTareCompletion() {
+    if (!tareAwaitingCompletion || scalePtr == nullptr) {
+        return;
+    }
+    if (scalePtr->getTareCount() != tareCountAtRequest) {
+        tareAwaitingCompletion = false;
+        Serial.println("Scale tared successfully");
+        
+        // Show completion message on display if available
+        if (displayPtr != nullptr) {
+            displayPtr->showTaredMessage();
+        }
+    }
+}
+
 void TouchSensor::handleStatusPageToggle() {
     Serial.println("Medium press detected - toggling status page");
     
@@ -0,0 +1,126 @@
+#include "TraceRecorder.h"
+#include "Scale.h"
+
+TraceRecorder::TraceRecorder()
+    : scalePtr(nullptr), records(nullptr), capacity(0), count(0), recording(false), startRequested(false),
+      overflowed(false) {
+    initTraceHeader(header);
+}
+
+void TraceRecorder::setBuffer(uint8_t* buffer, size_t bytes) {
+    recording.store(false, std::memory_order_release);
+    records = buffer;
+    capacity = buffer != nullptr ? (uint32_t)(bytes / sizeof(TraceRecord)) : 0;
+    count.store(0, std::memory_order_release);
+}
+
+void TraceRecorder::start() {
+    if (!isAvailable()) {
+        return;
+    }
+    overflowed = false;
+    startRequested.store(true, std::memory_order_release);
+    recording.store(true, std::memory_order_release);
+    Serial.println("Trace recording started");
+}
+
+void TraceRecorder::resume() {
+    if (!isAvailable()) {
+        return;
+    }
+    if (getRecordCount() == 0 || overflowed) {
+        start();
+        return;
+    }
+    recording.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::stop() {
+    if (!recording.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    Serial.println("Trace recording stopped: " + String(getRecordCount()) + " records");
+}
+
+void TraceRecorder::recordSample(const RawSample& sample) {
+    if (startRequested.load(std::memory_order_acquire)) {
+        beginTrace();
+    }
+    if (!recording.load(std::memory_order_acquire)) {
+        return;
+    }
+    append(sample.timestampUs, sample.raw);
+}
+
+void TraceRecorder::recordTare(uint8_t samples) {
+    if (!recording.load(std::memory_order_acquire) || startRequested.load(std::memory_order_acquire)) {
+        return;
+    }
+    append(0, (int32_t)(TRACE_TARE_MARKER | samples));
+}
+
+void TraceRecorder::beginTrace() {
+    startRequested.store(false, std::memory_order_relaxed);
+    count.store(0, std::memory_order_release);
+
+    // Snapshot everything replay needs to reproduce the device pipeline
+    initTraceHeader(header);
+    if (scalePtr != nullptr) {
+        header.filterMode = (uint8_t)scalePtr->getFilterMode();
+        header.calibrationFactor = scalePtr->getCalibrationFactor();
+        header.offset = scalePtr->getOffset();
+        header.brewingThreshold = scalePtr->getBrewingThreshold();
+        header.stabilityTimeout = (uint32_t)scalePtr->getStabilityTimeout();
+        header.medianSamples = (uint16_t)scalePtr->getMedianSamples();
+        header.averageSamples = (uint16_t)scalePtr->getAverageSamples();
+        header.kalmanProcessNoise = scalePtr->getKalmanProcessNoise();
+        header.kalmanMeasurementNoise = scalePtr->getKalmanMeasurementNoise();
+        header.flowProfile = (uint8_t)scalePtr->getFlowProfile();
+    }
+}
+
+void TraceRecorder::append(uint32_t timestampUs, int32_t raw) {
+    uint32_t n = count.load(std::memory_order_relaxed);
+    if (n >= capacity) {
+        // Buffer full - keep what we have rather than wrapping over the start of the shot
+        overflowed = true;
+        recording.store(false, std::memory_order_release);
+        return;
+    }
+    TraceRecord record;
+    record.timestampUs = timestampUs;
+    record.raw = raw;
+    memcpy(records + (size_t)n * sizeof(TraceRecord), &record, sizeof(TraceRecord));
+    count.store(n + 1, std::memory_order_release);
+}
+
+size_t TraceRecorder::getTraceSize() const {
+    return sizeof(TraceHeader) + (size_t)getRecordCount() * sizeof(TraceRecord);
+}
+
+size_t TraceRecorder::readTrace(uint8_t* out, size_t maxLen, size_t index) const {
+    size_t total = getTraceSize();
+    if (index >= total || maxLen == 0) {
+        return 0;
+    }
+
+    size_t written = 0;
+    if (index < sizeof(TraceHeader)) {
+        TraceHeader current = header;
+        current.recordCount = getRecordCount();
+        size_t n = sizeof(TraceHeader) - index;
+        if (n > maxLen) n = maxLen;
+        memcpy(out, reinterpret_cast<const uint8_t*>(&current) + index, n);
+        written = n;
+        index += n;
+    }
+
+    size_t remaining = total - index;
+    size_t n = maxLen - written;
+    if (n > remaining) n = remaining;
+    if (n > 0) {
+        memcpy(out + written, records + (index - sizeof(TraceHeader)), n);
+        written += n;
+    }
+    return written;
+}
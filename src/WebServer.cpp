@@ -8,6 +8,13 @@
 #include "Calibration.h"
 #include "BluetoothScale.h"
 #include "Version.h"
+#include "JsonWriter.h"
+#include "StaticAssetHandler.h"
+#include "BrewFrame.h"
+#include "RouteMetrics.h"
+#include "LoopProfiler.h"
+#include <esp_heap_caps.h>
+#include <memory>
 
 Preferences preferences;
 
@@ -53,44 +60,125 @@ void setCachedDecimals(int decimals) {
     }
 }
 
-void diagnoseEEPROMPerformance() {
-    Serial.println("=== EEPROM Performance Diagnostics ===");
-    
-    // Test WiFi preferences
-    unsigned long startTime = millis();
-    Preferences testPrefs;
-    if (testPrefs.begin("test", false)) {
-        testPrefs.putInt("testkey", 42);
-        int val = testPrefs.getInt("testkey", 0);
-        testPrefs.end();
-        Serial.printf("EEPROM test write/read took: %lu ms\n", millis() - startTime);
-    } else {
-        Serial.println("ERROR: Cannot open test preferences namespace");
-    }
-    
-    // Test existing namespaces
-    startTime = millis();
-    if (testPrefs.begin("wifi", true)) {
-        String ssid = testPrefs.getString("ssid", "");
-        testPrefs.end();
-        Serial.printf("WiFi namespace read took: %lu ms\n", millis() - startTime);
-    } else {
-        Serial.println("ERROR: Cannot open wifi preferences namespace");
-    }
-    
-    startTime = millis();
-    if (testPrefs.begin("display", true)) {
-        int decimals = testPrefs.getInt("decimals", 1);
-        testPrefs.end();
-        Serial.printf("Display namespace read took: %lu ms\n", millis() - startTime);
-    } else {
-        Serial.println("ERROR: Cannot open display preferences namespace");
+AsyncWebServer server(80);
+static StaticAssetHandler staticAssets(LittleFS);
+
+// Per-route request count, body bytes and handler latency, exposed at /api/metrics.
+// Handlers report body sizes through countResponseBytes(); latency is the time
+// spent in the handler, the response itself streams out afterwards.
+static RouteMetrics routeMetrics;
+static size_t responseBytes = 0; // Body bytes of the request being handled
+
+static void countResponseBytes(size_t bytes) {
+  responseBytes += bytes;
+}
+
+static const char* methodName(WebRequestMethodComposite method) {
+  switch (method) {
+    case HTTP_GET: return "GET";
+    case HTTP_POST: return "POST";
+    case HTTP_DELETE: return "DELETE";
+    case HTTP_PUT: return "PUT";
+    default: return "ANY";
+  }
+}
+
+// server.on() with instrumentation
+static RouteMetrics::Route* onRoute(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler) {
+  RouteMetrics::Route* route = routeMetrics.addRoute(uri, methodName(method));
+  if (route == nullptr) {
+    Serial.printf("ERROR: RouteMetrics full - %s %s not measured\n", methodName(method), uri);
+  }
+  server.on(uri, method, [route, handler](AsyncWebServerRequest *request) {
+    responseBytes = 0;
+    uint32_t start = micros();
+    handler(request);
+    routeMetrics.record(route, micros() - start, responseBytes);
+  });
+  return route;
+}
+
+static void sendText(AsyncWebServerRequest *request, int code, const char *contentType, const char *body) {
+  countResponseBytes(strlen(body));
+  request->send(code, contentType, body);
+}
+
+static void sendText(AsyncWebServerRequest *request, int code, const char *contentType, const String &body) {
+  countResponseBytes(body.length());
+  request->send(code, contentType, body);
+}
+
+// Side effects run from loop() - 503 if the command queue is full
+static void sendQueued(AsyncWebServerRequest *request, uint32_t commandId, const String &body) {
+  if (commandId == 0) {
+    sendText(request, 503, "text/plain", "Busy - try again");
+    return;
+  }
+  AsyncWebServerResponse *response = request->beginResponse(202, "text/plain", body);
+  response->addHeader("X-Command-Id", String(commandId));
+  countResponseBytes(body.length());
+  request->send(response);
+}
+
+static const char WIFI_DISABLED_MESSAGE[] =
+    "WiFi disabled for battery saving. Device will be inaccessible until WiFi is re-enabled.";
+
+// JSON responses are serialized into pooled buffers instead of String concatenation.
+// A slot stays owned until the client disconnects, since the response streams
+// straight from it. All handlers run on the async_tcp task, so no locking needed.
+static const size_t JSON_SLOT_SIZE = 1536;
+static const size_t JSON_SLOT_COUNT = 4;
+
+struct JsonSlot {
+  char buffer[JSON_SLOT_SIZE];
+  bool inUse;
+};
+
+static JsonSlot jsonSlots[JSON_SLOT_COUNT];
+
+static JsonSlot* acquireJsonSlot() {
+  for (size_t i = 0; i < JSON_SLOT_COUNT; i++) {
+    if (!jsonSlots[i].inUse) {
+      jsonSlots[i].inUse = true;
+      return &jsonSlots[i];
     }
-    
-    Serial.println("=== End Diagnostics ===");
+  }
+  return nullptr;
 }
 
-AsyncWebServer server(80);
+// build(JsonWriter&) writes the body; sent with the given content type
+template <typename Builder>
+static void sendJson(AsyncWebServerRequest *request, int code, Builder build, const char *contentType = "application/json") {
+  JsonSlot *slot = acquireJsonSlot();
+  if (slot == nullptr) {
+    // Every slot busy - serialize on the stack and copy into a stream response
+    char buffer[JSON_SLOT_SIZE];
+    JsonWriter json(buffer, sizeof(buffer));
+    build(json);
+    if (json.overflowed()) {
+      sendText(request, 500, "application/json", "{\"status\":\"error\",\"message\":\"Response too large\"}");
+      return;
+    }
+    AsyncResponseStream *response = request->beginResponseStream(contentType, json.length());
+    response->setCode(code);
+    response->write((const uint8_t*)json.c_str(), json.length());
+    countResponseBytes(json.length());
+    request->send(response);
+    return;
+  }
+
+  JsonWriter json(slot->buffer, sizeof(slot->buffer));
+  build(json);
+  if (json.overflowed()) {
+    slot->inUse = false;
+    Serial.printf("JSON response for %s exceeds %u bytes\n", request->url().c_str(), (unsigned)JSON_SLOT_SIZE);
+    sendText(request, 500, "application/json", "{\"status\":\"error\",\"message\":\"Response too large\"}");
+    return;
+  }
+  request->onDisconnect([slot]() { slot->inUse = false; });
+  countResponseBytes(json.length());
+  request->send(request->beginResponse_P(code, contentType, (const uint8_t*)slot->buffer, json.length()));
+}
 
 /*
  * API Endpoints for External Brewing Systems (e.g., GaggiMate):
@@ -103,12 +191,58 @@ AsyncWebServer server(80);
  * GET /api/brew/status  
  * Response: {"w":45.2,"f":2.1} (weight and flowrate)
  * 
+ * Binary sample, full resolution (24 bytes, layout in BrewFrame.h):
+ * GET /api/brew/frame -> version, filter state, flags, sequence, timestamp us,
+ *                         weight 0.01 g, flow 0.01 g/s, timer ms
+ * Same frames on /ws after sending {"format":"binary"}
+ * 
+ * Streaming instead of polling (Server-Sent Events, format in BrewEvents.h):
+ * GET /api/brew/events -> event: w / data: 45.2 / id: 812, event: f, event: timer
+ * POST /api/brew/events/config intervalMs=50 (0 = every sample, max 1000)
+ * 
+ * Non-blocking tare (returns 202 immediately, completes after 20 samples):
+ * POST /api/tare
+ * GET /api/tare/status -> {"in_progress":false,"tare_count":3}
+ * 
+ * Raw trace of the last timer session (recorded while the timer runs, PSRAM boards only):
+ * GET /api/trace/status -> {"available":true,"recording":false,"records":2412,"capacity":65536,"bytes":19336,"overflowed":false}
+ * GET /api/trace -> binary trace download (409 while recording, 404 if empty) - format in TraceFormat.h
+ * 
+ * BLE weight notifications (sent on change, keepalive when idle):
+ * GET /api/bluetooth/status -> {"connected":true,"clients":2,"notifications":{"gaggimate":{"sent":812,"suppressed":2210,...},...,
+ *                              "batch":{"frames":96,"samples":768,"intervalMs":100}},
+ *                              "connections":[{"handle":1,"mtu":247,"interval_ms":7.50,"link_profile":"fast","phy_tx":"2M","bytes_per_second":400,...},...]}
+ * POST /api/bluetooth/notify-policy channel=gaggimate|beanconqueror|decent [deadband] [minIntervalMs] [keepaliveMs]
+ * GET /api/bluetooth/codecs -> {"codecs":[{"name":"decent","enabled":false,"stored":true,"service":"0000FFF0-...",...},...],"restart_required":true}
+ * POST /api/bluetooth/codecs enabled=gaggimate,beanconqueror,decent (stored, applied on next boot)
+ * 
+ * Commands (tare, timer, calibration, NVS reset, WiFi credentials and power) are queued
+ * and run from loop(); their responses are 202 with an X-Command-Id header. A tare stays
+ * running until the new zero is in place, a WiFi change until the link has switched:
+ * GET /api/commands -> {"queued":0,"running":0,"capacity":16,"executed":12,"dropped":0,"recent":[{"id":12,"type":"tare","source":"http","state":"done","age_ms":840},...]}
+ * GET /api/commands?id=12 -> {"id":12,"state":"queued|running|done|failed|unknown"}
+ * 
  * Standard dashboard:
  * GET /api/dashboard
  * Response: {"weight":45.23,"flowrate":2.15}
+ * 
+ * Web UI: static files are served gzipped with ETag = filesystem build hash;
+ * assets linked as ?v=<hash> are cached immutably, pages revalidate (304).
+ * 
+ * Live push (WebSocket, protocol in LiveStream.h):
+ * ws://<device>/ws -> {"t":"l","s":812,"w":45.23,"f":2.1,"tm":27340,"tr":1,"a":null} per sample
+ * 
+ * Loop profile (builds with -DWEIGHMYBRU_PROFILER=1):
+ * GET /api/profile -> {"deadlineUs":20000,"missedDeadlines":0,"sections":{"wifi":{"count":812,"meanUs":41,"p50Us":39,"p99Us":95,"maxUs":310},...}}
+ * 
+ * Metrics (Prometheus text format):
+ * GET /api/metrics -> per-route weighmybru_http_requests_total, _response_bytes_total,
+ *                     weighmybru_http_request_duration_microseconds histogram; heap and client gauges,
+ *                     OLED frame, I2C byte and frame time metrics, WiFi reconnect counters,
+ *                     weighmybru_metrics_dropped (routes/gauges that found no slot)
  */
 
-void setupWebServer(Scale &scale, FlowRate &flowRate, BluetoothScale &bluetoothScale, Display &display, BatteryMonitor &battery) {
+void setupWebServer(Scale &scale, FlowRate &flowRate, SamplingTask &samplingTask, TraceRecorder &traceRecorder, LiveStream &liveStream, BrewEvents &brewEvents, BluetoothScale &bluetoothScale, Display &display, BatteryMonitor &battery, ControlCommands &commands) {
   if (!LittleFS.begin()) {
     Serial.println();
     Serial.println("=====================================");
@@ -129,142 +263,156 @@ void setupWebServer(Scale &scale, FlowRate &flowRate, BluetoothScale &bluetoothS
     return;
   }
 
-  // Run EEPROM diagnostics
-  diagnoseEEPROMPerformance();
-
   // Pre-cache settings to avoid delays on first page load
   Serial.println("Pre-caching settings for faster page loads...");
   getCachedDecimals();        // This will cache the decimal setting
   getStoredSSID();            // This will cache WiFi credentials
 
+  // Live push for the dashboard - /api/dashboard stays as the polling fallback
+  liveStream.begin(server);
+
+  // Event stream for brewing controllers that poll /api/brew/*
+  brewEvents.begin(server);
+
   // Register API route first
-  server.on("/api/dashboard", HTTP_GET, [&scale, &flowRate, &display, &battery, &bluetoothScale](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"weight\":" + String(scale.getCurrentWeight(), 2) + ",";
-    json += "\"flowrate\":" + String(flowRate.getFlowRate(), 1) + ",";
-    json += "\"scale_connected\":" + String(scale.isHX711Connected() ? "true" : "false") + ",";
-    json += "\"filter_state\":\"" + scale.getFilterState() + "\",";
-    
-    // Always show unified mode
-    json += "\"mode\":\"UNIFIED\",";
-    
-    // Add timer information
-    unsigned long elapsedTime = display.getElapsedTime();
-    if (elapsedTime > 0 || display.isTimerRunning()) {
-      unsigned long minutes = elapsedTime / 60000;
-      unsigned long seconds = (elapsedTime % 60000) / 1000;
-      unsigned long milliseconds = elapsedTime % 1000;
-      json += "\"timer_running\":" + String(display.isTimerRunning() ? "true" : "false") + ",";
-      json += "\"timer_elapsed\":" + String(elapsedTime) + ",";
-      json += "\"timer_display\":\"" + String(minutes) + ":" + 
-              (seconds < 10 ? "0" : "") + String(seconds) + "." + 
-              (milliseconds < 100 ? (milliseconds < 10 ? "00" : "0") : "") + String(milliseconds) + "\",";
+  onRoute("/api/dashboard", HTTP_GET, [&scale, &flowRate, &samplingTask, &display, &battery, &bluetoothScale](AsyncWebServerRequest *request) {
+    // One consistent weight/flow pair published by the sampling task
+    WeightSnapshot snapshot = samplingTask.getSnapshot();
+    sendJson(request, 200, [&](JsonWriter &json) {
+      json.beginObject();
+      json.field("weight", snapshot.weight, 2);
+      json.field("flowrate", snapshot.flowRate, 1);
+      json.field("scale_connected", scale.isHX711Connected());
+      json.field("filter_state", Scale::getFilterStateName((Scale::FilterState)snapshot.filterState));
+      json.field("taring", snapshot.taring);
+      
+      // Always show unified mode
+      json.field("mode", "UNIFIED");
+      
+      // Add timer information
+      unsigned long elapsedTime = display.getElapsedTime();
+      if (elapsedTime > 0 || display.isTimerRunning()) {
+        char timerDisplay[16];
+        snprintf(timerDisplay, sizeof(timerDisplay), "%lu:%02lu.%03lu",
+                 elapsedTime / 60000, (elapsedTime % 60000) / 1000, elapsedTime % 1000);
+        json.field("timer_running", display.isTimerRunning());
+        json.field("timer_elapsed", elapsedTime);
+        json.field("timer_display", timerDisplay);
+      } else {
+        json.field("timer_running", false);
+        json.field("timer_elapsed", 0);
+        json.field("timer_display", "0:00.000");
+      }
       
       // Add timer average flow rate
-      if (flowRate.hasTimerAverage()) {
-        json += "\"timer_avg_flowrate\":" + String(flowRate.getTimerAverageFlowRate(), 2);
+      if (flowRate.hasTimerAverage() && (elapsedTime > 0 || display.isTimerRunning())) {
+        json.field("timer_avg_flowrate", flowRate.getTimerAverageFlowRate(), 2);
       } else {
-        json += "\"timer_avg_flowrate\":null";
+        json.nullField("timer_avg_flowrate");
       }
-    } else {
-      json += "\"timer_running\":false,";
-      json += "\"timer_elapsed\":0,";
-      json += "\"timer_display\":\"0:00.000\",";
-      json += "\"timer_avg_flowrate\":null";
-    }
-    
-    // Add battery information
-    json += ",\"battery_voltage\":" + String(battery.getBatteryVoltage(), 2);
-    json += ",\"battery_percentage\":" + String(battery.getBatteryPercentage());
-    json += ",\"battery_status\":\"" + battery.getBatteryStatus() + "\"";
-    json += ",\"battery_segments\":" + String(battery.getBatterySegments());
-    json += ",\"battery_low\":" + String(battery.isLowBattery() ? "true" : "false");
-    json += ",\"battery_critical\":" + String(battery.isCriticalBattery() ? "true" : "false");
-    
-    // Add signal strength information
-    json += ",\"wifi_signal_strength\":" + String(getWiFiSignalStrength());
-    json += ",\"wifi_signal_quality\":\"" + getWiFiSignalQuality() + "\"";
-    json += ",\"bluetooth_connected\":" + String(bluetoothScale.isConnected() ? "true" : "false");
-    json += ",\"bluetooth_signal_strength\":" + String(bluetoothScale.getBluetoothSignalStrength());
-    
-    // Add device version information
-    json += ",\"device_version\":\"" + String(WEIGHMYBRU_VERSION_STRING) + "\"";
-    json += ",\"device_board\":\"" + String(WEIGHMYBRU_BOARD_NAME) + "\"";
-    json += ",\"device_build_date\":\"" + String(WEIGHMYBRU_BUILD_DATE) + "\"";
-    json += ",\"device_full_version\":\"" + String(WEIGHMYBRU_FULL_VERSION) + "\"";
-    
-    json += "}";
-    request->send(200, "application/json", json);
+      
+      // Add battery information
+      json.field("battery_voltage", battery.getBatteryVoltage(), 2);
+      json.field("battery_percentage", battery.getBatteryPercentage());
+      json.field("battery_status", battery.getBatteryStatus());
+      json.field("battery_segments", battery.getBatterySegments());
+      json.field("battery_low", battery.isLowBattery());
+      json.field("battery_critical", battery.isCriticalBattery());
+      
+      // Add signal strength information
+      json.field("wifi_signal_strength", getWiFiSignalStrength());
+      json.field("wifi_signal_quality", getWiFiSignalQuality());
+      json.field("bluetooth_connected", bluetoothScale.isConnected());
+      json.field("bluetooth_signal_strength", bluetoothScale.getBluetoothSignalStrength());
+      
+      // Add device version information
+      json.field("device_version", WEIGHMYBRU_VERSION_STRING);
+      json.field("device_board", WEIGHMYBRU_BOARD_NAME);
+      json.field("device_build_date", WEIGHMYBRU_BUILD_DATE);
+      json.field("device_full_version", WEIGHMYBRU_FULL_VERSION);
+      json.endObject();
+    });
   });
 
   // Timer control endpoints
-  server.on("/api/timer/start", HTTP_POST, [&display](AsyncWebServerRequest *request) {
-    display.startTimer();
-    request->send(200, "text/plain", "Timer started");
+  onRoute("/api/timer/start", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
+    sendQueued(request, commands.post(ControlCommands::TIMER_START, ControlCommands::SOURCE_HTTP), "Timer started");
   });
 
-  server.on("/api/timer/stop", HTTP_POST, [&display](AsyncWebServerRequest *request) {
-    display.stopTimer();
-    request->send(200, "text/plain", "Timer stopped");
+  onRoute("/api/timer/stop", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
+    sendQueued(request, commands.post(ControlCommands::TIMER_STOP, ControlCommands::SOURCE_HTTP), "Timer stopped");
   });
 
-  server.on("/api/timer/reset", HTTP_POST, [&display](AsyncWebServerRequest *request) {
-    display.resetTimer();
-    request->send(200, "text/plain", "Timer reset");
+  onRoute("/api/timer/reset", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
+    sendQueued(request, commands.post(ControlCommands::TIMER_RESET, ControlCommands::SOURCE_HTTP), "Timer reset");
   });
 
-  server.on("/api/weight", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
-    request->send(200, "text/plain", String(scale.getCurrentWeight()));
+  onRoute("/api/weight", HTTP_GET, [&samplingTask](AsyncWebServerRequest *request) {
+    float weight = samplingTask.getSnapshot().weight;
+    sendJson(request, 200, [weight](JsonWriter &json) { json.value(weight, 2); }, "text/plain");
   });
 
   // Lightweight weight-only endpoint for brewing applications
-  server.on("/api/weight-fast", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
+  onRoute("/api/weight-fast", HTTP_GET, [&samplingTask](AsyncWebServerRequest *request) {
     // Minimal processing for fastest response
-    request->send(200, "text/plain", String(scale.getCurrentWeight(), 2));
+    float weight = samplingTask.getSnapshot().weight;
+    sendJson(request, 200, [weight](JsonWriter &json) { json.value(weight, 2); }, "text/plain");
   });
 
   // Brewing mode endpoints for external devices like GaggiMate
-  server.on("/api/brew/weight", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
+  onRoute("/api/brew/weight", HTTP_GET, [&samplingTask](AsyncWebServerRequest *request) {
     // Ultra-fast response for brewing systems
-    float weight = scale.getCurrentWeight();
-    request->send(200, "text/plain", String(weight, 1)); // 1 decimal for speed
+    float weight = samplingTask.getSnapshot().weight;
+    sendJson(request, 200, [weight](JsonWriter &json) { json.value(weight, 1); }, "text/plain"); // 1 decimal for speed
   });
   
-  server.on("/api/brew/status", HTTP_GET, [&scale, &flowRate](AsyncWebServerRequest *request) {
+  onRoute("/api/brew/status", HTTP_GET, [&samplingTask](AsyncWebServerRequest *request) {
     // Minimal JSON for brewing systems
-    String json = "{\"w\":" + String(scale.getCurrentWeight(), 1) + 
-                  ",\"f\":" + String(flowRate.getFlowRate(), 1) + "}";
-    request->send(200, "application/json", json);
+    WeightSnapshot snapshot = samplingTask.getSnapshot();
+    sendJson(request, 200, [&snapshot](JsonWriter &json) {
+      json.beginObject().field("w", snapshot.weight, 1).field("f", snapshot.flowRate, 1).endObject();
+    });
+  });
+
+  onRoute("/api/brew/frame", HTTP_GET, [&samplingTask, &display](AsyncWebServerRequest *request) {
+    // Fixed 24-byte little-endian frame - layout in BrewFrame.h
+    uint8_t frame[sizeof(BrewFrame)];
+    encodeBrewFrame(samplingTask.getSnapshot(), display.getElapsedTime(), display.isTimerRunning(), frame);
+    AsyncResponseStream *response = request->beginResponseStream("application/octet-stream", sizeof(frame));
+    response->write(frame, sizeof(frame));
+    countResponseBytes(sizeof(frame));
+    request->send(response);
   });
 
   // Battery calibration endpoints (must be before general /api/battery route)
-  server.on("/api/battery/calibrate", HTTP_POST, [&battery](AsyncWebServerRequest *request) {
+  onRoute("/api/battery/calibrate", HTTP_POST, [&battery](AsyncWebServerRequest *request) {
     if (request->hasParam("actualVoltage", true)) {
-      String value = request->getParam("actualVoltage", true)->value();
-      float actualVoltage = value.toFloat();
+      float actualVoltage = request->getParam("actualVoltage", true)->value().toFloat();
       if (actualVoltage > 0.0f && actualVoltage <= 5.0f) {
         battery.calibrateVoltage(actualVoltage);
-        String json = "{";
-        json += "\"status\":\"success\",";
-        json += "\"message\":\"Battery calibrated to " + String(actualVoltage, 3) + "V\",";
-        json += "\"new_voltage\":" + String(battery.getBatteryVoltage(), 3) + ",";
-        json += "\"new_percentage\":" + String(battery.getBatteryPercentage()) + ",";
-        json += "\"calibration_offset\":" + String(battery.getCalibrationOffset(), 3);
-        json += "}";
-        request->send(200, "application/json", json);
+        char message[48];
+        snprintf(message, sizeof(message), "Battery calibrated to %.3fV", actualVoltage);
+        sendJson(request, 200, [&](JsonWriter &json) {
+          json.beginObject();
+          json.field("status", "success");
+          json.field("message", message);
+          json.field("new_voltage", battery.getBatteryVoltage(), 3);
+          json.field("new_percentage", battery.getBatteryPercentage());
+          json.field("calibration_offset", battery.getCalibrationOffset(), 3);
+          json.endObject();
+        });
       } else {
-        request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid voltage. Must be between 0.1V and 5.0V\"}");
+        sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid voltage. Must be between 0.1V and 5.0V\"}");
       }
     } else {
-      request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Missing 'actualVoltage' parameter\"}");
+      sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Missing 'actualVoltage' parameter\"}");
     }
   });
 
   // GET version for easy browser access
-  server.on("/api/battery/calibrate", HTTP_GET, [&battery](AsyncWebServerRequest *request) {
+  onRoute("/api/battery/calibrate", HTTP_GET, [&battery](AsyncWebServerRequest *request) {
     if (request->hasParam("voltage")) {
-      String value = request->getParam("voltage")->value();
-      float actualVoltage = value.toFloat();
+      float actualVoltage = request->getParam("voltage")->value().toFloat();
       if (actualVoltage > 0.0f && actualVoltage <= 5.0f) {
         float beforeVoltage = battery.getBatteryVoltage();
         int beforePercentage = battery.getBatteryPercentage();
@@ -274,126 +422,174 @@ void setupWebServer(Scale &scale, FlowRate &flowRate, BluetoothScale &bluetoothS
         float afterVoltage = battery.getBatteryVoltage();
         int afterPercentage = battery.getBatteryPercentage();
         
-        String json = "{";
-        json += "\"status\":\"success\",";
-        json += "\"message\":\"Battery calibrated successfully\",";
-        json += "\"before_voltage\":" + String(beforeVoltage, 3) + ",";
-        json += "\"before_percentage\":" + String(beforePercentage) + ",";
-        json += "\"after_voltage\":" + String(afterVoltage, 3) + ",";
-        json += "\"after_percentage\":" + String(afterPercentage) + ",";
-        json += "\"target_voltage\":" + String(actualVoltage, 3) + ",";
-        json += "\"calibration_offset\":" + String(battery.getCalibrationOffset(), 3);
-        json += "}";
-        request->send(200, "application/json", json);
+        sendJson(request, 200, [&](JsonWriter &json) {
+          json.beginObject();
+          json.field("status", "success");
+          json.field("message", "Battery calibrated successfully");
+          json.field("before_voltage", beforeVoltage, 3);
+          json.field("before_percentage", beforePercentage);
+          json.field("after_voltage", afterVoltage, 3);
+          json.field("after_percentage", afterPercentage);
+          json.field("target_voltage", actualVoltage, 3);
+          json.field("calibration_offset", battery.getCalibrationOffset(), 3);
+          json.endObject();
+        });
         Serial.printf("Battery calibrated via GET: %.3fV (was %.3fV, now %.3fV)\n", actualVoltage, beforeVoltage, afterVoltage);
       } else {
-        request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid voltage. Must be between 0.1V and 5.0V\"}");
+        sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid voltage. Must be between 0.1V and 5.0V\"}");
       }
     } else {
-      request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Missing 'voltage' parameter. Use ?voltage=4.30\"}");
+      sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Missing 'voltage' parameter. Use ?voltage=4.30\"}");
     }
   });
 
   // Battery monitoring endpoint (general status)
-  server.on("/api/battery", HTTP_GET, [&battery](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"voltage\":" + String(battery.getBatteryVoltage(), 3);
-    json += ",\"percentage\":" + String(battery.getBatteryPercentage());
-    json += ",\"status\":\"" + battery.getBatteryStatus() + "\"";
-    json += ",\"segments\":" + String(battery.getBatterySegments());
-    json += ",\"low_battery\":" + String(battery.isLowBattery() ? "true" : "false");
-    json += ",\"critical_battery\":" + String(battery.isCriticalBattery() ? "true" : "false");
-    json += ",\"charging\":" + String(battery.isCharging() ? "true" : "false");
-    json += ",\"calibration_offset\":" + String(battery.getCalibrationOffset(), 3);
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/battery", HTTP_GET, [&battery](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [&battery](JsonWriter &json) {
+      json.beginObject();
+      json.field("voltage", battery.getBatteryVoltage(), 3);
+      json.field("percentage", battery.getBatteryPercentage());
+      json.field("status", battery.getBatteryStatus());
+      json.field("segments", battery.getBatterySegments());
+      json.field("low_battery", battery.isLowBattery());
+      json.field("critical_battery", battery.isCriticalBattery());
+      json.field("charging", battery.isCharging());
+      json.field("calibration_offset", battery.getCalibrationOffset(), 3);
+      json.endObject();
+    });
   });
 
   // Battery debug endpoint for troubleshooting
-  server.on("/api/battery/debug", HTTP_GET, [&battery](AsyncWebServerRequest *request) {
+  onRoute("/api/battery/debug", HTTP_GET, [&battery](AsyncWebServerRequest *request) {
     // We need to expose the raw ADC reading for debugging
     // Let's create a temporary battery instance to get raw data
     int rawADC = analogRead(7); // GPIO7 battery pin
     float rawVoltage = ((float)rawADC / 4095.0f) * 3.3f;
     float dividedVoltage = rawVoltage * 2.0f; // Apply voltage divider ratio
     
-    String json = "{";
-    json += "\"raw_adc\":" + String(rawADC) + ",";
-    json += "\"raw_voltage\":" + String(rawVoltage, 3) + ",";
-    json += "\"divided_voltage\":" + String(dividedVoltage, 3) + ",";
-    json += "\"calibrated_voltage\":" + String(battery.getBatteryVoltage(), 3) + ",";
-    json += "\"calibration_offset\":" + String(battery.getCalibrationOffset(), 3) + ",";
-    json += "\"percentage\":" + String(battery.getBatteryPercentage());
-    json += "}";
-    request->send(200, "application/json", json);
-  });
-
-  server.on("/api/tare", HTTP_POST, [&scale, &display, &flowRate](AsyncWebServerRequest *request){
-    scale.tare(20);
-    
-    // Reset timer when taring (prepare for fresh brew)
-    display.resetTimer();
-    
-    // Reset flow rate averaging for fresh brew measurement
-    flowRate.resetTimerAveraging();
+    sendJson(request, 200, [&](JsonWriter &json) {
+      json.beginObject();
+      json.field("raw_adc", rawADC);
+      json.field("raw_voltage", rawVoltage, 3);
+      json.field("divided_voltage", dividedVoltage, 3);
+      json.field("calibrated_voltage", battery.getBatteryVoltage(), 3);
+      json.field("calibration_offset", battery.getCalibrationOffset(), 3);
+      json.field("percentage", battery.getBatteryPercentage());
+      json.endObject();
+    });
+  });
+
+  onRoute("/api/tare", HTTP_POST, [&scale, &commands](AsyncWebServerRequest *request){
+    if (!scale.isHX711Connected()) {
+      sendText(request, 503, "text/plain", "Tare failed - scale not connected");
+      return;
+    }
     
-    request->send(200, "text/plain", "Scale tared! Timer and flow rate reset for fresh brew.");
+    // Tares from the next 20 captured samples, resets timer and flow rate averaging for a fresh brew
+    sendQueued(request, commands.post(ControlCommands::TARE, ControlCommands::SOURCE_HTTP, 0.0f, 20),
+               "Scale taring! Timer and flow rate reset for fresh brew.");
+  });
+
+  // Tare progress - poll until in_progress is false and tare_count has advanced
+  onRoute("/api/tare/status", HTTP_GET, [&scale](AsyncWebServerRequest *request){
+    sendJson(request, 200, [&scale](JsonWriter &json) {
+      json.beginObject().field("in_progress", scale.isTaring()).field("tare_count", scale.getTareCount()).endObject();
+    });
+  });
+
+  onRoute("/api/trace/status", HTTP_GET, [&traceRecorder](AsyncWebServerRequest *request){
+    sendJson(request, 200, [&traceRecorder](JsonWriter &json) {
+      json.beginObject();
+      json.field("available", traceRecorder.isAvailable());
+      json.field("recording", traceRecorder.isRecording());
+      json.field("records", traceRecorder.getRecordCount());
+      json.field("capacity", traceRecorder.getCapacity());
+      json.field("bytes", traceRecorder.getTraceSize());
+      json.field("overflowed", traceRecorder.hasOverflowed());
+      json.endObject();
+    });
+  });
+
+  onRoute("/api/trace", HTTP_GET, [&traceRecorder](AsyncWebServerRequest *request){
+    if (traceRecorder.isRecording()) {
+      sendText(request, 409, "text/plain", "Trace is still recording - stop the timer first");
+      return;
+    }
+    if (traceRecorder.getRecordCount() == 0) {
+      sendText(request, 404, "text/plain", "No trace recorded");
+      return;
+    }
+    // Stream straight out of PSRAM in TCP-sized chunks, no heap copy of the trace
+    AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", traceRecorder.getTraceSize(),
+      [&traceRecorder](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        return traceRecorder.readTrace(buffer, maxLen, index);
+      });
+    response->addHeader("Content-Disposition", "attachment; filename=\"weighmybru-trace.bin\"");
+    countResponseBytes(traceRecorder.getTraceSize());
+    request->send(response);
   });
 
-  server.on("/api/set-calibrationfactor", HTTP_POST, [&scale](AsyncWebServerRequest *request){
+  onRoute("/api/set-calibrationfactor", HTTP_POST, [&commands](AsyncWebServerRequest *request){
   if (request->hasParam("calibrationfactor", true)) {
     String value = request->getParam("calibrationfactor", true)->value();
     float calibrationFactor = value.toFloat();
     Serial.printf("Updated calibration factor weight: %.2f\n", calibrationFactor);
-    request->send(200, "text/plain", "Calibration factor updated to " + value);
-    scale.set_scale(calibrationFactor); // Assuming you have a method to set the calibration factor in Scale class
+    sendQueued(request, commands.post(ControlCommands::SET_CALIBRATION, ControlCommands::SOURCE_HTTP, calibrationFactor),
+               "Calibration factor updated to " + value);
   } else {
-    request->send(400, "text/plain", "Missing 'calibrationfactor' parameter");
+    sendText(request, 400, "text/plain", "Missing 'calibrationfactor' parameter");
   }
 });
 
-  server.on("/api/calibrate", HTTP_POST, [&scale](AsyncWebServerRequest *request){
+  onRoute("/api/calibrate", HTTP_POST, [&scale, &commands](AsyncWebServerRequest *request){
     if (request->hasParam("knownWeight", true)) {
       String value = request->getParam("knownWeight", true)->value();
       float knownWeight = value.toFloat();
+      // The raw value is relative to the tare offset - an unfinished tare job would mix in the old zero
+      if (scale.isTaring()) {
+        sendText(request, 409, "text/plain", "Tare still in progress - try again when it has finished");
+        return;
+      }
       // Read raw value from the scale (uncalibrated)
       long raw = scale.getRawValue();
       if (knownWeight > 0 && raw != 0) {
+        // Factor is worked out here, applied (and saved to NVS) from loop()
         float newCalibrationFactor = (float)raw / knownWeight;
-        scale.set_scale(newCalibrationFactor);
         Serial.printf("Calibration complete. New factor: %.6f\n", newCalibrationFactor);
-        request->send(200, "text/plain", "Scale calibrated! New factor: " + String(newCalibrationFactor, 6));
+        sendQueued(request, commands.post(ControlCommands::SET_CALIBRATION, ControlCommands::SOURCE_HTTP, newCalibrationFactor),
+                   "Scale calibrated! New factor: " + String(newCalibrationFactor, 6));
       } else {
-        request->send(400, "text/plain", "Invalid known weight or scale reading");
+        sendText(request, 400, "text/plain", "Invalid known weight or scale reading");
       }
     } else {
-      request->send(400, "text/plain", "Missing 'knownWeight' parameter");
+      sendText(request, 400, "text/plain", "Missing 'knownWeight' parameter");
     }
   });
 
-  server.on("/api/calibrationfactor", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
-    request->send(200, "text/plain", String(scale.getCalibrationFactor(), 6));
+  onRoute("/api/calibrationfactor", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
+    float factor = scale.getCalibrationFactor();
+    sendJson(request, 200, [factor](JsonWriter &json) { json.value(factor, 6); }, "text/plain");
   });
 
   // Scale connection status endpoint
-  server.on("/api/scale/status", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"connected\":" + String(scale.isHX711Connected() ? "true" : "false") + ",";
-    json += "\"weight\":" + String(scale.getCurrentWeight(), 2) + ",";
-    json += "\"raw_value\":" + String(scale.getRawValue()) + ",";
-    json += "\"calibration_factor\":" + String(scale.getCalibrationFactor(), 6);
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/scale/status", HTTP_GET, [&scale, &samplingTask](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [&](JsonWriter &json) {
+      json.beginObject();
+      json.field("connected", scale.isHX711Connected());
+      json.field("weight", samplingTask.getSnapshot().weight, 2);
+      json.field("raw_value", scale.getRawValue());
+      json.field("calibration_factor", scale.getCalibrationFactor(), 6);
+      json.endObject();
+    });
   });
 
-  server.on("/api/wifi-creds", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String ssid = getStoredSSID();
-    String password = getStoredPassword();
-    String json = "{\"ssid\":\"" + ssid + "\",\"password\":\"" + password + "\"}";
-    request->send(200, "application/json", json);
+  onRoute("/api/wifi-creds", HTTP_GET, [](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [](JsonWriter &json) {
+      json.beginObject().field("ssid", getStoredSSID().c_str()).field("password", getStoredPassword().c_str()).endObject();
+    });
   });
 
-  server.on("/api/wifi-creds", HTTP_POST, [](AsyncWebServerRequest *request) {
+  onRoute("/api/wifi-creds", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
     if (request->hasParam("ssid", true) && request->hasParam("password", true)) {
       String ssid = request->getParam("ssid", true)->value();
       String password = request->getParam("password", true)->value();
@@ -403,276 +599,450 @@ void setupWebServer(Scale &scale, FlowRate &flowRate, BluetoothScale &bluetoothS
       // Save credentials first
       saveWiFiCredentials(ssid.c_str(), password.c_str());
       
-      // Attempt immediate STA connection to avoid needing a reboot
-      bool connected = attemptSTAConnection(ssid.c_str(), password.c_str());
-      
-      if (connected) {
-        request->send(200, "application/json", 
-          "{\"status\":\"success\",\"message\":\"Connected successfully! AP mode disabled for power savings.\",\"ip\":\"" + WiFi.localIP().toString() + "\"}");
-      } else {
-        // Connection failed - switch back to AP mode
-        switchToAPMode();
-        request->send(200, "application/json", 
-          "{\"status\":\"failed\",\"message\":\"Connection failed. Check credentials and try again. AP mode restored.\"}");
-      }
+      // Connect from loop() to avoid needing a reboot - AP mode comes back if it fails
+      sendQueued(request, commands.post(ControlCommands::WIFI_CONNECT, ControlCommands::SOURCE_HTTP),
+                 "Connecting to " + ssid + ". If it succeeds the AP is disabled for power savings; "
+                 "otherwise AP mode is restored.");
     } else {
-      request->send(400, "text/plain", "Missing SSID or password");
+      sendText(request, 400, "text/plain", "Missing SSID or password");
     }
   });
 
-  server.on("/api/wifi-creds", HTTP_DELETE, [](AsyncWebServerRequest *request) {
+  onRoute("/api/wifi-creds", HTTP_DELETE, [](AsyncWebServerRequest *request) {
     clearWiFiCredentials();
-    request->send(200, "text/plain", "WiFi credentials cleared. Reboot to apply changes.");
+    sendText(request, 200, "text/plain", "WiFi credentials cleared. Reboot to apply changes.");
   });
 
   // WiFi Power Management endpoints
-  server.on("/api/wifi-status", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"enabled\":" + String(isWiFiEnabled() ? "true" : "false") + ",";
-    json += "\"connected\":" + String((WiFi.status() == WL_CONNECTED) ? "true" : "false");
-    if (WiFi.status() == WL_CONNECTED) {
-      json += ",\"ssid\":\"" + WiFi.SSID() + "\"";
-    }
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/wifi-status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [](JsonWriter &json) {
+      bool connected = WiFi.status() == WL_CONNECTED;
+      json.beginObject();
+      json.field("enabled", isWiFiEnabled());
+      json.field("connected", connected);
+      if (connected) {
+        char ssid[33];
+        json.field("ssid", getConnectedSSID(ssid, sizeof(ssid)));
+      }
+      json.endObject();
+    });
   });
 
-  server.on("/api/wifi-toggle", HTTP_POST, [](AsyncWebServerRequest *request) {
+  onRoute("/api/wifi-toggle", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
     bool currentlyEnabled = isWiFiEnabled() && WiFi.getMode() != WIFI_OFF;
-    
-    if (currentlyEnabled) {
-      // Send response before disabling WiFi
-      request->send(200, "text/plain", "WiFi disabled for battery saving. Device will be inaccessible until WiFi is re-enabled.");
-      // Add delay to allow response to be sent, then disable WiFi
-      delay(100);
-      disableWiFi();
-    } else {
-      enableWiFi();
-      request->send(200, "text/plain", "WiFi enabled");
-    }
+    sendQueued(request, commands.post(ControlCommands::WIFI_TOGGLE, ControlCommands::SOURCE_HTTP),
+               currentlyEnabled ? WIFI_DISABLED_MESSAGE : "WiFi enabled");
   });
 
-  server.on("/api/wifi-enable", HTTP_POST, [](AsyncWebServerRequest *request) {
+  onRoute("/api/wifi-enable", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
     if (request->hasParam("enabled", true)) {
       bool enabled = request->getParam("enabled", true)->value() == "true";
-      if (enabled) {
-        enableWiFi();
-        request->send(200, "text/plain", "WiFi enabled");
-      } else {
-        // Send response before disabling WiFi
-        request->send(200, "text/plain", "WiFi disabled for battery saving. Device will be inaccessible until WiFi is re-enabled.");
-        // Add delay to allow response to be sent, then disable WiFi
-        delay(100);
-        disableWiFi();
-      }
+      sendQueued(request, commands.post(enabled ? ControlCommands::WIFI_ENABLE : ControlCommands::WIFI_DISABLE,
+                                        ControlCommands::SOURCE_HTTP),
+                 enabled ? "WiFi enabled" : WIFI_DISABLED_MESSAGE);
     } else {
-      request->send(400, "text/plain", "Missing enabled parameter");
+      sendText(request, 400, "text/plain", "Missing enabled parameter");
     }
   });
 
   // Device information endpoint
-  server.on("/api/device/info", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"version\":\"" + String(WEIGHMYBRU_VERSION_STRING) + "\",";
-    json += "\"full_version\":\"" + String(WEIGHMYBRU_FULL_VERSION) + "\",";
-    json += "\"board\":\"" + String(WEIGHMYBRU_BOARD_NAME) + "\",";
-    json += "\"build_date\":\"" + String(WEIGHMYBRU_BUILD_DATE) + "\",";
-    json += "\"build_time\":\"" + String(WEIGHMYBRU_BUILD_TIME) + "\",";
-    json += "\"firmware_size\":" + String(ESP.getSketchSize()) + ",";
-    json += "\"free_space\":" + String(ESP.getFreeSketchSpace()) + ",";
-    json += "\"chip_model\":\"" + String(ESP.getChipModel()) + "\",";
-    json += "\"chip_revision\":" + String(ESP.getChipRevision()) + ",";
-    json += "\"cpu_frequency\":" + String(ESP.getCpuFreqMHz()) + ",";
-    json += "\"flash_size\":" + String(ESP.getFlashChipSize()) + ",";
-    json += "\"free_heap\":" + String(ESP.getFreeHeap()) + ",";
-    json += "\"sdk_version\":\"" + String(ESP.getSdkVersion()) + "\"";
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/device/info", HTTP_GET, [](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [](JsonWriter &json) {
+      json.beginObject();
+      json.field("version", WEIGHMYBRU_VERSION_STRING);
+      json.field("full_version", WEIGHMYBRU_FULL_VERSION);
+      json.field("board", WEIGHMYBRU_BOARD_NAME);
+      json.field("build_date", WEIGHMYBRU_BUILD_DATE);
+      json.field("build_time", WEIGHMYBRU_BUILD_TIME);
+      json.field("firmware_size", ESP.getSketchSize());
+      json.field("free_space", ESP.getFreeSketchSpace());
+      json.field("chip_model", ESP.getChipModel());
+      json.field("chip_revision", ESP.getChipRevision());
+      json.field("cpu_frequency", ESP.getCpuFreqMHz());
+      json.field("flash_size", ESP.getFlashChipSize());
+      json.field("free_heap", ESP.getFreeHeap());
+      json.field("sdk_version", ESP.getSdkVersion());
+      json.endObject();
+    });
   });
 
   // Signal strength endpoint for WiFi and Bluetooth monitoring
-  server.on("/api/signal-strength", HTTP_GET, [&bluetoothScale](AsyncWebServerRequest *request) {
-    String json = "{";
-    
-    // WiFi signal strength
-    json += "\"wifi\":" + getWiFiConnectionInfo() + ",";
-    
-    // Bluetooth signal strength
-    json += "\"bluetooth\":" + bluetoothScale.getBluetoothConnectionInfo();
-    
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/signal-strength", HTTP_GET, [&bluetoothScale](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [&bluetoothScale](JsonWriter &json) {
+      json.beginObject();
+      
+      // WiFi signal strength
+      json.beginObject("wifi");
+      writeWiFiConnectionInfo(json);
+      json.endObject();
+      
+      // Bluetooth signal strength
+      json.beginObject("bluetooth");
+      bluetoothScale.writeConnectionInfo(json);
+      json.endObject();
+      
+      json.endObject();
+    });
   });
 
-  server.on("/api/decimal-setting", HTTP_GET, [](AsyncWebServerRequest *request) {
+  onRoute("/api/decimal-setting", HTTP_GET, [](AsyncWebServerRequest *request) {
     int decimals = getCachedDecimals();
-    String json = "{\"decimals\":" + String(decimals) + "}";
-    request->send(200, "application/json", json);
+    sendJson(request, 200, [decimals](JsonWriter &json) {
+      json.beginObject().field("decimals", decimals).endObject();
+    });
   });
 
-  server.on("/api/decimal-setting", HTTP_POST, [](AsyncWebServerRequest *request) {
+  onRoute("/api/decimal-setting", HTTP_POST, [](AsyncWebServerRequest *request) {
     if (request->hasParam("decimals", true)) {
       int decimals = request->getParam("decimals", true)->value().toInt();
       if (decimals < 0) decimals = 0;
       if (decimals > 2) decimals = 2;
       setCachedDecimals(decimals);
-      request->send(200, "text/plain", "Decimal setting saved.");
+      sendText(request, 200, "text/plain", "Decimal setting saved.");
     } else {
-      request->send(400, "text/plain", "Missing decimals parameter");
+      sendText(request, 400, "text/plain", "Missing decimals parameter");
     }
   });
 
-  server.on("/api/flowrate", HTTP_GET, [&flowRate](AsyncWebServerRequest *request) {
-    request->send(200, "text/plain", String(flowRate.getFlowRate(), 1));
+  onRoute("/api/flowrate", HTTP_GET, [&samplingTask](AsyncWebServerRequest *request) {
+    float flow = samplingTask.getSnapshot().flowRate;
+    sendJson(request, 200, [flow](JsonWriter &json) { json.value(flow, 1); }, "text/plain");
   });
 
   // Bluetooth status API
-  server.on("/api/bluetooth/status", HTTP_GET, [&bluetoothScale](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"connected\":" + String(bluetoothScale.isConnected() ? "true" : "false");
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/bluetooth/status", HTTP_GET, [&bluetoothScale](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [&bluetoothScale](JsonWriter &json) {
+      json.beginObject();
+      json.field("connected", bluetoothScale.isConnected());
+      json.field("clients", (unsigned int)bluetoothScale.getClientCount());
+      json.beginObject("notifications");
+      for (int i = 0; i < BluetoothScale::CHANNEL_COUNT; i++) {
+        BluetoothScale::WeightChannel channel = (BluetoothScale::WeightChannel)i;
+        NotificationPolicy policy = bluetoothScale.getNotificationPolicy(channel);
+        uint32_t sent, suppressed;
+        bluetoothScale.getNotificationCounts(channel, sent, suppressed);
+        json.beginObject(BluetoothScale::getChannelName(channel));
+        json.field("enabled", bluetoothScale.isChannelEnabled(channel));
+        json.field("sent", (unsigned long)sent);
+        json.field("suppressed", (unsigned long)suppressed);
+        json.field("deadband", policy.deadbandGrams, 2);
+        json.field("minIntervalMs", policy.minIntervalMs);
+        json.field("keepaliveMs", policy.keepaliveMs);
+        json.endObject();
+      }
+      json.beginObject("batch");
+      json.field("frames", (unsigned long)bluetoothScale.getBatchFramesSent());
+      json.field("samples", (unsigned long)bluetoothScale.getBatchSamplesSent());
+      json.field("intervalMs", (unsigned long)BluetoothScale::BATCH_INTERVAL_MS);
+      json.endObject();
+      json.endObject();
+      bluetoothScale.writeConnections(json);
+      json.endObject();
+    });
+  });
+
+  // Per-characteristic notification policy (runtime only, defaults restored on reboot)
+  onRoute("/api/bluetooth/notify-policy", HTTP_POST, [&bluetoothScale](AsyncWebServerRequest *request) {
+    if (!request->hasParam("channel", true)) {
+      sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Missing channel\"}");
+      return;
+    }
+    String name = request->getParam("channel", true)->value();
+    BluetoothScale::WeightChannel channel = BluetoothScale::CHANNEL_COUNT;
+    for (int i = 0; i < BluetoothScale::CHANNEL_COUNT; i++) {
+      if (name == BluetoothScale::getChannelName((BluetoothScale::WeightChannel)i)) {
+        channel = (BluetoothScale::WeightChannel)i;
+      }
+    }
+    if (channel == BluetoothScale::CHANNEL_COUNT) {
+      sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Unknown channel\"}");
+      return;
+    }
+    NotificationPolicy policy = bluetoothScale.getNotificationPolicy(channel);
+    if (request->hasParam("deadband", true)) {
+      policy.deadbandGrams = request->getParam("deadband", true)->value().toFloat();
+    }
+    if (request->hasParam("minIntervalMs", true)) {
+      policy.minIntervalMs = request->getParam("minIntervalMs", true)->value().toInt();
+    }
+    if (request->hasParam("keepaliveMs", true)) {
+      policy.keepaliveMs = request->getParam("keepaliveMs", true)->value().toInt();
+    }
+    bluetoothScale.setNotificationPolicy(channel, policy);
+    sendText(request, 200, "application/json", "{\"status\":\"success\"}");
+  });
+
+  // Scale protocol codecs - clients cache the GATT layout, so a new selection is only stored here
+  onRoute("/api/bluetooth/codecs", HTTP_GET, [&bluetoothScale](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [&bluetoothScale](JsonWriter &json) {
+      uint8_t stored = bluetoothScale.getStoredCodecs();
+      json.beginObject();
+      json.beginArray("codecs");
+      for (uint8_t i = 0; i < ScaleCodecs::COUNT; i++) {
+        const IScaleCodec* codec = ScaleCodecs::get(i);
+        json.beginObject();
+        json.field("name", codec->getName());
+        json.field("enabled", bluetoothScale.isChannelEnabled(i));
+        json.field("stored", (stored & (1 << i)) != 0);
+        json.field("service", codec->getServiceUuid());
+        json.field("weight", codec->getWeightUuid());
+        if (codec->getCommandUuid() != nullptr) {
+          json.field("command", codec->getCommandUuid());
+        } else {
+          json.nullField("command");
+        }
+        json.endObject();
+      }
+      json.endArray();
+      json.field("restart_required", stored != bluetoothScale.getEnabledCodecs());
+      json.endObject();
+    });
+  });
+
+  onRoute("/api/bluetooth/codecs", HTTP_POST, [&bluetoothScale](AsyncWebServerRequest *request) {
+    if (!request->hasParam("enabled", true)) {
+      sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Missing enabled\"}");
+      return;
+    }
+    String list = request->getParam("enabled", true)->value();
+    uint8_t mask = 0;
+    int start = 0;
+    while (start <= (int)list.length()) {
+      int end = list.indexOf(',', start);
+      if (end < 0) {
+        end = list.length();
+      }
+      uint8_t index = ScaleCodecs::find(list.c_str() + start, end - start);
+      if (index == ScaleCodecs::COUNT) {
+        sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"Unknown codec\"}");
+        return;
+      }
+      mask |= 1 << index;
+      start = end + 1;
+    }
+    if (!bluetoothScale.setStoredCodecs(mask)) {
+      sendText(request, 500, "application/json", "{\"status\":\"error\",\"message\":\"Failed to save\"}");
+      return;
+    }
+    bool restart = mask != bluetoothScale.getEnabledCodecs();
+    sendText(request, 200, "application/json", restart ? "{\"status\":\"success\",\"restart_required\":true}"
+                                                        : "{\"status\":\"success\",\"restart_required\":false}");
   });
 
   // Filter settings API endpoints
-  server.on("/api/filter-settings", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"brewingThreshold\":" + String(scale.getBrewingThreshold(), 2) + ",";
-    json += "\"stabilityTimeout\":" + String(scale.getStabilityTimeout()) + ",";
-    json += "\"medianSamples\":" + String(scale.getMedianSamples()) + ",";
-    json += "\"averageSamples\":" + String(scale.getAverageSamples());
-    json += "}";
-    request->send(200, "application/json", json);
-  });
-
-  server.on("/api/filter-settings", HTTP_POST, [&scale](AsyncWebServerRequest *request) {
-    String response = "{\"status\":\"success\",\"message\":\"";
+  onRoute("/api/filter-settings", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [&scale](JsonWriter &json) {
+      json.beginObject();
+      json.field("brewingThreshold", scale.getBrewingThreshold(), 2);
+      json.field("stabilityTimeout", scale.getStabilityTimeout());
+      json.field("medianSamples", scale.getMedianSamples());
+      json.field("averageSamples", scale.getAverageSamples());
+      json.field("filterMode", Scale::getFilterModeName(scale.getFilterMode()));
+      json.field("kalmanProcessNoise", scale.getKalmanProcessNoise(), 4);
+      json.field("kalmanMeasurementNoise", scale.getKalmanMeasurementNoise(), 4);
+      json.field("flowProfile", FlowRate::getProfileName(scale.getFlowProfile()));
+      json.endObject();
+    });
+  });
+
+  onRoute("/api/filter-settings", HTTP_POST, [&scale](AsyncWebServerRequest *request) {
+    char message[192] = "";
     bool updated = false;
     
     if (request->hasParam("brewingThreshold", true)) {
       float threshold = request->getParam("brewingThreshold", true)->value().toFloat();
       scale.setBrewingThreshold(threshold);
-      response += "Brewing threshold updated. ";
+      strlcat(message, "Brewing threshold updated. ", sizeof(message));
       updated = true;
     }
     if (request->hasParam("stabilityTimeout", true)) {
       unsigned long timeout = request->getParam("stabilityTimeout", true)->value().toInt();
       scale.setStabilityTimeout(timeout);
-      response += "Stability timeout updated. ";
+      strlcat(message, "Stability timeout updated. ", sizeof(message));
       updated = true;
     }
     if (request->hasParam("medianSamples", true)) {
       int samples = request->getParam("medianSamples", true)->value().toInt();
       scale.setMedianSamples(samples);
-      response += "Median samples updated. ";
+      strlcat(message, "Median samples updated. ", sizeof(message));
       updated = true;
     }
     if (request->hasParam("averageSamples", true)) {
       int samples = request->getParam("averageSamples", true)->value().toInt();
       scale.setAverageSamples(samples);
-      response += "Average samples updated. ";
+      strlcat(message, "Average samples updated. ", sizeof(message));
+      updated = true;
+    }
+    if (request->hasParam("filterMode", true)) {
+      String mode = request->getParam("filterMode", true)->value();
+      if (mode == "kalman") {
+        scale.setFilterMode(Scale::FILTER_KALMAN);
+        strlcat(message, "Filter mode updated. ", sizeof(message));
+        updated = true;
+      } else if (mode == "smart") {
+        scale.setFilterMode(Scale::FILTER_SMART);
+        strlcat(message, "Filter mode updated. ", sizeof(message));
+        updated = true;
+      }
+    }
+    if (request->hasParam("kalmanProcessNoise", true)) {
+      float q = request->getParam("kalmanProcessNoise", true)->value().toFloat();
+      scale.setKalmanProcessNoise(q);
+      strlcat(message, "Kalman process noise updated. ", sizeof(message));
+      updated = true;
+    }
+    if (request->hasParam("kalmanMeasurementNoise", true)) {
+      float r = request->getParam("kalmanMeasurementNoise", true)->value().toFloat();
+      scale.setKalmanMeasurementNoise(r);
+      strlcat(message, "Kalman measurement noise updated. ", sizeof(message));
       updated = true;
     }
+    if (request->hasParam("flowProfile", true)) {
+      String profile = request->getParam("flowProfile", true)->value();
+      if (profile == "fast") {
+        scale.setFlowProfile(FlowRate::PROFILE_FAST);
+        strlcat(message, "Flow profile updated. ", sizeof(message));
+        updated = true;
+      } else if (profile == "smooth") {
+        scale.setFlowProfile(FlowRate::PROFILE_SMOOTH);
+        strlcat(message, "Flow profile updated. ", sizeof(message));
+        updated = true;
+      }
+    }
     
     if (updated) {
-      response += "\"}";
-      request->send(200, "application/json", response);
+      sendJson(request, 200, [&message](JsonWriter &json) {
+        json.beginObject().field("status", "success").field("message", message).endObject();
+      });
     } else {
-      request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"No valid parameters provided\"}");
+      sendText(request, 400, "application/json", "{\"status\":\"error\",\"message\":\"No valid parameters provided\"}");
     }
   });
 
   // Filter debug endpoint - shows current filter state
-  server.on("/api/filter-debug", HTTP_GET, [&scale](AsyncWebServerRequest *request) {
-    String json = "{";
-    json += "\"filterState\":\"" + scale.getFilterState() + "\",";
-    json += "\"brewingThreshold\":" + String(scale.getBrewingThreshold(), 2) + ",";
-    json += "\"stabilityTimeout\":" + String(scale.getStabilityTimeout()) + ",";
-    json += "\"medianSamples\":" + String(scale.getMedianSamples()) + ",";
-    json += "\"averageSamples\":" + String(scale.getAverageSamples()) + ",";
-    json += "\"currentWeight\":" + String(scale.getCurrentWeight(), 1);
-    json += "}";
-    request->send(200, "application/json", json);
+  onRoute("/api/filter-debug", HTTP_GET, [&scale, &samplingTask](AsyncWebServerRequest *request) {
+    WeightSnapshot snapshot = samplingTask.getSnapshot();
+    sendJson(request, 200, [&](JsonWriter &json) {
+      json.beginObject();
+      json.field("filterState", Scale::getFilterStateName((Scale::FilterState)snapshot.filterState));
+      json.field("brewingThreshold", scale.getBrewingThreshold(), 2);
+      json.field("stabilityTimeout", scale.getStabilityTimeout());
+      json.field("medianSamples", scale.getMedianSamples());
+      json.field("averageSamples", scale.getAverageSamples());
+      json.field("filterMode", Scale::getFilterModeName(scale.getFilterMode()));
+      json.field("currentWeight", snapshot.weight, 1);
+      json.field("sequence", snapshot.sequence);
+      json.field("capturedSamples", scale.getCapturedSamples());
+      json.field("droppedSamples", scale.getDroppedSamples());
+      json.field("latencyUs", samplingTask.getLastLatencyUs());
+      json.field("maxLatencyUs", samplingTask.getMaxLatencyUs());
+      json.endObject();
+    });
   });
 
   // Combined settings endpoint for faster loading
-  server.on("/api/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
-    // Get WiFi credentials (from cache)
-    String ssid = getStoredSSID();
-    String password = getStoredPassword();
-    
-    // Get decimal setting (from cache)
-    int decimals = getCachedDecimals();
-    
-    // Combine into single JSON response
-    String json = "{";
-    json += "\"ssid\":\"" + ssid + "\",";
-    json += "\"password\":\"" + password + "\",";
-    json += "\"decimals\":" + String(decimals);
-    json += "}";
-    
-    request->send(200, "application/json", json);
+  onRoute("/api/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // WiFi credentials and decimal setting, all from cache, in one response
+    sendJson(request, 200, [](JsonWriter &json) {
+      json.beginObject();
+      json.field("ssid", getStoredSSID().c_str());
+      json.field("password", getStoredPassword().c_str());
+      json.field("decimals", getCachedDecimals());
+      json.endObject();
+    });
   });
 
   // Emergency NVS reset endpoint (use with caution)
-  server.on("/api/reset-nvs", HTTP_POST, [](AsyncWebServerRequest *request) {
+  onRoute("/api/reset-nvs", HTTP_POST, [&commands](AsyncWebServerRequest *request) {
     if (request->hasParam("confirm", true) && request->getParam("confirm", true)->value() == "yes") {
-      Serial.println("Resetting NVS storage...");
-      
-      // Clear all preferences
-      Preferences clearPrefs;
-      clearPrefs.begin("wifi", false);
-      clearPrefs.clear();
-      clearPrefs.end();
-      
-      clearPrefs.begin("display", false);
-      clearPrefs.clear();
-      clearPrefs.end();
-      
-      clearPrefs.begin("scale", false);
-      clearPrefs.clear();
-      clearPrefs.end();
-      
-      request->send(200, "text/plain", "NVS storage reset. Device will restart in 3 seconds.");
-      
-      // Restart the ESP32 after a short delay
-      delay(3000);
-      ESP.restart();
+      // Cleared from loop(), which restarts 3 s later without blocking anything
+      sendQueued(request, commands.post(ControlCommands::RESET_SETTINGS, ControlCommands::SOURCE_HTTP),
+                 "NVS storage reset. Device will restart in 3 seconds.");
     } else {
-      request->send(400, "text/plain", "Missing confirmation parameter. Use 'confirm=yes' to reset NVS.");
+      sendText(request, 400, "text/plain", "Missing confirmation parameter. Use 'confirm=yes' to reset NVS.");
     }
   });
 
-  // Serve static files for non-API paths
-  server.serveStatic("/", LittleFS, "/").setDefaultFile("index.html");
-
-  // 404 Not Found handler for unmatched routes
-  server.onNotFound([](AsyncWebServerRequest *request) {
-    String path = request->url();
-    // If the request is for an API endpoint that doesn't exist, return 404
-    if (path.startsWith("/api/")) {
-      request->send(404, "text/plain", "API endpoint not found");
+  onRoute("/api/commands", HTTP_GET, [&commands](AsyncWebServerRequest *request) {
+    if (request->hasParam("id")) {
+      uint32_t id = (uint32_t)request->getParam("id")->value().toInt();
+      ControlCommands::State state = commands.getState(id);
+      sendJson(request, 200, [id, state](JsonWriter &json) {
+        json.beginObject().field("id", (unsigned long)id).field("state", ControlCommands::getStateName(state)).endObject();
+      });
       return;
     }
-    // For all other unmatched paths, serve index.html (SPA fallback)
-    request->send(LittleFS, "/index.html", "text/html");
+    sendJson(request, 200, [&commands](JsonWriter &json) {
+      commands.writeStatus(json);
+    });
   });
 
-  // Add explicit MIME type handlers for font files
-  server.on("/css/all.min.css", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send(LittleFS, "/css/all.min.css", "text/css");
-  });
-  
-  server.on("/js/alpine.min.js", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send(LittleFS, "/js/alpine.min.js", "application/javascript");
+  // Prometheus scrape: per-route metrics above plus a few global gauges
+  static RouteMetrics::Route* metricsRoute = nullptr;
+  metricsRoute = onRoute("/api/metrics", HTTP_GET, [&liveStream, &brewEvents, &display, &bluetoothScale](AsyncWebServerRequest *request) {
+    std::shared_ptr<RouteMetrics::Cursor> cursor = std::make_shared<RouteMetrics::Cursor>();
+    RouteMetrics::beginScrape(*cursor);
+    size_t slotsInUse = 0;
+    for (size_t i = 0; i < JSON_SLOT_COUNT; i++) {
+      slotsInUse += jsonSlots[i].inUse ? 1 : 0;
+    }
+    RouteMetrics::addGauge(*cursor, "weighmybru_heap_free_bytes", "Free heap", ESP.getFreeHeap());
+    RouteMetrics::addGauge(*cursor, "weighmybru_heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    RouteMetrics::addGauge(*cursor, "weighmybru_heap_largest_free_block_bytes", "Largest allocatable block",
+                           heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    // Handlers run on the async_tcp task, so this is its stack headroom
+    RouteMetrics::addGauge(*cursor, "weighmybru_async_tcp_stack_free_bytes", "Lowest free stack of the async_tcp task",
+                           uxTaskGetStackHighWaterMark(NULL));
+    RouteMetrics::addGauge(*cursor, "weighmybru_json_slots_in_use", "JSON response buffers held by open responses", slotsInUse);
+    RouteMetrics::addGauge(*cursor, "weighmybru_websocket_clients", "Clients on /ws", liveStream.getClientCount());
+    RouteMetrics::addGauge(*cursor, "weighmybru_sse_clients", "Clients on /api/brew/events", brewEvents.getClientCount());
+    RouteMetrics::addGauge(*cursor, "weighmybru_ble_clients", "BLE centrals connected", bluetoothScale.getClientCount());
+    RouteMetrics::addCounter(*cursor, "weighmybru_display_frames_pushed_total", "OLED frames sent to the panel", display.getFramesPushed());
+    RouteMetrics::addCounter(*cursor, "weighmybru_display_frames_skipped_total", "Main view renders skipped as unchanged", display.getFramesSkipped());
+    RouteMetrics::addCounter(*cursor, "weighmybru_display_i2c_bytes_total", "Bytes written to the OLED over I2C", display.getI2CBytes());
+    RouteMetrics::addCounter(*cursor, "weighmybru_display_frames_dropped_total", "OLED frames replaced before the display task sent them", display.getFramesDropped());
+    RouteMetrics::addGauge(*cursor, "weighmybru_display_frame_us", "I2C transfer time of the last OLED frame", display.getLastFrameUs());
+    RouteMetrics::addGauge(*cursor, "weighmybru_display_frame_max_us", "Longest OLED frame transfer since boot", display.getMaxFrameUs());
+    RouteMetrics::addCounter(*cursor, "weighmybru_wifi_reconnect_attempts_total", "WiFi station reconnect attempts", getWiFiReconnectAttempts());
+    RouteMetrics::addCounter(*cursor, "weighmybru_wifi_disconnected_milliseconds_total", "Time the WiFi station spent disconnected", getWiFiDisconnectedMs());
+
+    // Rendered a chunk at a time as the connection drains, never held whole
+    request->send(request->beginChunkedResponse("text/plain; version=0.0.4",
+      [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t written = routeMetrics.render(*cursor, (char*)buffer, maxLen);
+        routeMetrics.addBytes(metricsRoute, written);
+        return written;
+      }));
   });
-  
-  server.on("/webfonts/fa-solid-900.woff2", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send(LittleFS, "/webfonts/fa-solid-900.woff2", "font/woff2");
+
+#if WEIGHMYBRU_PROFILER
+  // loop() and subsystem timing (LoopProfiler.h)
+  onRoute("/api/profile", HTTP_GET, [](AsyncWebServerRequest *request) {
+    sendJson(request, 200, [](JsonWriter &json) {
+      loopProfiler.writeReport(json);
+    });
   });
-  
-  server.on("/webfonts/fa-regular-400.woff2", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send(LittleFS, "/webfonts/fa-regular-400.woff2", "font/woff2");
+#endif
+
+  // Web UI from LittleFS - gzipped, cache-validated by build hash (scripts/web_assets.py)
+  staticAssets.loadBuildHash();
+  staticAssets.setMetrics(&routeMetrics);
+  server.addHandler(&staticAssets);
+
+  // 404 Not Found handler for unmatched routes
+  RouteMetrics::Route* notFoundRoute = routeMetrics.addRoute("notfound", "ANY");
+  server.onNotFound([notFoundRoute](AsyncWebServerRequest *request) {
+    uint32_t start = micros();
+    responseBytes = 0;
+    String path = request->url();
+    // If the request is for an API endpoint that doesn't exist, return 404
+    if (path.startsWith("/api/")) {
+      sendText(request, 404, "text/plain", "API endpoint not found");
+    } else {
+      // For all other unmatched paths, serve index.html (SPA fallback, index.html.gz when compressed)
+      countResponseBytes(staticAssets.sendFile(request, "/index.html"));
+    }
+    routeMetrics.record(notFoundRoute, micros() - start, responseBytes);
   });
 
   // Only start the web server if WiFi is enabled
@@ -3,6 +3,9 @@
 #include <Preferences.h>
 #include <ESPmDNS.h>
 #include "WebServer.h"  // For web server control
+#include "JsonWriter.h"
+#include "esp_wifi.h"
+#include <atomic>
 
 // ESP-IDF includes for advanced WiFi power management (SuperMini antenna fix)
 #ifdef ESP_IDF_VERSION_MAJOR
@@ -41,6 +44,34 @@ static wifi_mode_t previousWiFiMode = WIFI_OFF; // Store previous mode when disa
 unsigned long startAttemptTime = 0;
 const unsigned long timeout = 10000; // 10 seconds
 
+// STA link supervision. WiFi events (event task) only raise flags; maintainWiFi()
+// advances the state machine from loop() and never waits on the radio.
+enum LinkState : uint8_t {
+    LINK_IDLE,       // Not supervising - no credentials, or WiFi just (re)enabled
+    LINK_CONNECTED,
+    LINK_BACKOFF,    // Waiting before the next attempt
+    LINK_CONNECTING  // WiFi.begin() issued, waiting for an IP or a failure event
+};
+static LinkState linkState = LINK_IDLE;
+static unsigned long linkStateSince = 0;
+static unsigned long reconnectBackoffMs = 0;
+static uint8_t failedReconnects = 0;
+static std::atomic<bool> staGotIP(false);
+static std::atomic<bool> staDisconnected(false);
+static volatile uint8_t lastDisconnectReason = 0;
+static bool wifiEventsRegistered = false;
+static WiFiConnectResult connectResult = WIFI_CONNECT_IDLE; // Last attemptSTAConnection()
+// Reported via getWiFiReconnectAttempts() / getWiFiDisconnectedMs()
+static uint32_t reconnectAttempts = 0;
+static uint32_t disconnectedTotalMs = 0;
+static unsigned long disconnectedSince = 0;
+static bool linkDown = false;
+const unsigned long RECONNECT_BACKOFF_MIN_MS = 1000;
+const unsigned long RECONNECT_BACKOFF_MAX_MS = 60000;
+const unsigned long RECONNECT_TIMEOUT_MS = 10000;
+const uint8_t AP_FALLBACK_AFTER_FAILURES = 3; // Bring up the config AP, keep retrying STA behind it
+static void setLinkState(LinkState state);
+
 void checkFilesystemStatus() {
     if (filesystemChecked) {
         return; // Already checked
@@ -202,7 +233,7 @@ void loadWiFiCredentials(char* ssid, char* password, size_t maxLen) {
     password[maxLen - 1] = '\0';
 }
 
-String getStoredSSID() {
+const String& getStoredSSID() {
     // Fast path - return immediately if already cached and recent
     if (credentialsCached && (millis() - lastCacheTime < CACHE_TIMEOUT)) {
         return cachedSSID;
@@ -213,7 +244,7 @@ String getStoredSSID() {
     return cachedSSID;
 }
 
-String getStoredPassword() {
+const String& getStoredPassword() {
     // Fast path - return immediately if already cached and recent
     if (credentialsCached && (millis() - lastCacheTime < CACHE_TIMEOUT)) {
         return cachedPassword;
@@ -224,7 +255,23 @@ String getStoredPassword() {
     return cachedPassword;
 }
 
-void setupWiFi() {
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        staGotIP = true;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        lastDisconnectReason = info.wifi_sta_disconnected.reason;
+        staDisconnected = true;
+    }
+}
+
+void setupWiFi(uint8_t channel, const uint8_t* bssid) {
+    // Reconnection is driven by maintainWiFi() with backoff, not by the core's immediate retry
+    if (!wifiEventsRegistered) {
+        WiFi.onEvent(onWiFiEvent);
+        wifiEventsRegistered = true;
+    }
+    WiFi.setAutoReconnect(false);
+    
     // Check if WiFi should be enabled
     if (!loadWiFiEnabledState()) {
         Serial.println("WiFi is disabled - skipping WiFi setup for battery saving");
@@ -236,12 +283,11 @@ void setupWiFi() {
     char password[65] = {0};
     loadWiFiCredentials(ssid, password, sizeof(ssid));
     
-    // Ensure WiFi is completely reset first
+    // Ensure WiFi is completely reset first - mode() returns once the driver has stopped
     Serial.println("=== WIFI ANTENNA OPTIMIZATION ===");
     Serial.println("Resetting WiFi subsystem...");
     WiFi.disconnect(true);
     WiFi.mode(WIFI_OFF);
-    delay(500); // Longer delay for complete reset
     
     // Apply SuperMini antenna fix for boards with poor antenna design
     applySuperMiniAntennaFix();
@@ -254,7 +300,6 @@ void setupWiFi() {
         
         // Try STA mode first for lower power consumption
         WiFi.mode(WIFI_STA);
-        delay(1000); // Ensure mode switch is stable
         
         // ANTENNA FIX: Reapply power settings after mode switch for SuperMini boards
         // Mode switch can reset power levels, so reapply the fix
@@ -263,59 +308,33 @@ void setupWiFi() {
         }
         
         startAttemptTime = millis();
-        WiFi.begin(ssid, password);
-        
-        // Wait for connection with reasonable timeout
-        int connectionAttempts = 0;
-        const int maxAttempts = 24; // 12 seconds total - more time for reliable connection
-        
-        Serial.print("Connecting");
-        while (WiFi.status() != WL_CONNECTED && connectionAttempts < maxAttempts) {
-            delay(500);
-            Serial.print(".");
-            connectionAttempts++;
-            
-            // Check for immediate connection failures
-            if (WiFi.status() == WL_NO_SSID_AVAIL) {
-                Serial.println("\nNetwork '" + String(ssid) + "' not found");
-                break;
-            }
-            if (WiFi.status() == WL_CONNECT_FAILED) {
-                Serial.println("\nConnection failed - likely incorrect password");
-                break;
-            }
-        }
-        
-        if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("\nSTA CONNECTION SUCCESSFUL!");
-            Serial.println("===========================");
-            Serial.println("Connected to: " + String(ssid));
-            Serial.println("IP Address: " + WiFi.localIP().toString());
-            Serial.println("Gateway: " + WiFi.gatewayIP().toString());
-            Serial.println("DNS: " + WiFi.dnsIP().toString());
-            Serial.println("Signal: " + String(WiFi.RSSI()) + " dBm");
-            Serial.println("AP mode disabled - optimized for low power");
-            Serial.println("Will auto-fallback to AP if connection lost");
-            Serial.println("===========================");
-            
-            // Setup mDNS for STA mode
-            setupmDNS();
-            
-            return; // Exit early - we're connected via STA, no need for AP
+        staGotIP = false;
+        staDisconnected = false;
+        if (channel != 0 && bssid != nullptr) {
+            // Access point from before deep sleep - skips the channel scan
+            Serial.printf("Fast connect: channel %u, BSSID %02X:%02X:%02X:%02X:%02X:%02X\n", (unsigned)channel,
+                          bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+            WiFi.begin(ssid, password, channel, bssid);
+            // A stale hint gets one plain retry before the AP comes up
+            failedReconnects = AP_FALLBACK_AFTER_FAILURES - 2;
         } else {
-            Serial.println("\nSTA CONNECTION FAILED");
-            Serial.println("Status code: " + String(WiFi.status()));
-            Serial.println("Falling back to AP mode for configuration...");
+            WiFi.begin(ssid, password);
+            failedReconnects = AP_FALLBACK_AFTER_FAILURES - 1;
         }
+        
+        // maintainWiFi() takes it from here: it picks up the IP from loop() and starts
+        // the config AP if this attempt fails, so boot no longer waits on the router
+        Serial.println("Connecting in the background - AP mode follows if this attempt fails");
+        setLinkState(LINK_CONNECTING);
+        return;
     } else {
         Serial.println("=== NO STORED CREDENTIALS ===");
         Serial.println("No WiFi credentials found - starting AP mode for initial setup");
     }
     
-    // Fallback to AP mode if STA failed or no credentials exist
+    // No credentials - AP mode for setup (a failed STA attempt gets here via maintainWiFi())
     Serial.println("Starting AP mode...");
     WiFi.mode(WIFI_AP);
-    delay(1000); // Ensure mode switch is stable
     
     // Configure AP with optimized settings for maximum visibility
     WiFi.softAPConfig(IPAddress(192, 168, 4, 1), IPAddress(192, 168, 4, 1), IPAddress(255, 255, 255, 0));
@@ -396,12 +415,163 @@ void printWiFiStatus() {
     Serial.println("==================");
 }
 
+static void setLinkState(LinkState state) {
+    linkState = state;
+    linkStateSince = millis();
+}
+
+static void markLinkDown() {
+    if (!linkDown) {
+        linkDown = true;
+        disconnectedSince = millis();
+    }
+}
+
+static void markLinkUp() {
+    if (linkDown) {
+        linkDown = false;
+        disconnectedTotalMs += millis() - disconnectedSince;
+    }
+}
+
+// Config AP next to the STA interface, so a failed STA attempt never leaves the scale unreachable
+static void startFallbackAP() {
+    if (WiFi.getMode() == WIFI_AP_STA || WiFi.getMode() == WIFI_AP) {
+        return;
+    }
+    WiFi.mode(WIFI_AP_STA);
+    if (WiFi.softAP(ap_ssid, ap_password, 6, false, 4) || WiFi.softAP(ap_ssid)) {
+        Serial.println("WiFi: STA unreachable - 'WeighMyBru-AP' up at " + WiFi.softAPIP().toString() + ", still retrying STA");
+        setupmDNS();
+    } else {
+        Serial.println("WiFi: ERROR - fallback AP failed to start");
+    }
+}
+
+static void stopFallbackAP() {
+    if (WiFi.getMode() == WIFI_AP_STA) {
+        WiFi.softAPdisconnect(true);
+        WiFi.mode(WIFI_STA);
+        Serial.println("WiFi: STA back - fallback AP stopped");
+    }
+}
+
+static void startConnecting(const char* ssid, const char* password) {
+    if (WiFi.getMode() == WIFI_AP) {
+        WiFi.mode(WIFI_AP_STA);
+    }
+    staGotIP = false;
+    staDisconnected = false;
+    WiFi.begin(ssid, password);
+    setLinkState(LINK_CONNECTING);
+}
+
+static void beginReconnect() {
+    const String& ssid = getStoredSSID();
+    if (ssid.isEmpty()) {
+        startFallbackAP(); // Credentials were cleared - nothing to reconnect to
+        setLinkState(LINK_IDLE);
+        return;
+    }
+    // Don't pull the config AP from under a connected client - STA retries hop channels
+    if (WiFi.getMode() != WIFI_STA && WiFi.softAPgetStationNum() > 0) {
+        setLinkState(LINK_BACKOFF);
+        return;
+    }
+    reconnectAttempts++;
+    Serial.printf("WiFi: reconnect attempt %u to %s\n", (unsigned)reconnectAttempts, ssid.c_str());
+    startConnecting(ssid.c_str(), getStoredPassword().c_str());
+}
+
+static void reconnectFailed() {
+    failedReconnects++;
+    markLinkDown(); // Also counts a boot attempt that never connected
+    WiFi.disconnect(false); // Abandon this attempt, keep the STA interface
+    reconnectBackoffMs = reconnectBackoffMs == 0 ? RECONNECT_BACKOFF_MIN_MS
+                                                 : min(reconnectBackoffMs * 2, RECONNECT_BACKOFF_MAX_MS);
+    Serial.printf("WiFi: reconnect failed (reason %u), next try in %lus\n",
+                  (unsigned)lastDisconnectReason, reconnectBackoffMs / 1000);
+    if (failedReconnects >= AP_FALLBACK_AFTER_FAILURES) {
+        startFallbackAP();
+    }
+    if (connectResult == WIFI_CONNECT_RUNNING) {
+        connectResult = WIFI_CONNECT_FAILED;
+    }
+    setLinkState(LINK_BACKOFF);
+}
+
+static void updateLink() {
+    unsigned long now = millis();
+    switch (linkState) {
+        case LINK_IDLE:
+            if (WiFi.isConnected()) {
+                markLinkUp();
+                staDisconnected = false;
+                setLinkState(LINK_CONNECTED);
+            } else if (!getStoredSSID().isEmpty()) {
+                // Boot ended in AP mode, or WiFi was re-enabled: retry STA in the background
+                markLinkDown();
+                reconnectBackoffMs = RECONNECT_BACKOFF_MIN_MS;
+                failedReconnects = AP_FALLBACK_AFTER_FAILURES;
+                setLinkState(LINK_BACKOFF);
+            }
+            break;
+            
+        case LINK_CONNECTED:
+            if (staDisconnected.exchange(false) || !WiFi.isConnected()) {
+                Serial.printf("WiFi: STA link lost (reason %u) - reconnecting in the background\n",
+                              (unsigned)lastDisconnectReason);
+                markLinkDown();
+                failedReconnects = 0;
+                reconnectBackoffMs = 0;
+                beginReconnect(); // First retry right away
+            }
+            break;
+            
+        case LINK_BACKOFF:
+            staDisconnected = false; // Our own disconnect() reports here too
+            if (WiFi.isConnected()) {
+                setLinkState(LINK_CONNECTING); // Late success - confirmed on the next call
+            } else if (now - linkStateSince >= reconnectBackoffMs) {
+                beginReconnect();
+            }
+            break;
+            
+        case LINK_CONNECTING:
+            // A requested switch starts on the old network, so only its own GOT_IP counts
+            if (staGotIP.exchange(false) || (connectResult != WIFI_CONNECT_RUNNING && WiFi.isConnected())) {
+                markLinkUp();
+                failedReconnects = 0;
+                reconnectBackoffMs = 0;
+                stopFallbackAP();
+                Serial.println(String(reconnectAttempts == 0 ? "WiFi: STA connected" : "WiFi: STA reconnected") +
+                               " to " + WiFi.SSID() + " - IP " + WiFi.localIP().toString() +
+                               ", RSSI " + String(WiFi.RSSI()) + " dBm");
+                setupmDNS();
+                staDisconnected = false;
+                if (connectResult == WIFI_CONNECT_RUNNING) {
+                    connectResult = WIFI_CONNECT_OK;
+                }
+                setLinkState(LINK_CONNECTED);
+            } else if ((staDisconnected.exchange(false) && lastDisconnectReason != WIFI_REASON_ASSOC_LEAVE) ||
+                       now - linkStateSince >= RECONNECT_TIMEOUT_MS) {
+                // ASSOC_LEAVE is us leaving the previous network, not this attempt failing
+                reconnectFailed();
+            }
+            break;
+    }
+}
+
 void maintainWiFi() {
     // Skip maintenance if WiFi is disabled
     if (!isWiFiEnabled()) {
+        markLinkUp(); // Switched off on purpose - not counted as disconnected
+        linkState = LINK_IDLE;
         return;
     }
     
+    updateLink();
+    
     static unsigned long lastMaintenance = 0;
     const unsigned long maintenanceInterval = 15000; // Every 15 seconds for more responsive switching
     
@@ -411,45 +581,11 @@ void maintainWiFi() {
         // Check current WiFi mode and connection health
         wifi_mode_t currentMode = WiFi.getMode();
         
-        if (currentMode == WIFI_STA) {
-            // We're in STA mode - check if connection is still healthy
-            if (WiFi.status() != WL_CONNECTED) {
-                Serial.println("WARNING: STA connection lost! Attempting immediate reconnection...");
-                
-                // Try to reconnect to saved credentials
-                char ssid[33] = {0};
-                char password[65] = {0};
-                loadWiFiCredentials(ssid, password, sizeof(ssid));
-                
-                if (strlen(ssid) > 0) {
-                    Serial.println("Attempting to reconnect to: " + String(ssid));
-                    WiFi.begin(ssid, password);
-                    
-                    // Wait briefly for reconnection - reduced timeout for faster fallback
-                    int attempts = 0;
-                    while (WiFi.status() != WL_CONNECTED && attempts < 6) { // 3 second timeout
-                        delay(500);
-                        Serial.print(".");
-                        attempts++;
-                    }
-                    
-                    if (WiFi.status() == WL_CONNECTED) {
-                        Serial.println("\nSTA reconnection successful");
-                        Serial.println("IP: " + WiFi.localIP().toString());
-                    } else {
-                        Serial.println("\nSTA reconnection failed - switching to AP mode immediately");
-                        switchToAPMode();
-                    }
-                } else {
-                    Serial.println("No stored credentials - switching to AP mode");
-                    switchToAPMode();
-                }
-            } else {
-                Serial.println("STA mode healthy - connection maintained");
-                Serial.println("Connected to: " + WiFi.SSID() + " | IP: " + WiFi.localIP().toString() + " | RSSI: " + String(WiFi.RSSI()) + "dBm");
-            }
-        } else if (currentMode == WIFI_AP) {
-            // We're in AP mode - just ensure it's still running properly
+        if (linkState == LINK_CONNECTED) {
+            Serial.println("STA mode healthy - connection maintained");
+            Serial.println("Connected to: " + WiFi.SSID() + " | IP: " + WiFi.localIP().toString() + " | RSSI: " + String(WiFi.RSSI()) + "dBm");
+        } else if (currentMode == WIFI_AP || currentMode == WIFI_AP_STA) {
+            // AP is up - for configuration, or as fallback while STA retries
             if (WiFi.softAPgetStationNum() == 0) {
                 Serial.println("AP mode active - 'WeighMyBru-AP' ready for configuration");
             } else {
@@ -457,7 +593,12 @@ void maintainWiFi() {
             }
         } else if (currentMode == WIFI_OFF) {
             Serial.println("CRITICAL: WiFi is OFF! This should not happen - restarting AP mode");
-            switchToAPMode();
+            startFallbackAP();
+        }
+        
+        if (linkDown) {
+            Serial.printf("WiFi: STA down for %lus, %u reconnect attempts so far\n",
+                          (millis() - disconnectedSince) / 1000, (unsigned)reconnectAttempts);
         }
         
         // Ensure WiFi sleep stays enabled for BLE coexistence
@@ -471,76 +612,46 @@ void maintainWiFi() {
     }
 }
 
-// Function to attempt STA connection with new credentials and switch from AP mode
-bool attemptSTAConnection(const char* ssid, const char* password) {
+uint32_t getWiFiReconnectAttempts() {
+    return reconnectAttempts;
+}
+
+uint32_t getWiFiDisconnectedMs() {
+    return disconnectedTotalMs + (linkDown ? millis() - disconnectedSince : 0);
+}
+
+WiFiConnectResult getWiFiConnectResult() {
+    return connectResult;
+}
+
+// Join a network with new credentials. maintainWiFi() finishes the attempt: the config AP
+// stays up until the IP arrives and comes back if it fails; getWiFiConnectResult() reports it
+void attemptSTAConnection(const char* ssid, const char* password) {
     Serial.println("=== ATTEMPTING STA CONNECTION ===");
     Serial.println("SSID: " + String(ssid));
-    Serial.println("Switching from AP mode to STA mode...");
     
-    // Disconnect from AP mode but keep WiFi on
-    WiFi.mode(WIFI_STA);
-    delay(1000); // Allow mode switch to stabilize
+    if (WiFi.getMode() == WIFI_OFF) {
+        WiFi.mode(WIFI_STA);
+    }
     
     // ANTENNA FIX: Reapply power settings after mode switch for SuperMini boards
     if (ENABLE_SUPERMINI_ANTENNA_FIX) {
-        Serial.println("Reapplying SuperMini antenna fix after mode switch...");
         applySuperMiniAntennaFix();
     }
     
-    // Attempt connection with new credentials
-    startAttemptTime = millis();
-    WiFi.begin(ssid, password);
-    
-    // Wait for connection with reasonable timeout
-    int connectionAttempts = 0;
-    const int maxAttempts = 30; // 15 seconds total - more generous for initial connection
-    
-    Serial.print("Connecting");
-    while (WiFi.status() != WL_CONNECTED && connectionAttempts < maxAttempts) {
-        delay(500);
-        Serial.print(".");
-        connectionAttempts++;
-        
-        // Check for immediate connection failures
-        if (WiFi.status() == WL_NO_SSID_AVAIL) {
-            Serial.println("\nSSID not found");
-            return false;
-        }
-        if (WiFi.status() == WL_CONNECT_FAILED) {
-            Serial.println("\nConnection failed - likely wrong password");
-            return false;
-        }
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("\nSTA CONNECTION SUCCESSFUL!");
-        Serial.println("Connected to: " + String(ssid));
-        Serial.println("IP Address: " + WiFi.localIP().toString());
-        Serial.println("Gateway: " + WiFi.gatewayIP().toString());
-        Serial.println("RSSI: " + String(WiFi.RSSI()) + " dBm");
-        Serial.println("AP mode disabled - power consumption optimized");
-        
-        // Setup mDNS for the new STA connection
-        setupmDNS();
-        
-        return true;
-    } else {
-        Serial.println("\nSTA connection failed or timed out");
-        Serial.println("Status code: " + String(WiFi.status()));
-        return false;
+    if (WiFi.isConnected()) {
+        WiFi.disconnect(false); // Leave the old network, keep the STA interface
     }
+    connectResult = WIFI_CONNECT_RUNNING;
+    failedReconnects = AP_FALLBACK_AFTER_FAILURES - 1; // One failure brings the config AP up
+    reconnectBackoffMs = 0;
+    startConnecting(ssid, password);
 }
 
-// Function to switch back to AP mode if STA connection fails
+// AP-only mode for configuration; maintainWiFi() keeps retrying any stored network behind it
 void switchToAPMode() {
     Serial.println("=== SWITCHING TO AP MODE ===");
-    Serial.println("Disconnecting from STA mode...");
-    WiFi.disconnect(true);
-    delay(500);
-    
-    Serial.println("Setting AP mode...");
-    WiFi.mode(WIFI_AP);
-    delay(1000); // Allow mode switch to stabilize
+    WiFi.mode(WIFI_AP); // Returns once the driver has switched - stops the STA interface too
     
     // Restart AP with same settings as setupWiFi()
     Serial.println("Starting AP broadcast...");
@@ -568,6 +679,7 @@ void switchToAPMode() {
             Serial.println("FATAL: Cannot start AP mode - WiFi hardware issue?");
         }
     }
+    setLinkState(LINK_IDLE);
 }
 
 // Apply SuperMini antenna fix for boards with poor antenna design
@@ -608,7 +720,7 @@ int getWiFiSignalStrength() {
 }
 
 // Get WiFi signal quality description
-String getWiFiSignalQuality() {
+const char* getWiFiSignalQuality() {
     if (WiFi.status() != WL_CONNECTED) {
         return "Disconnected";
     }
@@ -630,39 +742,64 @@ String getWiFiSignalQuality() {
     }
 }
 
-// Get detailed WiFi connection information
-String getWiFiConnectionInfo() {
-    String info = "{";
+// SSID of the joined network, read from the driver without a String copy
+const char* getConnectedSSID(char* buffer, size_t size) {
+    wifi_ap_record_t apInfo;
+    if (size == 0) {
+        return buffer;
+    }
+    buffer[0] = '\0';
+    if (esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK) {
+        strlcpy(buffer, (const char*)apInfo.ssid, size);
+    }
+    return buffer;
+}
+
+static void formatIP(char* buffer, size_t size, const IPAddress& ip) {
+    snprintf(buffer, size, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+// Write detailed WiFi connection information as fields of the current object
+void writeWiFiConnectionInfo(JsonWriter& json) {
+    char text[33];
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    char macText[18];
+    snprintf(macText, sizeof(macText), "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     
     if (WiFi.status() == WL_CONNECTED) {
-        info += "\"connected\":true,";
-        info += "\"mode\":\"STA\",";
-        info += "\"ssid\":\"" + WiFi.SSID() + "\",";
-        info += "\"signal_strength\":" + String(WiFi.RSSI()) + ",";
-        info += "\"signal_quality\":\"" + getWiFiSignalQuality() + "\",";
-        info += "\"channel\":" + String(WiFi.channel()) + ",";
-        info += "\"tx_power\":" + String(WiFi.getTxPower()) + ",";
-        info += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-        info += "\"gateway\":\"" + WiFi.gatewayIP().toString() + "\",";
-        info += "\"dns\":\"" + WiFi.dnsIP().toString() + "\",";
-        info += "\"mac\":\"" + WiFi.macAddress() + "\"";
+        json.field("connected", true);
+        json.field("mode", "STA");
+        json.field("ssid", getConnectedSSID(text, sizeof(text)));
+        json.field("signal_strength", (int)WiFi.RSSI());
+        json.field("signal_quality", getWiFiSignalQuality());
+        json.field("channel", (int)WiFi.channel());
+        json.field("tx_power", (int)WiFi.getTxPower());
+        formatIP(text, sizeof(text), WiFi.localIP());
+        json.field("ip", text);
+        formatIP(text, sizeof(text), WiFi.gatewayIP());
+        json.field("gateway", text);
+        formatIP(text, sizeof(text), WiFi.dnsIP());
+        json.field("dns", text);
+        json.field("mac", macText);
     } else {
-        info += "\"connected\":false,";
-        info += "\"mode\":\"AP\",";
-        info += "\"ssid\":\"" + String(ap_ssid) + "\",";
-        info += "\"signal_strength\":null,";
-        info += "\"signal_quality\":\"N/A - AP Mode\",";
-        info += "\"channel\":" + String(WiFi.channel()) + ",";
-        info += "\"tx_power\":" + String(WiFi.getTxPower()) + ",";
-        info += "\"ip\":\"" + WiFi.softAPIP().toString() + "\",";
-        info += "\"gateway\":\"N/A\",";
-        info += "\"dns\":\"N/A\",";
-        info += "\"mac\":\"" + WiFi.macAddress() + "\",";
-        info += "\"connected_clients\":" + String(WiFi.softAPgetStationNum());
-    }
-    
-    info += "}";
-    return info;
+        json.field("connected", false);
+        json.field("mode", "AP");
+        json.field("ssid", ap_ssid);
+        json.nullField("signal_strength");
+        json.field("signal_quality", "N/A - AP Mode");
+        json.field("channel", (int)WiFi.channel());
+        json.field("tx_power", (int)WiFi.getTxPower());
+        formatIP(text, sizeof(text), WiFi.softAPIP());
+        json.field("ip", text);
+        json.field("gateway", "N/A");
+        json.field("dns", "N/A");
+        json.field("mac", macText);
+        json.field("connected_clients", (int)WiFi.softAPgetStationNum());
+    }
+    json.field("reconnect_attempts", getWiFiReconnectAttempts());
+    json.field("disconnected_ms", getWiFiDisconnectedMs());
 }
 
 // WiFi Power Management Functions
@@ -733,25 +870,22 @@ void enableWiFi() {
     
     // If WiFi was previously off, restore it
     if (WiFi.getMode() == WIFI_OFF) {
-        // Try to restore to STA mode first if we have credentials
+        // Saved network first - maintainWiFi() brings the AP up if it cannot be joined
         if (loadWiFiCredentialsFromEEPROM() && !cachedSSID.isEmpty()) {
-            Serial.println("Attempting to reconnect to saved network...");
-            if (attemptSTAConnection(cachedSSID.c_str(), cachedPassword.c_str())) {
-                Serial.println("WiFi reconnected to STA mode");
-                startWebServer(); // Start web server when WiFi is enabled
-                return;
-            }
+            Serial.println("Reconnecting to saved network in the background...");
+            attemptSTAConnection(cachedSSID.c_str(), cachedPassword.c_str());
+        } else {
+            Serial.println("Starting WiFi in AP mode...");
+            switchToAPMode();
         }
-        
-        // Fall back to AP mode if STA connection fails
-        Serial.println("Starting WiFi in AP mode...");
-        switchToAPMode();
         startWebServer(); // Start web server when WiFi is enabled
     }
     
     Serial.println("WiFi enabled");
 }
 
+// Runs from loop() after the HTTP response has gone out (ControlCommands) or from the
+// touch handler, so there are no responses left to wait for
 void disableWiFi() {
     Serial.println("Disabling WiFi to save battery...");
     
@@ -764,12 +898,6 @@ void disableWiFi() {
     // Save the disabled state
     saveWiFiEnabledState(false);
     
-    // Gracefully close active connections before disabling WiFi
-    Serial.println("Closing active connections...");
-    
-    // Give time for current HTTP responses to complete
-    delay(100);
-    
     // Properly disconnect based on current mode
     if (previousWiFiMode == WIFI_STA || previousWiFiMode == WIFI_AP_STA) {
         Serial.println("Disconnecting from STA...");
@@ -781,11 +909,12 @@ void disableWiFi() {
         WiFi.softAPdisconnect(true);
     }
     
-    // Additional delay to ensure cleanup
-    delay(200);
-    
-    // Now safely turn off WiFi
+    // Now turn off WiFi - mode() returns once the driver has stopped
     WiFi.mode(WIFI_OFF);
+    if (connectResult == WIFI_CONNECT_RUNNING) {
+        connectResult = WIFI_CONNECT_FAILED;
+    }
+    setLinkState(LINK_IDLE);
     
     Serial.println("WiFi disabled - battery saving mode active");
 }
@@ -13,6 +13,16 @@
 #include "Display.h"
 #include "PowerManager.h"
 #include "BatteryMonitor.h"
+#include "SamplingTask.h"
+#include "TraceRecorder.h"
+#include "LiveStream.h"
+#include "BrewEvents.h"
+#include "LoopProfiler.h"
+#include "BootSequencer.h"
+#include "ControlCommands.h"
+#include "HX711Capture.h"
+#include "ArduinoClock.h"
+#include "PreferencesSettingsStore.h"
 #include "BoardConfig.h"
 #include "Version.h"
 
@@ -25,13 +35,26 @@ uint8_t batteryPin = BATTERY_PIN;     // Battery voltage monitoring
 uint8_t sdaPin = I2C_SDA_PIN;         // I2C Data pin for display
 uint8_t sclPin = I2C_SCL_PIN;         // I2C Clock pin for display
 float calibrationFactor = 4195.712891;
-Scale scale(dataPin, clockPin, calibrationFactor);
+ArduinoClock systemClock;
+HX711Capture loadCell(dataPin, clockPin);
+PreferencesSettingsStore scaleSettings;
+Scale scale(loadCell, scaleSettings, systemClock, calibrationFactor);
 FlowRate flowRate;
 BluetoothScale bluetoothScale;
 TouchSensor touchSensor(touchPin, &scale);
 Display oledDisplay(sdaPin, sclPin, &scale, &flowRate);
 PowerManager powerManager(sleepTouchPin, &oledDisplay);
 BatteryMonitor batteryMonitor(batteryPin);
+SamplingTask samplingTask(&scale, &flowRate);
+TraceRecorder traceRecorder;
+LiveStream liveStream(scale, samplingTask, flowRate, oledDisplay, batteryMonitor, bluetoothScale);
+BrewEvents brewEvents(samplingTask, oledDisplay);
+BootSequencer bootSequencer(scale, samplingTask);
+ControlCommands controlCommands(scale, oledDisplay, flowRate, bluetoothScale);
+#if WEIGHMYBRU_PROFILER
+LoopProfiler loopProfiler;
+#endif
+const size_t TRACE_BUFFER_BYTES = 512 * 1024; // 65536 samples: ~13 min at 80 SPS
 
 void setup() {
   Serial.begin(115200);
@@ -45,6 +68,9 @@ void setup() {
   Serial.printf("Flash Size: %dMB\n", FLASH_SIZE_MB);
   Serial.println("=================================");
   
+  // Wake cause and fast-wake state (tare, WiFi AP) kept in RTC memory over deep sleep
+  bootSequencer.begin();
+  
   // Link scale and flow rate for tare operation coordination
   scale.setFlowRatePtr(&flowRate);
   
@@ -56,72 +82,59 @@ void setup() {
     delay(1000);
   }
   
-  // CRITICAL: Initialize BLE FIRST before WiFi to prevent radio conflicts
-  Serial.println("Initializing BLE FIRST for GaggiMate compatibility...");
-  Serial.printf("Free heap before BLE init: %u bytes\n", ESP.getFreeHeap());
-  Serial.printf("Free PSRAM before BLE init: %u bytes\n", ESP.getFreePsram());
-  
-  try {
-    bluetoothScale.begin();  // Initialize BLE without scale reference
-    Serial.println("BLE initialized successfully - GaggiMate should be able to connect");
-    Serial.printf("Free heap after BLE init: %u bytes\n", ESP.getFreeHeap());
-    Serial.printf("Free PSRAM after BLE init: %u bytes\n", ESP.getFreePsram());
-  } catch (...) {
-    Serial.println("BLE initialization failed - continuing without Bluetooth");
-    Serial.printf("Free heap after BLE fail: %u bytes\n", ESP.getFreeHeap());
-  }
+  // HX711 and display only talk to their own pins - probe them in the background
+  // while the radios come up, instead of serially with fixed waits in between
+  bootSequencer.start(BootSequencer::STAGE_SCALE, []() -> bool {
+    // After a deep sleep wake the zero from before sleep still holds - skip the blocking tare
+    int32_t tareOffset;
+    bool restoreTare = bootSequencer.getTareOffset(tareOffset);
+    if (!scale.begin(!restoreTare)) {
+      return false;
+    }
+    if (restoreTare) {
+      scale.setOffset(tareOffset);
+      Serial.println("Tare offset restored from before sleep: " + String(tareOffset));
+    }
+    return true;
+  });
+  bootSequencer.start(BootSequencer::STAGE_DISPLAY, []() -> bool {
+    return oledDisplay.begin();
+  });
   
-  // Initialize display with error handling - don't block if display fails
-  Serial.println("Initializing display...");
-  bool displayAvailable = oledDisplay.begin();
-  
-  if (!displayAvailable) {
-    Serial.println("WARNING: Display initialization failed!");
-    Serial.println("System will continue in headless mode without display.");
-    Serial.println("All functionality remains available via web interface.");
-  } else {
-    Serial.println("Display initialized - ready for visual feedback");
-  }
-  
-  // Check wake-up reason and show appropriate message
-  esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
-  switch(wakeup_reason) {
-    case ESP_SLEEP_WAKEUP_EXT0:
-      Serial.println("Wakeup caused by external signal (touch sensor)");
-      // Show the same starting message as normal boot for consistency
-      delay(1500);
-      break;
-    case ESP_SLEEP_WAKEUP_EXT1:
-      Serial.println("Wakeup caused by external signal using RTC_CNTL");
-      break;
-    case ESP_SLEEP_WAKEUP_TIMER:
-      Serial.println("Wakeup caused by timer");
-      break;
-    case ESP_SLEEP_WAKEUP_TOUCHPAD:
-      Serial.println("Wakeup caused by touchpad");
-      break;
-    default:
-      Serial.println("Wakeup was not caused by deep sleep: " + String(wakeup_reason));
-      // For normal startup, the begin() method already shows a startup message
-      delay(1000);
-      break;
-  }
-  //Wait for BLE to finish intitalizing before starting WiFi
-  delay(1500); 
-  
-  // ALWAYS enable WiFi power management for optimal battery life
-  // This works regardless of WiFi mode (STA/AP/OFF) and should be set early
-  WiFi.setSleep(true);
-  Serial.println("WiFi power management enabled for battery optimization");
+  // CRITICAL: Initialize BLE FIRST before WiFi to prevent radio conflicts
+  bootSequencer.run(BootSequencer::STAGE_BLE, []() -> bool {
+    Serial.println("Initializing BLE FIRST for GaggiMate compatibility...");
+    Serial.printf("Free heap before BLE init: %u bytes\n", ESP.getFreeHeap());
+    Serial.printf("Free PSRAM before BLE init: %u bytes\n", ESP.getFreePsram());
+    
+    try {
+      bluetoothScale.begin();  // Initialize BLE without scale reference
+      Serial.println("BLE initialized successfully - GaggiMate should be able to connect");
+      Serial.printf("Free heap after BLE init: %u bytes\n", ESP.getFreeHeap());
+      Serial.printf("Free PSRAM after BLE init: %u bytes\n", ESP.getFreePsram());
+      return true;
+    } catch (...) {
+      Serial.println("BLE initialization failed - continuing without Bluetooth");
+      Serial.printf("Free heap after BLE fail: %u bytes\n", ESP.getFreeHeap());
+      return false;
+    }
+  });
   
-  setupWiFi();
-
-  // Wait for WiFi to fully stabilize after BLE is already running
-  delay(1500);
+  // BLE is up once begin() returns - WiFi starts right away rather than after a fixed wait
+  bootSequencer.run(BootSequencer::STAGE_WIFI, []() -> bool {
+    // ALWAYS enable WiFi power management for optimal battery life
+    // This works regardless of WiFi mode (STA/AP/OFF) and should be set early
+    WiFi.setSleep(true);
+    Serial.println("WiFi power management enabled for battery optimization");
+    
+    // Connects in the background; maintainWiFi() finishes the job from loop()
+    setupWiFi(bootSequencer.getWiFiChannel(), bootSequencer.getWiFiBssid());
+    return true;
+  });
   Serial.printf("Version: %s\n", ESP.getSdkVersion());
-  // Initialize scale with error handling - don't block web server if HX711 fails
-  Serial.println("Initializing scale...");
-  if (!scale.begin()) {
+  
+  // Probe (up to 3 s without an HX711) plus initial tare (up to 3 s)
+  if (!bootSequencer.waitFor(BootSequencer::STAGE_SCALE, 8000)) {
     Serial.println("WARNING: Scale (HX711) initialization failed!");
     Serial.println("Web server will continue to run, but scale readings will not be available.");
     Serial.println("Check HX711 wiring and connections.");
@@ -131,6 +144,36 @@ void setup() {
     bluetoothScale.setScale(&scale);
   }
   
+  // Raw trace recorder lives in PSRAM - skipped on boards without it
+  if (psramFound()) {
+    uint8_t* traceBuffer = (uint8_t*)ps_malloc(TRACE_BUFFER_BYTES);
+    if (traceBuffer != nullptr) {
+      traceRecorder.setBuffer(traceBuffer, TRACE_BUFFER_BYTES);
+      traceRecorder.setScale(&scale);
+      scale.setTraceRecorder(&traceRecorder);
+      oledDisplay.setTraceRecorder(&traceRecorder);
+      Serial.printf("Trace recorder ready: %u samples in PSRAM\n", (unsigned)traceRecorder.getCapacity());
+    }
+  } else {
+    Serial.println("No PSRAM - trace recording disabled");
+  }
+  
+  // Acquisition, filtering and flow rate run in their own pinned task from here on
+  samplingTask.begin();
+  bluetoothScale.setSamplingTask(&samplingTask);
+  
+  // I2C probe gives up after 3 s without a display
+  if (!bootSequencer.waitFor(BootSequencer::STAGE_DISPLAY, 4000)) {
+    Serial.println("WARNING: Display initialization failed!");
+    Serial.println("System will continue in headless mode without display.");
+    Serial.println("All functionality remains available via web interface.");
+  } else {
+    Serial.println("Display initialized - ready for visual feedback");
+  }
+  if (oledDisplay.isConnected()) {
+    oledDisplay.setSamplingTask(&samplingTask);
+  }
+  
   // BLE was initialized earlier - no need to initialize again
   // bluetoothScale.begin(&scale);
   
@@ -142,6 +185,9 @@ void setup() {
   // Set display reference in bluetooth for timer control
   bluetoothScale.setDisplay(&oledDisplay);
   
+  // Tare and timer writes from BLE clients are executed by loop(), not the NimBLE host task
+  bluetoothScale.setCommandQueue(&controlCommands);
+  
   // Set power manager reference in display for timer state synchronization (if display available)
   if (oledDisplay.isConnected()) {
     oledDisplay.setPowerManager(&powerManager);
@@ -156,14 +202,14 @@ void setup() {
   touchSensor.begin();
 
   // Initialize power manager
+  powerManager.setBootSequencer(&bootSequencer);
   powerManager.begin();
 
   // Initialize battery monitor
   batteryMonitor.begin();
 
-  // Show IP addresses and welcome message if display is available
-  delay(100); // Small delay to ensure WiFi is fully initialized
-  if (oledDisplay.isConnected()) {
+  // Show welcome message if display is available - after a wake the weight goes up straight away
+  if (oledDisplay.isConnected() && !bootSequencer.isFastWake()) {
     oledDisplay.showIPAddresses();
   }
 
@@ -175,21 +221,22 @@ void setup() {
   // Link flow rate to touch sensor for averaging reset on tare
   touchSensor.setFlowRate(&flowRate);
 
-  setupWebServer(scale, flowRate, bluetoothScale, oledDisplay, batteryMonitor);
+  bootSequencer.run(BootSequencer::STAGE_WEB, []() -> bool {
+    setupWebServer(scale, flowRate, samplingTask, traceRecorder, liveStream, brewEvents, bluetoothScale, oledDisplay, batteryMonitor, controlCommands);
+    return true;
+  });
+  bootSequencer.printReport();
 }
 
 void loop() {
-  static unsigned long lastWeightUpdate = 0;
   static unsigned long lastWiFiCheck = 0;
   
-  // Update weight at optimal frequency for brewing accuracy
-  if (millis() - lastWeightUpdate >= 20) { // Update every 20ms (50Hz) - still very responsive
-    float weight = scale.getWeight();
-    flowRate.update(weight);
-    lastWeightUpdate = millis();
-  }
+  PROFILE_LOOP_START();
   
-  static unsigned long lastBLEUpdate = 0;
+  // One-off boot milestones: first weight, WiFi link
+  bootSequencer.update();
+  
+  // Weight and flow rate are produced by the sampling task - loop() only consumes snapshots
   
   // Check WiFi status every 30 seconds for debugging
   if (millis() - lastWiFiCheck >= 30000) {
@@ -197,27 +244,39 @@ void loop() {
     lastWiFiCheck = millis();
   }
   
+  // Commands queued by BLE and HTTP callbacks
+  PROFILE_CALL(LoopProfiler::COMMANDS, controlCommands.process());
+  
   // Maintain WiFi AP stability
-  maintainWiFi();
+  PROFILE_CALL(LoopProfiler::WIFI, maintainWiFi());
   
-  // Update Bluetooth less frequently to reduce BLE interference
-  if (millis() - lastBLEUpdate >= 50) { // Update every 50ms (20Hz) - sufficient for app responsiveness
-    bluetoothScale.update();
-    lastBLEUpdate = millis();
-  }
+  // Push new samples to WebSocket and event stream clients
+  PROFILE_CALL(LoopProfiler::LIVE_STREAM, liveStream.update());
+  PROFILE_CALL(LoopProfiler::BREW_EVENTS, brewEvents.update());
+  
+  // Offers each new snapshot once - every codec's NotificationPolicy sets its own rate cap
+  PROFILE_CALL(LoopProfiler::BLUETOOTH, bluetoothScale.update());
   
   // Update touch sensor
-  touchSensor.update();
+  PROFILE_CALL(LoopProfiler::TOUCH, touchSensor.update());
   
   // Update power manager
-  powerManager.update();
+  PROFILE_CALL(LoopProfiler::POWER, powerManager.update());
   
   // Update battery monitor
-  batteryMonitor.update();
+  PROFILE_CALL(LoopProfiler::BATTERY, batteryMonitor.update());
   
   // Update display
-  oledDisplay.update();
+  PROFILE_CALL(LoopProfiler::OLED, oledDisplay.update());
+  
+#if WEIGHMYBRU_PROFILER
+  // Serial "profile" / "profile reset"
+  loopProfiler.handleSerial();
+#endif
+  
+  PROFILE_LOOP_END();
   
-  // Balanced delay for responsive readings without system overload
-  delay(25); // Increased from 5ms to 25ms to reduce BLE interference and system load
+  // Sleep until the next snapshot (every 12.5 ms at 80 SPS) so BLE can notify each sample
+  // its policy allows; 25 ms at most, as before, when no samples arrive
+  samplingTask.waitForSnapshot(25);
 }
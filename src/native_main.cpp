@@ -0,0 +1,463 @@
+// Native (Linux host) entry point for the signal path - built only by [env:native].
+//
+//   program                      Simulated shot: prints weight/flow, per-sample cost,
+//                                and checks that replaying its own trace reproduces it
+//   program --save shot.bin      Same, and writes the recorded trace
+//   program shot.bin [key=value] Replay a trace (e.g. from /api/trace) as CSV on stdout.
+//                                Keys match /api/filter-settings: brewingThreshold,
+//                                stabilityTimeout, medianSamples, averageSamples,
+//                                filterMode (smart|kalman), kalmanProcessNoise,
+//                                kalmanMeasurementNoise, flowProfile (fast|smooth)
+//   program --bench-json         Heap allocations and time per /api/dashboard body,
+//                                String concatenation vs JsonWriter
+//   program --bench-median       Time per sample of the sliding-window median against
+//                                the bubble-sort median it replaced, windows 5..64
+//   program --bench-codecs       Time per encoded weight frame for each BLE scale codec
+// Left out of `pio test -e native` builds, whose test/ programs bring their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <cstdlib>
+#include "Scale.h"
+#include "FlowRate.h"
+#include "SimulatedClock.h"
+#include "SimulatedLoadCell.h"
+#include "MemorySettingsStore.h"
+#include "ScalePayload.h"
+#include "ScaleCodecs.h"
+#include "TraceRecorder.h"
+#include "TraceReplay.h"
+#include "JsonWriter.h"
+#include "SlidingMedian.h"
+#include "SimulatedShot.h"
+
+// Count heap traffic for --bench-json
+static size_t heapAllocations = 0;
+static size_t heapBytes = 0;
+
+void* operator new(size_t size) {
+    heapAllocations++;
+    heapBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+const uint32_t SAMPLES_PER_SECOND = 80;
+
+// 180 g cup at 2 s, a steady 2 g/s pour from 6 s to 31 s
+const SimulatedShot::FlowPoint SHOT_PROFILE[] = {
+    {6000000, 2.0f},
+    {31000000, 2.0f},
+    {31000000, 0.0f},
+};
+const uint32_t CUP_AT_US = 2000000;
+
+struct LivePoint {
+    float weight;
+    float flowRate;
+};
+
+// Replay starts with an empty filter window while the device's was already
+// filled, so outputs may only differ until the largest window has refilled
+const size_t REPLAY_WARMUP_SAMPLES = 64;
+
+struct ReplayCheck {
+    const std::vector<LivePoint>* live;
+    size_t index;
+    size_t mismatches;
+};
+
+void compareWithLive(const ReplayPoint& point, void* context) {
+    ReplayCheck& check = *static_cast<ReplayCheck*>(context);
+    if (check.index >= REPLAY_WARMUP_SAMPLES &&
+        (check.index >= check.live->size() ||
+         (*check.live)[check.index].weight != point.weight ||
+         (*check.live)[check.index].flowRate != point.flowRate)) {
+        check.mismatches++;
+    }
+    check.index++;
+}
+
+void printCsvRow(const ReplayPoint& point, void* context) {
+    uint32_t firstUs = *static_cast<uint32_t*>(context);
+    printf("%.6f,%ld,%.3f,%.3f,%s\n", (uint32_t)(point.timestampUs - firstUs) / 1e6, (long)point.raw, point.weight,
+           point.flowRate, Scale::getFilterStateName((Scale::FilterState)point.filterState));
+}
+
+bool applyOverride(MemorySettingsStore& settings, const std::string& arg) {
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+        return false;
+    }
+    std::string key = arg.substr(0, eq);
+    std::string value = arg.substr(eq + 1);
+
+    settings.begin("scale", false);
+    bool known = true;
+    if (key == "brewingThreshold") {
+        settings.putFloat("brew_thresh", std::stof(value));
+    } else if (key == "stabilityTimeout") {
+        settings.putULong("stab_timeout", std::stoul(value));
+    } else if (key == "medianSamples") {
+        settings.putInt("median_samples", std::stoi(value));
+    } else if (key == "averageSamples") {
+        settings.putInt("avg_samples", std::stoi(value));
+    } else if (key == "filterMode") {
+        settings.putUChar("filter_mode", value == "kalman" ? Scale::FILTER_KALMAN : Scale::FILTER_SMART);
+    } else if (key == "kalmanProcessNoise") {
+        settings.putFloat("kf_q", std::stof(value));
+    } else if (key == "kalmanMeasurementNoise") {
+        settings.putFloat("kf_r", std::stof(value));
+    } else if (key == "flowProfile") {
+        settings.putUChar("flow_profile", value == "fast" ? FlowRate::PROFILE_FAST : FlowRate::PROFILE_SMOOTH);
+    } else {
+        known = false;
+    }
+    settings.end();
+    return known;
+}
+
+int replayFile(const char* path, int argc, char** argv) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        Serial.printf("Cannot open %s\n", path);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    TraceReader trace;
+    if (!trace.parse(data.data(), data.size())) {
+        Serial.printf("%s is not a WeighMyBru trace\n", path);
+        return 1;
+    }
+
+    TraceReplay replay(trace);
+    for (int i = 0; i < argc; i++) {
+        if (!applyOverride(replay.getSettings(), argv[i])) {
+            Serial.printf("Unknown override: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    uint32_t firstUs = trace.size() > 0 ? trace.at(0).timestampUs : 0;
+    printf("time_s,raw,weight_g,flow_gps,filter_state\n");
+    uint32_t replayed = replay.run(printCsvRow, &firstUs);
+    Serial.printf("Replayed %u conversions from %s\n", (unsigned)replayed, path);
+    return 0;
+}
+
+// Same fields and formatting as the /api/dashboard handler, before and after
+struct DashboardValues {
+    float weight;
+    float flowRate;
+    unsigned long elapsedMs;
+    float batteryVoltage;
+    int batteryPercentage;
+    int wifiSignal;
+    int bluetoothSignal;
+};
+
+String dashboardWithString(const DashboardValues& v) {
+    String json = "{";
+    json += "\"weight\":" + String(v.weight, 2) + ",";
+    json += "\"flowrate\":" + String(v.flowRate, 1) + ",";
+    json += "\"scale_connected\":" + String("true") + ",";
+    json += "\"filter_state\":\"" + String("BREWING") + "\",";
+    json += "\"taring\":" + String("false") + ",";
+    json += "\"mode\":\"UNIFIED\"";
+    json += ",\"timer_running\":true";
+    json += ",\"timer_elapsed\":" + String(v.elapsedMs);
+    json += ",\"timer_display\":\"0:27.340\"";
+    json += ",\"timer_avg_flowrate\":null";
+    json += ",\"battery_voltage\":" + String(v.batteryVoltage, 2);
+    json += ",\"battery_percentage\":" + String(v.batteryPercentage);
+    json += ",\"battery_status\":\"" + String("Good") + "\"";
+    json += ",\"battery_segments\":" + String(3);
+    json += ",\"battery_low\":" + String("false");
+    json += ",\"battery_critical\":" + String("false");
+    json += ",\"wifi_signal_strength\":" + String(v.wifiSignal);
+    json += ",\"wifi_signal_quality\":\"" + String("Good") + "\"";
+    json += ",\"bluetooth_connected\":" + String("true");
+    json += ",\"bluetooth_signal_strength\":" + String(v.bluetoothSignal);
+    json += ",\"device_version\":\"" + String("2.1.0") + "\"";
+    json += ",\"device_board\":\"" + String("ESP32-S3 SuperMini") + "\"";
+    json += ",\"device_build_date\":\"" + String("Oct 16 2026") + "\"";
+    json += ",\"device_full_version\":\"" + String("WeighMyBru v2.1.0 (ESP32-S3 SuperMini)") + "\"";
+    json += "}";
+    return json;
+}
+
+size_t dashboardWithWriter(const DashboardValues& v, char* buffer, size_t size) {
+    JsonWriter json(buffer, size);
+    json.beginObject();
+    json.field("weight", v.weight, 2);
+    json.field("flowrate", v.flowRate, 1);
+    json.field("scale_connected", true);
+    json.field("filter_state", "BREWING");
+    json.field("taring", false);
+    json.field("mode", "UNIFIED");
+    json.field("timer_running", true);
+    json.field("timer_elapsed", v.elapsedMs);
+    json.field("timer_display", "0:27.340");
+    json.nullField("timer_avg_flowrate");
+    json.field("battery_voltage", v.batteryVoltage, 2);
+    json.field("battery_percentage", v.batteryPercentage);
+    json.field("battery_status", "Good");
+    json.field("battery_segments", 3);
+    json.field("battery_low", false);
+    json.field("battery_critical", false);
+    json.field("wifi_signal_strength", v.wifiSignal);
+    json.field("wifi_signal_quality", "Good");
+    json.field("bluetooth_connected", true);
+    json.field("bluetooth_signal_strength", v.bluetoothSignal);
+    json.field("device_version", "2.1.0");
+    json.field("device_board", "ESP32-S3 SuperMini");
+    json.field("device_build_date", "Oct 16 2026");
+    json.field("device_full_version", "WeighMyBru v2.1.0 (ESP32-S3 SuperMini)");
+    json.endObject();
+    return json.overflowed() ? 0 : json.length();
+}
+
+int benchJson() {
+    const int ROUNDS = 100000;
+    DashboardValues v = {45.23f, 2.1f, 27340, 3.97f, 87, -58, -64};
+    static char buffer[1536];
+    size_t checksum = 0;
+
+    size_t allocationsBefore = heapAllocations;
+    size_t bytesBefore = heapBytes;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        v.weight = 45.0f + i * 0.01f;
+        checksum += dashboardWithString(v).length();
+    }
+    double stringUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+    double stringAllocations = (double)(heapAllocations - allocationsBefore) / ROUNDS;
+    double stringBytes = (double)(heapBytes - bytesBefore) / ROUNDS;
+
+    allocationsBefore = heapAllocations;
+    bytesBefore = heapBytes;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        v.weight = 45.0f + i * 0.01f;
+        checksum += dashboardWithWriter(v, buffer, sizeof(buffer));
+    }
+    double writerUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+    double writerAllocations = (double)(heapAllocations - allocationsBefore) / ROUNDS;
+    double writerBytes = (double)(heapBytes - bytesBefore) / ROUNDS;
+
+    String reference = dashboardWithString(v);
+    size_t length = dashboardWithWriter(v, buffer, sizeof(buffer));
+    bool same = reference == String(buffer);
+
+    Serial.printf("/api/dashboard body: %u bytes, identical output: %s (checksum %u)\n",
+                  (unsigned)length, same ? "yes" : "no", (unsigned)checksum);
+    Serial.printf("String concatenation: %6.2f us, %5.1f allocations, %6.0f bytes per response\n",
+                  stringUs, stringAllocations, stringBytes);
+    Serial.printf("JsonWriter:           %6.2f us, %5.1f allocations, %6.0f bytes per response\n",
+                  writerUs, writerAllocations, writerBytes);
+    return same ? 0 : 1;
+}
+
+// The smart filter's median before SlidingMedian: copy the window, bubble sort, upper median
+float bubbleSortMedian(const float* readings, int readingIndex, int maxSamples, int samples) {
+    float temp[64];
+    for (int i = 0; i < samples; i++) {
+        temp[i] = readings[(readingIndex - 1 - i + maxSamples) % maxSamples];
+    }
+    for (int i = 0; i < samples - 1; i++) {
+        for (int j = 0; j < samples - i - 1; j++) {
+            if (temp[j] > temp[j + 1]) {
+                float swap = temp[j];
+                temp[j] = temp[j + 1];
+                temp[j + 1] = swap;
+            }
+        }
+    }
+    return temp[samples / 2];
+}
+
+int benchMedian() {
+    const int ROUNDS = 200000;
+    const int MAX_SAMPLES = 64;
+    std::vector<float> input(ROUNDS);
+    SimulatedShot noiseSource(0.0f, 0, nullptr, 0, 0.15f, 2463534242u);
+    for (int i = 0; i < ROUNDS; i++) {
+        input[i] = 36.0f + noiseSource.noise();
+    }
+
+    const int windows[] = {5, 10, 32, 64};
+    bool same = true;
+    for (int window : windows) {
+        float readings[MAX_SAMPLES];
+        for (int i = 0; i < MAX_SAMPLES; i++) {
+            readings[i] = input[0];
+        }
+        int readingIndex = 0;
+        double bubbleSum = 0.0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ROUNDS; i++) {
+            readings[readingIndex] = input[i];
+            readingIndex = (readingIndex + 1) % MAX_SAMPLES;
+            bubbleSum += bubbleSortMedian(readings, readingIndex, MAX_SAMPLES, window);
+        }
+        double bubbleNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+
+        SlidingMedian<MAX_SAMPLES> median;
+        median.reset(window, input[0]);
+        double slidingSum = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ROUNDS; i++) {
+            median.push(input[i]);
+            slidingSum += median.median();
+        }
+        double slidingNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+
+        same &= bubbleSum == slidingSum;
+        Serial.printf("window %2d: bubble sort %8.1f ns/sample, sliding %6.1f ns/sample, same output: %s\n",
+                      window, bubbleNs, slidingNs, bubbleSum == slidingSum ? "yes" : "no");
+    }
+    return same ? 0 : 1;
+}
+
+// Encode cost per frame, as update() pays it once per codec and sample.
+// Wire format and command checks live in test/test_scale_codecs.
+int benchCodecs() {
+    const int ROUNDS = 1000000;
+    uint8_t frame[IScaleCodec::MAX_WEIGHT_FRAME];
+    IScaleCodec::WeightFrame weight = {36.27f, 1.8f, true};
+    for (uint8_t i = 0; i < ScaleCodecs::COUNT; i++) {
+        const IScaleCodec* codec = ScaleCodecs::get(i);
+        size_t checksum = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int round = 0; round < ROUNDS; round++) {
+            weight.weight = round * 0.01f;
+            checksum += codec->encodeWeight(weight, frame, sizeof(frame)) + frame[0];
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+        Serial.printf("%-14s %6.1f ns per frame (checksum %u)\n", codec->getName(), ns, (unsigned)checksum);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && std::string(argv[1]) == "--bench-json") {
+        return benchJson();
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-median") {
+        return benchMedian();
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-codecs") {
+        return benchCodecs();
+    }
+    if (argc >= 2 && std::string(argv[1]) != "--save") {
+        return replayFile(argv[1], argc - 2, argv + 2);
+    }
+    const char* savePath = (argc >= 3) ? argv[2] : nullptr;
+
+    SimulatedShot shot(180.0f, CUP_AT_US, SHOT_PROFILE, sizeof(SHOT_PROFILE) / sizeof(SHOT_PROFILE[0]), 0.15f,
+                       2463534242u);
+
+    SimulatedClock clock;
+    SimulatedLoadCell loadCell(clock, SAMPLES_PER_SECOND, SimulatedShot::generate, &shot);
+    MemorySettingsStore settings;
+    Scale scale(loadCell, settings, clock, SimulatedShot::CALIBRATION_FACTOR);
+    FlowRate flowRate;
+    scale.setFlowRatePtr(&flowRate);
+
+    std::vector<uint8_t> traceBuffer(64 * 1024);
+    TraceRecorder recorder;
+    recorder.setBuffer(traceBuffer.data(), traceBuffer.size());
+    recorder.setScale(&scale);
+    scale.setTraceRecorder(&recorder);
+
+    if (!scale.begin()) {
+        Serial.println("Scale failed to start");
+        return 1;
+    }
+
+    // Record from a clean FlowRate state so the replay starts from the same point
+    flowRate.clearFlowRateBuffer();
+    recorder.start();
+
+    // Tare the cup once it has settled, like a user would before the shot
+    bool cupTared = false;
+    uint32_t samples = 0;
+    double processingNs = 0.0;
+    const uint32_t stepUs = 1000000UL / SAMPLES_PER_SECOND;
+    std::vector<LivePoint> live;
+
+    // One conversion per step, like the sampling task woken per data-ready edge
+    while (clock.nowUs() < 36000000UL) {
+        clock.advanceUs(stepUs);
+        uint32_t t = clock.nowUs();
+        if (!cupTared && t >= CUP_AT_US + 2000000UL) {
+            scale.tare(10);
+            cupTared = true;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        float weight = scale.getWeight();
+        processingNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        samples++;
+        live.push_back(LivePoint{weight, flowRate.getFlowRate()});
+
+        if (t % 1000000UL < stepUs) {
+            Serial.printf("t=%5.1fs weight=%7.2fg flow=%5.2fg/s state=%s\n", t / 1e6, weight,
+                          flowRate.getFlowRate(), scale.getFilterState().c_str());
+        }
+    }
+    recorder.stop();
+
+    Serial.printf("Expected final weight: %.2fg\n", shot.pouredAt(clock.nowUs()));
+    Serial.printf("Samples: %u captured, %u dropped, %.0f ns per sample (Scale + FlowRate)\n",
+                  (unsigned)scale.getCapturedSamples(), (unsigned)scale.getDroppedSamples(), processingNs / samples);
+
+    // BLE payloads for the final weight, byte-for-byte what the device would notify
+    uint8_t gaggiMate[ScalePayload::WEIGHMYBRU_WEIGHT_LENGTH];
+    ScalePayload::encodeWeighMyBruWeight(scale.getCurrentWeight(), gaggiMate);
+    Serial.print("WeighMyBru weight payload:");
+    for (size_t i = 0; i < sizeof(gaggiMate); i++) {
+        Serial.printf(" %02X", gaggiMate[i]);
+    }
+    Serial.println();
+
+    // Serialize the trace exactly as /api/trace would and replay it
+    std::vector<uint8_t> traceFile(recorder.getTraceSize());
+    recorder.readTrace(traceFile.data(), traceFile.size(), 0);
+    TraceReader trace;
+    if (!trace.parse(traceFile.data(), traceFile.size())) {
+        Serial.println("Recorded trace failed to parse");
+        return 1;
+    }
+    TraceReplay replay(trace);
+    ReplayCheck check = {&live, 0, 0};
+    uint32_t replayed = replay.run(compareWithLive, &check);
+    Serial.printf("Trace: %u records (%u bytes), replayed %u conversions, %u mismatches after warm-up\n",
+                  (unsigned)trace.size(), (unsigned)traceFile.size(), (unsigned)replayed, (unsigned)check.mismatches);
+
+    if (savePath != nullptr) {
+        std::ofstream out(savePath, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(traceFile.data()), traceFile.size());
+        Serial.printf("Trace written to %s\n", savePath);
+    }
+    return (check.mismatches == 0 && replayed == live.size()) ? 0 : 1;
+}
+
+#endif // PIO_UNIT_TESTING
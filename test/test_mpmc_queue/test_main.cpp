@@ -0,0 +1,172 @@
+// MpmcQueue: the command queue fed from the NimBLE host and async_tcp tasks
+#include <unity.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "MpmcQueue.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Item {
+    uint32_t producer;
+    uint32_t sequence;
+};
+
+// Producers retry until accepted while consumers race for the items: every item
+// must come out exactly once, and each producer's items in the order it pushed them
+template <size_t N>
+static void checkExactlyOnce(MpmcQueue<Item, N>& queue, uint32_t producerCount, uint32_t consumerCount,
+                             uint32_t count) {
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < producerCount; p++) {
+        producers.emplace_back([&queue, p, count]() {
+            for (uint32_t i = 0; i < count; i++) {
+                while (!queue.push(Item{p, i})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    const uint32_t total = producerCount * count;
+    std::atomic<uint32_t> consumed(0);
+    std::vector<std::vector<uint32_t>> seen(consumerCount * producerCount);
+    std::vector<std::thread> consumers;
+    for (uint32_t c = 0; c < consumerCount; c++) {
+        consumers.emplace_back([&queue, &consumed, &seen, c, producerCount, total]() {
+            Item item;
+            while (consumed.load() < total) {
+                if (queue.pop(item)) {
+                    seen[c * producerCount + item.producer].push_back(item.sequence);
+                    consumed++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    for (std::thread& consumer : consumers) {
+        consumer.join();
+    }
+
+    Item item;
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(total, consumed.load());
+    TEST_ASSERT_EQUAL_UINT32(0, queue.available());
+
+    std::vector<uint32_t> counts(total, 0);
+    bool ordered = true;
+    for (uint32_t c = 0; c < consumerCount; c++) {
+        for (uint32_t p = 0; p < producerCount; p++) {
+            const std::vector<uint32_t>& sequence = seen[c * producerCount + p];
+            for (size_t i = 0; i < sequence.size(); i++) {
+                ordered &= i == 0 || sequence[i] > sequence[i - 1];
+                counts[p * count + sequence[i]]++;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(ordered);
+    bool exactlyOnce = true;
+    for (uint32_t seenCount : counts) {
+        exactlyOnce &= seenCount == 1;
+    }
+    TEST_ASSERT_TRUE(exactlyOnce);
+}
+
+void test_concurrent_producers_and_consumers() {
+    MpmcQueue<Item, 16> queue;
+    checkExactlyOnce(queue, 4, 3, 50000);
+}
+
+// Two cells: producers and consumers constantly meet on the same cell and lap
+void test_contention_on_a_tiny_queue() {
+    MpmcQueue<Item, 2> queue;
+    checkExactlyOnce(queue, 3, 3, 20000);
+}
+
+// Single-threaded first, then with all threads crossing the wrap
+void test_sequence_counters_wrap() {
+    const uint32_t NEAR_WRAP = UINT32_MAX - 5;
+    MpmcQueue<uint32_t, 8> queue(NEAR_WRAP);
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(queue.push(i)); // Cells straddle 0xFFFFFFFF -> 0
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, queue.available());
+    TEST_ASSERT_FALSE(queue.push(8));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.getDroppedCount());
+
+    uint32_t item;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(0, queue.available());
+
+    // Further laps past the wrap keep the cell sequence numbers in step
+    for (uint32_t i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(queue.push(i));
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+
+    MpmcQueue<Item, 16> shared(UINT32_MAX - 50000);
+    checkExactlyOnce(shared, 4, 3, 25000);
+}
+
+// Producers that give up when full, as ControlCommands::post() does:
+// accepted + dropped accounts for every attempt, and nothing accepted is lost
+void test_concurrent_drops_are_counted() {
+    MpmcQueue<uint32_t, 8> queue;
+    const uint32_t PRODUCERS = 4;
+    const uint32_t COUNT = 20000; // Attempts per producer
+
+    std::atomic<uint32_t> accepted(0);
+    std::atomic<bool> producing(true);
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&queue, &accepted]() {
+            for (uint32_t i = 0; i < COUNT; i++) {
+                if (queue.push(i)) {
+                    accepted++;
+                }
+            }
+        });
+    }
+
+    uint32_t consumed = 0;
+    std::thread consumer([&queue, &consumed, &producing]() {
+        uint32_t item;
+        for (;;) {
+            bool finished = !producing.load(); // Read before the pop, so a failed pop means drained
+            if (queue.pop(item)) {
+                consumed++;
+            } else if (finished) {
+                break;
+            }
+        }
+    });
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    producing = false;
+    consumer.join();
+
+    uint32_t item;
+    TEST_ASSERT_FALSE(queue.pop(item));
+    TEST_ASSERT_EQUAL_UINT32(PRODUCERS * COUNT, accepted.load() + queue.getDroppedCount());
+    TEST_ASSERT_EQUAL_UINT32(accepted.load(), consumed);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_concurrent_producers_and_consumers);
+    RUN_TEST(test_contention_on_a_tiny_queue);
+    RUN_TEST(test_sequence_counters_wrap);
+    RUN_TEST(test_concurrent_drops_are_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+// RouteMetrics: Prometheus exposition behind /api/metrics
+#include <unity.h>
+#include <string>
+#include "RouteMetrics.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Drains the exposition the way the chunked /api/metrics response does
+static std::string scrape(const RouteMetrics& metrics, RouteMetrics::Cursor& cursor, size_t chunk) {
+    std::string text;
+    char buffer[512];
+    size_t written;
+    while ((written = metrics.render(cursor, buffer, chunk)) > 0) {
+        TEST_ASSERT_TRUE(written <= chunk);
+        text.append(buffer, written);
+    }
+    return text;
+}
+
+static bool contains(const std::string& text, const char* line) {
+    return text.find(line) != std::string::npos;
+}
+
+void test_exposition_format() {
+    static RouteMetrics metrics;
+    RouteMetrics::Route* weight = metrics.addRoute("/api/weight", "GET");
+    metrics.addRoute("/api/tare", "POST"); // Never hit
+    metrics.record(weight, 120, 40);
+    metrics.record(weight, 80, 40);
+    metrics.addBytes(weight, 10);
+
+    static RouteMetrics::Cursor cursor;
+    RouteMetrics::beginScrape(cursor);
+    RouteMetrics::addGauge(cursor, "weighmybru_heap_free_bytes", "Free heap", 81234);
+    RouteMetrics::addCounter(cursor, "weighmybru_display_frames_pushed_total", "OLED frames sent to the panel", 7);
+    std::string text = scrape(metrics, cursor, 512);
+
+    TEST_ASSERT_TRUE(contains(text, "# HELP weighmybru_heap_free_bytes Free heap\n"
+                                    "# TYPE weighmybru_heap_free_bytes gauge\n"
+                                    "weighmybru_heap_free_bytes 81234\n"));
+    TEST_ASSERT_TRUE(contains(text, "# TYPE weighmybru_display_frames_pushed_total counter\n"
+                                    "weighmybru_display_frames_pushed_total 7\n"));
+    TEST_ASSERT_TRUE(contains(text, "# TYPE weighmybru_metrics_dropped gauge\nweighmybru_metrics_dropped 0\n"));
+    TEST_ASSERT_TRUE(contains(text, "# TYPE weighmybru_http_requests_total counter\n"
+                                    "weighmybru_http_requests_total{route=\"/api/weight\",method=\"GET\"} 2\n"));
+    TEST_ASSERT_TRUE(contains(text, "weighmybru_http_response_bytes_total{route=\"/api/weight\",method=\"GET\"} 90\n"));
+    TEST_ASSERT_TRUE(contains(text, "# TYPE weighmybru_http_request_duration_microseconds histogram\n"));
+    TEST_ASSERT_FALSE(contains(text, "/api/tare")); // Unused routes are left out
+    TEST_ASSERT_EQUAL('\n', text[text.size() - 1]);
+
+    // Any chunk size gives the same bytes
+    const size_t chunks[] = {1, 7, 64, 191};
+    for (size_t chunk : chunks) {
+        RouteMetrics::beginScrape(cursor);
+        RouteMetrics::addGauge(cursor, "weighmybru_heap_free_bytes", "Free heap", 81234);
+        RouteMetrics::addCounter(cursor, "weighmybru_display_frames_pushed_total", "OLED frames sent to the panel", 7);
+        TEST_ASSERT_EQUAL_STRING(text.c_str(), scrape(metrics, cursor, chunk).c_str());
+    }
+}
+
+void test_histogram_buckets_are_cumulative() {
+    static RouteMetrics metrics;
+    RouteMetrics::Route* route = metrics.addRoute("/api/status", "GET");
+    const uint32_t elapsedUs[] = {50, 100, 101, 900, 2500, 60000, 60000};
+    uint64_t sumUs = 0;
+    for (uint32_t us : elapsedUs) {
+        metrics.record(route, us, 0);
+        sumUs += us;
+    }
+
+    static RouteMetrics::Cursor cursor;
+    RouteMetrics::beginScrape(cursor);
+    std::string text = scrape(metrics, cursor, 512);
+
+    // A value on a bound counts in that bucket
+    const char* expected[] = {
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"100\"} 2\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"250\"} 3\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"500\"} 3\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"1000\"} 4\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"2500\"} 5\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"10000\"} 5\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"50000\"} 5\n",
+        "_bucket{route=\"/api/status\",method=\"GET\",le=\"+Inf\"} 7\n",
+        "_count{route=\"/api/status\",method=\"GET\"} 7\n",
+    };
+    size_t position = 0;
+    for (const char* line : expected) {
+        size_t found = text.find(line, position);
+        TEST_ASSERT_TRUE(found != std::string::npos); // Present and in order
+        position = found;
+    }
+    char sum[96];
+    snprintf(sum, sizeof(sum), "_sum{route=\"/api/status\",method=\"GET\"} %llu\n", (unsigned long long)sumUs);
+    TEST_ASSERT_TRUE(contains(text, sum));
+}
+
+void test_capacity_overflow_is_reported() {
+    static RouteMetrics metrics;
+    for (size_t i = 0; i < RouteMetrics::MAX_ROUTES; i++) {
+        TEST_ASSERT_NOT_NULL(metrics.addRoute("/api/route", "GET"));
+    }
+    RouteMetrics::Route* extra = metrics.addRoute("/api/extra", "GET");
+    TEST_ASSERT_NULL(extra);
+    metrics.record(extra, 100, 10); // Ignored
+    metrics.addBytes(extra, 10);
+    TEST_ASSERT_EQUAL_UINT32(RouteMetrics::MAX_ROUTES, metrics.getRouteCount());
+    TEST_ASSERT_EQUAL_UINT32(1, metrics.getDroppedRoutes());
+
+    static RouteMetrics::Cursor cursor;
+    RouteMetrics::beginScrape(cursor);
+    for (size_t i = 0; i < RouteMetrics::MAX_GAUGES + 2; i++) {
+        RouteMetrics::addGauge(cursor, "weighmybru_test", "Filler", (uint32_t)i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(RouteMetrics::MAX_GAUGES, cursor.gaugeCount);
+    std::string text = scrape(metrics, cursor, 512);
+    TEST_ASSERT_TRUE(contains(text, "\nweighmybru_metrics_dropped 3\n"));
+    TEST_ASSERT_FALSE(contains(text, "/api/extra"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_exposition_format);
+    RUN_TEST(test_histogram_buckets_are_cumulative);
+    RUN_TEST(test_capacity_overflow_is_reported);
+    return UNITY_END();
+}
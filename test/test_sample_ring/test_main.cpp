@@ -0,0 +1,104 @@
+// SampleRing: the SPSC ring between the HX711 data-ready ISR and the filter chain
+#include <unity.h>
+#include <thread>
+#include "SampleRing.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_pop_returns_items_in_order() {
+    SampleRing<RawSample, 8> ring;
+    for (uint32_t i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(ring.push(RawSample{i * 12500, (int32_t)i - 2}));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, ring.available());
+
+    RawSample sample;
+    for (uint32_t i = 0; i < 5; i++) {
+        TEST_ASSERT_TRUE(ring.pop(sample));
+        TEST_ASSERT_EQUAL_UINT32(i * 12500, sample.timestampUs);
+        TEST_ASSERT_EQUAL_INT32((int32_t)i - 2, sample.raw);
+    }
+    TEST_ASSERT_FALSE(ring.pop(sample));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.available());
+}
+
+void test_full_ring_drops_newest_and_counts() {
+    SampleRing<int, 4> ring;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_FALSE(ring.push(4));
+    TEST_ASSERT_FALSE(ring.push(5));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getDroppedCount());
+
+    // What was queued survives the overflow
+    int item;
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_INT(0, item);
+    TEST_ASSERT_TRUE(ring.push(6));
+    const int expected[] = {1, 2, 3, 6};
+    for (int value : expected) {
+        TEST_ASSERT_TRUE(ring.pop(item));
+        TEST_ASSERT_EQUAL_INT(value, item);
+    }
+}
+
+void test_clear_discards_pending() {
+    SampleRing<int, 4> ring;
+    ring.push(1);
+    ring.push(2);
+    ring.clear();
+    int item;
+    TEST_ASSERT_FALSE(ring.pop(item));
+    TEST_ASSERT_TRUE(ring.push(3));
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL_INT(3, item);
+}
+
+void test_indices_wrap_past_capacity() {
+    SampleRing<int, 4> ring;
+    int item;
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+        TEST_ASSERT_TRUE(ring.pop(item));
+        TEST_ASSERT_EQUAL_INT(i, item);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDroppedCount());
+}
+
+// One producer thread standing in for the ISR, the test thread as the filter task
+void test_concurrent_producer_consumer() {
+    static SampleRing<RawSample, 64> ring;
+    const uint32_t COUNT = 200000;
+    std::thread producer([]() {
+        for (uint32_t i = 0; i < COUNT; i++) {
+            while (!ring.push(RawSample{i, (int32_t)(i * 3)})) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool ordered = true;
+    RawSample sample;
+    while (expected < COUNT) {
+        if (ring.pop(sample)) {
+            ordered &= sample.timestampUs == expected && sample.raw == (int32_t)(expected * 3);
+            expected++;
+        }
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_FALSE(ring.pop(sample));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pop_returns_items_in_order);
+    RUN_TEST(test_full_ring_drops_newest_and_counts);
+    RUN_TEST(test_clear_discards_pending);
+    RUN_TEST(test_indices_wrap_past_capacity);
+    RUN_TEST(test_concurrent_producer_consumer);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+// BLE scale codecs: wire format, command decoding and the registry
+#include <unity.h>
+#include <string.h>
+#include "ScaleCodecs.h"
+#include "ScalePayload.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const IScaleCodec* gaggiMate() { return ScaleCodecs::get(ScaleCodecs::GAGGIMATE); }
+static const IScaleCodec* beanConqueror() { return ScaleCodecs::get(ScaleCodecs::BEAN_CONQUEROR); }
+static const IScaleCodec* decent() { return ScaleCodecs::get(ScaleCodecs::DECENT); }
+
+static const IScaleCodec::WeightFrame BREWING = {36.27f, 1.8f, true};
+
+// Ported protocols keep their exact bytes
+void test_ported_frames_match_scale_payload() {
+    uint8_t frame[IScaleCodec::MAX_WEIGHT_FRAME];
+    uint8_t reference[IScaleCodec::MAX_WEIGHT_FRAME];
+
+    ScalePayload::encodeWeighMyBruWeight(BREWING.weight, reference);
+    TEST_ASSERT_EQUAL_UINT32(ScalePayload::WEIGHMYBRU_WEIGHT_LENGTH,
+                             gaggiMate()->encodeWeight(BREWING, frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(reference, frame, ScalePayload::WEIGHMYBRU_WEIGHT_LENGTH);
+
+    ScalePayload::encodeBeanConquerorWeight(BREWING.weight, reference);
+    TEST_ASSERT_EQUAL_UINT32(ScalePayload::BEAN_CONQUEROR_WEIGHT_LENGTH,
+                             beanConqueror()->encodeWeight(BREWING, frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(reference, frame, ScalePayload::BEAN_CONQUEROR_WEIGHT_LENGTH);
+}
+
+void test_short_buffer_is_rejected() {
+    uint8_t frame[IScaleCodec::MAX_WEIGHT_FRAME];
+    TEST_ASSERT_EQUAL_UINT32(0, gaggiMate()->encodeWeight(BREWING, frame, 4));
+    TEST_ASSERT_EQUAL_UINT32(0, beanConqueror()->encodeWeight(BREWING, frame, 3));
+    TEST_ASSERT_EQUAL_UINT32(0, decent()->encodeWeight(BREWING, frame, 6));
+}
+
+void test_decent_weight_frames() {
+    uint8_t frame[IScaleCodec::MAX_WEIGHT_FRAME];
+
+    // 36.27 g -> 363 (0x016B) tenths, changing
+    const uint8_t changing[] = {0x03, 0xCA, 0x01, 0x6B, 0x00, 0x00, 0x03 ^ 0xCA ^ 0x01 ^ 0x6B};
+    TEST_ASSERT_EQUAL_UINT32(sizeof(changing), decent()->encodeWeight(BREWING, frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(changing, frame, sizeof(changing));
+
+    // -1.26 g -> -13 tenths, stable
+    IScaleCodec::WeightFrame negative = {-1.26f, 0.0f, false};
+    decent()->encodeWeight(negative, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_HEX8(0xCE, frame[1]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, frame[2]);
+    TEST_ASSERT_EQUAL_HEX8(0xF3, frame[3]);
+    TEST_ASSERT_EQUAL_HEX8(ScalePayload::checksum(frame, 6), frame[6]);
+}
+
+static const uint8_t WEIGHMYBRU_TARE[] = {0x03, 0x0A, 0x01, 0x01, 0x00, 0x00};
+
+void test_weighmybru_commands() {
+    const uint8_t gaggiMateStart[] = {0x02, 0x0A, 0x02, 0x01, 0x00, 0x00};
+    const uint8_t stop[] = {0x03, 0x0A, 0x03, 0x01, 0x00, 0x00};
+    const uint8_t reset[] = {0x03, 0x0A, 0x04, 0x01, 0x00, 0x00};
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TARE, gaggiMate()->decodeCommand(WEIGHMYBRU_TARE, sizeof(WEIGHMYBRU_TARE)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TIMER_START,
+                      beanConqueror()->decodeCommand(gaggiMateStart, sizeof(gaggiMateStart)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TIMER_STOP, gaggiMate()->decodeCommand(stop, sizeof(stop)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TIMER_RESET, gaggiMate()->decodeCommand(reset, sizeof(reset)));
+}
+
+void test_weighmybru_ignores_untriggered_foreign_and_short_messages() {
+    const uint8_t notTriggered[] = {0x03, 0x0A, 0x01, 0x00, 0x00, 0x00};
+    const uint8_t unknownProduct[] = {0x05, 0x0A, 0x01, 0x01, 0x00, 0x00};
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, gaggiMate()->decodeCommand(notTriggered, sizeof(notTriggered)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, gaggiMate()->decodeCommand(unknownProduct, sizeof(unknownProduct)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, gaggiMate()->decodeCommand(WEIGHMYBRU_TARE, 3));
+}
+
+static const uint8_t DECENT_TARE[] = {0x03, 0x0F, 0x01, 0x00, 0x00, 0x00, 0x03 ^ 0x0F ^ 0x01};
+
+void test_decent_commands() {
+    const uint8_t start[] = {0x03, 0x0B, 0x03, 0x00, 0x00, 0x00, 0x03 ^ 0x0B ^ 0x03};
+    const uint8_t stop[] = {0x03, 0x0B, 0x00, 0x00, 0x00, 0x00, 0x03 ^ 0x0B};
+    const uint8_t reset[] = {0x03, 0x0B, 0x02, 0x00, 0x00, 0x00, 0x03 ^ 0x0B ^ 0x02};
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TARE, decent()->decodeCommand(DECENT_TARE, sizeof(DECENT_TARE)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TIMER_START, decent()->decodeCommand(start, sizeof(start)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TIMER_STOP, decent()->decodeCommand(stop, sizeof(stop)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_TIMER_RESET, decent()->decodeCommand(reset, sizeof(reset)));
+}
+
+void test_decent_ignores_bad_checksum_led_short_and_foreign_messages() {
+    const uint8_t badChecksum[] = {0x03, 0x0F, 0x01, 0x00, 0x00, 0x00, 0x00};
+    const uint8_t led[] = {0x03, 0x0A, 0x01, 0x00, 0x00, 0x00, 0x03 ^ 0x0A ^ 0x01};
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, decent()->decodeCommand(badChecksum, sizeof(badChecksum)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, decent()->decodeCommand(led, sizeof(led)));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, decent()->decodeCommand(DECENT_TARE, 6));
+    TEST_ASSERT_EQUAL(IScaleCodec::COMMAND_NONE, decent()->decodeCommand(WEIGHMYBRU_TARE, sizeof(WEIGHMYBRU_TARE)));
+}
+
+// Registry lookups used by /api/bluetooth/codecs
+void test_codec_lookup_by_name() {
+    TEST_ASSERT_EQUAL_UINT8(ScaleCodecs::DECENT, ScaleCodecs::find("decent", 6));
+    TEST_ASSERT_EQUAL_UINT8(ScaleCodecs::GAGGIMATE, ScaleCodecs::find("gaggimate,decent", 9));
+    TEST_ASSERT_EQUAL_UINT8(ScaleCodecs::COUNT, ScaleCodecs::find("gaggi", 5));
+    TEST_ASSERT_EQUAL_UINT8(ScaleCodecs::COUNT, ScaleCodecs::find("", 0));
+    for (uint8_t i = 0; i < ScaleCodecs::COUNT; i++) {
+        const char* name = ScaleCodecs::get(i)->getName();
+        TEST_ASSERT_EQUAL_UINT8(i, ScaleCodecs::find(name, strlen(name)));
+    }
+    TEST_ASSERT_NULL(ScaleCodecs::get(ScaleCodecs::COUNT));
+}
+
+// Codecs sharing a service must not also share a characteristic
+void test_gatt_layout_has_no_clashes() {
+    for (uint8_t a = 0; a < ScaleCodecs::COUNT; a++) {
+        for (uint8_t b = a + 1; b < ScaleCodecs::COUNT; b++) {
+            const IScaleCodec* first = ScaleCodecs::get(a);
+            const IScaleCodec* second = ScaleCodecs::get(b);
+            if (strcmp(first->getServiceUuid(), second->getServiceUuid()) != 0) {
+                continue;
+            }
+            TEST_ASSERT_TRUE(strcmp(first->getWeightUuid(), second->getWeightUuid()) != 0);
+        }
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ported_frames_match_scale_payload);
+    RUN_TEST(test_short_buffer_is_rejected);
+    RUN_TEST(test_decent_weight_frames);
+    RUN_TEST(test_weighmybru_commands);
+    RUN_TEST(test_weighmybru_ignores_untriggered_foreign_and_short_messages);
+    RUN_TEST(test_decent_commands);
+    RUN_TEST(test_decent_ignores_bad_checksum_led_short_and_foreign_messages);
+    RUN_TEST(test_codec_lookup_by_name);
+    RUN_TEST(test_gatt_layout_has_no_clashes);
+    return UNITY_END();
+}
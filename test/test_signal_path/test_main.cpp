@@ -0,0 +1,175 @@
+// Scale + FlowRate on simulated time: a shot end to end, and trace replay reproducing it
+#include <unity.h>
+#include <vector>
+#include "Scale.h"
+#include "FlowRate.h"
+#include "SimulatedClock.h"
+#include "SimulatedLoadCell.h"
+#include "SimulatedShot.h"
+#include "SimulatedTestHelpers.h"
+#include "MemorySettingsStore.h"
+#include "TraceRecorder.h"
+#include "TraceReplay.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t SHOT_END_US = 36 * SECOND_US;
+
+// 180 g cup, then 2 g/s from 6 s to 31 s: 50 g in the cup
+static const SimulatedShot::FlowPoint SHOT_PROFILE[] = {
+    {6 * SECOND_US, 2.0f},
+    {31 * SECOND_US, 2.0f},
+    {31 * SECOND_US, 0.0f},
+};
+
+struct LivePoint {
+    uint32_t timestampUs;
+    float weight;
+    float flowRate;
+};
+
+struct Shot {
+    std::vector<LivePoint> live;
+    std::vector<uint8_t> trace;
+    float weightBeforeTare;
+    uint32_t droppedSamples;
+};
+
+// One conversion per step, like the sampling task woken per data-ready edge
+static Shot runShot(uint32_t sps, Scale::FilterMode mode, FlowRate::Profile profile) {
+    SimulatedShot source(180.0f, CUP_AT_US, SHOT_PROFILE, 3, 0.15f, XorShift32::DEFAULT_SEED);
+    SimulatedClock clock;
+    SimulatedLoadCell loadCell(clock, sps, SimulatedShot::generate, &source);
+    MemorySettingsStore settings;
+    Scale scale(loadCell, settings, clock, SimulatedShot::CALIBRATION_FACTOR);
+    FlowRate flowRate;
+    scale.setFlowRatePtr(&flowRate);
+
+    std::vector<uint8_t> buffer(64 * 1024);
+    TraceRecorder recorder;
+    recorder.setBuffer(buffer.data(), buffer.size());
+    recorder.setScale(&scale);
+    scale.setTraceRecorder(&recorder);
+
+    Shot shot;
+    TEST_ASSERT_TRUE(scale.begin());
+    scale.setFilterMode(mode);
+    scale.setFlowProfile(profile);
+
+    // Record from a clean FlowRate state so the replay starts from the same point
+    flowRate.clearFlowRateBuffer();
+    recorder.start();
+    bool tared = false;
+    while (clock.nowUs() < SHOT_END_US) {
+        clock.advanceUs(SECOND_US / sps);
+        if (!tared && clock.nowUs() >= TARE_AT_US) {
+            shot.weightBeforeTare = scale.getCurrentWeight();
+            scale.tare(10);
+            tared = true;
+        }
+        float weight = scale.getWeight();
+        shot.live.push_back(LivePoint{clock.nowUs(), weight, flowRate.getFlowRate()});
+    }
+    recorder.stop();
+    shot.droppedSamples = scale.getDroppedSamples();
+
+    shot.trace.resize(recorder.getTraceSize());
+    recorder.readTrace(shot.trace.data(), shot.trace.size(), 0);
+    return shot;
+}
+
+static float liveAt(const Shot& shot, uint32_t timestampUs, bool flow) {
+    for (const LivePoint& point : shot.live) {
+        if (point.timestampUs >= timestampUs) {
+            return flow ? point.flowRate : point.weight;
+        }
+    }
+    return flow ? shot.live.back().flowRate : shot.live.back().weight;
+}
+
+void test_shot_weighs_cup_tare_and_pour() {
+    const uint32_t rates[] = {10, 80};
+    for (uint32_t sps : rates) {
+        Shot shot = runShot(sps, Scale::FILTER_SMART, FlowRate::PROFILE_SMOOTH);
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, 180.0f, shot.weightBeforeTare);
+        TEST_ASSERT_FLOAT_WITHIN(0.3f, 0.0f, liveAt(shot, 5 * SECOND_US + SECOND_US / 2, false));
+        TEST_ASSERT_FLOAT_WITHIN(0.5f, 50.0f, shot.live.back().weight);
+        TEST_ASSERT_EQUAL_UINT32(0, shot.droppedSamples);
+    }
+}
+
+void test_flow_follows_the_pour() {
+    const uint32_t rates[] = {10, 80};
+    const Scale::FilterMode modes[] = {Scale::FILTER_SMART, Scale::FILTER_KALMAN};
+    for (uint32_t sps : rates) {
+        for (Scale::FilterMode mode : modes) {
+            Shot shot = runShot(sps, mode, FlowRate::PROFILE_SMOOTH);
+            // At 10 SPS the first second after a tare is fitted to a handful of samples
+            if (sps == 80) {
+                TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, liveAt(shot, 5 * SECOND_US + SECOND_US / 2, true));
+            }
+            for (uint32_t t = 10 * SECOND_US; t < 30 * SECOND_US; t += SECOND_US) {
+                TEST_ASSERT_FLOAT_WITHIN(0.15f, 2.0f, liveAt(shot, t, true));
+            }
+            TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, liveAt(shot, 34 * SECOND_US, true));
+        }
+    }
+}
+
+struct ReplayCheck {
+    const std::vector<LivePoint>* live;
+    size_t index;
+    size_t mismatches;
+};
+
+// Replay starts with an empty filter window while the live one was already
+// filled, so outputs may only differ until the largest window has refilled
+static const size_t REPLAY_WARMUP_SAMPLES = 64;
+
+static void compareWithLive(const ReplayPoint& point, void* context) {
+    ReplayCheck& check = *static_cast<ReplayCheck*>(context);
+    if (check.index >= REPLAY_WARMUP_SAMPLES &&
+        (check.index >= check.live->size() || (*check.live)[check.index].weight != point.weight ||
+         (*check.live)[check.index].flowRate != point.flowRate)) {
+        check.mismatches++;
+    }
+    check.index++;
+}
+
+void test_replay_reproduces_the_live_shot() {
+    const Scale::FilterMode modes[] = {Scale::FILTER_SMART, Scale::FILTER_KALMAN};
+    const FlowRate::Profile profiles[] = {FlowRate::PROFILE_FAST, FlowRate::PROFILE_SMOOTH};
+    for (Scale::FilterMode mode : modes) {
+        for (FlowRate::Profile profile : profiles) {
+            Shot shot = runShot(80, mode, profile);
+            TraceReader trace;
+            TEST_ASSERT_TRUE(trace.parse(shot.trace.data(), shot.trace.size()));
+            TEST_ASSERT_EQUAL((uint8_t)mode, trace.getHeader().filterMode);
+            TEST_ASSERT_EQUAL((uint8_t)profile, trace.getHeader().flowProfile);
+
+            TraceReplay replay(trace);
+            ReplayCheck check = {&shot.live, 0, 0};
+            uint32_t replayed = replay.run(compareWithLive, &check);
+            TEST_ASSERT_EQUAL_UINT32(shot.live.size(), replayed);
+            TEST_ASSERT_EQUAL_UINT32(0, check.mismatches);
+        }
+    }
+}
+
+void test_corrupt_trace_is_rejected() {
+    Shot shot = runShot(10, Scale::FILTER_SMART, FlowRate::PROFILE_SMOOTH);
+    TraceReader trace;
+    TEST_ASSERT_FALSE(trace.parse(shot.trace.data(), 4));
+    shot.trace[0] ^= 0xFF; // Magic
+    TEST_ASSERT_FALSE(trace.parse(shot.trace.data(), shot.trace.size()));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_shot_weighs_cup_tare_and_pour);
+    RUN_TEST(test_flow_follows_the_pour);
+    RUN_TEST(test_replay_reproduces_the_live_shot);
+    RUN_TEST(test_corrupt_trace_is_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,86 @@
+// SlidingMedian: incremental median used by the smart filter while brewing
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "SlidingMedian.h"
+#include "SimulatedTestHelpers.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Reference: sort the last 'window' values and take the upper median, like the old bubble-sort filter
+static float referenceMedian(const std::vector<float>& values, size_t window) {
+    size_t count = std::min(window, values.size());
+    std::vector<float> recent(values.end() - count, values.end());
+    std::sort(recent.begin(), recent.end());
+    return recent[count / 2];
+}
+
+static XorShift32 rng;
+static float randomGrams() {
+    return (rng.next() % 2001) / 100.0f - 10.0f; // -10..10 g in 0.01 g steps, many duplicates
+}
+
+void test_matches_sorted_window_for_every_size() {
+    const size_t windows[] = {1, 2, 3, 5, 10, 31, 64};
+    for (size_t window : windows) {
+        SlidingMedian<64> median;
+        median.rebuild(window, nullptr, 0);
+        std::vector<float> values;
+        for (int i = 0; i < 2000; i++) {
+            float value = randomGrams();
+            values.push_back(value);
+            median.push(value);
+            TEST_ASSERT_EQUAL_FLOAT(referenceMedian(values, window), median.median());
+        }
+        TEST_ASSERT_EQUAL_UINT32(window, median.size());
+    }
+}
+
+void test_reset_fills_window_with_value() {
+    SlidingMedian<16> median;
+    median.reset(5, 12.5f);
+    TEST_ASSERT_EQUAL_UINT32(5, median.size());
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, median.median());
+
+    // Two outliers out of five cannot move the median
+    median.push(100.0f);
+    median.push(-100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, median.median());
+}
+
+void test_rebuild_keeps_most_recent_values() {
+    const float history[] = {1.0f, 2.0f, 30.0f, 4.0f, 5.0f, 6.0f};
+    SlidingMedian<16> median;
+    median.rebuild(3, history, 6);
+    TEST_ASSERT_EQUAL_UINT32(3, median.size());
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, median.median());
+
+    // Growing the window pulls the older values back in
+    median.rebuild(6, history, 6);
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, median.median()); // Upper median of 1 2 4 5 6 30
+}
+
+void test_window_is_clamped_to_capacity() {
+    SlidingMedian<8> median;
+    median.reset(100, 1.0f);
+    TEST_ASSERT_EQUAL_UINT32(8, median.getWindow());
+    median.reset(0, 1.0f);
+    TEST_ASSERT_EQUAL_UINT32(1, median.getWindow());
+}
+
+void test_empty_median_is_zero() {
+    SlidingMedian<8> median;
+    median.rebuild(4, nullptr, 0);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, median.median());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_sorted_window_for_every_size);
+    RUN_TEST(test_reset_fills_window_with_value);
+    RUN_TEST(test_rebuild_keeps_most_recent_values);
+    RUN_TEST(test_window_is_clamped_to_capacity);
+    RUN_TEST(test_empty_median_is_zero);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// SlopeWindow: running-sum least squares used by FlowRate
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "SlopeWindow.h"
+#include "SimulatedTestHelpers.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Sample {
+    uint32_t timestampUs;
+    float value;
+};
+
+// Reference: fit the kept samples from scratch in double precision
+static double referenceSlope(const std::vector<Sample>& samples) {
+    if (samples.size() < 2) {
+        return 0.0;
+    }
+    double n = samples.size(), sumT = 0, sumV = 0, sumTT = 0, sumTV = 0;
+    for (const Sample& sample : samples) {
+        double t = (uint32_t)(sample.timestampUs - samples.front().timestampUs) / 1e6;
+        sumT += t;
+        sumV += sample.value;
+        sumTT += t * t;
+        sumTV += t * sample.value;
+    }
+    return (n * sumTV - sumT * sumV) / (n * sumTT - sumT * sumT);
+}
+
+// Same eviction rule as SlopeWindow: capacity first, then everything older than the window
+static void referencePush(std::vector<Sample>& samples, Sample sample, size_t capacity, uint32_t windowUs) {
+    if (samples.size() == capacity) {
+        samples.erase(samples.begin());
+    }
+    samples.push_back(sample);
+    while (samples.size() > 1 && (uint32_t)(sample.timestampUs - samples.front().timestampUs) > windowUs) {
+        samples.erase(samples.begin());
+    }
+}
+
+static XorShift32 rng;
+
+void test_matches_brute_force_fit() {
+    const uint32_t windows[] = {250000, 750000, 2000000, 5000000};
+    for (uint32_t windowUs : windows) {
+        SlopeWindow<256> window;
+        window.setWindowUs(windowUs);
+        std::vector<Sample> reference;
+        uint32_t t = 1000;
+        float grams = 0.0f;
+        for (int i = 0; i < 5000; i++) {
+            t += 10000 + rng.next() % 5000;                      // ~80 SPS with jitter
+            grams += (rng.next() % 1000) / 10000.0f - 0.02f;     // Wandering pour
+            float value = grams + ((rng.next() % 300) / 1000.0f - 0.15f);
+            window.push(t, value);
+            referencePush(reference, Sample{t, value}, 256, windowUs);
+            TEST_ASSERT_EQUAL_UINT32(reference.size(), window.size());
+            double expected = referenceSlope(reference);
+            TEST_ASSERT_FLOAT_WITHIN(1e-3 + 1e-4 * fabs(expected), expected, window.slopePerSecond());
+        }
+    }
+}
+
+void test_window_evicts_by_time() {
+    SlopeWindow<64> window;
+    window.setWindowUs(1000000);
+    for (uint32_t i = 0; i <= 30; i++) {
+        window.push(i * 100000, i * 0.2f); // 2 g/s
+    }
+    TEST_ASSERT_EQUAL_UINT32(11, window.size()); // Newest minus oldest may equal the window
+    TEST_ASSERT_EQUAL_UINT32(1000000, window.spanUs());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f, window.slopePerSecond());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 6.0f, window.fittedValue());
+}
+
+void test_capacity_bounds_a_long_window() {
+    SlopeWindow<16> window;
+    window.setWindowUs(10000000);
+    for (uint32_t i = 0; i < 100; i++) {
+        window.push(i * 100000, i * 0.1f);
+    }
+    TEST_ASSERT_EQUAL_UINT32(16, window.size());
+    TEST_ASSERT_EQUAL_UINT32(1500000, window.spanUs());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, window.slopePerSecond());
+}
+
+void test_timestamp_wrap() {
+    SlopeWindow<64> window;
+    window.setWindowUs(2000000);
+    uint32_t start = 0xFFFFFFFFu - 1000000; // micros() wraps after ~71.6 minutes
+    for (uint32_t i = 0; i < 40; i++) {
+        window.push(start + i * 100000, 36.0f + i * 0.15f); // 1.5 g/s across the wrap
+        if (i >= 1) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.5f, window.slopePerSecond());
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(21, window.size());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 36.0f + 39 * 0.15f, window.fittedValue());
+}
+
+void test_long_run_stays_precise_across_rebases() {
+    SlopeWindow<256> window;
+    window.setWindowUs(2000000);
+    const uint32_t stepUs = 12500;
+    for (uint32_t i = 0; i < 80 * 60 * 10; i++) { // Ten minutes at 80 SPS, several rebases
+        uint32_t t = 5000 + i * stepUs;
+        window.push(t, 1000.0f + 2.0f * (t / 1e6f));
+    }
+    // Float timestamps would have lost the slope long ago; the rebased double sums must not
+    TEST_ASSERT_FLOAT_WITHIN(2e-3f, 2.0f, window.slopePerSecond());
+}
+
+void test_degenerate_inputs_read_zero() {
+    SlopeWindow<8> window;
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, window.slopePerSecond());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, window.fittedValue());
+    window.push(1000, 5.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, window.slopePerSecond());
+    TEST_ASSERT_EQUAL_UINT32(0, window.spanUs());
+    window.push(1000, 7.0f); // Same timestamp - no time spread to fit
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, window.slopePerSecond());
+
+    window.clear();
+    TEST_ASSERT_EQUAL_UINT32(0, window.size());
+    window.setWindowUs(0); // Clamped to 1 us rather than dividing the window by zero
+    TEST_ASSERT_EQUAL_UINT32(1, window.getWindowUs());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_brute_force_fit);
+    RUN_TEST(test_window_evicts_by_time);
+    RUN_TEST(test_capacity_bounds_a_long_window);
+    RUN_TEST(test_timestamp_wrap);
+    RUN_TEST(test_long_run_stays_precise_across_rebases);
+    RUN_TEST(test_degenerate_inputs_read_zero);
+    return UNITY_END();
+}
@@ -0,0 +1,283 @@
+// ScalePayload::encodeWeightBatch: frames for the batched weight characteristic
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "ScalePayload.h"
+#include "Scale.h"
+#include "SimulatedClock.h"
+#include "SimulatedLoadCell.h"
+#include "MemorySettingsStore.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct DecodedFrame {
+    uint8_t flags;
+    float flowRate;
+    std::vector<BatchSample> samples;
+};
+
+static uint32_t readLE(const uint8_t* data, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint32_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+// Client-side decoder written from the frame layout in ScalePayload.h
+static bool decode(const uint8_t* frame, size_t length, DecodedFrame& decoded) {
+    if (length < ScalePayload::BATCH_OVERHEAD || frame[0] != ScalePayload::PRODUCT_NUMBER ||
+        frame[1] != static_cast<uint8_t>(WeighMyBruMessageType::WEIGHT_BATCH) ||
+        length != ScalePayload::BATCH_OVERHEAD + frame[2] * ScalePayload::BATCH_SAMPLE_LENGTH ||
+        ScalePayload::checksum(frame, length - 1) != frame[length - 1]) {
+        return false;
+    }
+    decoded.flags = frame[3];
+    decoded.flowRate = (int16_t)readLE(frame + 12, 2) / 100.0f;
+    decoded.samples.clear();
+    uint32_t sequence = readLE(frame + 4, 4);
+    uint32_t timestampUs = readLE(frame + 8, 4);
+    const uint8_t* cursor = frame + ScalePayload::BATCH_HEADER_LENGTH;
+    for (size_t i = 0; i < frame[2]; i++, cursor += ScalePayload::BATCH_SAMPLE_LENGTH) {
+        sequence += cursor[0];
+        timestampUs += readLE(cursor + 1, 2);
+        int32_t weight = (int32_t)(readLE(cursor + 3, 3) << 8) >> 8; // Sign-extend int24
+        decoded.samples.push_back(BatchSample{sequence, timestampUs, weight / 100.0f});
+    }
+    return true;
+}
+
+// 80 SPS conversions starting at the given sequence and time
+static std::vector<BatchSample> makeSamples(size_t count, uint32_t sequence, uint32_t timestampUs) {
+    std::vector<BatchSample> samples;
+    for (size_t i = 0; i < count; i++) {
+        samples.push_back(BatchSample{sequence + (uint32_t)i, timestampUs + (uint32_t)i * 12500,
+                                      36.0f + i * 0.25f});
+    }
+    return samples;
+}
+
+// Frames the way BluetoothScale::sendBatch() does for one client
+static std::vector<std::vector<uint8_t>> frameAll(const std::vector<BatchSample>& samples, size_t capacity) {
+    std::vector<std::vector<uint8_t>> frames;
+    uint8_t frame[512];
+    size_t offset = 0;
+    while (offset < samples.size()) {
+        size_t consumed;
+        size_t length = ScalePayload::encodeWeightBatch(samples.data() + offset, samples.size() - offset, 1.5f,
+                                                        false, frame, capacity, consumed);
+        TEST_ASSERT_TRUE(length > 0);
+        TEST_ASSERT_TRUE(length <= capacity);
+        frames.push_back(std::vector<uint8_t>(frame, frame + length));
+        offset += consumed;
+    }
+    return frames;
+}
+
+static void assertSameSamples(const BatchSample& expected, const BatchSample& actual) {
+    TEST_ASSERT_EQUAL_UINT32(expected.sequence, actual.sequence);
+    TEST_ASSERT_EQUAL_UINT32(expected.timestampUs, actual.timestampUs);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected.weight, actual.weight);
+}
+
+void test_frame_round_trips() {
+    std::vector<BatchSample> samples = makeSamples(8, 812, 5000000);
+    samples[3].weight = -0.42f;
+    uint8_t frame[244];
+    size_t consumed;
+    size_t length = ScalePayload::encodeWeightBatch(samples.data(), samples.size(), -2.37f, true, frame,
+                                                    sizeof(frame), consumed);
+    TEST_ASSERT_EQUAL_UINT32(8, consumed);
+    TEST_ASSERT_EQUAL_UINT32(ScalePayload::BATCH_OVERHEAD + 8 * ScalePayload::BATCH_SAMPLE_LENGTH, length);
+
+    DecodedFrame decoded;
+    TEST_ASSERT_TRUE(decode(frame, length, decoded));
+    TEST_ASSERT_EQUAL_HEX8(ScalePayload::BATCH_FLAG_TARING, decoded.flags);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -2.37f, decoded.flowRate);
+    TEST_ASSERT_EQUAL_UINT32(8, decoded.samples.size());
+    for (size_t i = 0; i < samples.size(); i++) {
+        assertSameSamples(samples[i], decoded.samples[i]);
+    }
+}
+
+void test_checksum_catches_a_flipped_byte() {
+    std::vector<BatchSample> samples = makeSamples(4, 1, 0);
+    uint8_t frame[64];
+    size_t consumed;
+    size_t length = ScalePayload::encodeWeightBatch(samples.data(), samples.size(), 0.0f, false, frame,
+                                                    sizeof(frame), consumed);
+    DecodedFrame decoded;
+    TEST_ASSERT_TRUE(decode(frame, length, decoded));
+    for (size_t i = 0; i < length; i++) {
+        frame[i] ^= 0x10;
+        TEST_ASSERT_FALSE(decode(frame, length, decoded));
+        frame[i] ^= 0x10;
+    }
+}
+
+void test_mtu_limits_samples_per_frame() {
+    std::vector<BatchSample> samples = makeSamples(40, 100, 0);
+    uint8_t frame[512];
+    size_t consumed;
+
+    // Default 23-byte MTU: 20 bytes of payload cannot carry the header and one sample
+    TEST_ASSERT_EQUAL_UINT32(0, ScalePayload::batchCapacity(20));
+    TEST_ASSERT_EQUAL_UINT32(0, ScalePayload::encodeWeightBatch(samples.data(), samples.size(), 0.0f, false,
+                                                                frame, 20, consumed));
+    TEST_ASSERT_EQUAL_UINT32(0, consumed);
+
+    // Exactly one sample
+    size_t length = ScalePayload::encodeWeightBatch(samples.data(), samples.size(), 0.0f, false, frame,
+                                                    ScalePayload::BATCH_OVERHEAD + ScalePayload::BATCH_SAMPLE_LENGTH,
+                                                    consumed);
+    TEST_ASSERT_EQUAL_UINT32(1, consumed);
+    TEST_ASSERT_EQUAL_UINT32(ScalePayload::BATCH_OVERHEAD + ScalePayload::BATCH_SAMPLE_LENGTH, length);
+
+    // 247-byte MTU (244 payload) and a mid-size one: frames fill up and cover every sample in order
+    const size_t capacities[] = {244, 100};
+    for (size_t capacity : capacities) {
+        std::vector<std::vector<uint8_t>> frames = frameAll(samples, capacity);
+        std::vector<BatchSample> received;
+        for (const std::vector<uint8_t>& bytes : frames) {
+            DecodedFrame decoded;
+            TEST_ASSERT_TRUE(decode(bytes.data(), bytes.size(), decoded));
+            TEST_ASSERT_TRUE(decoded.samples.size() <= ScalePayload::batchCapacity(capacity));
+            received.insert(received.end(), decoded.samples.begin(), decoded.samples.end());
+        }
+        TEST_ASSERT_EQUAL_UINT32((samples.size() + ScalePayload::batchCapacity(capacity) - 1) /
+                                     ScalePayload::batchCapacity(capacity),
+                                 frames.size());
+        TEST_ASSERT_EQUAL_UINT32(samples.size(), received.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            assertSameSamples(samples[i], received[i]);
+        }
+    }
+}
+
+void test_count_field_caps_at_255() {
+    std::vector<BatchSample> samples = makeSamples(300, 0, 0);
+    std::vector<uint8_t> frame(ScalePayload::BATCH_OVERHEAD + 300 * ScalePayload::BATCH_SAMPLE_LENGTH);
+    size_t consumed;
+    size_t length = ScalePayload::encodeWeightBatch(samples.data(), samples.size(), 0.0f, false, frame.data(),
+                                                    frame.size(), consumed);
+    TEST_ASSERT_EQUAL_UINT32(255, consumed);
+    TEST_ASSERT_EQUAL_UINT32(ScalePayload::BATCH_OVERHEAD + 255 * ScalePayload::BATCH_SAMPLE_LENGTH, length);
+}
+
+// Deltas that overflow their field end the frame; the next one restarts from absolute values
+void test_gap_starts_a_new_frame() {
+    std::vector<BatchSample> samples = makeSamples(10, 500, 1000000);
+    for (size_t i = 4; i < samples.size(); i++) {
+        samples[i].sequence += 300; // Dropped conversions: sequence delta over 255
+    }
+    for (size_t i = 7; i < samples.size(); i++) {
+        samples[i].timestampUs += 70000; // Stalled sampling: more than 65535 us apart
+    }
+
+    std::vector<std::vector<uint8_t>> frames = frameAll(samples, 244);
+    TEST_ASSERT_EQUAL_UINT32(3, frames.size());
+    const size_t frameSizes[] = {4, 3, 3};
+    size_t index = 0;
+    for (size_t f = 0; f < frames.size(); f++) {
+        DecodedFrame decoded;
+        TEST_ASSERT_TRUE(decode(frames[f].data(), frames[f].size(), decoded));
+        TEST_ASSERT_EQUAL_UINT32(frameSizes[f], decoded.samples.size());
+        for (const BatchSample& sample : decoded.samples) {
+            assertSameSamples(samples[index++], sample);
+        }
+    }
+}
+
+void test_counters_wrap_inside_a_frame() {
+    std::vector<BatchSample> samples = makeSamples(6, 0xFFFFFFFEu, 0xFFFFFFFFu - 20000);
+    uint8_t frame[128];
+    size_t consumed;
+    size_t length = ScalePayload::encodeWeightBatch(samples.data(), samples.size(), 0.0f, false, frame,
+                                                    sizeof(frame), consumed);
+    TEST_ASSERT_EQUAL_UINT32(6, consumed);
+    DecodedFrame decoded;
+    TEST_ASSERT_TRUE(decode(frame, length, decoded));
+    for (size_t i = 0; i < samples.size(); i++) {
+        assertSameSamples(samples[i], decoded.samples[i]);
+    }
+}
+
+void test_out_of_range_values_clamp() {
+    BatchSample samples[] = {{1, 0, 90000.0f}, {2, 12500, -90000.0f}};
+    uint8_t frame[64];
+    size_t consumed;
+    size_t length = ScalePayload::encodeWeightBatch(samples, 2, 400.0f, false, frame, sizeof(frame), consumed);
+    DecodedFrame decoded;
+    TEST_ASSERT_TRUE(decode(frame, length, decoded));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0x7FFFFF / 100.0f, decoded.samples[0].weight);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -0x800000 / 100.0f, decoded.samples[1].weight);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, INT16_MAX / 100.0f, decoded.flowRate);
+}
+
+// Slow pour: 1 g/s on top of 100 g
+static int32_t pour(uint32_t timestampUs, void* context) {
+    return (int32_t)((100.0f + timestampUs / 1000000.0f) * 1000.0f);
+}
+
+struct DrainedSamples {
+    Scale* scale;
+    std::vector<BatchSample> samples;
+};
+
+// What SamplingTask::onSample() queues for the batch, one entry per conversion
+static void collectSample(void* context, const RawSample& sample) {
+    DrainedSamples* drained = static_cast<DrainedSamples*>(context);
+    drained->samples.push_back(BatchSample{(uint32_t)drained->samples.size() + 1, sample.timestampUs,
+                                           drained->scale->getCurrentWeight()});
+}
+
+// The sampling task often wakes to several conversions: each must reach the batch with its own timestamp
+void test_every_drained_sample_is_batched() {
+    const uint32_t SPS = 80;
+    const uint32_t TICK_US = 100000; // 8 conversions per drain
+    SimulatedClock clock;
+    SimulatedLoadCell loadCell(clock, SPS, pour);
+    MemorySettingsStore settings;
+    Scale scale(loadCell, settings, clock, 1000.0f);
+    TEST_ASSERT_TRUE(scale.begin(false));
+
+    DrainedSamples drained;
+    drained.scale = &scale;
+    scale.setSampleCallback(collectSample, &drained);
+    uint32_t capturedBefore = scale.getCapturedSamples();
+    for (int tick = 0; tick < 30; tick++) {
+        clock.advanceUs(TICK_US);
+        scale.getWeight();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(30 * TICK_US * SPS / 1000000, drained.samples.size());
+    TEST_ASSERT_EQUAL_UINT32(scale.getCapturedSamples() - capturedBefore, drained.samples.size());
+    for (size_t i = 1; i < drained.samples.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(1000000 / SPS, drained.samples[i].timestampUs - drained.samples[i - 1].timestampUs);
+    }
+
+    std::vector<BatchSample> received;
+    for (const std::vector<uint8_t>& bytes : frameAll(drained.samples, 244)) {
+        DecodedFrame decoded;
+        TEST_ASSERT_TRUE(decode(bytes.data(), bytes.size(), decoded));
+        received.insert(received.end(), decoded.samples.begin(), decoded.samples.end());
+    }
+    TEST_ASSERT_EQUAL_UINT32(drained.samples.size(), received.size());
+    for (size_t i = 0; i < received.size(); i++) {
+        assertSameSamples(drained.samples[i], received[i]);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_round_trips);
+    RUN_TEST(test_checksum_catches_a_flipped_byte);
+    RUN_TEST(test_mtu_limits_samples_per_frame);
+    RUN_TEST(test_count_field_caps_at_255);
+    RUN_TEST(test_gap_starts_a_new_frame);
+    RUN_TEST(test_counters_wrap_inside_a_frame);
+    RUN_TEST(test_out_of_range_values_clamp);
+    RUN_TEST(test_every_drained_sample_is_batched);
+    return UNITY_END();
+}
@@ -0,0 +1,302 @@
+// WeightFlowKalman: the filter on its own, then the Kalman mode's defaults replayed
+// against the default pipeline (smart filter + smooth least-squares flow) on recorded shots
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+#include <vector>
+#include "WeightFlowKalman.h"
+#include "Scale.h"
+#include "FlowRate.h"
+#include "SimulatedClock.h"
+#include "SimulatedLoadCell.h"
+#include "SimulatedShot.h"
+#include "SimulatedTestHelpers.h"
+#include "MemorySettingsStore.h"
+#include "TraceRecorder.h"
+#include "TraceReplay.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t SHOT_END_US = 40 * SECOND_US;
+
+// 2 g/s switched on at 6 s and off at 31 s - worst case for lag
+static const SimulatedShot::FlowPoint STEP_SHOT[] = {
+    {6 * SECOND_US, 2.0f},
+    {31 * SECOND_US, 2.0f},
+    {31 * SECOND_US, 0.0f},
+};
+
+// Preinfusion drip, ramp to peak, declining pour, cut off
+static const SimulatedShot::FlowPoint ESPRESSO_SHOT[] = {
+    {6 * SECOND_US, 0.4f},
+    {12 * SECOND_US, 0.4f},
+    {15 * SECOND_US, 2.2f},
+    {34 * SECOND_US, 1.5f},
+    {34 * SECOND_US, 0.0f},
+};
+
+static const uint32_t RATES[] = {10, 80};        // SPS: HX711 RATE pin low / high
+static const float NOISES[] = {0.05f, 0.15f, 0.4f}; // +-g per sample
+
+// Noise-free weight fed straight into the filter
+static void feed(WeightFlowKalman& kalman, float gramsPerSec, float startGrams, uint32_t fromUs, uint32_t toUs,
+                 uint32_t stepUs, SimulatedShot* noise = nullptr) {
+    for (uint32_t t = fromUs; t <= toUs; t += stepUs) {
+        float grams = startGrams + gramsPerSec * (t - fromUs) / 1e6f;
+        kalman.update(noise != nullptr ? grams + noise->noise() : grams, t);
+    }
+}
+
+void test_first_sample_initializes() {
+    WeightFlowKalman kalman;
+    TEST_ASSERT_FALSE(kalman.isInitialized());
+    kalman.update(36.0f, 1000);
+    TEST_ASSERT_TRUE(kalman.isInitialized());
+    TEST_ASSERT_EQUAL_FLOAT(36.0f, kalman.getWeight());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, kalman.getFlowRate());
+}
+
+// Five minutes at rest: a false switch to the fast estimate would show as a flow jump
+void test_still_scale_reads_no_flow() {
+    struct Case {
+        float noiseGrams;
+        float measurementNoise;
+    };
+    // Default r, and a noisy load cell with r raised to match (uniform +-a has variance a^2/3)
+    const Case cases[] = {{0.15f, WeightFlowKalman::DEFAULT_MEASUREMENT_NOISE}, {0.6f, 0.12f}};
+    const uint32_t steps[] = {12500, 100000};
+    for (const Case& c : cases) {
+        for (uint32_t stepUs : steps) {
+            WeightFlowKalman kalman;
+            kalman.setMeasurementNoise(c.measurementNoise);
+            SimulatedShot noise(0.0f, 0, nullptr, 0, c.noiseGrams, XorShift32::DEFAULT_SEED);
+            feed(kalman, 0.0f, 36.0f, 0, 5 * SECOND_US, stepUs, &noise);
+            for (uint32_t t = 5 * SECOND_US + stepUs; t < 300 * SECOND_US; t += stepUs) {
+                kalman.update(36.0f + noise.noise(), t);
+                TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, kalman.getFlowRate());
+                TEST_ASSERT_FLOAT_WITHIN(0.3f, 36.0f, kalman.getWeight());
+            }
+        }
+    }
+}
+
+void test_constant_pour_converges_to_its_rate() {
+    const uint32_t steps[] = {12500, 100000};
+    for (uint32_t stepUs : steps) {
+        WeightFlowKalman kalman;
+        feed(kalman, 1.5f, 0.0f, 0, 8 * SECOND_US, stepUs);
+        TEST_ASSERT_FLOAT_WITHIN(0.02f, 1.5f, kalman.getFlowRate());
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, 12.0f, kalman.getWeight());
+    }
+}
+
+void test_flow_change_switches_to_fast_estimate() {
+    WeightFlowKalman kalman;
+    feed(kalman, 0.0f, 0.0f, 0, 5 * SECOND_US, 100000);
+    feed(kalman, 2.0f, 0.0f, 5 * SECOND_US + 100000, 7 * SECOND_US, 100000);
+    // The steady estimate alone would still be far below 2 g/s two seconds in
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 2.0f, kalman.getFlowRate());
+}
+
+void test_step_over_threshold_resets() {
+    WeightFlowKalman kalman;
+    feed(kalman, 1.0f, 0.0f, 0, 5 * SECOND_US, 100000);
+    kalman.update(185.0f, 5 * SECOND_US + 100000); // Cup placed
+    TEST_ASSERT_EQUAL_FLOAT(185.0f, kalman.getWeight());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, kalman.getFlowRate());
+}
+
+void test_gap_in_samples_resets() {
+    WeightFlowKalman kalman;
+    feed(kalman, 1.0f, 0.0f, 0, 5 * SECOND_US, 100000);
+    kalman.update(7.0f, 7 * SECOND_US); // 2 s without samples
+    TEST_ASSERT_EQUAL_FLOAT(7.0f, kalman.getWeight());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, kalman.getFlowRate());
+}
+
+void test_timestamp_wrap_is_not_a_gap() {
+    WeightFlowKalman kalman;
+    uint32_t start = 0xFFFFFFFFu - 3 * SECOND_US;
+    for (uint32_t i = 0; i <= 60; i++) {
+        kalman.update(1.0f * i * 0.1f, start + i * 100000); // Wraps at ~3 s
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f, kalman.getFlowRate());
+}
+
+// Record a simulated shot through the real Scale the way /api/trace would capture it
+static std::vector<uint8_t> recordShot(const SimulatedShot::FlowPoint* profile, size_t points, uint32_t sps,
+                                       float noiseGrams) {
+    SimulatedShot shot(180.0f, CUP_AT_US, profile, points, noiseGrams, XorShift32::DEFAULT_SEED);
+    SimulatedClock clock;
+    SimulatedLoadCell loadCell(clock, sps, SimulatedShot::generate, &shot);
+    MemorySettingsStore settings;
+    Scale scale(loadCell, settings, clock, SimulatedShot::CALIBRATION_FACTOR);
+    FlowRate flowRate;
+    scale.setFlowRatePtr(&flowRate);
+
+    std::vector<uint8_t> buffer(64 * 1024);
+    TraceRecorder recorder;
+    recorder.setBuffer(buffer.data(), buffer.size());
+    recorder.setScale(&scale);
+    scale.setTraceRecorder(&recorder);
+
+    TEST_ASSERT_TRUE(scale.begin());
+    flowRate.clearFlowRateBuffer();
+    recorder.start();
+    bool tared = false;
+    while (clock.nowUs() < SHOT_END_US) {
+        clock.advanceUs(SECOND_US / sps);
+        if (!tared && clock.nowUs() >= TARE_AT_US) {
+            scale.tare(10);
+            tared = true;
+        }
+        scale.getWeight();
+    }
+    recorder.stop();
+
+    std::vector<uint8_t> trace(recorder.getTraceSize());
+    recorder.readTrace(trace.data(), trace.size(), 0);
+    return trace;
+}
+
+static void collect(const ReplayPoint& point, void* context) {
+    static_cast<std::vector<ReplayPoint>*>(context)->push_back(point);
+}
+
+// kalman = false: the defaults a new device runs with (smart filter, smooth flow)
+static std::vector<ReplayPoint> replay(const std::vector<uint8_t>& trace, bool kalman) {
+    TraceReader reader;
+    TEST_ASSERT_TRUE(reader.parse(trace.data(), trace.size()));
+    TraceReplay replay(reader);
+    MemorySettingsStore& settings = replay.getSettings();
+    settings.begin("scale", false);
+    settings.putUChar("filter_mode", kalman ? Scale::FILTER_KALMAN : Scale::FILTER_SMART);
+    settings.putFloat("kf_q", WeightFlowKalman::DEFAULT_PROCESS_NOISE);
+    settings.putFloat("kf_r", WeightFlowKalman::DEFAULT_MEASUREMENT_NOISE);
+    settings.putUChar("flow_profile", FlowRate::PROFILE_SMOOTH);
+    settings.end();
+
+    std::vector<ReplayPoint> points;
+    replay.run(collect, &points);
+    return points;
+}
+
+// Spread of the flow reading around its mean between fromUs and toUs
+static float flowDeviation(const std::vector<ReplayPoint>& points, uint32_t fromUs, uint32_t toUs) {
+    double sum = 0.0, sumSquares = 0.0;
+    size_t count = 0;
+    for (const ReplayPoint& point : points) {
+        if (point.timestampUs >= fromUs && point.timestampUs < toUs) {
+            sum += point.flowRate;
+            sumSquares += (double)point.flowRate * point.flowRate;
+            count++;
+        }
+    }
+    double mean = sum / count;
+    return (float)sqrt(sumSquares / count - mean * mean);
+}
+
+// RMS difference from the poured flow between fromUs and toUs
+static float flowError(const std::vector<ReplayPoint>& points, const SimulatedShot& shot, uint32_t fromUs,
+                       uint32_t toUs) {
+    double sumSquares = 0.0;
+    size_t count = 0;
+    for (const ReplayPoint& point : points) {
+        if (point.timestampUs >= fromUs && point.timestampUs < toUs) {
+            double error = point.flowRate - shot.flowAt(point.timestampUs);
+            sumSquares += error * error;
+            count++;
+        }
+    }
+    return (float)sqrt(sumSquares / count);
+}
+
+// Seconds from fromUs until the flow reading first crosses threshold (rising or falling)
+static float crossingSeconds(const std::vector<ReplayPoint>& points, uint32_t fromUs, float threshold, bool rising) {
+    for (const ReplayPoint& point : points) {
+        if (point.timestampUs >= fromUs &&
+            (rising ? point.flowRate >= threshold : point.flowRate <= threshold)) {
+            return (point.timestampUs - fromUs) / 1e6f;
+        }
+    }
+    return 1e9f;
+}
+
+void test_kalman_is_steadier_during_a_constant_pour() {
+    for (uint32_t sps : RATES) {
+        for (float noise : NOISES) {
+            std::vector<uint8_t> trace = recordShot(STEP_SHOT, 3, sps, noise);
+            float smooth = flowDeviation(replay(trace, false), 12 * SECOND_US, 29 * SECOND_US);
+            float kalman = flowDeviation(replay(trace, true), 12 * SECOND_US, 29 * SECOND_US);
+            printf("  steady pour %2u SPS +-%.2fg: flow sd smooth %.4f, kalman %.4f g/s\n", (unsigned)sps, noise,
+                   smooth, kalman);
+            TEST_ASSERT_LESS_THAN_FLOAT(smooth, kalman);
+        }
+    }
+}
+
+void test_kalman_follows_pour_start_and_stop_no_slower() {
+    for (uint32_t sps : RATES) {
+        std::vector<uint8_t> trace = recordShot(STEP_SHOT, 3, sps, 0.15f);
+        std::vector<ReplayPoint> smooth = replay(trace, false);
+        std::vector<ReplayPoint> kalman = replay(trace, true);
+        float smoothRise = crossingSeconds(smooth, 6 * SECOND_US, 1.8f, true);
+        float kalmanRise = crossingSeconds(kalman, 6 * SECOND_US, 1.8f, true);
+        float smoothFall = crossingSeconds(smooth, 31 * SECOND_US, 0.2f, false);
+        float kalmanFall = crossingSeconds(kalman, 31 * SECOND_US, 0.2f, false);
+        printf("  step %2u SPS: rise smooth %.2f kalman %.2f s, fall smooth %.2f kalman %.2f s\n", (unsigned)sps,
+               smoothRise, kalmanRise, smoothFall, kalmanFall);
+        TEST_ASSERT_TRUE(kalmanRise <= smoothRise);
+        TEST_ASSERT_TRUE(kalmanFall <= smoothFall);
+    }
+}
+
+void test_kalman_tracks_shot_profiles_more_closely() {
+    struct Profile {
+        const SimulatedShot::FlowPoint* points;
+        size_t count;
+        const char* name;
+    };
+    const Profile profiles[] = {{STEP_SHOT, 3, "step"}, {ESPRESSO_SHOT, 5, "espresso"}};
+    for (const Profile& profile : profiles) {
+        for (uint32_t sps : RATES) {
+            for (float noise : NOISES) {
+                std::vector<uint8_t> trace = recordShot(profile.points, profile.count, sps, noise);
+                SimulatedShot shot(180.0f, CUP_AT_US, profile.points, profile.count, noise, 1);
+                float smooth = flowError(replay(trace, false), shot, 5 * SECOND_US, SHOT_END_US);
+                float kalman = flowError(replay(trace, true), shot, 5 * SECOND_US, SHOT_END_US);
+                printf("  %-8s %2u SPS +-%.2fg: flow RMS error smooth %.3f, kalman %.3f g/s\n", profile.name,
+                       (unsigned)sps, noise, smooth, kalman);
+                TEST_ASSERT_LESS_THAN_FLOAT(smooth, kalman);
+            }
+        }
+    }
+}
+
+void test_kalman_reads_no_flow_after_the_shot() {
+    for (uint32_t sps : RATES) {
+        std::vector<uint8_t> trace = recordShot(STEP_SHOT, 3, sps, 0.15f);
+        for (const ReplayPoint& point : replay(trace, true)) {
+            if (point.timestampUs >= 33 * SECOND_US) {
+                TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, point.flowRate);
+            }
+        }
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sample_initializes);
+    RUN_TEST(test_still_scale_reads_no_flow);
+    RUN_TEST(test_constant_pour_converges_to_its_rate);
+    RUN_TEST(test_flow_change_switches_to_fast_estimate);
+    RUN_TEST(test_step_over_threshold_resets);
+    RUN_TEST(test_gap_in_samples_resets);
+    RUN_TEST(test_timestamp_wrap_is_not_a_gap);
+    RUN_TEST(test_kalman_is_steadier_during_a_constant_pour);
+    RUN_TEST(test_kalman_follows_pour_start_and_stop_no_slower);
+    RUN_TEST(test_kalman_tracks_shot_profiles_more_closely);
+    RUN_TEST(test_kalman_reads_no_flow_after_the_shot);
+    return UNITY_END();
+}